@@ -0,0 +1,111 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Compares the default and the work-stealing CPU thread pools of the
+// async_scheduling net on a wide DAG of small operators: `width` independent
+// chains of `depth` Scale ops each, joined by a final Sum.
+
+#include <cstdio>
+
+#include "caffe2/core/init.h"
+#include "caffe2/core/logging.h"
+#include "caffe2/core/net.h"
+#include "caffe2/core/timer.h"
+#include "caffe2/core/workspace.h"
+
+CAFFE2_DEFINE_int(width, 64, "Number of parallel chains in the net.");
+CAFFE2_DEFINE_int(depth, 8, "Number of ops in each chain.");
+CAFFE2_DEFINE_int(tensor_size, 256, "Number of floats in each tensor.");
+CAFFE2_DEFINE_int(warmup, 10, "Number of warmup runs.");
+CAFFE2_DEFINE_int(iter, 100, "Number of measured runs.");
+
+CAFFE2_DECLARE_bool(caffe2_net_async_work_stealing);
+
+namespace caffe2 {
+
+NetDef CreateWideNet() {
+  NetDef net;
+  net.set_name("wide");
+  net.set_type("async_scheduling");
+  net.add_external_input("x");
+  vector<string> chain_outputs;
+  for (int w = 0; w < FLAGS_width; ++w) {
+    string prev = "x";
+    for (int d = 0; d < FLAGS_depth; ++d) {
+      string out = "y_" + caffe2::to_string(w) + "_" + caffe2::to_string(d);
+      auto* op = net.add_op();
+      op->set_type("Scale");
+      op->add_input(prev);
+      op->add_output(out);
+      auto* arg = op->add_arg();
+      arg->set_name("scale");
+      arg->set_f(1.0001);
+      prev = out;
+    }
+    chain_outputs.push_back(prev);
+  }
+  auto* sum = net.add_op();
+  sum->set_type("Sum");
+  for (const auto& input : chain_outputs) {
+    sum->add_input(input);
+  }
+  sum->add_output("out");
+  net.add_external_output("out");
+  return net;
+}
+
+double BenchmarkPool(bool work_stealing) {
+  FLAGS_caffe2_net_async_work_stealing = work_stealing;
+  Workspace ws;
+  auto* x = ws.CreateBlob("x")->GetMutable<TensorCPU>();
+  x->Resize(FLAGS_tensor_size);
+  float* data = x->mutable_data<float>();
+  for (int i = 0; i < FLAGS_tensor_size; ++i) {
+    data[i] = 1.0;
+  }
+  // The net owns the shared CPU pool, so a fresh pool of the requested type
+  // is created for every benchmark.
+  NetBase* net = ws.CreateNet(CreateWideNet());
+  CAFFE_ENFORCE(net);
+  for (int i = 0; i < FLAGS_warmup; ++i) {
+    CAFFE_ENFORCE(net->Run());
+  }
+  Timer timer;
+  for (int i = 0; i < FLAGS_iter; ++i) {
+    CAFFE_ENFORCE(net->Run());
+  }
+  double ms = timer.MilliSeconds() / FLAGS_iter;
+  ws.DeleteNet("wide");
+  return ms;
+}
+
+} // namespace caffe2
+
+int main(int argc, char** argv) {
+  caffe2::GlobalInit(&argc, &argv);
+  const double default_ms = caffe2::BenchmarkPool(false);
+  const double stealing_ms = caffe2::BenchmarkPool(true);
+  printf(
+      "Wide net (%d x %d ops, %d floats): default pool %.4f ms/run, "
+      "work-stealing pool %.4f ms/run, speedup %.2fx\n",
+      caffe2::FLAGS_width,
+      caffe2::FLAGS_depth,
+      caffe2::FLAGS_tensor_size,
+      default_ms,
+      stealing_ms,
+      default_ms / stealing_ms);
+  return 0;
+}
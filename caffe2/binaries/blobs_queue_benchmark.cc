@@ -0,0 +1,90 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// Measures the throughput of the mutex-based and the lock-free BlobsQueue
+// with 1, 4 and 16 producers and as many consumers. Every record is a single
+// small tensor, so the numbers are dominated by the queue synchronization.
+
+#include <cstdio>
+#include <thread>
+
+#include "caffe2/core/init.h"
+#include "caffe2/core/logging.h"
+#include "caffe2/core/timer.h"
+#include "caffe2/queue/blobs_queue.h"
+#include "caffe2/utils/string_utils.h"
+
+CAFFE2_DEFINE_int(records, 200000, "Number of records sent through a queue.");
+CAFFE2_DEFINE_int(capacity, 64, "Queue capacity.");
+CAFFE2_DEFINE_string(threads, "1,4,16", "Numbers of producers/consumers.");
+
+namespace caffe2 {
+
+double BenchmarkQueue(bool lockFree, int numThreads) {
+  Workspace ws;
+  auto queue = std::make_shared<BlobsQueue>(
+      &ws,
+      "queue",
+      FLAGS_capacity,
+      1,
+      false,
+      std::vector<std::string>(),
+      lockFree);
+  const int perThread = FLAGS_records / numThreads;
+  std::vector<std::thread> threads;
+  Timer timer;
+  for (int t = 0; t < numThreads; ++t) {
+    threads.emplace_back([&]() {
+      Blob blob;
+      auto* tensor = blob.GetMutable<TensorCPU>();
+      tensor->Resize(1);
+      tensor->mutable_data<float>();
+      for (int i = 0; i < perThread; ++i) {
+        CAFFE_ENFORCE(queue->blockingWrite({&blob}));
+      }
+    });
+    threads.emplace_back([&]() {
+      Blob blob;
+      for (int i = 0; i < perThread; ++i) {
+        CAFFE_ENFORCE(queue->blockingRead({&blob}));
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  return perThread * numThreads / timer.Seconds();
+}
+
+} // namespace caffe2
+
+int main(int argc, char** argv) {
+  caffe2::GlobalInit(&argc, &argv);
+  for (const auto& threads : caffe2::split(',', caffe2::FLAGS_threads)) {
+    const int numThreads = std::stoi(threads);
+    const double mutexRate = caffe2::BenchmarkQueue(false, numThreads);
+    const double lockFreeRate = caffe2::BenchmarkQueue(true, numThreads);
+    printf(
+        "%2d producers/consumers: mutex %.0f records/s, lock-free %.0f "
+        "records/s, speedup %.2fx\n",
+        numThreads,
+        mutexRate,
+        lockFreeRate,
+        lockFreeRate / mutexRate);
+  }
+  return 0;
+}
@@ -0,0 +1,127 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Compares the WINOGRAD engine of Conv on 3x3 stride-1 convolutions (NCHW)
+// and the DIRECT engine on 1x1 convolutions (NHWC) with the default im2col +
+// GEMM engine, on layer shapes typical of ResNet-style networks.
+
+#include <cstdio>
+#include <memory>
+#include <string>
+
+#include "caffe2/core/init.h"
+#include "caffe2/core/logging.h"
+#include "caffe2/core/operator.h"
+#include "caffe2/core/timer.h"
+#include "caffe2/core/workspace.h"
+#include "caffe2/utils/math.h"
+
+CAFFE2_DEFINE_int(batch_size, 1, "Batch size of the benchmarked convolutions.");
+CAFFE2_DEFINE_int(warmup, 3, "Number of warmup runs.");
+CAFFE2_DEFINE_int(iter, 10, "Number of measured runs.");
+
+namespace caffe2 {
+
+struct ConvShape {
+  const char* engine;
+  int C;
+  int M;
+  int size;
+  int kernel;
+  int stride;
+};
+
+const ConvShape kShapes[] = {
+    {"WINOGRAD", 64, 64, 56, 3, 1},
+    {"WINOGRAD", 128, 128, 28, 3, 1},
+    {"WINOGRAD", 256, 256, 14, 3, 1},
+    {"WINOGRAD", 512, 512, 7, 3, 1},
+    {"DIRECT", 64, 256, 56, 1, 1},
+    {"DIRECT", 256, 64, 56, 1, 1},
+    {"DIRECT", 512, 128, 28, 1, 1},
+    {"DIRECT", 1024, 2048, 14, 1, 2},
+};
+
+double BenchmarkConv(const ConvShape& shape, const string& engine) {
+  const bool nhwc = shape.kernel == 1;
+  Workspace ws;
+  DeviceOption option;
+  CPUContext context(option);
+  auto fill = [&](const string& name, const vector<TIndex>& dims) {
+    auto* tensor = ws.CreateBlob(name)->GetMutable<TensorCPU>();
+    tensor->Resize(dims);
+    math::RandGaussian<float, CPUContext>(
+        tensor->size(), 0, 1, tensor->mutable_data<float>(), &context);
+  };
+  const TIndex N = FLAGS_batch_size;
+  if (nhwc) {
+    fill("X", {N, shape.size, shape.size, shape.C});
+    fill("W", {shape.M, 1, 1, shape.C});
+  } else {
+    fill("X", {N, shape.C, shape.size, shape.size});
+    fill("W", {shape.M, shape.C, shape.kernel, shape.kernel});
+  }
+  fill("B", {shape.M});
+
+  OperatorDef def;
+  def.set_type("Conv");
+  def.set_engine(engine);
+  def.add_input("X");
+  def.add_input("W");
+  def.add_input("B");
+  def.add_output("Y");
+  def.add_arg()->CopyFrom(MakeArgument<int>("kernel", shape.kernel));
+  def.add_arg()->CopyFrom(MakeArgument<int>("stride", shape.stride));
+  def.add_arg()->CopyFrom(MakeArgument<int>("pad", shape.kernel / 2));
+  def.add_arg()->CopyFrom(
+      MakeArgument<string>("order", nhwc ? "NHWC" : "NCHW"));
+  std::unique_ptr<OperatorBase> op(CreateOperator(def, &ws));
+  CAFFE_ENFORCE(op);
+  CAFFE_ENFORCE_EQ(op->engine(), engine);
+  for (int i = 0; i < FLAGS_warmup; ++i) {
+    CAFFE_ENFORCE(op->Run());
+  }
+  Timer timer;
+  for (int i = 0; i < FLAGS_iter; ++i) {
+    CAFFE_ENFORCE(op->Run());
+  }
+  return timer.MilliSeconds() / FLAGS_iter;
+}
+
+} // namespace caffe2
+
+int main(int argc, char** argv) {
+  caffe2::GlobalInit(&argc, &argv);
+  for (const auto& shape : caffe2::kShapes) {
+    const double default_ms = caffe2::BenchmarkConv(shape, "");
+    const double engine_ms = caffe2::BenchmarkConv(shape, shape.engine);
+    printf(
+        "%dx%d conv %4d -> %4d channels, %3dx%-3d stride %d: "
+        "default %.3f ms, %s %.3f ms, speedup %.2fx\n",
+        shape.kernel,
+        shape.kernel,
+        shape.C,
+        shape.M,
+        shape.size,
+        shape.size,
+        shape.stride,
+        default_ms,
+        shape.engine,
+        engine_ms,
+        default_ms / engine_ms);
+  }
+  return 0;
+}
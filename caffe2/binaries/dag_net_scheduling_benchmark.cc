@@ -0,0 +1,127 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// Compares FIFO and critical path dispatch of ready chains in the dag net on
+// an Inception-like net: a sequence of `blocks` blocks, each of which forks
+// into `width` branches and joins them with a Sum. Every branch is a single
+// Scale op, except the last one, which is a chain of `depth` Scale ops. FIFO
+// dispatch starts the long branch after all the short ones declared before
+// it, critical path dispatch starts it first.
+
+#include <cstdio>
+
+#include "caffe2/core/init.h"
+#include "caffe2/core/logging.h"
+#include "caffe2/core/net.h"
+#include "caffe2/core/timer.h"
+#include "caffe2/core/workspace.h"
+
+CAFFE2_DEFINE_int(blocks, 8, "Number of fork/join blocks in the net.");
+CAFFE2_DEFINE_int(width, 16, "Number of branches in each block.");
+CAFFE2_DEFINE_int(depth, 8, "Number of ops in the long branch of a block.");
+CAFFE2_DEFINE_int(threads, 4, "Number of dag net workers.");
+CAFFE2_DEFINE_int(tensor_size, 65536, "Number of floats in each tensor.");
+CAFFE2_DEFINE_int(warmup, 5, "Number of warmup runs.");
+CAFFE2_DEFINE_int(iter, 50, "Number of measured runs.");
+
+CAFFE2_DECLARE_bool(caffe2_dag_net_critical_path);
+
+namespace caffe2 {
+
+void AddScale(NetDef* net, const string& input, const string& output) {
+  auto* op = net->add_op();
+  op->set_type("Scale");
+  op->add_input(input);
+  op->add_output(output);
+  auto* arg = op->add_arg();
+  arg->set_name("scale");
+  arg->set_f(0.5);
+}
+
+NetDef CreateInceptionLikeNet() {
+  NetDef net;
+  net.set_name("inception_like");
+  net.set_type("dag");
+  net.set_num_workers(FLAGS_threads);
+  net.add_external_input("x");
+  string block_input = "x";
+  for (int b = 0; b < FLAGS_blocks; ++b) {
+    const string prefix = "b" + caffe2::to_string(b) + "_";
+    vector<string> branch_outputs;
+    for (int w = 0; w < FLAGS_width; ++w) {
+      const int depth = w == FLAGS_width - 1 ? FLAGS_depth : 1;
+      string prev = block_input;
+      for (int d = 0; d < depth; ++d) {
+        string out = prefix + caffe2::to_string(w) + "_" + caffe2::to_string(d);
+        AddScale(&net, prev, out);
+        prev = out;
+      }
+      branch_outputs.push_back(prev);
+    }
+    auto* sum = net.add_op();
+    sum->set_type("Sum");
+    for (const auto& input : branch_outputs) {
+      sum->add_input(input);
+    }
+    block_input = prefix + "out";
+    sum->add_output(block_input);
+  }
+  net.add_external_output(block_input);
+  return net;
+}
+
+double BenchmarkScheduling(bool critical_path) {
+  FLAGS_caffe2_dag_net_critical_path = critical_path;
+  Workspace ws;
+  auto* x = ws.CreateBlob("x")->GetMutable<TensorCPU>();
+  x->Resize(FLAGS_tensor_size);
+  float* data = x->mutable_data<float>();
+  for (int i = 0; i < FLAGS_tensor_size; ++i) {
+    data[i] = 1.0;
+  }
+  // With critical path dispatch, the first warmup run measures the op costs.
+  NetBase* net = ws.CreateNet(CreateInceptionLikeNet());
+  CAFFE_ENFORCE(net);
+  for (int i = 0; i < FLAGS_warmup; ++i) {
+    CAFFE_ENFORCE(net->Run());
+  }
+  Timer timer;
+  for (int i = 0; i < FLAGS_iter; ++i) {
+    CAFFE_ENFORCE(net->Run());
+  }
+  return timer.MilliSeconds() / FLAGS_iter;
+}
+
+} // namespace caffe2
+
+int main(int argc, char** argv) {
+  caffe2::GlobalInit(&argc, &argv);
+  const double fifo_ms = caffe2::BenchmarkScheduling(false);
+  const double critical_path_ms = caffe2::BenchmarkScheduling(true);
+  printf(
+      "Inception-like net (%d blocks x %d branches, long branch %d ops, "
+      "%d threads): FIFO %.4f ms/run, critical path %.4f ms/run, "
+      "speedup %.2fx\n",
+      caffe2::FLAGS_blocks,
+      caffe2::FLAGS_width,
+      caffe2::FLAGS_depth,
+      caffe2::FLAGS_threads,
+      fifo_ms,
+      critical_path_ms,
+      fifo_ms / critical_path_ms);
+  return 0;
+}
@@ -30,6 +30,13 @@ CAFFE2_DEFINE_int(repeat, 10, "The number to repeat the throughput test.");
 CAFFE2_DEFINE_bool(use_reader, false, "If true, use the reader interface.");
 CAFFE2_DEFINE_int(num_read_threads, 1,
                    "The number of concurrent reading threads.");
+CAFFE2_DEFINE_int(prefetch, 0,
+                  "If positive, the reader reads this many records ahead.");
+CAFFE2_DEFINE_int(batch_size, 1,
+                  "Number of records per reader call; uses ReadBatch if > 1.");
+CAFFE2_DEFINE_bool(shard_readers, false,
+                   "If true, every thread reads its own shard of the db "
+                   "through its own reader instead of sharing one.");
 
 using caffe2::db::Cursor;
 using caffe2::db::DB;
@@ -60,10 +67,16 @@ void TestThroughputWithDB() {
 
 void TestThroughputWithReaderWorker(const DBReader* reader, int thread_id) {
   string key, value;
+  std::vector<string> keys, values;
   for (int iter_id = 0; iter_id < caffe2::FLAGS_repeat; ++iter_id) {
     caffe2::Timer timer;
-    for (int i = 0; i < caffe2::FLAGS_report_interval; ++i) {
-      reader->Read(&key, &value);
+    for (int i = 0; i < caffe2::FLAGS_report_interval;
+         i += caffe2::FLAGS_batch_size) {
+      if (caffe2::FLAGS_batch_size > 1) {
+        reader->ReadBatch(caffe2::FLAGS_batch_size, &keys, &values);
+      } else {
+        reader->Read(&key, &value);
+      }
     }
     double elapsed_seconds = timer.Seconds();
     printf("Thread %03d iteration %03d, took %4.5f seconds, "
@@ -74,13 +87,21 @@ void TestThroughputWithReaderWorker(const DBReader* reader, int thread_id) {
 }
 
 void TestThroughputWithReader() {
-  caffe2::db::DBReader reader(
-      caffe2::FLAGS_input_db_type, caffe2::FLAGS_input_db);
+  const int num_readers =
+      caffe2::FLAGS_shard_readers ? caffe2::FLAGS_num_read_threads : 1;
+  std::vector<std::unique_ptr<DBReader>> readers;
+  for (int i = 0; i < num_readers; ++i) {
+    readers.emplace_back(new DBReader(
+        caffe2::FLAGS_input_db_type, caffe2::FLAGS_input_db, num_readers, i));
+    if (caffe2::FLAGS_prefetch > 0) {
+      readers.back()->SetPrefetch(caffe2::FLAGS_prefetch);
+    }
+  }
   std::vector<std::unique_ptr<std::thread>> reading_threads(
       caffe2::FLAGS_num_read_threads);
   for (int i = 0; i < reading_threads.size(); ++i) {
     reading_threads[i].reset(new std::thread(
-        TestThroughputWithReaderWorker, &reader, i));
+        TestThroughputWithReaderWorker, readers[i % num_readers].get(), i));
   }
   for (int i = 0; i < reading_threads.size(); ++i) {
     reading_threads[i]->join();
@@ -0,0 +1,149 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// Measures how the CPU operators that split their loops with
+// CPUContext::ParallelFor scale with the size of the workspace thread pool:
+// broadcast Add, ReduceBackSum, Transpose, MaxPool, AveragePool and Softmax
+// on a batch of `batch` x `channels` x `size` x `size` floats.
+
+#include <cstdio>
+
+#include "caffe2/core/init.h"
+#include "caffe2/core/logging.h"
+#include "caffe2/core/operator.h"
+#include "caffe2/core/timer.h"
+#include "caffe2/core/workspace.h"
+#include "caffe2/utils/proto_utils.h"
+#include "caffe2/utils/string_utils.h"
+
+CAFFE2_DEFINE_string(threads, "1,2,4,8", "Comma separated thread counts.");
+CAFFE2_DEFINE_int(batch, 32, "Batch size of the input.");
+CAFFE2_DEFINE_int(channels, 64, "Number of channels of the input.");
+CAFFE2_DEFINE_int(size, 56, "Height and width of the input.");
+CAFFE2_DEFINE_int(warmup, 3, "Number of warmup runs of every operator.");
+CAFFE2_DEFINE_int(iter, 20, "Number of measured runs of every operator.");
+
+CAFFE2_DECLARE_int(caffe2_threadpool_num_threads);
+
+namespace caffe2 {
+
+std::vector<OperatorDef> CreateOps() {
+  std::vector<OperatorDef> ops;
+  ops.push_back(CreateOperatorDef(
+      "Add",
+      "",
+      {"X", "bias"},
+      {"Y"},
+      {MakeArgument<int>("broadcast", 1), MakeArgument<int>("axis", 1)}));
+  ops.push_back(CreateOperatorDef(
+      "ReduceBackSum",
+      "",
+      {"X"},
+      {"Y"},
+      {MakeArgument<int>("num_reduce_dims", 2)}));
+  ops.push_back(CreateOperatorDef(
+      "Transpose",
+      "",
+      {"X"},
+      {"Y"},
+      {MakeArgument<vector<int>>("axes", {0, 2, 3, 1})}));
+  for (const char* type : {"MaxPool", "AveragePool"}) {
+    ops.push_back(CreateOperatorDef(
+        type,
+        "",
+        {"X"},
+        {"Y"},
+        {MakeArgument<int>("kernel", 3),
+         MakeArgument<int>("stride", 2),
+         MakeArgument<int>("pad", 1)}));
+  }
+  ops.push_back(CreateOperatorDef(
+      "Softmax", "", {"X"}, {"Y"}, {MakeArgument<int>("axis", 1)}));
+  return ops;
+}
+
+// Returns the milliseconds per run of every operator with a pool of the given
+// number of threads.
+std::vector<double> BenchmarkOps(
+    const std::vector<OperatorDef>& defs,
+    int num_threads) {
+  // The pool is created on first use with the current flag value.
+  FLAGS_caffe2_threadpool_num_threads = num_threads;
+  Workspace ws;
+  auto* X = ws.CreateBlob("X")->GetMutable<TensorCPU>();
+  X->Resize(FLAGS_batch, FLAGS_channels, FLAGS_size, FLAGS_size);
+  float* data = X->mutable_data<float>();
+  for (TIndex i = 0; i < X->size(); ++i) {
+    data[i] = (i % 255) / 255.0f;
+  }
+  auto* bias = ws.CreateBlob("bias")->GetMutable<TensorCPU>();
+  bias->Resize(FLAGS_channels);
+  float* bias_data = bias->mutable_data<float>();
+  for (int i = 0; i < FLAGS_channels; ++i) {
+    bias_data[i] = i;
+  }
+
+  std::vector<double> ms;
+  for (const auto& def : defs) {
+    auto op = CreateOperator(def, &ws);
+    for (int i = 0; i < FLAGS_warmup; ++i) {
+      CAFFE_ENFORCE(op->Run());
+    }
+    Timer timer;
+    for (int i = 0; i < FLAGS_iter; ++i) {
+      CAFFE_ENFORCE(op->Run());
+    }
+    ms.push_back(timer.MilliSeconds() / FLAGS_iter);
+  }
+  return ms;
+}
+
+} // namespace caffe2
+
+int main(int argc, char** argv) {
+  caffe2::GlobalInit(&argc, &argv);
+  const auto defs = caffe2::CreateOps();
+  std::vector<int> thread_counts;
+  for (const auto& count : caffe2::split(',', caffe2::FLAGS_threads)) {
+    thread_counts.push_back(std::stoi(count));
+  }
+  CAFFE_ENFORCE(!thread_counts.empty());
+
+  std::vector<std::vector<double>> results;
+  for (int num_threads : thread_counts) {
+    results.push_back(caffe2::BenchmarkOps(defs, num_threads));
+  }
+  printf(
+      "Input %d x %d x %d x %d, ms/run (speedup over %d threads)\n",
+      caffe2::FLAGS_batch,
+      caffe2::FLAGS_channels,
+      caffe2::FLAGS_size,
+      caffe2::FLAGS_size,
+      thread_counts[0]);
+  for (size_t op = 0; op < defs.size(); ++op) {
+    printf("%-14s", defs[op].type().c_str());
+    for (size_t t = 0; t < thread_counts.size(); ++t) {
+      printf(
+          "  %2d threads: %8.3f (%.2fx)",
+          thread_counts[t],
+          results[t][op],
+          results[0][op] / results[t][op]);
+    }
+    printf("\n");
+  }
+  return 0;
+}
@@ -0,0 +1,179 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// Measures forward-only RecurrentNetwork throughput on CPU with and without
+// the RNN executor over a range of sequence lengths. The step net is a stack
+// of `layers` simple tanh RNN cells,
+//   h_l[t] = tanh(FC(h_{l-1}[t], Wx_l) + FC(h_l[t - 1], Wh_l)),
+// so the executor can pipeline timestep t + 1 of a lower layer with
+// timestep t of the layers above it.
+
+#include <cstdio>
+
+#include "caffe2/core/init.h"
+#include "caffe2/core/logging.h"
+#include "caffe2/core/operator.h"
+#include "caffe2/core/timer.h"
+#include "caffe2/core/workspace.h"
+#include "caffe2/utils/proto_utils.h"
+#include "caffe2/utils/string_utils.h"
+
+CAFFE2_DEFINE_string(
+    seq_lengths,
+    "16,32,64,128,256,512",
+    "Comma separated sequence lengths.");
+CAFFE2_DEFINE_int(layers, 4, "Number of stacked RNN layers.");
+CAFFE2_DEFINE_int(batch_size, 8, "Batch size of the input sequence.");
+CAFFE2_DEFINE_int(hidden_size, 64, "Input and hidden state size.");
+CAFFE2_DEFINE_int(num_threads, 4, "Number of RNN executor threads.");
+CAFFE2_DEFINE_int(warmup, 3, "Number of warmup runs.");
+CAFFE2_DEFINE_int(iter, 20, "Number of measured runs.");
+
+namespace caffe2 {
+
+void FillTensor(Workspace* ws, const string& name, vector<TIndex> dims) {
+  auto* tensor = ws->CreateBlob(name)->GetMutable<TensorCPU>();
+  tensor->Resize(dims);
+  float* data = tensor->mutable_data<float>();
+  for (TIndex i = 0; i < tensor->size(); ++i) {
+    data[i] = ((i * 7) % 13 - 6) / (13.0f * FLAGS_hidden_size);
+  }
+}
+
+OperatorDef CreateRecurrentNetworkOp(bool enable_rnn_executor) {
+  NetDef step_net;
+  step_net.set_name("rnn_step");
+  vector<string> link_internal;
+  vector<string> link_external;
+  vector<int> link_offset;
+  vector<string> states;
+  vector<int> state_ids;
+  vector<string> inputs{"input"};
+  link_internal.push_back("input_t");
+  link_external.push_back("input");
+  link_offset.push_back(0);
+  string below = "input_t";
+  for (int l = 0; l < FLAGS_layers; ++l) {
+    const string suffix = "_" + caffe2::to_string(l);
+    const string hidden = "hidden" + suffix;
+    for (const char* param : {"Wx", "bx", "Wh", "bh"}) {
+      step_net.add_external_input(param + suffix);
+    }
+    // Links are 1 x N x D slices of the sequences.
+    step_net.add_op()->CopyFrom(CreateOperatorDef(
+        "FC",
+        "",
+        {below, "Wx" + suffix, "bx" + suffix},
+        {"xw" + suffix},
+        {MakeArgument<int>("axis", 2)}));
+    step_net.add_op()->CopyFrom(CreateOperatorDef(
+        "FC",
+        "",
+        {hidden + "_prev", "Wh" + suffix, "bh" + suffix},
+        {"hw" + suffix},
+        {MakeArgument<int>("axis", 2)}));
+    step_net.add_op()->CopyFrom(CreateOperatorDef(
+        "Add", "", {"xw" + suffix, "hw" + suffix}, {"pre" + suffix}));
+    step_net.add_op()->CopyFrom(
+        CreateOperatorDef("Tanh", "", {"pre" + suffix}, {hidden + "_t"}));
+    link_internal.push_back(hidden + "_prev");
+    link_external.push_back(hidden + "_states");
+    link_offset.push_back(0);
+    link_internal.push_back(hidden + "_t");
+    link_external.push_back(hidden + "_states");
+    link_offset.push_back(1);
+    states.push_back(hidden + "_states");
+    state_ids.push_back(inputs.size());
+    inputs.push_back(hidden + "_init");
+    below = hidden + "_t";
+  }
+
+  Argument step_net_arg;
+  step_net_arg.set_name("step_net");
+  step_net_arg.mutable_n()->CopyFrom(step_net);
+  const string last = "hidden_" + caffe2::to_string(FLAGS_layers - 1);
+  return CreateOperatorDef(
+      "RecurrentNetwork",
+      "",
+      inputs,
+      {"output", "step_workspaces"},
+      {step_net_arg,
+       MakeArgument<vector<string>>("recurrent_states", states),
+       MakeArgument<vector<int>>("initial_recurrent_state_ids", state_ids),
+       MakeArgument<vector<string>>("link_internal", link_internal),
+       MakeArgument<vector<string>>("link_external", link_external),
+       MakeArgument<vector<int>>("link_offset", link_offset),
+       MakeArgument<vector<int>>(
+           "link_window", vector<int>(link_offset.size(), 1)),
+       MakeArgument<vector<string>>("alias_src", {last + "_states"}),
+       MakeArgument<vector<string>>("alias_dst", {"output"}),
+       MakeArgument<vector<int>>("alias_offset", {1}),
+       MakeArgument<int>("enable_rnn_executor", enable_rnn_executor),
+       MakeArgument<int>("rnn_executor.num_threads", FLAGS_num_threads)});
+}
+
+// Returns the milliseconds per forward pass over a sequence of the given
+// length.
+double BenchmarkRecurrentNetwork(bool enable_rnn_executor, int seq_length) {
+  const int N = FLAGS_batch_size;
+  const int D = FLAGS_hidden_size;
+  Workspace ws;
+  FillTensor(&ws, "input", {seq_length, N, D});
+  for (int l = 0; l < FLAGS_layers; ++l) {
+    const string suffix = "_" + caffe2::to_string(l);
+    FillTensor(&ws, "hidden" + suffix + "_init", {1, N, D});
+    FillTensor(&ws, "Wx" + suffix, {D, D});
+    FillTensor(&ws, "bx" + suffix, {D});
+    FillTensor(&ws, "Wh" + suffix, {D, D});
+    FillTensor(&ws, "bh" + suffix, {D});
+  }
+  auto op = CreateOperator(CreateRecurrentNetworkOp(enable_rnn_executor), &ws);
+  for (int i = 0; i < FLAGS_warmup; ++i) {
+    CAFFE_ENFORCE(op->Run());
+  }
+  Timer timer;
+  for (int i = 0; i < FLAGS_iter; ++i) {
+    CAFFE_ENFORCE(op->Run());
+  }
+  return timer.MilliSeconds() / FLAGS_iter;
+}
+
+} // namespace caffe2
+
+int main(int argc, char** argv) {
+  caffe2::GlobalInit(&argc, &argv);
+  printf(
+      "%d layers, batch %d, hidden %d, %d executor threads, ms/run\n",
+      caffe2::FLAGS_layers,
+      caffe2::FLAGS_batch_size,
+      caffe2::FLAGS_hidden_size,
+      caffe2::FLAGS_num_threads);
+  for (const auto& length : caffe2::split(',', caffe2::FLAGS_seq_lengths)) {
+    const int seq_length = std::stoi(length);
+    const double step_nets_ms =
+        caffe2::BenchmarkRecurrentNetwork(false, seq_length);
+    const double executor_ms =
+        caffe2::BenchmarkRecurrentNetwork(true, seq_length);
+    printf(
+        "T=%4d  step nets: %9.3f  executor: %9.3f (%.2fx)\n",
+        seq_length,
+        step_nets_ms,
+        executor_ms,
+        step_nets_ms / executor_ms);
+  }
+  return 0;
+}
@@ -0,0 +1,89 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// Measures the cost of CAFFE_EVENT on an exported stat updated concurrently
+// by 1 to 64 threads, against a counter shared by all threads through a
+// single std::atomic, which is how StatValue used to be implemented.
+
+#include <atomic>
+#include <cstdio>
+#include <thread>
+
+#include "caffe2/core/init.h"
+#include "caffe2/core/logging.h"
+#include "caffe2/core/stats.h"
+#include "caffe2/core/timer.h"
+#include "caffe2/utils/string_utils.h"
+
+CAFFE2_DEFINE_int(updates, 2000000, "Number of updates done by each thread.");
+CAFFE2_DEFINE_string(threads, "1,2,4,8,16,32,64", "Numbers of threads.");
+
+namespace caffe2 {
+
+struct BenchmarkStats {
+  CAFFE_STAT_CTOR(BenchmarkStats);
+  CAFFE_EXPORTED_STAT(updates);
+};
+
+// Returns the average time of an update in nanoseconds.
+template <typename F>
+double BenchmarkUpdates(int numThreads, F update) {
+  std::vector<std::thread> threads;
+  std::atomic<double> totalNs{0};
+  for (int t = 0; t < numThreads; ++t) {
+    threads.emplace_back([&]() {
+      Timer timer;
+      for (int i = 0; i < FLAGS_updates; ++i) {
+        update();
+      }
+      const double ns = timer.NanoSeconds();
+      double expected = totalNs.load();
+      while (!totalNs.compare_exchange_weak(expected, expected + ns)) {
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  return totalNs / (double(numThreads) * FLAGS_updates);
+}
+
+} // namespace caffe2
+
+int main(int argc, char** argv) {
+  caffe2::GlobalInit(&argc, &argv);
+  caffe2::BenchmarkStats stats("stats_benchmark");
+  std::atomic<int64_t> shared{0};
+  for (const auto& threads : caffe2::split(',', caffe2::FLAGS_threads)) {
+    const int numThreads = std::stoi(threads);
+    const double sharedNs = caffe2::BenchmarkUpdates(
+        numThreads, [&]() { shared.fetch_add(1); });
+    const double shardedNs = caffe2::BenchmarkUpdates(
+        numThreads, [&]() { CAFFE_EVENT(stats, updates); });
+    printf(
+        "%2d threads: shared atomic %.2f ns/update, "
+        "sharded stat %.2f ns/update\n",
+        numThreads,
+        sharedNs,
+        shardedNs);
+  }
+  const auto published =
+      caffe2::toMap(caffe2::StatRegistry::get().publish())
+          ["stats_benchmark/updates"];
+  CAFFE_ENFORCE_EQ(published, shared.load());
+  return 0;
+}
@@ -49,6 +49,7 @@ void MemoryAllocationReporter::New(void* ptr, size_t nbytes) {
   size_table_[ptr] = nbytes;
   allocated_ += nbytes;
   LOG(INFO) << "Caffe2 alloc " << nbytes << " bytes, total alloc " << allocated_
+            << " bytes, allocator cache " << GetCPUAllocator()->CachedBytes()
             << " bytes.";
 }
 
@@ -58,7 +59,8 @@ void MemoryAllocationReporter::Delete(void* ptr) {
   CHECK(it != size_table_.end());
   allocated_ -= it->second;
   LOG(INFO) << "Caffe2 deleted " << it->second << " bytes, total alloc "
-            << allocated_ << " bytes.";
+            << allocated_ << " bytes, allocator cache "
+            << GetCPUAllocator()->CachedBytes() << " bytes.";
   size_table_.erase(it);
 }
 
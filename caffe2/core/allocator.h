@@ -40,6 +40,11 @@ struct CPUAllocator {
   virtual ~CPUAllocator() noexcept {}
   virtual std::pair<void*, MemoryDeleter> New(size_t nbytes) = 0;
   virtual MemoryDeleter GetDeleter() = 0;
+  // Number of bytes the allocator holds on to for reuse but that are not
+  // handed out to anyone. Non-caching allocators return 0.
+  virtual size_t CachedBytes() const {
+    return 0;
+  }
 };
 
 // A virtual struct that is used to report Caffe2's memory allocation and
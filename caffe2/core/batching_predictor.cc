@@ -0,0 +1,282 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "caffe2/core/batching_predictor.h"
+
+namespace caffe2 {
+
+namespace {
+
+// Concatenates the i-th input of every request along the first dimension.
+void concat(
+    CPUContext& context,
+    const std::vector<const Predictor::TensorVector*>& inputs,
+    size_t index,
+    TIndex rows,
+    TensorCPU* output) {
+  const auto& first = *inputs[0]->at(index);
+  CAFFE_ENFORCE_GT(first.ndim(), 0, "Batched inputs need a batch dimension");
+  auto dims = first.dims();
+  dims[0] = rows;
+  output->Resize(dims);
+  auto* dst = static_cast<char*>(output->raw_mutable_data(first.meta()));
+  for (const auto* request : inputs) {
+    const auto& input = *request->at(index);
+    CAFFE_ENFORCE(input.meta() == first.meta());
+    CAFFE_ENFORCE_EQ(input.ndim(), first.ndim());
+    for (int k = 1; k < input.ndim(); ++k) {
+      CAFFE_ENFORCE_EQ(input.dim(k), first.dim(k));
+    }
+    if (input.size() == 0) {
+      continue;
+    }
+    context.CopyItems<CPUContext, CPUContext>(
+        input.meta(), input.size(), input.raw_data(), dst);
+    dst += input.nbytes();
+  }
+}
+
+// Copies rows [begin, begin + rows) of input into a new tensor.
+void slice(
+    CPUContext& context,
+    const TensorCPU& input,
+    TIndex begin,
+    TIndex rows,
+    TensorCPU* output) {
+  auto dims = input.dims();
+  dims[0] = rows;
+  output->Resize(dims);
+  const auto rowItems = input.size_from_dim(1);
+  context.CopyItems<CPUContext, CPUContext>(
+      input.meta(),
+      rows * rowItems,
+      static_cast<const char*>(input.raw_data()) +
+          begin * rowItems * input.itemsize(),
+      output->raw_mutable_data(input.meta()));
+}
+
+// Returns whether two requests can be concatenated into one batch: same
+// number of inputs, and inputs of the same type and trailing dimensions.
+bool compatible(
+    const Predictor::TensorVector& a,
+    const Predictor::TensorVector& b) {
+  if (a.size() != b.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < a.size(); ++i) {
+    if (a[i]->meta() != b[i]->meta() || a[i]->ndim() != b[i]->ndim()) {
+      return false;
+    }
+    for (int k = 1; k < a[i]->ndim(); ++k) {
+      if (a[i]->dim(k) != b[i]->dim(k)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+} // namespace
+
+BatchingPredictor::BatchingPredictor(
+    const NetDef& init_net,
+    const NetDef& run_net,
+    const Options& options,
+    Workspace* parent)
+    : predictor_(init_net, run_net, parent),
+      options_(options),
+      stats_(options.stats_name) {
+  CAFFE_ENFORCE_GT(options_.max_batch_size, 0);
+  thread_ = std::thread(&BatchingPredictor::batchingLoop, this);
+}
+
+BatchingPredictor::~BatchingPredictor() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    closing_ = true;
+  }
+  cv_.notify_all();
+  thread_.join();
+}
+
+std::future<BatchingPredictor::OutputVector> BatchingPredictor::run(
+    const TensorVector& inputs) {
+  CAFFE_ENFORCE(!inputs.empty());
+  CAFFE_ENFORCE(inputs.size() <= predictor_.def().external_input_size());
+  Request request;
+  request.inputs = inputs;
+  CAFFE_ENFORCE_GT(inputs[0]->ndim(), 0);
+  request.rows = inputs[0]->dim(0);
+  for (const auto* input : inputs) {
+    CAFFE_ENFORCE_GT(input->ndim(), 0);
+    CAFFE_ENFORCE_EQ(input->dim(0), request.rows);
+  }
+  request.enqueued = std::chrono::steady_clock::now();
+  auto future = request.promise.get_future();
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    CAFFE_ENFORCE(!closing_, "BatchingPredictor is shutting down");
+    queue_.push_back(std::move(request));
+  }
+  cv_.notify_one();
+  return future;
+}
+
+void BatchingPredictor::batchingLoop() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    while (queue_.empty() && !closing_) {
+      cv_.wait(lock);
+    }
+    if (queue_.empty()) {
+      return;
+    }
+
+    // Wait for more requests until the batch is full or the oldest request
+    // has waited long enough.
+    const auto deadline = queue_.front().enqueued + options_.max_batch_latency;
+    while (!closing_) {
+      TIndex rows = 0;
+      for (const auto& request : queue_) {
+        rows += request.rows;
+      }
+      if (rows >= TIndex(options_.max_batch_size) ||
+          cv_.wait_until(lock, deadline) == std::cv_status::timeout) {
+        break;
+      }
+    }
+
+    // Requests that cannot be concatenated with the oldest one stay queued
+    // for a later batch, so that a malformed request only fails itself.
+    std::vector<Request> batch;
+    batch.push_back(std::move(queue_.front()));
+    queue_.pop_front();
+    TIndex rows = batch[0].rows;
+    for (auto it = queue_.begin(); it != queue_.end();) {
+      if (!compatible(it->inputs, batch[0].inputs)) {
+        ++it;
+        continue;
+      }
+      if (rows + it->rows > TIndex(options_.max_batch_size)) {
+        break;
+      }
+      rows += it->rows;
+      batch.push_back(std::move(*it));
+      it = queue_.erase(it);
+    }
+
+    lock.unlock();
+    runBatch(batch);
+    lock.lock();
+  }
+}
+
+void BatchingPredictor::runBatch(std::vector<Request>& batch) {
+  const auto start = std::chrono::steady_clock::now();
+  for (const auto& request : batch) {
+    CAFFE_EVENT(
+        stats_,
+        queue_latency_ns,
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            start - request.enqueued)
+            .count());
+  }
+
+  std::vector<OutputVector> results(batch.size());
+  std::vector<std::exception_ptr> errors(batch.size());
+  std::vector<const Request*> requests;
+  for (const auto& request : batch) {
+    requests.push_back(&request);
+  }
+  try {
+    results = runRequests(requests);
+  } catch (...) {
+    if (batch.size() == 1) {
+      errors[0] = std::current_exception();
+    } else {
+      // The model rejected the batch. Run the requests one by one, so that
+      // only the ones that fail on their own get an error.
+      for (size_t r = 0; r < batch.size(); ++r) {
+        try {
+          results[r] = std::move(runRequests({&batch[r]})[0]);
+        } catch (...) {
+          errors[r] = std::current_exception();
+        }
+      }
+    }
+  }
+
+  for (size_t r = 0; r < batch.size(); ++r) {
+    if (errors[r]) {
+      batch[r].promise.set_exception(errors[r]);
+    } else {
+      batch[r].promise.set_value(std::move(results[r]));
+    }
+  }
+
+  CAFFE_EVENT(stats_, batch_requests, batch.size());
+  CAFFE_EVENT(
+      stats_,
+      batch_latency_ns,
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now() - start)
+          .count());
+}
+
+std::vector<BatchingPredictor::OutputVector> BatchingPredictor::runRequests(
+    const std::vector<const Request*>& requests) {
+  TIndex rows = 0;
+  size_t numInputs = requests[0]->inputs.size();
+  std::vector<const TensorVector*> inputs;
+  for (const auto* request : requests) {
+    CAFFE_ENFORCE_EQ(
+        request->inputs.size(),
+        numInputs,
+        "All batched requests must pass the same inputs");
+    inputs.push_back(&request->inputs);
+    rows += request->rows;
+  }
+
+  std::vector<TensorCPU> batchedInputs(numInputs);
+  TensorVector batchedInputPtrs;
+  for (size_t i = 0; i < numInputs; ++i) {
+    concat(context_, inputs, i, rows, &batchedInputs[i]);
+    batchedInputPtrs.push_back(&batchedInputs[i]);
+  }
+
+  TensorVector outputs;
+  CAFFE_ENFORCE(
+      predictor_.run(batchedInputPtrs, &outputs), "Failed to run batch");
+
+  std::vector<OutputVector> results(requests.size());
+  for (const auto* output : outputs) {
+    CAFFE_ENFORCE_GT(output->ndim(), 0);
+    CAFFE_ENFORCE_EQ(
+        output->dim(0),
+        rows,
+        "Outputs must keep the batch dimension of the inputs");
+    TIndex begin = 0;
+    for (size_t r = 0; r < requests.size(); ++r) {
+      results[r].emplace_back();
+      slice(context_, *output, begin, requests[r]->rows, &results[r].back());
+      begin += requests[r]->rows;
+    }
+  }
+  CAFFE_EVENT(stats_, batch_size, rows);
+  return results;
+}
+
+} // namespace caffe2
@@ -0,0 +1,107 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <thread>
+
+#include "caffe2/core/predictor.h"
+#include "caffe2/core/stats.h"
+
+namespace caffe2 {
+
+// Runs a Predictor on batches assembled from concurrent requests.
+//
+// Every request is a list of tensors whose first dimension is the batch
+// dimension. A background thread coalesces queued requests along that
+// dimension until either max_batch_size rows are collected or the oldest
+// request has waited max_batch_latency, runs `run_net` once on the
+// concatenated inputs, and splits every output back along the first
+// dimension into the callers' futures.
+//
+// Only requests with the same number of inputs, input types and trailing
+// dimensions are batched together. If the model fails on a batch, its
+// requests are run again one by one so that only failing requests get an
+// error.
+//
+// Stats are exported through StatRegistry under the given stats_name:
+// batch_size (rows per batch; divide by max_batch_size for the fill rate),
+// batch_requests, batch_latency_ns and queue_latency_ns.
+class BatchingPredictor {
+ public:
+  using TensorVector = Predictor::TensorVector;
+  using OutputVector = std::vector<TensorCPU>;
+
+  struct Options {
+    size_t max_batch_size = 64;
+    std::chrono::microseconds max_batch_latency{1000};
+    std::string stats_name = "batching_predictor";
+  };
+
+  BatchingPredictor(
+      const NetDef& init_net,
+      const NetDef& run_net,
+      const Options& options,
+      Workspace* parent = nullptr);
+  ~BatchingPredictor();
+
+  // Queues a request. The inputs are matched to the first inputs.size()
+  // external inputs of `run_net`, like in Predictor::run, and must all have
+  // the same first dimension. They are read when the batch runs, so they
+  // must stay alive and unchanged until the returned future is ready.
+  // A single request larger than max_batch_size runs as its own batch.
+  std::future<OutputVector> run(const TensorVector& inputs);
+
+ private:
+  struct Request {
+    TensorVector inputs;
+    TIndex rows;
+    std::chrono::steady_clock::time_point enqueued;
+    std::promise<OutputVector> promise;
+  };
+
+  void batchingLoop();
+  void runBatch(std::vector<Request>& batch);
+  // Runs the model once on the concatenated inputs of the requests and
+  // returns the outputs of every request. Throws if the run fails.
+  std::vector<OutputVector> runRequests(
+      const std::vector<const Request*>& requests);
+
+  Predictor predictor_;
+  const Options options_;
+  CPUContext context_;
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::deque<Request> queue_;
+  bool closing_{false};
+  std::thread thread_;
+
+  struct BatchingPredictorStats {
+    CAFFE_STAT_CTOR(BatchingPredictorStats);
+    CAFFE_AVG_EXPORTED_STAT(batch_size);
+    CAFFE_AVG_EXPORTED_STAT(batch_requests);
+    CAFFE_AVG_EXPORTED_STAT(batch_latency_ns);
+    CAFFE_AVG_EXPORTED_STAT(queue_latency_ns);
+  } stats_;
+};
+
+} // namespace caffe2
@@ -0,0 +1,176 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <thread>
+
+#include <google/protobuf/text_format.h>
+#include "caffe2/core/batching_predictor.h"
+
+#include <gtest/gtest.h>
+
+namespace caffe2 {
+
+namespace {
+
+const char* predictSpec = R"DOC(
+        name: "predict"
+        type: "simple"
+        external_input: "data"
+        external_input: "W"
+        external_input: "b"
+        external_output: "y"
+        op {
+          input: "data"
+          input: "W"
+          input: "b"
+          output: "y"
+          type: "FC"
+        }
+)DOC";
+
+const char* initSpec = R"DOC(
+        name: "init"
+        type: "simple"
+        op {
+          type: "ConstantFill"
+          output: "W"
+          arg {
+            name: "shape"
+            ints: 3
+            ints: 2
+          }
+          arg {
+            name: "value"
+            f: 1.0
+          }
+        }
+        op {
+          type: "ConstantFill"
+          output: "b"
+          arg {
+            name: "shape"
+            ints: 3
+          }
+          arg {
+            name: "value"
+            f: 0.5
+          }
+        }
+)DOC";
+
+NetDef parseNetDef(const std::string& value) {
+  NetDef def;
+  CAFFE_ENFORCE(
+      google::protobuf::TextFormat::ParseFromString(value, &def),
+      "Failed to parse NetDef with value: ",
+      value);
+  return def;
+}
+
+} // namespace
+
+TEST(BatchingPredictorTest, ConcurrentRequests) {
+  BatchingPredictor::Options options;
+  options.max_batch_size = 8;
+  options.max_batch_latency = std::chrono::milliseconds(5);
+  BatchingPredictor predictor(
+      parseNetDef(initSpec), parseNetDef(predictSpec), options);
+
+  const int kNumRequests = 16;
+  std::vector<TensorCPU> inputs(kNumRequests);
+  std::vector<std::future<BatchingPredictor::OutputVector>> futures(
+      kNumRequests);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kNumRequests; ++i) {
+    // Request i has (i % 3) + 1 rows, all filled with i.
+    inputs[i].Resize((i % 3) + 1, 2);
+    float* data = inputs[i].mutable_data<float>();
+    for (int j = 0; j < inputs[i].size(); ++j) {
+      data[j] = i;
+    }
+    threads.emplace_back([&, i]() {
+      futures[i] = predictor.run({&inputs[i]});
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  for (int i = 0; i < kNumRequests; ++i) {
+    auto outputs = futures[i].get();
+    ASSERT_EQ(outputs.size(), 1);
+    const auto& y = outputs[0];
+    EXPECT_EQ(y.dim(0), (i % 3) + 1);
+    EXPECT_EQ(y.dim(1), 3);
+    for (int j = 0; j < y.size(); ++j) {
+      EXPECT_FLOAT_EQ(y.data<float>()[j], 2.0 * i + 0.5);
+    }
+  }
+}
+
+TEST(BatchingPredictorTest, FailedBatchPropagatesError) {
+  BatchingPredictor::Options options;
+  options.max_batch_latency = std::chrono::microseconds(0);
+  BatchingPredictor predictor(
+      parseNetDef(initSpec), parseNetDef(predictSpec), options);
+  // Wrong inner dimension for FC.
+  TensorCPU input(std::vector<TIndex>{1, 5});
+  input.mutable_data<float>();
+  auto future = predictor.run({&input});
+  EXPECT_THROW(future.get(), EnforceNotMet);
+}
+
+TEST(BatchingPredictorTest, MalformedRequestFailsAlone) {
+  BatchingPredictor::Options options;
+  options.max_batch_size = 8;
+  options.max_batch_latency = std::chrono::milliseconds(50);
+  BatchingPredictor predictor(
+      parseNetDef(initSpec), parseNetDef(predictSpec), options);
+  // Requests 0 and 3 have the wrong inner dimension for FC, request 4 the
+  // wrong type; they are queued together with well-formed requests.
+  std::vector<TensorCPU> inputs(6);
+  for (int i = 0; i < inputs.size(); ++i) {
+    inputs[i].Resize(1, (i == 0 || i == 3) ? 5 : 2);
+    if (i == 4) {
+      inputs[i].mutable_data<int>();
+    } else {
+      float* data = inputs[i].mutable_data<float>();
+      for (int j = 0; j < inputs[i].size(); ++j) {
+        data[j] = i;
+      }
+    }
+  }
+  std::vector<std::future<BatchingPredictor::OutputVector>> futures;
+  for (auto& input : inputs) {
+    futures.push_back(predictor.run({&input}));
+  }
+
+  for (int i = 0; i < futures.size(); ++i) {
+    if (i == 0 || i == 3 || i == 4) {
+      EXPECT_THROW(futures[i].get(), EnforceNotMet);
+      continue;
+    }
+    auto outputs = futures[i].get();
+    ASSERT_EQ(outputs.size(), 1);
+    EXPECT_EQ(outputs[0].dim(0), 1);
+    EXPECT_EQ(outputs[0].dim(1), 3);
+    for (int j = 0; j < outputs[0].size(); ++j) {
+      EXPECT_FLOAT_EQ(outputs[0].data<float>()[j], 2.0 * i + 0.5);
+    }
+  }
+}
+
+} // namespace caffe2
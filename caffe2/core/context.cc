@@ -16,13 +16,28 @@
 
 #include "caffe2/core/context.h"
 
+#include <algorithm>
 #include <atomic>
 #if defined(_MSC_VER)
 #include <process.h>
 #endif
 
+#include "caffe2/core/workspace.h"
+#include "caffe2/utils/threadpool/ThreadPool.h"
+
+CAFFE2_DEFINE_int64(
+    caffe2_parallel_for_min_work,
+    32768,
+    "Minimum number of scalar operations per chunk of an intra-op "
+    "CPUContext::ParallelFor. Loops with less work run on the calling thread.");
+
 namespace caffe2 {
 
+namespace {
+// Set while the current thread runs a chunk of a ParallelFor.
+thread_local bool in_parallel_for = false;
+} // namespace
+
 uint32_t RandomNumberSeed() {
   // Originally copied from folly::randomNumberSeed (at 418ad4)
   // modified to use chrono instead of sys/time.h
@@ -40,4 +55,58 @@ uint32_t RandomNumberSeed() {
       kPrime2 * tv_sec + kPrime3 * tv_usec;
 }
 
+TIndex CPUContext::ParallelForGrain(TIndex work_per_iteration) {
+  const TIndex work = std::max<TIndex>(work_per_iteration, 1);
+  const TIndex min_work =
+      std::max<TIndex>(FLAGS_caffe2_parallel_for_min_work, 1);
+  return min_work / work + (min_work % work != 0);
+}
+
+void CPUContext::ParallelFor(
+    TIndex range,
+    TIndex grain,
+    const std::function<void(TIndex, TIndex)>& fn) {
+  if (range <= 0) {
+    return;
+  }
+  grain = std::max<TIndex>(grain, 1);
+  ThreadPool* pool = nullptr;
+  if (workspace_ && !in_parallel_for && range / grain >= 2) {
+    pool = workspace_->GetThreadPool();
+  }
+  const TIndex num_chunks =
+      pool ? std::min<TIndex>(pool->getNumThreads(), range / grain) : 1;
+  if (num_chunks <= 1) {
+    fn(0, range);
+    return;
+  }
+
+  // The pool runs one job at a time. If it is busy, e.g. with a loop of an
+  // operator in another net, running inline beats waiting for it.
+  std::vector<std::exception_ptr> errors(num_chunks);
+  const bool ran = pool->tryRun(
+      [&](int /* unused */, size_t c) {
+        const TIndex begin = range * c / num_chunks;
+        const TIndex end = range * (c + 1) / num_chunks;
+        const bool was_in_parallel_for = in_parallel_for;
+        in_parallel_for = true;
+        try {
+          fn(begin, end);
+        } catch (...) {
+          errors[c] = std::current_exception();
+        }
+        in_parallel_for = was_in_parallel_for;
+      },
+      num_chunks);
+  if (!ran) {
+    fn(0, range);
+    return;
+  }
+  for (const auto& error : errors) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+}
+
 } // namespace caffe2
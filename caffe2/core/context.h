@@ -19,6 +19,7 @@
 
 #include <cstdlib>
 #include <ctime>
+#include <functional>
 #include <random>
 #include <unordered_map>
 
@@ -29,9 +30,12 @@
 #include "caffe2/proto/caffe2.pb.h"
 
 CAFFE2_DECLARE_bool(caffe2_report_cpu_memory_usage);
+CAFFE2_DECLARE_int64(caffe2_parallel_for_min_work);
 
 namespace caffe2 {
 
+class Workspace;
+
 /**
  * A function to generate a random number seed that is unique in a best-effort
  * basis, using an ever-incrementing seed and the current time.
@@ -108,6 +112,32 @@ class CPUContext final {
 
   inline void FinishDeviceComputation() {}
 
+  // The workspace whose thread pool ParallelFor distributes work on. It is set
+  // by Operator<CPUContext>; contexts without a workspace run serially.
+  inline void set_workspace(Workspace* ws) {
+    workspace_ = ws;
+  }
+  inline Workspace* workspace() const {
+    return workspace_;
+  }
+
+  // Splits [0, range) into contiguous chunks of at least `grain` iterations
+  // and calls fn(begin, end) on each of them, using the thread pool of the
+  // workspace. Everything runs inline on the calling thread if there is only
+  // one chunk, no workspace, if the pool is busy with a loop of another
+  // thread, or if the caller is already inside a ParallelFor (nested loops
+  // never oversubscribe the pool). The first exception thrown by fn is
+  // rethrown on the calling thread after all chunks finish.
+  void ParallelFor(
+      TIndex range,
+      TIndex grain,
+      const std::function<void(TIndex, TIndex)>& fn);
+
+  // Grain for loops whose iterations cost about `work_per_iteration` scalar
+  // operations each, so that every chunk does at least
+  // --caffe2_parallel_for_min_work operations.
+  static TIndex ParallelForGrain(TIndex work_per_iteration);
+
   inline rand_gen_type& RandGenerator() {
     if (!random_generator_.get()) {
       random_generator_.reset(new rand_gen_type(random_seed_));
@@ -171,6 +201,7 @@ class CPUContext final {
   // TODO(jiayq): instead of hard-coding a generator, make it more flexible.
   int random_seed_{1701};
   std::unique_ptr<rand_gen_type> random_generator_;
+  Workspace* workspace_{nullptr};
   static MemoryAllocationReporter reporter_;
 
  private:
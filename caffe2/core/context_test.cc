@@ -14,12 +14,19 @@
  * limitations under the License.
  */
 
+#include <atomic>
+#include <mutex>
 #include <random>
+#include <thread>
 
 #include "caffe2/proto/caffe2.pb.h"
 #include "caffe2/core/context.h"
+#include "caffe2/core/scope_guard.h"
+#include "caffe2/core/workspace.h"
 #include <gtest/gtest.h>
 
+CAFFE2_DECLARE_int(caffe2_threadpool_num_threads);
+
 namespace caffe2 {
 
 TEST(CPUContextTest, TestAllocAlignment) {
@@ -50,4 +57,150 @@ TEST(CPUContextTest, TestAllocDealloc) {
   dst_data_and_deleter.second(dst_data);
 }
 
+namespace {
+
+// Records the chunks a ParallelFor was split into.
+struct ChunkRecorder {
+  void operator()(TIndex begin, TIndex end) {
+    std::lock_guard<std::mutex> guard(mutex);
+    chunks.emplace_back(begin, end);
+  }
+  TIndex covered() const {
+    TIndex total = 0;
+    for (const auto& chunk : chunks) {
+      total += chunk.second - chunk.first;
+    }
+    return total;
+  }
+  std::mutex mutex;
+  std::vector<std::pair<TIndex, TIndex>> chunks;
+};
+
+} // namespace
+
+TEST(CPUContextTest, ParallelForWithoutWorkspaceRunsInline) {
+  CPUContext context;
+  ChunkRecorder recorder;
+  context.ParallelFor(
+      1000, 1, [&](TIndex begin, TIndex end) { recorder(begin, end); });
+  ASSERT_EQ(recorder.chunks.size(), 1);
+  EXPECT_EQ(recorder.chunks[0], std::make_pair(TIndex(0), TIndex(1000)));
+}
+
+TEST(CPUContextTest, ParallelForCoversRangeOnce) {
+  const int old_num_threads = FLAGS_caffe2_threadpool_num_threads;
+  auto guard = MakeGuard(
+      [&]() { FLAGS_caffe2_threadpool_num_threads = old_num_threads; });
+  FLAGS_caffe2_threadpool_num_threads = 4;
+  Workspace ws;
+  CPUContext context;
+  context.set_workspace(&ws);
+  std::vector<std::atomic<int>> visits(1000);
+  for (auto& v : visits) {
+    v = 0;
+  }
+  ChunkRecorder recorder;
+  context.ParallelFor(1000, 10, [&](TIndex begin, TIndex end) {
+    recorder(begin, end);
+    for (TIndex i = begin; i < end; ++i) {
+      visits[i]++;
+    }
+  });
+  EXPECT_EQ(recorder.chunks.size(), 4);
+  EXPECT_EQ(recorder.covered(), 1000);
+  for (const auto& v : visits) {
+    EXPECT_EQ(v, 1);
+  }
+
+  // Not enough work for two chunks of the given grain.
+  ChunkRecorder small;
+  context.ParallelFor(
+      100, 60, [&](TIndex begin, TIndex end) { small(begin, end); });
+  EXPECT_EQ(small.chunks.size(), 1);
+}
+
+TEST(CPUContextTest, NestedParallelForRunsInline) {
+  const int old_num_threads = FLAGS_caffe2_threadpool_num_threads;
+  auto guard = MakeGuard(
+      [&]() { FLAGS_caffe2_threadpool_num_threads = old_num_threads; });
+  FLAGS_caffe2_threadpool_num_threads = 4;
+  Workspace ws;
+  CPUContext context;
+  context.set_workspace(&ws);
+  std::atomic<int> inner_calls(0);
+  std::atomic<TIndex> inner_covered(0);
+  context.ParallelFor(8, 1, [&](TIndex begin, TIndex end) {
+    for (TIndex i = begin; i < end; ++i) {
+      context.ParallelFor(100, 1, [&](TIndex b, TIndex e) {
+        inner_calls++;
+        inner_covered += e - b;
+      });
+    }
+  });
+  EXPECT_EQ(inner_calls, 8);
+  EXPECT_EQ(inner_covered, 800);
+}
+
+TEST(CPUContextTest, ParallelForRunsInlineWhilePoolIsBusy) {
+  const int old_num_threads = FLAGS_caffe2_threadpool_num_threads;
+  auto guard = MakeGuard(
+      [&]() { FLAGS_caffe2_threadpool_num_threads = old_num_threads; });
+  FLAGS_caffe2_threadpool_num_threads = 4;
+  Workspace ws;
+  CPUContext context;
+  context.set_workspace(&ws);
+  // Another thread keeps the pool busy until the loop below is done.
+  std::atomic<bool> started(false);
+  std::atomic<bool> release(false);
+  std::thread busy([&]() {
+    ws.GetThreadPool()->run(
+        [&](int /* unused */, size_t /* unused */) {
+          started = true;
+          while (!release) {
+            std::this_thread::yield();
+          }
+        },
+        1);
+  });
+  while (!started) {
+    std::this_thread::yield();
+  }
+  ChunkRecorder recorder;
+  context.ParallelFor(
+      1000, 10, [&](TIndex begin, TIndex end) { recorder(begin, end); });
+  release = true;
+  busy.join();
+  ASSERT_EQ(recorder.chunks.size(), 1);
+  EXPECT_EQ(recorder.chunks[0], std::make_pair(TIndex(0), TIndex(1000)));
+}
+
+TEST(CPUContextTest, ParallelForRethrowsExceptions) {
+  const int old_num_threads = FLAGS_caffe2_threadpool_num_threads;
+  auto guard = MakeGuard(
+      [&]() { FLAGS_caffe2_threadpool_num_threads = old_num_threads; });
+  FLAGS_caffe2_threadpool_num_threads = 4;
+  Workspace ws;
+  CPUContext context;
+  context.set_workspace(&ws);
+  EXPECT_THROW(
+      context.ParallelFor(
+          100,
+          1,
+          [](TIndex begin, TIndex /* unused */) {
+            CAFFE_ENFORCE_NE(begin, 0, "first chunk fails");
+          }),
+      EnforceNotMet);
+}
+
+TEST(CPUContextTest, ParallelForGrain) {
+  EXPECT_EQ(
+      CPUContext::ParallelForGrain(1), FLAGS_caffe2_parallel_for_min_work);
+  EXPECT_EQ(
+      CPUContext::ParallelForGrain(FLAGS_caffe2_parallel_for_min_work), 1);
+  EXPECT_EQ(
+      CPUContext::ParallelForGrain(4 * FLAGS_caffe2_parallel_for_min_work), 1);
+  EXPECT_EQ(
+      CPUContext::ParallelForGrain(0), FLAGS_caffe2_parallel_for_min_work);
+}
+
 }  // namespace caffe2
@@ -16,6 +16,7 @@
 
 #include "caffe2/core/db.h"
 
+#include <algorithm>
 #include <mutex>
 
 #include "caffe2/core/blob_serialization.h"
@@ -185,6 +186,126 @@ class MiniDB : public DB {
 REGISTER_CAFFE2_DB(MiniDB, MiniDB);
 REGISTER_CAFFE2_DB(minidb, MiniDB);
 
+void DBReader::SetPrefetch(size_t num_records) {
+  StopPrefetch();
+  if (num_records == 0) {
+    return;
+  }
+  CAFFE_ENFORCE(cursor_ != nullptr, "Reader not initialized.");
+  std::lock_guard<std::mutex> lock(prefetch_mutex_);
+  // Keep the records that are still buffered, in order.
+  std::vector<std::pair<string, string>> ring(
+      std::max(num_records, prefetch_count_));
+  for (size_t i = 0; i < prefetch_count_; ++i) {
+    std::swap(
+        ring[i], prefetch_ring_[(prefetch_head_ + i) % prefetch_ring_.size()]);
+  }
+  prefetch_ring_.swap(ring);
+  prefetch_head_ = 0;
+  prefetch_error_ = nullptr;
+  stop_prefetch_ = false;
+  prefetch_size_ = num_records;
+  prefetch_thread_ = std::thread(&DBReader::PrefetchLoop, this);
+}
+
+void DBReader::StopPrefetch() {
+  if (!prefetch_thread_.joinable()) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(prefetch_mutex_);
+    stop_prefetch_ = true;
+  }
+  prefetch_cv_.notify_all();
+  prefetch_thread_.join();
+  {
+    std::lock_guard<std::mutex> lock(prefetch_mutex_);
+    prefetch_size_ = 0;
+  }
+  // Readers waiting for the ring now fall back to the cursor.
+  prefetch_cv_.notify_all();
+}
+
+void DBReader::PrefetchLoop() {
+  string key, value;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(prefetch_mutex_);
+      prefetch_cv_.wait(lock, [this]() {
+        return stop_prefetch_ || prefetch_count_ < prefetch_size_;
+      });
+      if (stop_prefetch_) {
+        return;
+      }
+    }
+    // Readers only wait for prefetch_mutex_, which is not held while the db
+    // is being read.
+    std::lock_guard<std::mutex> cursor_lock(cursor_mutex_);
+    try {
+      ReadFromCursor(&key, &value);
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(prefetch_mutex_);
+      prefetch_error_ = std::current_exception();
+      prefetch_cv_.notify_all();
+      return;
+    }
+    std::lock_guard<std::mutex> lock(prefetch_mutex_);
+    auto& slot =
+        prefetch_ring_[(prefetch_head_ + prefetch_count_) %
+                       prefetch_ring_.size()];
+    std::swap(slot.first, key);
+    std::swap(slot.second, value);
+    ++prefetch_count_;
+    prefetch_cv_.notify_all();
+  }
+}
+
+void DBReader::ReadRecords(size_t num_records, string* keys, string* values)
+    const {
+  size_t i = 0;
+  while (i < num_records) {
+    std::unique_lock<std::mutex> lock(prefetch_mutex_);
+    prefetch_cv_.wait(lock, [this]() {
+      return prefetch_count_ > 0 || prefetch_size_ == 0 ||
+          prefetch_error_ != nullptr;
+    });
+    if (prefetch_count_ == 0) {
+      if (prefetch_size_ > 0) {
+        std::rethrow_exception(prefetch_error_);
+      }
+      // Prefetching is off and nothing is buffered: no thread can refill the
+      // ring, so the remaining records come from the cursor.
+      lock.unlock();
+      std::lock_guard<std::mutex> cursor_lock(cursor_mutex_);
+      for (; i < num_records; ++i) {
+        ReadFromCursor(&keys[i], &values[i]);
+      }
+      return;
+    }
+    // Take everything that is ready in one go.
+    for (; i < num_records && prefetch_count_ > 0; ++i) {
+      auto& slot = prefetch_ring_[prefetch_head_];
+      std::swap(keys[i], slot.first);
+      std::swap(values[i], slot.second);
+      prefetch_head_ = (prefetch_head_ + 1) % prefetch_ring_.size();
+      --prefetch_count_;
+    }
+    prefetch_cv_.notify_all();
+  }
+}
+
+bool DBReader::NextKey(string* key) const {
+  if (!cursor_ || !cursor_->SupportsSeek()) {
+    return false;
+  }
+  std::lock_guard<std::mutex> mutex_lock(reader_mutex_);
+  std::lock_guard<std::mutex> cursor_lock(cursor_mutex_);
+  std::lock_guard<std::mutex> prefetch_lock(prefetch_mutex_);
+  *key = prefetch_count_ > 0 ? prefetch_ring_[prefetch_head_].first
+                             : cursor_->key();
+  return true;
+}
+
 void DBReaderSerializer::Serialize(
     const Blob& blob,
     const string& name,
@@ -195,8 +316,9 @@ void DBReaderSerializer::Serialize(
   proto.set_name(name);
   proto.set_source(reader.source_);
   proto.set_db_type(reader.db_type_);
-  if (reader.cursor() && reader.cursor()->SupportsSeek()) {
-    proto.set_key(reader.cursor()->key());
+  string key;
+  if (reader.NextKey(&key)) {
+    proto.set_key(key);
   }
   BlobProto blob_proto;
   blob_proto.set_name(name);
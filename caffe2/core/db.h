@@ -17,7 +17,9 @@
 #ifndef CAFFE2_CORE_DB_H_
 #define CAFFE2_CORE_DB_H_
 
+#include <condition_variable>
 #include <mutex>
+#include <thread>
 
 #include "caffe2/core/blob_serialization.h"
 #include "caffe2/core/registry.h"
@@ -67,6 +69,20 @@ class Cursor {
    * reached the end of the database, return false.
    */
   virtual bool Valid() = 0;
+  /**
+   * Optional zero-copy access to the current value. If the value is a
+   * serialized tensor whose contents the db keeps in memory (for example in
+   * mmap'd pages), fills `proto` with the value stripped of its tensor data,
+   * sets `owner` to a handle that keeps that memory alive, and returns a
+   * pointer to the contents of the whole tensor described by
+   * `proto->tensor().dims()`. Returns nullptr if the value can only be read
+   * via value(), which is the default.
+   */
+  virtual const void* TensorData(
+      BlobProto* /*proto*/,
+      std::shared_ptr<void>* /*owner*/) {
+    return nullptr;
+  }
 
   DISABLE_COPY_AND_ASSIGN(Cursor);
 };
@@ -162,6 +178,9 @@ class DBReader {
 
   friend class DBReaderSerializer;
   DBReader() {}
+  ~DBReader() {
+    StopPrefetch();
+  }
 
   DBReader(
       const string& db_type,
@@ -198,6 +217,7 @@ class DBReader {
       const int32_t shard_id = 0) {
     // Note(jiayq): resetting is needed when we re-open e.g. leveldb where no
     // concurrent access is allowed.
+    StopPrefetch();
     cursor_.reset();
     db_.reset();
     db_type_ = db_type;
@@ -211,6 +231,7 @@ class DBReader {
       unique_ptr<DB>&& db,
       const int32_t num_shards = 1,
       const int32_t shard_id = 0) {
+    StopPrefetch();
     cursor_.reset();
     db_.reset();
     db_ = std::move(db);
@@ -238,26 +259,50 @@ class DBReader {
   void Read(string* key, string* value) const {
     CAFFE_ENFORCE(cursor_ != nullptr, "Reader not initialized.");
     std::unique_lock<std::mutex> mutex_lock(reader_mutex_);
-    *key = cursor_->key();
-    *value = cursor_->value();
+    ReadRecords(1, key, value);
+  }
 
-    // In sharded mode, each read skips num_shards_ records
-    for (int s = 0; s < num_shards_; s++) {
-      cursor_->Next();
-      if (!cursor_->Valid()) {
-        MoveToBeginning();
-        break;
-      }
-    }
+  /**
+   * Reads the next num_records keys and values into keys and values, with
+   * the same semantics as calling Read() num_records times but taking the
+   * lock only once. Records from one call are consecutive even if other
+   * threads read concurrently. Thread safe.
+   */
+  void ReadBatch(
+      size_t num_records,
+      std::vector<string>* keys,
+      std::vector<string>* values) const {
+    CAFFE_ENFORCE(cursor_ != nullptr, "Reader not initialized.");
+    keys->resize(num_records);
+    values->resize(num_records);
+    std::unique_lock<std::mutex> mutex_lock(reader_mutex_);
+    ReadRecords(num_records, keys->data(), values->data());
   }
 
+  /**
+   * Starts a background thread that reads up to num_records records ahead of
+   * the readers into a ring of buffers, so that Read() and ReadBatch() only
+   * wait for the db when the ring runs dry. The records and their order are
+   * the same as without prefetching. Passing 0 stops prefetching; records
+   * that were already read ahead are still returned first. Not thread safe
+   * with respect to concurrent reads.
+   */
+  void SetPrefetch(size_t num_records);
+
   /**
    * @brief Seeks to the first key. Thread safe.
    */
   void SeekToFirst() const {
     CAFFE_ENFORCE(cursor_ != nullptr, "Reader not initialized.");
     std::unique_lock<std::mutex> mutex_lock(reader_mutex_);
+    std::unique_lock<std::mutex> cursor_lock(cursor_mutex_);
     MoveToBeginning();
+    // Drop what was read ahead; the prefetch thread continues from the new
+    // cursor position.
+    std::unique_lock<std::mutex> prefetch_lock(prefetch_mutex_);
+    prefetch_head_ = 0;
+    prefetch_count_ = 0;
+    prefetch_cv_.notify_all();
   }
 
   /**
@@ -270,10 +315,40 @@ class DBReader {
   inline Cursor* cursor() const {
     LOG(ERROR) << "Usually for a DBReader you should use Read() to be "
                   "thread safe. Consider refactoring your code.";
+    std::lock_guard<std::mutex> prefetch_lock(prefetch_mutex_);
+    CAFFE_ENFORCE(
+        prefetch_size_ == 0 && prefetch_count_ == 0,
+        "The cursor of a prefetching DBReader is ahead of its readers.");
     return cursor_.get();
   }
 
  private:
+  void ReadFromCursor(string* key, string* value) const {
+    *key = cursor_->key();
+    *value = cursor_->value();
+
+    // In sharded mode, each read skips num_shards_ records
+    for (int s = 0; s < num_shards_; s++) {
+      cursor_->Next();
+      if (!cursor_->Valid()) {
+        MoveToBeginning();
+        break;
+      }
+    }
+  }
+
+  // Reads the next num_records records. They are taken out of the prefetch
+  // ring first, waiting for the prefetch thread if needed; once the ring is
+  // drained and prefetching is off, the rest come from the cursor. Must hold
+  // reader_mutex_. The caller's strings are swapped into the ring so that
+  // their buffers get reused.
+  void ReadRecords(size_t num_records, string* keys, string* values) const;
+  void PrefetchLoop();
+  void StopPrefetch();
+  // Returns the key of the next record to be read, if the db supports
+  // seeking to it.
+  bool NextKey(string* key) const;
+
   void InitializeCursor(const int32_t num_shards, const int32_t shard_id) {
     CAFFE_ENFORCE(num_shards >= 1);
     CAFFE_ENFORCE(shard_id >= 0);
@@ -301,6 +376,22 @@ class DBReader {
   uint32_t num_shards_;
   uint32_t shard_id_;
 
+  // Read-ahead state, see SetPrefetch(). reader_mutex_ serializes the
+  // readers, the ring is guarded by prefetch_mutex_, and cursor_mutex_ is
+  // held by the prefetch thread from reading a record until it is in the
+  // ring. Locks are taken in this order: reader_mutex_, cursor_mutex_,
+  // prefetch_mutex_.
+  size_t prefetch_size_{0};
+  std::thread prefetch_thread_;
+  bool stop_prefetch_{false};
+  mutable std::mutex cursor_mutex_;
+  mutable std::mutex prefetch_mutex_;
+  mutable std::condition_variable prefetch_cv_;
+  mutable std::vector<std::pair<string, string>> prefetch_ring_;
+  mutable size_t prefetch_head_{0};
+  mutable size_t prefetch_count_{0};
+  mutable std::exception_ptr prefetch_error_;
+
   DISABLE_COPY_AND_ASSIGN(DBReader);
 };
 
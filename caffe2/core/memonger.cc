@@ -16,9 +16,13 @@
 
 #include "caffe2/core/memonger.h"
 
+#include <algorithm>
+#include <limits>
 #include <set>
 #include <unordered_set>
 
+#include "caffe2/core/allocator.h"
+#include "caffe2/core/types.h"
 #include "caffe2/utils/proto_utils.h"
 #include "google/protobuf/text_format.h"
 
@@ -606,5 +610,147 @@ NetDef compute_blob_recycling_for_dag(
       blob_shapes);
 }
 
+StaticMemoryPlan plan_static_memory(
+    const NetDef& net,
+    const TensorShapes& blob_shapes,
+    const std::set<string>& static_blobs) {
+  StaticMemoryPlan plan;
+  if (net.type() != "" && net.type() != "simple") {
+    LOG(INFO) << "Cannot plan memory for nets of type: " << net.type();
+    return plan;
+  }
+  for (auto& op : net.op()) {
+    if (op.type() == "RecurrentNetwork") {
+      LOG(INFO) << "Static memory planning does not support RecurrentNetwork";
+      return plan;
+    }
+  }
+
+  std::unordered_set<string> excluded(static_blobs.begin(), static_blobs.end());
+  excluded.insert(net.external_input().begin(), net.external_input().end());
+  excluded.insert(net.external_output().begin(), net.external_output().end());
+
+  std::unordered_map<string, const TensorShape*> shapes;
+  for (const auto& shape : blob_shapes.shapes()) {
+    shapes[shape.name()] = &shape;
+  }
+
+  // Step 1: compute the lifetime of every blob as the interval between the
+  // op that first writes it and the op that last touches it. A blob that is
+  // read before it is written comes from outside the net and is excluded.
+  std::unordered_map<string, std::pair<int, int>> ranges;
+  vector<string> order;
+  for (int i = 0; i < net.op_size(); i++) {
+    for (auto& inp : net.op(i).input()) {
+      auto rit = ranges.find(inp);
+      if (rit != ranges.end()) {
+        rit->second.second = i;
+      } else {
+        excluded.insert(inp);
+      }
+    }
+    for (auto& outp : net.op(i).output()) {
+      if (excluded.count(outp)) {
+        continue;
+      }
+      auto rit = ranges.find(outp);
+      if (rit == ranges.end()) {
+        ranges[outp] = std::make_pair(i, i);
+        order.push_back(outp);
+      } else {
+        rit->second.second = i;
+      }
+    }
+  }
+
+  // Step 2: size every blob that has a known shape and a POD type.
+  vector<std::pair<int, int>> lifetimes;
+  for (const auto& name : order) {
+    if (excluded.count(name)) {
+      continue;
+    }
+    auto sit = shapes.find(name);
+    if (sit == shapes.end() || sit->second->unknown_shape()) {
+      VLOG(1) << "Not planning " << name << ": unknown shape.";
+      continue;
+    }
+    const TensorShape& shape = *sit->second;
+    const TypeMeta& meta = DataTypeToTypeMeta(shape.data_type());
+    if (meta.ctor() != nullptr || meta.itemsize() == 0) {
+      VLOG(1) << "Not planning " << name << ": not a POD type.";
+      continue;
+    }
+    StaticMemoryPlan::Assignment assignment;
+    assignment.name = name;
+    assignment.data_type = shape.data_type();
+    size_t size = 1;
+    for (auto d : shape.dims()) {
+      assignment.dims.push_back(d);
+      size *= d;
+    }
+    size_t nbytes = size * meta.itemsize();
+    assignment.nbytes =
+        (nbytes + gCaffe2Alignment - 1) / gCaffe2Alignment * gCaffe2Alignment;
+    assignment.offset = 0;
+    plan.assignments.push_back(assignment);
+    lifetimes.push_back(ranges[name]);
+  }
+
+  // Step 3: place blobs largest first. Each blob goes into the smallest gap
+  // between already placed blobs that are alive at the same time, or after
+  // all of them if no gap is big enough.
+  vector<int> by_size(plan.assignments.size());
+  for (int i = 0; i < by_size.size(); i++) {
+    by_size[i] = i;
+  }
+  std::stable_sort(by_size.begin(), by_size.end(), [&](int a, int b) {
+    return plan.assignments[a].nbytes > plan.assignments[b].nbytes;
+  });
+
+  vector<int> placed;
+  for (int idx : by_size) {
+    auto& current = plan.assignments[idx];
+    vector<int> live;
+    for (int other : placed) {
+      if (lifetimes[other].first <= lifetimes[idx].second &&
+          lifetimes[idx].first <= lifetimes[other].second) {
+        live.push_back(other);
+      }
+    }
+    std::sort(live.begin(), live.end(), [&](int a, int b) {
+      return plan.assignments[a].offset < plan.assignments[b].offset;
+    });
+
+    size_t best_offset = 0;
+    size_t best_gap = std::numeric_limits<size_t>::max();
+    size_t prev_end = 0;
+    for (int other : live) {
+      const auto& o = plan.assignments[other];
+      if (o.offset > prev_end) {
+        size_t gap = o.offset - prev_end;
+        if (gap >= current.nbytes && gap < best_gap) {
+          best_gap = gap;
+          best_offset = prev_end;
+        }
+      }
+      prev_end = std::max(prev_end, o.offset + o.nbytes);
+    }
+    current.offset =
+        best_gap == std::numeric_limits<size_t>::max() ? prev_end : best_offset;
+    plan.arena_nbytes =
+        std::max(plan.arena_nbytes, current.offset + current.nbytes);
+    placed.push_back(idx);
+  }
+
+  size_t total_nbytes = 0;
+  for (const auto& assignment : plan.assignments) {
+    total_nbytes += assignment.nbytes;
+  }
+  LOG(INFO) << "Planned " << plan.assignments.size() << " blobs totalling "
+            << total_nbytes << " bytes into an arena of " << plan.arena_nbytes
+            << " bytes.";
+  return plan;
+}
+
 } // memonger
 } // caffe2
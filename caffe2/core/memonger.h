@@ -39,6 +39,32 @@ NetDef compute_blob_recycling_for_dag(
     const std::unordered_set<string>& dont_share_blob_names,
     const std::unordered_map<string, vector<int>>& blob_shapes);
 
+// A static memory plan for an inference net: every planned blob lives at a
+// fixed, aligned offset inside one arena of arena_nbytes bytes. Blobs whose
+// lifetimes overlap never share bytes.
+struct StaticMemoryPlan {
+  struct Assignment {
+    string name;
+    vector<TIndex> dims;
+    TensorProto::DataType data_type;
+    size_t offset;
+    size_t nbytes;
+  };
+  size_t arena_nbytes = 0;
+  vector<Assignment> assignments;
+};
+
+// Computes a StaticMemoryPlan for the intermediate blobs of a simple net,
+// given the shapes of its blobs (for example from shape inference). Net
+// inputs and outputs, static_blobs, and blobs with unknown shapes or
+// non-POD types are left out of the plan. Offsets are assigned greedily,
+// largest blob first, into the best-fitting gap among the blobs already
+// placed whose lifetimes overlap.
+StaticMemoryPlan plan_static_memory(
+    const NetDef& net,
+    const TensorShapes& blob_shapes,
+    const std::set<string>& static_blobs);
+
 } // memonger
 } // caffe2
 
@@ -18,6 +18,7 @@
 
 #include "caffe2/core/operator.h"
 #include "caffe2/core/timer.h"
+#include "caffe2/utils/work_stealing_thread_pool.h"
 
 CAFFE2_DEFINE_int(
     caffe2_streams_per_gpu,
@@ -51,6 +52,11 @@ CAFFE2_DEFINE_int(
     0,
     "Number of threads in CPU pool (default - number of cores)");
 
+CAFFE2_DEFINE_bool(
+    caffe2_net_async_work_stealing,
+    false,
+    "Use a work-stealing thread pool for CPU chains");
+
 CAFFE2_DEFINE_bool(
     caffe2_net_async_check_stream_status,
     true,
@@ -76,6 +82,9 @@ AsyncNetBase::AsyncNetBase(
     chains_.push_back(kv.second);
   }
   chain_nodes_ = dag_utils::prepareChainGraphNodes(operator_nodes_, chains_);
+  if (FLAGS_caffe2_net_trace) {
+    trace_ids_ = tracing::RegisterOperators(Name(), operators_);
+  }
 
   events_.reserve(chains_.size());
   for (const auto& chain : chains_) {
@@ -97,7 +106,7 @@ AsyncNetBase::AsyncNetBase(
   }
 }
 
-std::shared_ptr<TaskThreadPool> AsyncNetBase::pool(
+std::shared_ptr<TaskThreadPoolBase> AsyncNetBase::pool(
     const DeviceOption& device_option) {
   if (FLAGS_caffe2_net_async_use_single_pool ||
       device_option.device_type() == CPU) {
@@ -219,15 +228,21 @@ void AsyncNetBase::asyncWait(
 bool AsyncNetBase::run(int task_id, int stream_id) {
   bool failed = false;
   std::string err_msg;
+  const bool trace = FLAGS_caffe2_net_trace && !trace_ids_.empty();
   for (auto& op_id : chains_[task_id]) {
     auto& op = operators_[op_id];
     try {
+      const uint64_t start_ns = trace ? tracing::NowNs() : 0;
       if (!op->RunAsync(stream_id)) {
         failed = true;
         err_msg = "Failed to execute task: op " +
             (op->has_debug_def() ? op->type() : " unknown");
         break;
       }
+      if (trace) {
+        tracing::RecordOperator(
+            trace_ids_[op_id], op, task_id, stream_id, start_ns);
+      }
     } catch (const std::exception& e) {
       failed = true;
       err_msg = e.what();
@@ -267,11 +282,11 @@ AsyncNetBase::~AsyncNetBase() {}
 
 CAFFE_DEFINE_SHARED_REGISTRY(
     ThreadPoolRegistry,
-    TaskThreadPool,
+    TaskThreadPoolBase,
     const DeviceOption&);
 
 namespace {
-std::shared_ptr<TaskThreadPool> AsyncNetCPUThreadPoolCreator(
+std::shared_ptr<TaskThreadPoolBase> AsyncNetCPUThreadPoolCreator(
     const DeviceOption& device_option) {
   CAFFE_ENFORCE_EQ(
       device_option.device_type(),
@@ -284,8 +299,8 @@ std::shared_ptr<TaskThreadPool> AsyncNetCPUThreadPoolCreator(
 CAFFE_REGISTER_CREATOR(ThreadPoolRegistry, CPU, AsyncNetCPUThreadPoolCreator);
 
 /* static */
-std::shared_ptr<TaskThreadPool> GetAsyncNetCPUThreadPool() {
-  static std::weak_ptr<TaskThreadPool> pool;
+std::shared_ptr<TaskThreadPoolBase> GetAsyncNetCPUThreadPool() {
+  static std::weak_ptr<TaskThreadPoolBase> pool;
   static std::mutex pool_mutex;
   std::lock_guard<std::mutex> lock(pool_mutex);
 
@@ -298,7 +313,11 @@ std::shared_ptr<TaskThreadPool> GetAsyncNetCPUThreadPool() {
       pool_size = num_cores;
     }
     LOG(INFO) << "Using cpu pool size: " << pool_size;
-    shared_pool = std::make_shared<TaskThreadPool>(pool_size);
+    if (FLAGS_caffe2_net_async_work_stealing) {
+      shared_pool = std::make_shared<WorkStealingThreadPool>(pool_size);
+    } else {
+      shared_pool = std::make_shared<TaskThreadPool>(pool_size);
+    }
     pool = shared_pool;
   }
   return shared_pool;
@@ -20,6 +20,7 @@
 #include "caffe2/core/common.h"
 #include "caffe2/core/net.h"
 #include "caffe2/core/net_dag_utils.h"
+#include "caffe2/core/net_trace.h"
 #include "caffe2/core/registry.h"
 #include "caffe2/core/stats.h"
 #include "caffe2/core/timer.h"
@@ -59,7 +60,7 @@ class AsyncNetBase : public NetBase {
       const std::vector<int>& wait_task_ids) const;
   bool run(int task_id, int stream_id);
   int stream(int task_id);
-  std::shared_ptr<TaskThreadPool> pool(const DeviceOption& device_option);
+  std::shared_ptr<TaskThreadPoolBase> pool(const DeviceOption& device_option);
 
   void finishTasks(const std::unordered_set<int>& task_ids);
   void finalizeEvents();
@@ -71,12 +72,13 @@ class AsyncNetBase : public NetBase {
   std::vector<dag_utils::OperatorNode> operator_nodes_;
   std::vector<std::vector<int>> chains_;
   std::vector<dag_utils::OpGraphNode> chain_nodes_; // chains' parents/children
+  std::vector<uint32_t> trace_ids_; // operator ids for tracing::RecordOperator
 
   // Pools and streams
   std::mutex pools_mutex_;
-  std::vector<std::shared_ptr<TaskThreadPool>> gpu_pools_;
-  std::shared_ptr<TaskThreadPool> cpu_pool_;
-  std::shared_ptr<TaskThreadPool> gpu_pool_;
+  std::vector<std::shared_ptr<TaskThreadPoolBase>> gpu_pools_;
+  std::shared_ptr<TaskThreadPoolBase> cpu_pool_;
+  std::shared_ptr<TaskThreadPoolBase> gpu_pool_;
   static thread_local std::vector<int> stream_counters_;
 
   DISABLE_COPY_AND_ASSIGN(AsyncNetBase);
@@ -84,10 +86,10 @@ class AsyncNetBase : public NetBase {
 
 CAFFE_DECLARE_SHARED_REGISTRY(
     ThreadPoolRegistry,
-    TaskThreadPool,
+    TaskThreadPoolBase,
     const DeviceOption&);
 
-std::shared_ptr<TaskThreadPool> GetAsyncNetCPUThreadPool();
+std::shared_ptr<TaskThreadPoolBase> GetAsyncNetCPUThreadPool();
 
 } // namespace caffe2
 
@@ -23,7 +23,7 @@ CAFFE2_DEFINE_int(caffe2_threads_per_gpu, 1, "Number of CPU threads per GPU");
 namespace caffe2 {
 
 namespace {
-std::shared_ptr<TaskThreadPool> AsyncNetGPUThreadPoolCreator(const DeviceOption& device_option)
+std::shared_ptr<TaskThreadPoolBase> AsyncNetGPUThreadPoolCreator(const DeviceOption& device_option)
 {
     CAFFE_ENFORCE_EQ(
         device_option.device_type(), HIP, "Unexpected device type for HIP thread pool");
@@ -16,6 +16,7 @@
 
 #include "caffe2/core/net_dag.h"
 
+#include <algorithm>
 #include <set>
 #include <stack>
 #include <unordered_map>
@@ -37,12 +38,26 @@ CAFFE2_DEFINE_bool(
     false,
     "Collect time stats in DAG net");
 
+CAFFE2_DEFINE_bool(
+    caffe2_dag_net_critical_path,
+    false,
+    "Run ready chains of DAG nets in decreasing order of the cost of their "
+    "longest path to the end of the net, instead of in FIFO order. Operator "
+    "costs come from the net's op_costs argument if present, and are "
+    "otherwise measured during the first runs of the net.");
+
+CAFFE2_DEFINE_int(
+    caffe2_dag_net_critical_path_profile_runs,
+    1,
+    "Number of runs over which DAG nets without an op_costs argument time "
+    "their operators when critical path scheduling is enabled.");
+
 namespace caffe2 {
 
 DAGNetBase::DAGNetBase(
     const std::shared_ptr<const NetDef>& net_def,
     Workspace* ws)
-    : NetBase(net_def, ws), iter_(0) {
+    : NetBase(net_def, ws), profile_runs_left_(0), profiling_(false), iter_(0) {
   // Blob creator allows us to track which operator created which blob.
   VLOG(1) << "Constructing DAGNet " << net_def->name();
 
@@ -57,6 +72,24 @@ DAGNetBase::DAGNetBase(
   for (const auto& node : operator_nodes_) {
     operators_.push_back(node.operator_.get());
   }
+  if (FLAGS_caffe2_net_trace) {
+    trace_ids_ = tracing::RegisterOperators(Name(), operators_);
+  }
+
+  chain_priorities_.assign(operator_nodes_.size(), 0);
+  if (FLAGS_caffe2_dag_net_critical_path) {
+    auto op_costs = ArgumentHelper(*net_def).GetRepeatedArgument<float>(
+        "op_costs", vector<float>(operator_nodes_.size(), 1));
+    // Until measured or given costs are available, every operator costs the
+    // same and the priority of a chain is the length of its longest path.
+    UpdateChainPriorities(op_costs);
+    // There is nothing to measure in a net without operators.
+    if (!ArgumentHelper::HasArgument(*net_def, "op_costs") &&
+        !operator_nodes_.empty()) {
+      profile_runs_left_ = FLAGS_caffe2_dag_net_critical_path_profile_runs;
+      profiled_op_costs_.assign(operator_nodes_.size(), 0);
+    }
+  }
 
   LOG(INFO) << "Number of parallel execution chains "
             << execution_chains_.size()
@@ -96,6 +129,14 @@ DAGNetBase::DAGNetBase(
   }
 }
 
+void DAGNetBase::UpdateChainPriorities(const vector<float>& op_costs) {
+  const auto op_priorities =
+      dag_utils::computeCriticalPathPriorities(operator_nodes_, op_costs);
+  for (const auto& chain : execution_chains_) {
+    chain_priorities_[chain.first] = op_priorities[chain.first];
+  }
+}
+
 DAGNetBase::~DAGNetBase() {
   if (job_queue_) {
     job_queue_->NoMoreJobs();
@@ -117,8 +158,9 @@ bool DAGNetBase::DoRunAsync() {
   success_ = true;
   iter_++;
   if (!job_queue_) {
-    job_queue_ = caffe2::make_unique<SimpleQueue<int>>();
+    job_queue_ = caffe2::make_unique<SimplePriorityQueue<int>>();
   }
+  profiling_ = profile_runs_left_ > 0;
   // Figure out number of workers to start.
   auto num_workers_to_start = num_workers_ - workers_.size();
 
@@ -137,7 +179,7 @@ bool DAGNetBase::DoRunAsync() {
     if (FLAGS_caffe2_dag_net_collect_stats) {
       task_timers_[value]->Start();
     }
-    job_queue_->Push(value);
+    job_queue_->Push(value, chain_priorities_[value]);
   }
   // Wait for failure or completed execution.
   {
@@ -172,6 +214,14 @@ bool DAGNetBase::DoRunAsync() {
         op.operator_->debug_def().type(),
         ") has some runtime parents left.");
   }
+  if (profiling_ && --profile_runs_left_ == 0) {
+    // Subclasses that do not time their operators leave all costs at zero.
+    if (*std::max_element(
+            profiled_op_costs_.begin(), profiled_op_costs_.end()) > 0) {
+      UpdateChainPriorities(profiled_op_costs_);
+    }
+    profiled_op_costs_.clear();
+  }
 
   StopAllObservers();
   // If the above while loop finished, we know that the current run finished.
@@ -262,7 +312,7 @@ void DAGNetBase::WorkerFunction() {
         if (FLAGS_caffe2_dag_net_collect_stats) {
           task_timers_[idx]->Start();
         }
-        job_queue_->Push(idx);
+        job_queue_->Push(idx, chain_priorities_[idx]);
       }
     }
 
@@ -308,6 +358,7 @@ vector<float> DAGNetBase::TEST_Benchmark(
 }
 
 bool DAGNet::RunAt(int chain_id, const std::vector<int>& chain) {
+  const bool trace = FLAGS_caffe2_net_trace && !trace_ids_.empty();
   for (const auto i : chain) {
 #ifdef CAFFE2_ENABLE_SDT
     const auto& op_name =
@@ -318,6 +369,7 @@ bool DAGNet::RunAt(int chain_id, const std::vector<int>& chain) {
     const auto& net_name = name_.c_str();
     CAFFE_SDT(operator_start, net_name, op_name, op_type, op_ptr);
 #endif
+    const uint64_t start_ns = (trace || profiling_) ? tracing::NowNs() : 0;
     const auto success = operator_nodes_[i].operator_->Run();
 #ifdef CAFFE2_ENABLE_SDT
     CAFFE_SDT(operator_done, net_name, op_name, op_type, op_ptr);
@@ -325,6 +377,17 @@ bool DAGNet::RunAt(int chain_id, const std::vector<int>& chain) {
     if (!success) {
       return false;
     }
+    if (profiling_) {
+      profiled_op_costs_[i] += tracing::NowNs() - start_ns;
+    }
+    if (trace) {
+      tracing::RecordOperator(
+          trace_ids_[i],
+          operator_nodes_[i].operator_.get(),
+          chain_id,
+          0,
+          start_ns);
+    }
   }
   if (FLAGS_caffe2_dag_net_collect_stats) {
     auto device_option =
@@ -29,6 +29,7 @@
 #include "caffe2/core/common.h"
 #include "caffe2/core/logging.h"
 #include "caffe2/core/net_dag_utils.h"
+#include "caffe2/core/net_trace.h"
 #include "caffe2/core/observer.h"
 #include "caffe2/core/operator_schema.h"
 #include "caffe2/core/registry.h"
@@ -60,6 +61,12 @@ class DAGNetBase : public NetBase {
     return execution_chains_;
   }
 
+  // Priority of every chain, indexed by the chain's first operator. All zero
+  // unless critical path scheduling is enabled.
+  const vector<double>& TEST_chain_priorities() const {
+    return chain_priorities_;
+  }
+
   vector<OperatorBase*> GetOperators() const override {
     return operators_;
   }
@@ -69,11 +76,23 @@ class DAGNetBase : public NetBase {
 
   virtual bool RunAt(int chain_id, const std::vector<int>& chain) = 0;
 
+  // Recomputes chain_priorities_ from the given per-operator costs.
+  void UpdateChainPriorities(const vector<float>& op_costs);
+
   vector<dag_utils::OperatorNode> operator_nodes_;
   vector<OperatorBase*> operators_;
+  vector<uint32_t> trace_ids_; // operator ids for tracing::RecordOperator
   dag_utils::ExecutionChains execution_chains_;
   vector<int> initial_frontier_;
-  std::unique_ptr<SimpleQueue<int>> job_queue_;
+  std::unique_ptr<SimplePriorityQueue<int>> job_queue_;
+
+  // Critical path scheduling state. While profiling_ is set, RunAt adds the
+  // time spent in every operator to profiled_op_costs_.
+  vector<double> chain_priorities_;
+  vector<float> profiled_op_costs_;
+  int profile_runs_left_;
+  bool profiling_;
+
   std::vector<std::thread> workers_;
   int num_workers_;
   int remaining_ops_;
@@ -303,6 +303,28 @@ ExecutionChains singleChains(std::vector<OperatorNode>& nodes) {
   return chains;
 }
 
+std::vector<double> computeCriticalPathPriorities(
+    const std::vector<OperatorNode>& nodes,
+    const std::vector<float>& op_costs) {
+  CAFFE_ENFORCE_EQ(
+      nodes.size(),
+      op_costs.size(),
+      "Need exactly one cost per operator to compute critical paths.");
+  std::vector<double> priorities(nodes.size(), 0);
+  // Operators only depend on operators earlier in the net, so children always
+  // have larger indices than their parents.
+  for (int idx = nodes.size() - 1; idx >= 0; --idx) {
+    CAFFE_ENFORCE_GE(op_costs[idx], 0, "Negative cost for operator ", idx);
+    double longest_child_path = 0;
+    for (const auto child : nodes[idx].children_) {
+      CAFFE_ENFORCE_GT(child, idx);
+      longest_child_path = std::max(longest_child_path, priorities[child]);
+    }
+    priorities[idx] = op_costs[idx] + longest_child_path;
+  }
+  return priorities;
+}
+
 std::vector<OperatorNode> prepareOperatorNodes(
     const std::shared_ptr<const NetDef>& net_def,
     Workspace* ws) {
@@ -62,6 +62,16 @@ ExecutionChains computeChains(std::vector<OperatorNode>& orig_nodes);
 
 ExecutionChains singleChains(std::vector<OperatorNode>& nodes);
 
+// Computes the bottom level of every operator: the total cost of the most
+// expensive dependency path from the operator to the end of the net, given
+// the (measured or estimated) cost of every operator. Running ready chains in
+// decreasing order of the bottom level of their first operator is the
+// critical path list scheduling heuristic, which keeps the longest remaining
+// path busy and shortens the makespan of wide nets.
+std::vector<double> computeCriticalPathPriorities(
+    const std::vector<OperatorNode>& nodes,
+    const std::vector<float>& op_costs);
+
 std::vector<OperatorNode> prepareOperatorNodes(
     const std::shared_ptr<const NetDef>& net_def,
     Workspace* ws);
@@ -22,6 +22,8 @@
 #include "caffe2/core/scope_guard.h"
 
 CAFFE2_DECLARE_bool(caffe2_disable_chaining);
+CAFFE2_DECLARE_bool(caffe2_dag_net_critical_path);
+CAFFE2_DECLARE_int(caffe2_dag_net_critical_path_profile_runs);
 
 namespace caffe2 {
 
@@ -638,4 +640,130 @@ TEST(NetTest, FailingOperator) {
   }
 }
 
+namespace {
+
+// A fork with a short branch (op 1) and a long branch (ops 2-4), joined by
+// op 5. The chains are {0}, {1}, {2, 3, 4} and {5}.
+const char* kCriticalPathSpec = R"DOC(
+        name: "example"
+        type: "dag"
+        external_input: "in"
+        op {
+          input: "in"
+          output: "hidden"
+          type: "NetTestDummy"
+        }
+        op {
+          input: "hidden"
+          output: "short"
+          type: "NetTestDummy"
+        }
+        op {
+          input: "hidden"
+          output: "long1"
+          type: "NetTestDummy"
+        }
+        op {
+          input: "long1"
+          output: "long2"
+          type: "NetTestDummy"
+        }
+        op {
+          input: "long2"
+          output: "long3"
+          type: "NetTestDummy"
+        }
+        op {
+          input: "short"
+          input: "long3"
+          output: "out"
+          type: "NetTestDummy"
+        }
+)DOC";
+
+std::vector<double> chainPriorities(const NetDef& net_def, int profile_runs) {
+  Workspace ws;
+  ws.CreateBlob("in");
+  auto old = FLAGS_caffe2_dag_net_critical_path;
+  auto old_runs = FLAGS_caffe2_dag_net_critical_path_profile_runs;
+  auto g = MakeGuard([&]() {
+    FLAGS_caffe2_dag_net_critical_path = old;
+    FLAGS_caffe2_dag_net_critical_path_profile_runs = old_runs;
+  });
+  FLAGS_caffe2_dag_net_critical_path = true;
+  FLAGS_caffe2_dag_net_critical_path_profile_runs = profile_runs;
+
+  std::unique_ptr<NetBase> net(CreateNet(net_def, &ws));
+  auto* dag = dynamic_cast_if_rtti<DAGNetBase*>(net.get());
+  CHECK_NOTNULL(dag);
+  EXPECT_EQ(4, dag->TEST_execution_chains().size());
+  testExecution(net, net_def.op().size());
+  return dag->TEST_chain_priorities();
+}
+
+} // namespace
+
+TEST(NetTest, CriticalPathPrioritiesUnitCosts) {
+  NetDef net_def;
+  CAFFE_ENFORCE(google::protobuf::TextFormat::ParseFromString(
+      kCriticalPathSpec, &net_def));
+  net_def.set_num_workers(4);
+  const auto priorities = chainPriorities(net_def, 0);
+  EXPECT_EQ(priorities[0], 5);
+  EXPECT_EQ(priorities[1], 2);
+  EXPECT_EQ(priorities[2], 4);
+  EXPECT_EQ(priorities[5], 1);
+}
+
+TEST(NetTest, CriticalPathPrioritiesGivenCosts) {
+  NetDef net_def;
+  CAFFE_ENFORCE(google::protobuf::TextFormat::ParseFromString(
+      kCriticalPathSpec, &net_def));
+  net_def.set_num_workers(4);
+  auto* arg = net_def.add_arg();
+  arg->set_name("op_costs");
+  for (float cost : {1, 5, 1, 1, 1, 1}) {
+    arg->add_floats(cost);
+  }
+  // The short branch is now the critical one.
+  const auto priorities = chainPriorities(net_def, 1);
+  EXPECT_EQ(priorities[0], 7);
+  EXPECT_EQ(priorities[1], 6);
+  EXPECT_EQ(priorities[2], 4);
+  EXPECT_EQ(priorities[5], 1);
+}
+
+TEST(NetTest, CriticalPathPrioritiesProfiled) {
+  NetDef net_def;
+  CAFFE_ENFORCE(google::protobuf::TextFormat::ParseFromString(
+      kCriticalPathSpec, &net_def));
+  net_def.set_num_workers(4);
+  const auto priorities = chainPriorities(net_def, 1);
+  // Measured priorities still grow towards the start of the net.
+  EXPECT_GT(priorities[0], priorities[1]);
+  EXPECT_GT(priorities[0], priorities[2]);
+  EXPECT_GT(priorities[1], priorities[5]);
+  EXPECT_GT(priorities[2], priorities[5]);
+  EXPECT_GT(priorities[5], 0);
+}
+
+TEST(NetTest, CriticalPathEmptyNet) {
+  NetDef net_def;
+  net_def.set_type("dag");
+  net_def.set_num_workers(2);
+  Workspace ws;
+  auto old = FLAGS_caffe2_dag_net_critical_path;
+  auto old_runs = FLAGS_caffe2_dag_net_critical_path_profile_runs;
+  auto g = MakeGuard([&]() {
+    FLAGS_caffe2_dag_net_critical_path = old;
+    FLAGS_caffe2_dag_net_critical_path_profile_runs = old_runs;
+  });
+  FLAGS_caffe2_dag_net_critical_path = true;
+  FLAGS_caffe2_dag_net_critical_path_profile_runs = 1;
+  std::unique_ptr<NetBase> net(CreateNet(net_def, &ws));
+  ASSERT_TRUE(net.get() != nullptr);
+  EXPECT_TRUE(net->Run());
+  EXPECT_TRUE(net->Run());
+}
+
 } // namespace caffe2
@@ -0,0 +1,323 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "caffe2/core/net_trace.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <unordered_map>
+
+#include "caffe2/core/logging.h"
+#include "caffe2/core/operator.h"
+
+CAFFE2_DEFINE_bool(
+    caffe2_net_trace,
+    false,
+    "If set, async and DAG nets created while it is set record a timeline "
+    "of their operator runs, which can be dumped as Chrome trace JSON. "
+    "See caffe2/core/net_trace.h.");
+CAFFE2_DEFINE_int(
+    caffe2_net_trace_buffer_size,
+    65536,
+    "Number of events kept by the trace ring buffer of every thread.");
+
+namespace caffe2 {
+namespace tracing {
+
+namespace {
+
+struct Event {
+  uint64_t start_ns;
+  uint64_t end_ns;
+  uint64_t output_bytes;
+  uint32_t op_id;
+  int32_t chain_id;
+  int32_t stream_id;
+};
+
+// A slot holds the event number it was last written with, plus one, or zero
+// while it is being written, so that readers can detect torn events.
+struct Slot {
+  std::atomic<uint64_t> seq{0};
+  Event event;
+};
+
+// A ring buffer with a single writer thread and any number of readers.
+class ThreadBuffer {
+ public:
+  ThreadBuffer(size_t capacity, int tid)
+      : capacity_(capacity), slots_(new Slot[capacity]), tid_(tid) {}
+
+  int tid() const {
+    return tid_;
+  }
+
+  void Push(const Event& event) {
+    const uint64_t index = head_.load(std::memory_order_relaxed);
+    Slot& slot = slots_[index % capacity_];
+    slot.seq.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.event = event;
+    slot.seq.store(index + 1, std::memory_order_release);
+    head_.store(index + 1, std::memory_order_release);
+  }
+
+  template <typename F>
+  void ForEach(F f) const {
+    const uint64_t head = head_.load(std::memory_order_acquire);
+    uint64_t begin = begin_.load(std::memory_order_relaxed);
+    if (head - begin > capacity_) {
+      begin = head - capacity_;
+    }
+    for (uint64_t i = begin; i < head; ++i) {
+      const Slot& slot = slots_[i % capacity_];
+      if (slot.seq.load(std::memory_order_acquire) != i + 1) {
+        continue;
+      }
+      const Event event = slot.event;
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (slot.seq.load(std::memory_order_relaxed) == i + 1) {
+        f(event);
+      }
+    }
+  }
+
+  void Clear() {
+    begin_.store(
+        head_.load(std::memory_order_acquire), std::memory_order_relaxed);
+  }
+
+ private:
+  const size_t capacity_;
+  std::unique_ptr<Slot[]> slots_;
+  const int tid_;
+  std::atomic<uint64_t> head_{0};
+  std::atomic<uint64_t> begin_{0};
+};
+
+struct OperatorInfo {
+  std::string net;
+  int index;
+  std::string type;
+  std::string name;
+};
+
+// Owns the buffers of all threads and the interned operator names. Buffers
+// of exited threads are handed to new threads, with their events.
+class TraceRegistry {
+ public:
+  ThreadBuffer* AcquireBuffer() {
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (!free_buffers_.empty()) {
+      auto* buffer = free_buffers_.back();
+      free_buffers_.pop_back();
+      return buffer;
+    }
+    CAFFE_ENFORCE_GT(FLAGS_caffe2_net_trace_buffer_size, 0);
+    buffers_.emplace_back(
+        new ThreadBuffer(FLAGS_caffe2_net_trace_buffer_size, buffers_.size()));
+    return buffers_.back().get();
+  }
+
+  void ReleaseBuffer(ThreadBuffer* buffer) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    free_buffers_.push_back(buffer);
+  }
+
+  uint32_t RegisterOperator(OperatorInfo info) {
+    std::string key = info.net + '\0' + caffe2::to_string(info.index) + '\0' +
+        info.type + '\0' + info.name;
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto it = operator_ids_.find(key);
+    if (it != operator_ids_.end()) {
+      return it->second;
+    }
+    const uint32_t id = operators_.size();
+    operators_.push_back(std::move(info));
+    operator_ids_.emplace(std::move(key), id);
+    return id;
+  }
+
+  template <typename F>
+  void ForEachEvent(F f) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    for (const auto& buffer : buffers_) {
+      buffer->ForEach([&](const Event& event) {
+        f(*buffer, operators_[event.op_id], event);
+      });
+    }
+  }
+
+  void Clear() {
+    std::lock_guard<std::mutex> guard(mutex_);
+    for (const auto& buffer : buffers_) {
+      buffer->Clear();
+    }
+  }
+
+ private:
+  std::mutex mutex_;
+  std::vector<std::unique_ptr<ThreadBuffer>> buffers_;
+  std::vector<ThreadBuffer*> free_buffers_;
+  std::vector<OperatorInfo> operators_;
+  std::unordered_map<std::string, uint32_t> operator_ids_;
+};
+
+// Leaked, since threads may exit after static destruction.
+TraceRegistry& registry() {
+  static auto* registry = new TraceRegistry();
+  return *registry;
+}
+
+struct ThreadBufferHolder {
+  ThreadBuffer* buffer{nullptr};
+  ~ThreadBufferHolder() {
+    if (buffer) {
+      registry().ReleaseBuffer(buffer);
+    }
+  }
+};
+
+ThreadBuffer* threadBuffer() {
+  static thread_local ThreadBufferHolder holder;
+  if (!holder.buffer) {
+    holder.buffer = registry().AcquireBuffer();
+  }
+  return holder.buffer;
+}
+
+void WriteJsonString(std::ostream& out, const std::string& value) {
+  out << '"';
+  for (const char c : value) {
+    if (c == '"' || c == '\\') {
+      out << '\\' << c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      out << ' ';
+    } else {
+      out << c;
+    }
+  }
+  out << '"';
+}
+
+} // namespace
+
+uint32_t RegisterOperator(
+    const std::string& net_name,
+    int op_index,
+    const OperatorBase& op) {
+  OperatorInfo info{net_name, op_index, "", ""};
+  if (op.has_debug_def()) {
+    info.type = op.debug_def().type();
+    info.name = op.debug_def().name();
+  }
+  return registry().RegisterOperator(std::move(info));
+}
+
+std::vector<uint32_t> RegisterOperators(
+    const std::string& net_name,
+    const std::vector<OperatorBase*>& ops) {
+  std::vector<uint32_t> ids;
+  ids.reserve(ops.size());
+  for (int i = 0; i < ops.size(); ++i) {
+    ids.push_back(RegisterOperator(net_name, i, *ops[i]));
+  }
+  return ids;
+}
+
+uint64_t NowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+void RecordOperator(
+    uint32_t op_id,
+    OperatorBase* op,
+    int chain_id,
+    int stream_id,
+    uint64_t start_ns) {
+  Event event;
+  event.start_ns = start_ns;
+  event.end_ns = NowNs();
+  event.output_bytes = 0;
+  for (const auto* blob : op->Outputs()) {
+    if (blob && blob->IsType<TensorCPU>()) {
+      event.output_bytes += blob->Get<TensorCPU>().nbytes();
+    }
+  }
+  event.op_id = op_id;
+  event.chain_id = chain_id;
+  event.stream_id = stream_id;
+  threadBuffer()->Push(event);
+}
+
+std::string DumpChromeTrace() {
+  std::ostringstream out;
+  out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+  bool first = true;
+  registry().ForEachEvent([&](
+      const ThreadBuffer& buffer,
+      const OperatorInfo& info,
+      const Event& event) {
+    if (!first) {
+      out << ",";
+    }
+    first = false;
+    out << "\n{\"name\":";
+    WriteJsonString(out, info.name.empty() ? info.type : info.name);
+    out << ",\"cat\":";
+    WriteJsonString(out, info.type);
+    // Timestamps are in microseconds.
+    char times[64];
+    const uint64_t duration_ns = event.end_ns - event.start_ns;
+    snprintf(
+        times,
+        sizeof(times),
+        "\"ts\":%llu.%03llu,\"dur\":%llu.%03llu",
+        static_cast<unsigned long long>(event.start_ns / 1000),
+        static_cast<unsigned long long>(event.start_ns % 1000),
+        static_cast<unsigned long long>(duration_ns / 1000),
+        static_cast<unsigned long long>(duration_ns % 1000));
+    out << ",\"ph\":\"X\",\"pid\":0,\"tid\":" << buffer.tid() << ","
+        << times << ",\"args\":{\"net\":";
+    WriteJsonString(out, info.net);
+    out << ",\"op_index\":" << info.index << ",\"chain\":" << event.chain_id
+        << ",\"stream\":" << event.stream_id
+        << ",\"output_bytes\":" << event.output_bytes << "}}";
+  });
+  out << "\n]}\n";
+  return out.str();
+}
+
+void WriteChromeTrace(const std::string& filename) {
+  std::ofstream file(filename);
+  CAFFE_ENFORCE(file.good(), "Cannot open trace file ", filename);
+  file << DumpChromeTrace();
+  CAFFE_ENFORCE(file.good(), "Failed to write trace file ", filename);
+}
+
+void ClearTrace() {
+  registry().Clear();
+}
+
+} // namespace tracing
+} // namespace caffe2
@@ -0,0 +1,83 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "caffe2/core/common.h"
+#include "caffe2/core/flags.h"
+
+CAFFE2_DECLARE_bool(caffe2_net_trace);
+
+namespace caffe2 {
+
+class OperatorBase;
+
+namespace tracing {
+
+// A timeline of operator runs in async and DAG nets, exported in the Chrome
+// trace event format (chrome://tracing, Perfetto).
+//
+// Recording is enabled by --caffe2_net_trace, for nets created while it is
+// set: their operators are only registered then. Every thread records into its
+// own ring buffer of --caffe2_net_trace_buffer_size events without locks,
+// overwriting its oldest events when the buffer is full. Each event holds the
+// start and end time of an operator run, the thread, the chain and stream
+// the operator ran in, and the total size of the CPU tensors it output.
+// Operators that run asynchronously, e.g. on GPUs, are recorded until they
+// were scheduled, not until they finished.
+
+// Operator names are interned once per net into ids, so that events are
+// fixed-size. Operators are told apart by their index in the net, as several
+// may share a type and have no name. Registering the same operator again,
+// e.g. for a net created again, returns the same id.
+uint32_t RegisterOperator(
+    const std::string& net_name,
+    int op_index,
+    const OperatorBase& op);
+
+// Registers all operators of a net, in order.
+std::vector<uint32_t> RegisterOperators(
+    const std::string& net_name,
+    const std::vector<OperatorBase*>& ops);
+
+// Monotonic time in nanoseconds, as used for events.
+uint64_t NowNs();
+
+// Records a run of the operator registered as op_id, which started at
+// start_ns and ends now.
+void RecordOperator(
+    uint32_t op_id,
+    OperatorBase* op,
+    int chain_id,
+    int stream_id,
+    uint64_t start_ns);
+
+// Returns the recorded events of all threads as Chrome trace JSON. May be
+// called while nets run; events recorded concurrently may be missing.
+std::string DumpChromeTrace();
+
+// Writes DumpChromeTrace() to a file.
+void WriteChromeTrace(const std::string& filename);
+
+// Drops all recorded events.
+void ClearTrace();
+
+} // namespace tracing
+} // namespace caffe2
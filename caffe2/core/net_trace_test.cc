@@ -0,0 +1,154 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include "caffe2/core/net.h"
+#include "caffe2/core/net_trace.h"
+#include "caffe2/core/operator.h"
+#include "caffe2/core/scope_guard.h"
+
+namespace caffe2 {
+
+namespace {
+
+// Outputs a tensor of `size` floats.
+class TraceTestOp final : public Operator<CPUContext> {
+ public:
+  TraceTestOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<CPUContext>(operator_def, ws),
+        size_(OperatorBase::GetSingleArgument<int>("size", 1)) {}
+
+  bool RunOnDevice() override {
+    Output(0)->Resize(size_);
+    Output(0)->mutable_data<float>();
+    return true;
+  }
+
+ private:
+  int size_;
+};
+
+REGISTER_CPU_OPERATOR(NetTraceTestOp, TraceTestOp);
+OPERATOR_SCHEMA(NetTraceTestOp).NumInputs(0, INT_MAX).NumOutputs(1);
+
+// in --> a --> b
+//   \--> c
+NetDef CreateTestNet(const string& type, const string& name) {
+  NetDef net;
+  net.set_name(name);
+  net.set_type(type);
+  net.set_num_workers(2);
+  auto add = [&](const string& op_name, const string& in, const string& out) {
+    auto* op = net.add_op();
+    op->set_name(op_name);
+    op->set_type("NetTraceTestOp");
+    op->add_input(in);
+    op->add_output(out);
+    op->add_arg()->CopyFrom(MakeArgument<int>("size", 8));
+  };
+  add("trace_a", "in", "a");
+  add("trace_b", "a", "b");
+  add("trace_c", "in", "c");
+  net.add_external_input("in");
+  return net;
+}
+
+size_t Count(const string& s, const string& pattern) {
+  size_t count = 0;
+  for (auto pos = s.find(pattern); pos != string::npos;
+       pos = s.find(pattern, pos + 1)) {
+    ++count;
+  }
+  return count;
+}
+
+} // namespace
+
+TEST(NetTraceTest, RecordsAsyncAndDAGNets) {
+  const bool old_trace = FLAGS_caffe2_net_trace;
+  auto guard = MakeGuard([&] { FLAGS_caffe2_net_trace = old_trace; });
+  FLAGS_caffe2_net_trace = true;
+  tracing::ClearTrace();
+
+  Workspace ws;
+  ws.CreateBlob("in")->GetMutable<TensorCPU>()->Resize(1);
+  for (const string type : {"dag", "async_scheduling"}) {
+    const string name = "trace_test_" + type;
+    std::unique_ptr<NetBase> net(CreateNet(CreateTestNet(type, name), &ws));
+    ASSERT_TRUE(net->Run());
+    ASSERT_TRUE(net->Run());
+  }
+
+  const string trace = tracing::DumpChromeTrace();
+  EXPECT_EQ(trace.find("{\"displayTimeUnit\":\"ns\",\"traceEvents\":["), 0);
+  for (const string type : {"dag", "async_scheduling"}) {
+    EXPECT_EQ(Count(trace, "\"net\":\"trace_test_" + type + "\""), 6);
+  }
+  EXPECT_EQ(Count(trace, "\"name\":\"trace_a\""), 4);
+  EXPECT_EQ(Count(trace, "\"cat\":\"NetTraceTestOp\""), 12);
+  EXPECT_EQ(Count(trace, "\"output_bytes\":32}"), 12);
+
+  tracing::ClearTrace();
+  EXPECT_EQ(Count(tracing::DumpChromeTrace(), "\"ph\":\"X\""), 0);
+}
+
+TEST(NetTraceTest, UnnamedOperatorsAreDistinct) {
+  const bool old_trace = FLAGS_caffe2_net_trace;
+  auto guard = MakeGuard([&] { FLAGS_caffe2_net_trace = old_trace; });
+  FLAGS_caffe2_net_trace = true;
+  tracing::ClearTrace();
+
+  Workspace ws;
+  ws.CreateBlob("in")->GetMutable<TensorCPU>()->Resize(1);
+  NetDef def = CreateTestNet("dag", "trace_test_unnamed");
+  for (auto& op : *def.mutable_op()) {
+    op.clear_name();
+  }
+  std::unique_ptr<NetBase> net(CreateNet(def, &ws));
+  ASSERT_TRUE(net->Run());
+
+  const string trace = tracing::DumpChromeTrace();
+  EXPECT_EQ(Count(trace, "\"name\":\"NetTraceTestOp\""), 3);
+  for (const string index : {"0", "1", "2"}) {
+    EXPECT_EQ(Count(trace, "\"op_index\":" + index + ","), 1);
+  }
+  tracing::ClearTrace();
+}
+
+TEST(NetTraceTest, NetsCreatedBeforeTracingAreNotTraced) {
+  tracing::ClearTrace();
+  Workspace ws;
+  ws.CreateBlob("in")->GetMutable<TensorCPU>()->Resize(1);
+  std::unique_ptr<NetBase> net(
+      CreateNet(CreateTestNet("dag", "trace_test_late"), &ws));
+  const bool old_trace = FLAGS_caffe2_net_trace;
+  auto guard = MakeGuard([&] { FLAGS_caffe2_net_trace = old_trace; });
+  FLAGS_caffe2_net_trace = true;
+  ASSERT_TRUE(net->Run());
+  EXPECT_EQ(Count(tracing::DumpChromeTrace(), "\"ph\":\"X\""), 0);
+}
+
+TEST(NetTraceTest, DisabledByDefault) {
+  tracing::ClearTrace();
+  Workspace ws;
+  ws.CreateBlob("in")->GetMutable<TensorCPU>()->Resize(1);
+  std::unique_ptr<NetBase> net(
+      CreateNet(CreateTestNet("dag", "trace_test_disabled"), &ws));
+  ASSERT_TRUE(net->Run());
+  EXPECT_EQ(Count(tracing::DumpChromeTrace(), "\"ph\":\"X\""), 0);
+}
+
+} // namespace caffe2
@@ -574,6 +574,83 @@ TensorShapes InferBlobShapesAndTypesFromMap(
   return InferBlobShapesAndTypes(blob_desc, nets);
 }
 
+static NetCost InferNetCost(
+    CaffeMap<string, TensorShape>& blob_desc,
+    const NetDef& net) {
+  NetCost cost;
+  cost.op_costs.resize(net.op_size());
+  cost.op_cost_known.resize(net.op_size(), false);
+  for (int idx = 0; idx < net.op_size(); ++idx) {
+    const OperatorDef& op = net.op(idx);
+    const OpSchema* op_schema = OpSchemaRegistry::Schema(op.type());
+    vector<TensorShape> input_desc;
+    bool found_all = true;
+    for (const string& in : op.input()) {
+      auto inp_desc = blob_desc.find(in);
+      if (inp_desc == blob_desc.end() || inp_desc->second.unknown_shape()) {
+        found_all = false;
+        break;
+      }
+      input_desc.push_back(inp_desc->second);
+    }
+
+    vector<TensorShape> out;
+    if (op_schema && found_all) {
+      if (op_schema->HasCostInferenceFunction()) {
+        try {
+          const auto c = op_schema->InferCost(op, input_desc);
+          cost.op_costs[idx] = c;
+          cost.op_cost_known[idx] = true;
+          cost.total.flops += c.flops;
+          cost.total.bytes_moved += c.bytes_moved;
+        } catch (const std::exception& e) {
+          LOG(WARNING) << "Cost inference failed for operator #" << idx
+                       << " (" << op.type() << "): " << e.what();
+        }
+      }
+      try {
+        out = op_schema->InferTensor(op, input_desc);
+      } catch (const std::exception& e) {
+        LOG(WARNING) << "Shape inference failed for operator #" << idx
+                     << " (" << op.type() << "): " << e.what();
+      }
+    }
+    // Outputs whose shapes are unknown must not keep the shapes of earlier
+    // writers of the same blobs.
+    for (int i = 0; i < op.output_size(); ++i) {
+      if (i < out.size()) {
+        blob_desc[op.output(i)] = out[i];
+      } else {
+        blob_desc.erase(op.output(i));
+      }
+    }
+  }
+  return cost;
+}
+
+NetCost InferNetCostFromWorkspace(Workspace* ws, const NetDef& net) {
+  CaffeMap<string, TensorShape> blob_desc;
+  for (const auto& s : ws->Blobs()) {
+    blob_desc[s] = GetTensorShapeOfBlob(ws->GetBlob(s));
+  }
+  return InferNetCost(blob_desc, net);
+}
+
+NetCost InferNetCostFromMap(
+    const CaffeMap<std::string, std::vector<TIndex>>& blob_dimensions,
+    const NetDef& net) {
+  CaffeMap<string, TensorShape> blob_desc;
+  for (const auto& blob : blob_dimensions) {
+    TensorShape tp;
+    for (auto d : blob.second) {
+      CAFFE_ENFORCE_GE(d, 0);
+      tp.add_dims(d);
+    }
+    blob_desc[blob.first] = tp;
+  }
+  return InferNetCost(blob_desc, net);
+}
+
 std::map<string, std::pair<DeviceOption, DeviceOption>> ValidateTensorDevices(
     OperatorBase& op,
     const OperatorDef& op_def) {
@@ -326,6 +326,14 @@ class OperatorBase : public Observable<OperatorBase> {
 // Operator is the class that you usually want to derive, if your operator will
 // run on different devices. You should then implement the RunOnDevice()
 // function.
+// Gives CPU operators access to the thread pool of their workspace for
+// CPUContext::ParallelFor; other contexts ignore the workspace.
+template <class Context>
+inline void SetContextWorkspace(Context* /* context */, Workspace* /* ws */) {}
+inline void SetContextWorkspace(CPUContext* context, Workspace* ws) {
+  context->set_workspace(ws);
+}
+
 template <class Context>
 class Operator : public OperatorBase {
  public:
@@ -334,6 +342,7 @@ class Operator : public OperatorBase {
     // In the constructor, we switch to the device so that the child class
     // constructors will run on that device.
     context_.SwitchToDevice(0);
+    SetContextWorkspace(&context_, ws);
   }
   ~Operator() noexcept override {}
 
@@ -843,6 +852,26 @@ TensorShapes InferBlobShapesAndTypesFromMap(
     const CaffeMap<std::string, std::vector<TIndex>>& blob_dimensions,
     const vector<std::unique_ptr<NetDef>>& nets);
 
+// Estimated cost of one run of a net, from the cost inference functions of
+// the operator schemas. Input shapes are propagated through the net with
+// shape inference, starting from the blobs in the workspace or from the given
+// blob dimensions.
+struct NetCost {
+  // One entry per operator of the net. Operators without a cost inference
+  // function, or whose input shapes could not be inferred, have a zero cost
+  // and false in op_cost_known.
+  vector<OpSchema::Cost> op_costs;
+  vector<bool> op_cost_known;
+  // Sum of the known operator costs.
+  OpSchema::Cost total;
+};
+
+NetCost InferNetCostFromWorkspace(Workspace* ws, const NetDef& net);
+
+NetCost InferNetCostFromMap(
+    const CaffeMap<std::string, std::vector<TIndex>>& blob_dimensions,
+    const NetDef& net);
+
 std::map<string, std::pair<DeviceOption, DeviceOption>> ValidateTensorDevices(
     OperatorBase& op,
     const OperatorDef& op_def);
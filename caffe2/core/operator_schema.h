@@ -27,6 +27,7 @@
 #include "caffe2/core/common.h"
 #include "caffe2/core/logging.h"
 #include "caffe2/core/registry.h"
+#include "caffe2/core/types.h"
 #include "caffe2/proto/caffe2.pb.h"
 
 namespace caffe2 {
@@ -184,8 +185,8 @@ class OpSchema {
    * an operator such as FLOPs and total memory use.
    */
   struct Cost {
-    uint64_t flops; // Floating point operations.
-    uint64_t bytes_moved; // Total memory used.
+    uint64_t flops{0}; // Floating point operations.
+    uint64_t bytes_moved{0}; // Bytes of the inputs read and outputs written.
   };
   /**
    * @brief Registers a function that takes in an OperatorDef
@@ -473,19 +474,37 @@ InferOpInputOutputDevice(const OperatorDef& op) {
   return op_schema->InferDevice(op);
 }
 
+// Helper functions for cost inference: the number of elements in the
+// dimensions of a shape starting at dim, and the number of bytes of a shape.
+inline uint64_t nElemFromDim(const TensorShape& X, int dim = 0) {
+  uint64_t nElem = 1;
+  for (int i = dim; i < X.dims_size(); ++i) {
+    nElem *= X.dims(i);
+  }
+  return nElem;
+}
+
+inline uint64_t nBytesOfShape(const TensorShape& X) {
+  if (X.data_type() == TensorProto_DataType_UNDEFINED) {
+    return 0;
+  }
+  return nElemFromDim(X) * DataTypeToTypeMeta(X.data_type()).itemsize();
+}
+
+// Cost of an elementwise op whose output has the shape of its first input:
+// OpsPerPoint flops per output element, every input read once and the output
+// written once.
 template <uint64_t OpsPerPoint>
 OpSchema::Cost PointwiseCostInference(
     const OperatorDef& /* unused */,
     const vector<TensorShape>& inputs) {
   struct OpSchema::Cost c;
   const TensorShape X = inputs[0];
-  uint64_t size = 1;
-
-  for (auto i = 0; i < X.dims().size(); ++i) {
-    size *= X.dims(i);
+  c.flops = nElemFromDim(X) * OpsPerPoint;
+  c.bytes_moved = nBytesOfShape(X);
+  for (const auto& input : inputs) {
+    c.bytes_moved += nBytesOfShape(input);
   }
-
-  c.flops = size * OpsPerPoint;
   return c;
 }
 
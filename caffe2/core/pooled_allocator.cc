@@ -0,0 +1,354 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "caffe2/core/pooled_allocator.h"
+
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+#include "caffe2/core/init.h"
+#include "caffe2/core/logging.h"
+
+CAFFE2_DEFINE_string(
+    caffe2_cpu_allocator,
+    "",
+    "The CPU allocator to use. Either empty or 'default' for the plain "
+    "posix_memalign based allocator, or 'pooled' for the caching allocator.");
+CAFFE2_DEFINE_int(
+    caffe2_cpu_pool_max_cached_mb,
+    1024,
+    "The maximum number of megabytes the pooled CPU allocator keeps in its "
+    "global free lists. Freed blocks beyond this go back to the system.");
+CAFFE2_DEFINE_int(
+    caffe2_cpu_pool_thread_cache_blocks,
+    4,
+    "The number of blocks per size class the pooled CPU allocator keeps in "
+    "each thread's local cache. 0 disables thread-local caching.");
+
+namespace caffe2 {
+
+namespace {
+
+// Size classes are powers of two from 64 bytes to 1 GB. Larger requests are
+// never cached.
+constexpr int kMinSizeClassLog2 = 6;
+constexpr int kMaxSizeClassLog2 = 30;
+constexpr int kNumSizeClasses = kMaxSizeClassLog2 - kMinSizeClassLog2 + 1;
+// Only blocks up to 1 MB are kept in thread-local caches, so that a thread
+// that goes idle does not hold on to a lot of memory.
+constexpr int kNumThreadCachedClasses = 20 - kMinSizeClassLog2 + 1;
+constexpr int kUncachedClass = -1;
+
+// Every block carries a header in front of the user pointer that records
+// which size class it belongs to, since MemoryDeleter only gets the pointer.
+// The header occupies a full alignment unit so the user pointer stays aligned.
+struct BlockHeader {
+  size_t nbytes;
+  int size_class;
+};
+static_assert(
+    sizeof(BlockHeader) <= gCaffe2Alignment,
+    "Block header must fit in one alignment unit.");
+
+inline BlockHeader* HeaderOf(void* data) {
+  return reinterpret_cast<BlockHeader*>(
+      static_cast<char*>(data) - gCaffe2Alignment);
+}
+
+inline void* DataOf(void* block) {
+  return static_cast<char*>(block) + gCaffe2Alignment;
+}
+
+inline int SizeClassOf(size_t nbytes) {
+  int log2 = kMinSizeClassLog2;
+  while (log2 <= kMaxSizeClassLog2 && (size_t(1) << log2) < nbytes) {
+    ++log2;
+  }
+  return log2 > kMaxSizeClassLog2 ? kUncachedClass : log2 - kMinSizeClassLog2;
+}
+
+inline size_t SizeOfClass(int size_class) {
+  return size_t(1) << (size_class + kMinSizeClassLog2);
+}
+
+void* SystemAlloc(size_t nbytes) {
+  void* block = nullptr;
+#ifdef __ANDROID__
+  block = memalign(gCaffe2Alignment, nbytes + gCaffe2Alignment);
+#elif defined(_MSC_VER)
+  block = _aligned_malloc(nbytes + gCaffe2Alignment, gCaffe2Alignment);
+#else
+  CAFFE_ENFORCE_EQ(
+      posix_memalign(&block, gCaffe2Alignment, nbytes + gCaffe2Alignment), 0);
+#endif
+  CAFFE_ENFORCE(block);
+  return DataOf(block);
+}
+
+void SystemFree(void* data) {
+  void* block = HeaderOf(data);
+#ifdef _MSC_VER
+  _aligned_free(block);
+#else
+  free(block);
+#endif
+}
+
+// The process-wide part of the pool. It is intentionally leaked so that
+// tensors destroyed during static destruction can still be freed.
+class GlobalPool {
+ public:
+  static GlobalPool& Get() {
+    static GlobalPool* pool = new GlobalPool();
+    return *pool;
+  }
+
+  void* Pop(int size_class) {
+    auto& list = lists_[size_class];
+    std::lock_guard<std::mutex> guard(list.mutex);
+    if (list.blocks.empty()) {
+      return nullptr;
+    }
+    void* data = list.blocks.back();
+    list.blocks.pop_back();
+    bytes_cached_ -= SizeOfClass(size_class);
+    return data;
+  }
+
+  // Returns false if the block would exceed the retention cap, in which case
+  // the caller owns it and should return it to the system.
+  bool Push(int size_class, void* data) {
+    const size_t size = SizeOfClass(size_class);
+    const size_t cap = size_t(FLAGS_caffe2_cpu_pool_max_cached_mb) << 20;
+    // Reserve the bytes before touching the list: the lists have separate
+    // mutexes, so the cap can only be enforced on the shared counter.
+    size_t cached = bytes_cached_.load();
+    do {
+      if (cached + size > cap) {
+        return false;
+      }
+    } while (!bytes_cached_.compare_exchange_weak(cached, cached + size));
+    auto& list = lists_[size_class];
+    std::lock_guard<std::mutex> guard(list.mutex);
+    list.blocks.push_back(data);
+    return true;
+  }
+
+  void Clear() {
+    for (int i = 0; i < kNumSizeClasses; ++i) {
+      auto& list = lists_[i];
+      std::lock_guard<std::mutex> guard(list.mutex);
+      for (void* data : list.blocks) {
+        SystemFree(data);
+      }
+      bytes_cached_ -= SizeOfClass(i) * list.blocks.size();
+      list.blocks.clear();
+    }
+  }
+
+  size_t bytes_cached() const {
+    return bytes_cached_;
+  }
+
+  std::atomic<size_t> cache_hits{0};
+  std::atomic<size_t> cache_misses{0};
+  std::atomic<size_t> bytes_in_use{0};
+  // Bytes held in the thread-local caches of all threads.
+  std::atomic<size_t> bytes_thread_cached{0};
+
+ private:
+  GlobalPool() {}
+
+  struct FreeList {
+    std::mutex mutex;
+    std::vector<void*> blocks;
+  };
+  FreeList lists_[kNumSizeClasses];
+  std::atomic<size_t> bytes_cached_{0};
+};
+
+// Set once the calling thread's cache has been destroyed, so that blocks
+// freed later during thread teardown go straight to the global pool.
+thread_local bool tls_cache_destroyed = false;
+
+class ThreadCache {
+ public:
+  ~ThreadCache() {
+    tls_cache_destroyed = true;
+    Flush();
+  }
+
+  void* Pop(int size_class) {
+    auto& blocks = blocks_[size_class];
+    if (blocks.empty()) {
+      return nullptr;
+    }
+    void* data = blocks.back();
+    blocks.pop_back();
+    GlobalPool::Get().bytes_thread_cached -= SizeOfClass(size_class);
+    return data;
+  }
+
+  bool Push(int size_class, void* data) {
+    auto& blocks = blocks_[size_class];
+    if (blocks.size() >= size_t(FLAGS_caffe2_cpu_pool_thread_cache_blocks)) {
+      return false;
+    }
+    blocks.push_back(data);
+    GlobalPool::Get().bytes_thread_cached += SizeOfClass(size_class);
+    return true;
+  }
+
+  // Moves all blocks to the global pool, or back to the system if the pool
+  // is full.
+  void Flush() {
+    auto& pool = GlobalPool::Get();
+    for (int i = 0; i < kNumThreadCachedClasses; ++i) {
+      for (void* data : blocks_[i]) {
+        pool.bytes_thread_cached -= SizeOfClass(i);
+        if (!pool.Push(i, data)) {
+          SystemFree(data);
+        }
+      }
+      blocks_[i].clear();
+    }
+  }
+
+ private:
+  std::vector<void*> blocks_[kNumThreadCachedClasses];
+};
+
+inline ThreadCache* GetThreadCache() {
+  if (tls_cache_destroyed) {
+    return nullptr;
+  }
+  static thread_local ThreadCache cache;
+  return &cache;
+}
+
+} // namespace
+
+std::pair<void*, MemoryDeleter> PooledCPUAllocator::New(size_t nbytes) {
+  auto& pool = GlobalPool::Get();
+  const int size_class = SizeClassOf(nbytes);
+  void* data = nullptr;
+  if (size_class == kUncachedClass) {
+    data = SystemAlloc(nbytes);
+    HeaderOf(data)->nbytes = nbytes;
+    HeaderOf(data)->size_class = kUncachedClass;
+    pool.cache_misses++;
+  } else {
+    if (size_class < kNumThreadCachedClasses) {
+      ThreadCache* cache = GetThreadCache();
+      if (cache) {
+        data = cache->Pop(size_class);
+      }
+    }
+    if (!data) {
+      data = pool.Pop(size_class);
+    }
+    if (data) {
+      pool.cache_hits++;
+    } else {
+      data = SystemAlloc(SizeOfClass(size_class));
+      HeaderOf(data)->nbytes = SizeOfClass(size_class);
+      HeaderOf(data)->size_class = size_class;
+      pool.cache_misses++;
+    }
+  }
+  pool.bytes_in_use += HeaderOf(data)->nbytes;
+  if (FLAGS_caffe2_cpu_allocator_do_zero_fill) {
+    memset(data, 0, nbytes);
+  }
+  return {data, Delete};
+}
+
+void PooledCPUAllocator::Delete(void* data) {
+  if (!data) {
+    return;
+  }
+  auto& pool = GlobalPool::Get();
+  const BlockHeader* header = HeaderOf(data);
+  const int size_class = header->size_class;
+  pool.bytes_in_use -= header->nbytes;
+  if (size_class == kUncachedClass) {
+    SystemFree(data);
+    return;
+  }
+  if (size_class < kNumThreadCachedClasses) {
+    ThreadCache* cache = GetThreadCache();
+    if (cache && cache->Push(size_class, data)) {
+      return;
+    }
+  }
+  if (!pool.Push(size_class, data)) {
+    SystemFree(data);
+  }
+}
+
+size_t PooledCPUAllocator::CachedBytes() const {
+  auto& pool = GlobalPool::Get();
+  return pool.bytes_cached() + pool.bytes_thread_cached;
+}
+
+PooledCPUAllocatorStats PooledCPUAllocator::GetStats() {
+  auto& pool = GlobalPool::Get();
+  PooledCPUAllocatorStats stats;
+  stats.cache_hits = pool.cache_hits;
+  stats.cache_misses = pool.cache_misses;
+  stats.bytes_in_use = pool.bytes_in_use;
+  stats.bytes_cached = pool.bytes_cached();
+  stats.bytes_thread_cached = pool.bytes_thread_cached;
+  return stats;
+}
+
+void PooledCPUAllocator::EmptyCache() {
+  ThreadCache* cache = GetThreadCache();
+  if (cache) {
+    cache->Flush();
+  }
+  GlobalPool::Get().Clear();
+}
+
+void Caffe2UsePooledCPUAllocator() {
+  VLOG(1) << "Caffe2: setting CPUAllocator to PooledCPUAllocator.";
+  SetCPUAllocator(new PooledCPUAllocator());
+}
+
+namespace {
+
+bool Caffe2SetCPUAllocatorFromFlags(int*, char***) {
+  if (FLAGS_caffe2_cpu_allocator == "" ||
+      FLAGS_caffe2_cpu_allocator == "default") {
+    return true;
+  } else if (FLAGS_caffe2_cpu_allocator == "pooled") {
+    Caffe2UsePooledCPUAllocator();
+    return true;
+  }
+  LOG(ERROR) << "Unrecognized CPU allocator: " << FLAGS_caffe2_cpu_allocator;
+  return false;
+}
+
+} // namespace
+
+REGISTER_CAFFE2_INIT_FUNCTION(
+    Caffe2SetCPUAllocatorFromFlags,
+    &Caffe2SetCPUAllocatorFromFlags,
+    "Set the CPU allocator according to --caffe2_cpu_allocator.");
+
+} // namespace caffe2
@@ -0,0 +1,82 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CAFFE2_CORE_POOLED_ALLOCATOR_H_
+#define CAFFE2_CORE_POOLED_ALLOCATOR_H_
+
+#include "caffe2/core/allocator.h"
+#include "caffe2/core/flags.h"
+
+CAFFE2_DECLARE_string(caffe2_cpu_allocator);
+CAFFE2_DECLARE_int(caffe2_cpu_pool_max_cached_mb);
+CAFFE2_DECLARE_int(caffe2_cpu_pool_thread_cache_blocks);
+
+namespace caffe2 {
+
+// Statistics of the pooled allocator. All counters are process-wide, as the
+// pool itself is shared by every PooledCPUAllocator instance.
+struct PooledCPUAllocatorStats {
+  // Number of New() calls served from a thread-local or global free list.
+  size_t cache_hits{0};
+  // Number of New() calls that had to go to the system allocator.
+  size_t cache_misses{0};
+  // Bytes currently handed out to callers (rounded up to size classes).
+  size_t bytes_in_use{0};
+  // Bytes currently retained in the global free lists. This is the amount
+  // capped by FLAGS_caffe2_cpu_pool_max_cached_mb.
+  size_t bytes_cached{0};
+  // Bytes currently retained in the thread-local caches of all threads.
+  size_t bytes_thread_cached{0};
+};
+
+// A CPU allocator that keeps freed blocks around for reuse instead of
+// returning them to the system allocator.
+//
+// Requests are rounded up to power-of-two size classes. Each thread first
+// looks at its own small per-class cache, then at a mutex-protected global
+// free list for the class, and only then calls posix_memalign. The global
+// free lists retain at most FLAGS_caffe2_cpu_pool_max_cached_mb megabytes;
+// anything beyond that, as well as requests larger than the biggest size
+// class, is returned to the system right away.
+//
+// The pool state is process-wide and outlives any PooledCPUAllocator, so
+// memory allocated before a SetCPUAllocator() call can still be freed with
+// the deleter it was handed out with.
+struct PooledCPUAllocator final : CPUAllocator {
+  PooledCPUAllocator() {}
+  ~PooledCPUAllocator() override {}
+  std::pair<void*, MemoryDeleter> New(size_t nbytes) override;
+  MemoryDeleter GetDeleter() override {
+    return Delete;
+  }
+  // Bytes retained in the global free lists and in all thread caches.
+  size_t CachedBytes() const override;
+
+  static void Delete(void* data);
+
+  // Returns a snapshot of the pool counters.
+  static PooledCPUAllocatorStats GetStats();
+  // Returns all blocks in the global free lists and the calling thread's
+  // cache to the system allocator.
+  static void EmptyCache();
+};
+
+// Installs a PooledCPUAllocator as the CPU allocator.
+void Caffe2UsePooledCPUAllocator();
+
+} // namespace caffe2
+
+#endif // CAFFE2_CORE_POOLED_ALLOCATOR_H_
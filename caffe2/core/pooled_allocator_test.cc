@@ -0,0 +1,151 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <thread>
+#include <vector>
+
+#include "caffe2/core/pooled_allocator.h"
+#include "caffe2/core/scope_guard.h"
+#include <gtest/gtest.h>
+
+namespace caffe2 {
+
+TEST(PooledCPUAllocatorTest, TestAllocAlignment) {
+  PooledCPUAllocator allocator;
+  for (int i = 0; i < 100; ++i) {
+    auto data = allocator.New(i * 37);
+    EXPECT_EQ((reinterpret_cast<size_t>(data.first) % gCaffe2Alignment), 0);
+    data.second(data.first);
+  }
+  PooledCPUAllocator::EmptyCache();
+}
+
+TEST(PooledCPUAllocatorTest, TestReuse) {
+  PooledCPUAllocator::EmptyCache();
+  PooledCPUAllocator allocator;
+  auto first = allocator.New(1000);
+  void* ptr = first.first;
+  first.second(ptr);
+  auto before = PooledCPUAllocator::GetStats();
+  // Same size class, so the block should come straight back.
+  auto second = allocator.New(1024);
+  EXPECT_EQ(second.first, ptr);
+  auto after = PooledCPUAllocator::GetStats();
+  EXPECT_EQ(after.cache_hits, before.cache_hits + 1);
+  EXPECT_EQ(after.cache_misses, before.cache_misses);
+  second.second(second.first);
+  PooledCPUAllocator::EmptyCache();
+}
+
+TEST(PooledCPUAllocatorTest, TestZeroFillOnReuse) {
+  PooledCPUAllocator allocator;
+  auto first = allocator.New(256);
+  memset(first.first, 0xff, 256);
+  first.second(first.first);
+  auto second = allocator.New(256);
+  const char* bytes = static_cast<const char*>(second.first);
+  if (FLAGS_caffe2_cpu_allocator_do_zero_fill) {
+    for (int i = 0; i < 256; ++i) {
+      EXPECT_EQ(bytes[i], 0);
+    }
+  }
+  second.second(second.first);
+  PooledCPUAllocator::EmptyCache();
+}
+
+TEST(PooledCPUAllocatorTest, TestBytesInUse) {
+  PooledCPUAllocator::EmptyCache();
+  PooledCPUAllocator allocator;
+  auto before = PooledCPUAllocator::GetStats();
+  auto data = allocator.New(100);
+  EXPECT_EQ(PooledCPUAllocator::GetStats().bytes_in_use,
+            before.bytes_in_use + 128);
+  data.second(data.first);
+  EXPECT_EQ(PooledCPUAllocator::GetStats().bytes_in_use, before.bytes_in_use);
+  PooledCPUAllocator::EmptyCache();
+  EXPECT_EQ(PooledCPUAllocator::GetStats().bytes_cached, 0);
+}
+
+TEST(PooledCPUAllocatorTest, TestCrossThreadFree) {
+  PooledCPUAllocator allocator;
+  std::vector<std::pair<void*, MemoryDeleter>> blocks;
+  for (int i = 0; i < 64; ++i) {
+    blocks.push_back(allocator.New(4096));
+  }
+  std::thread freer([&blocks]() {
+    for (auto& block : blocks) {
+      block.second(block.first);
+    }
+  });
+  freer.join();
+  // Blocks freed on the exited thread must have made it to the global pool.
+  EXPECT_GT(PooledCPUAllocator::GetStats().bytes_cached, 0);
+  PooledCPUAllocator::EmptyCache();
+}
+
+TEST(PooledCPUAllocatorTest, TestConcurrentFreeRespectsCap) {
+  PooledCPUAllocator::EmptyCache();
+  auto old_cap = FLAGS_caffe2_cpu_pool_max_cached_mb;
+  auto old_blocks = FLAGS_caffe2_cpu_pool_thread_cache_blocks;
+  auto g = MakeGuard([&]() {
+    FLAGS_caffe2_cpu_pool_max_cached_mb = old_cap;
+    FLAGS_caffe2_cpu_pool_thread_cache_blocks = old_blocks;
+  });
+  FLAGS_caffe2_cpu_pool_max_cached_mb = 1;
+  FLAGS_caffe2_cpu_pool_thread_cache_blocks = 0;
+
+  // Blocks of different size classes go to different free lists.
+  PooledCPUAllocator allocator;
+  std::vector<std::vector<std::pair<void*, MemoryDeleter>>> blocks(4);
+  for (int t = 0; t < blocks.size(); ++t) {
+    for (int i = 0; i < 16; ++i) {
+      blocks[t].push_back(allocator.New((64 << 10) << t));
+    }
+  }
+  std::vector<std::thread> freers;
+  for (auto& thread_blocks : blocks) {
+    freers.emplace_back([&thread_blocks]() {
+      for (auto& block : thread_blocks) {
+        block.second(block.first);
+      }
+    });
+  }
+  for (auto& freer : freers) {
+    freer.join();
+  }
+  EXPECT_LE(PooledCPUAllocator::GetStats().bytes_cached, 1 << 20);
+  PooledCPUAllocator::EmptyCache();
+}
+
+TEST(PooledCPUAllocatorTest, TestCachedBytesIncludesThreadCache) {
+  PooledCPUAllocator::EmptyCache();
+  auto old_blocks = FLAGS_caffe2_cpu_pool_thread_cache_blocks;
+  auto g = MakeGuard(
+      [&]() { FLAGS_caffe2_cpu_pool_thread_cache_blocks = old_blocks; });
+  FLAGS_caffe2_cpu_pool_thread_cache_blocks = 4;
+
+  PooledCPUAllocator allocator;
+  auto data = allocator.New(1024);
+  data.second(data.first);
+  auto stats = PooledCPUAllocator::GetStats();
+  EXPECT_EQ(stats.bytes_thread_cached, 1024);
+  EXPECT_EQ(allocator.CachedBytes(), stats.bytes_cached + 1024);
+  PooledCPUAllocator::EmptyCache();
+  EXPECT_EQ(PooledCPUAllocator::GetStats().bytes_thread_cached, 0);
+  EXPECT_EQ(allocator.CachedBytes(), 0);
+}
+
+} // namespace caffe2
@@ -18,6 +18,9 @@
 
 #include <unordered_set>
 
+#include "caffe2/core/operator.h"
+#include "caffe2/core/types.h"
+
 namespace caffe2 {
 
 namespace {
@@ -48,6 +51,24 @@ TensorCPU* extractOutputTensor(Workspace* ws, const std::string& name) {
   return blob->template GetMutable<TensorCPU>();
 }
 
+void bindArena(
+    Workspace* ws,
+    const memonger::StaticMemoryPlan& plan,
+    TensorCPU* arena) {
+  if (plan.assignments.empty()) {
+    return;
+  }
+  auto* base = static_cast<char*>(arena->raw_mutable_data());
+  for (const auto& assignment : plan.assignments) {
+    auto* tensor = ws->GetBlob(assignment.name)->GetMutable<TensorCPU>();
+    tensor->Resize(assignment.dims);
+    tensor->ShareExternalPointer(
+        base + assignment.offset,
+        DataTypeToTypeMeta(assignment.data_type),
+        assignment.nbytes);
+  }
+}
+
 const NetDef& getNet(const MetaNetDef& def, const std::string& name) {
   for (const auto& n : def.nets()) {
     if (n.key() == name) {
@@ -110,6 +131,7 @@ bool Predictor::run(const TensorVector& inputs, TensorVector* outputs) {
   for (auto i = 0; i < inputs.size(); ++i) {
     shareInputTensor(&ws_, run_net_.external_input(i), inputs[i]);
   }
+  bindArena(&ws_, memoryPlan_, &arena_);
 
   if (!ws_.RunNet(run_net_.name())) {
     return false;
@@ -132,6 +154,7 @@ bool Predictor::run_map(const TensorMap& inputs, TensorVector* outputs) {
     }
     shareInputTensor(&ws_, input.first, input.second);
   }
+  bindArena(&ws_, memoryPlan_, &arena_);
 
   if (!ws_.RunNet(run_net_.name())) {
     return false;
@@ -143,4 +166,17 @@ bool Predictor::run_map(const TensorMap& inputs, TensorVector* outputs) {
   }
   return true;
 }
+
+void Predictor::plan_memory(const TensorMap& inputs) {
+  for (auto input : inputs) {
+    shareInputTensor(&ws_, input.first, input.second);
+  }
+  vector<std::unique_ptr<NetDef>> nets;
+  nets.emplace_back(new NetDef(run_net_));
+  auto shapes = InferBlobShapesAndTypesFromWorkspace(&ws_, nets);
+  memoryPlan_ = memonger::plan_static_memory(run_net_, shapes, {});
+  arena_.Resize(memoryPlan_.arena_nbytes);
+  arena_.mutable_data<uint8_t>();
+  bindArena(&ws_, memoryPlan_, &arena_);
+}
 } // namespace caffe2
@@ -17,6 +17,7 @@
 #pragma once
 
 #include <unordered_set>
+#include "caffe2/core/memonger.h"
 #include "caffe2/core/net.h"
 #include "caffe2/core/tensor.h"
 #include "caffe2/proto/metanet.pb.h"
@@ -57,6 +58,17 @@ class Predictor {
   // Similar to run, but consumes a map of name to tensor as input
   bool run_map(const TensorMap& inputs, TensorVector* outputs);
 
+  // Plans the memory of `run_net` for inputs shaped like `inputs`: runs
+  // shape inference, packs all intermediate tensors into one pre-allocated
+  // arena, and makes the intermediate blobs alias into it on every run.
+  // Runs with differently shaped inputs still work; tensors that outgrow
+  // their slot simply fall back to regular allocation for that run.
+  void plan_memory(const TensorMap& inputs);
+
+  const memonger::StaticMemoryPlan& memory_plan() const {
+    return memoryPlan_;
+  }
+
   const NetDef& def() const {
     return run_net_;
   };
@@ -69,5 +81,7 @@ class Predictor {
   NetDef run_net_;
   Workspace ws_;
   std::unordered_set<std::string> inputNames_;
+  memonger::StaticMemoryPlan memoryPlan_;
+  TensorCPU arena_;
 };
 }
@@ -14,6 +14,8 @@
  * limitations under the License.
  */
 
+#include <cmath>
+
 #include <google/protobuf/text_format.h>
 #include "caffe2/core/context.h"
 #include "caffe2/core/operator.h"
@@ -43,6 +45,41 @@ const char* predictSpec = R"DOC(
         }
 )DOC";
 
+const char* plannedPredictSpec = R"DOC(
+        name: "planned"
+        type: "simple"
+        external_input: "data"
+        external_input: "W"
+        external_input: "b"
+        external_output: "y"
+        op {
+          input: "data"
+          input: "W"
+          input: "b"
+          output: "fc"
+          type: "FC"
+        }
+        op {
+          input: "fc"
+          output: "relu"
+          type: "Relu"
+        }
+        op {
+          input: "relu"
+          output: "scaled"
+          type: "Scale"
+          arg {
+            name: "scale"
+            f: 0.5
+          }
+        }
+        op {
+          input: "scaled"
+          output: "y"
+          type: "Sigmoid"
+        }
+)DOC";
+
 const char* initSpec = R"DOC(
         name: "init"
         type: "dag"
@@ -214,6 +251,42 @@ TEST_F(PredictorTest, SimpleBatchSizedMapInput) {
   EXPECT_NEAR(output.front()->data<float>()[4], 0.1209, 1E-4);
 }
 
+TEST_F(PredictorTest, PlannedMemory) {
+  Predictor planned(parseNetDef(initSpec), parseNetDef(plannedPredictSpec));
+  auto inputData = randomTensor({3, 4}, ctx_.get());
+  Predictor::TensorMap input{
+      {"data", inputData->template GetMutable<TensorCPU>()}};
+  planned.plan_memory(input);
+
+  // fc and scaled are never alive at the same time, so they share a slot.
+  const auto& plan = planned.memory_plan();
+  EXPECT_EQ(plan.assignments.size(), 3);
+  EXPECT_EQ(plan.arena_nbytes, 2 * 128);
+  std::unordered_map<std::string, size_t> offsets;
+  for (const auto& assignment : plan.assignments) {
+    offsets[assignment.name] = assignment.offset;
+  }
+  EXPECT_EQ(offsets["fc"], offsets["scaled"]);
+  EXPECT_NE(offsets["fc"], offsets["relu"]);
+
+  for (int iter = 0; iter < 2; ++iter) {
+    Predictor::TensorVector output;
+    EXPECT_TRUE(planned.run_map(input, &output));
+    EXPECT_EQ(output.size(), 1);
+    EXPECT_EQ(output.front()->dim(0), 3);
+    EXPECT_EQ(output.front()->dim(1), 10);
+    const float* x = inputData->Get<TensorCPU>().data<float>();
+    for (int i = 0; i < 3; ++i) {
+      float fc = 2.0;
+      for (int j = 0; j < 4; ++j) {
+        fc += 2.0 * x[i * 4 + j];
+      }
+      float expected = 1.0 / (1.0 + std::exp(-0.5 * std::max(fc, 0.0f)));
+      EXPECT_NEAR(output.front()->data<float>()[i * 10], expected, 1E-4);
+    }
+  }
+}
+
 class PredictorMetaNetDefTest : public testing::Test {
  public:
   void SetUp() override {
@@ -16,11 +16,134 @@
 
 #include "caffe2/core/stats.h"
 
+#include <algorithm>
 #include <condition_variable>
 #include <thread>
 
 namespace caffe2 {
 
+namespace detail {
+namespace {
+
+// Tracks the threads holding StatValue shards and the ids of StatValues.
+struct StatShards {
+  std::mutex mutex;
+  std::vector<ThreadStatCells*> threads;
+  // Per StatValue id, the counts of threads that have exited.
+  std::vector<int64_t> retired;
+  std::vector<size_t> freeIds;
+
+  static StatShards& get() {
+    // Leaked, so that it outlives the thread-local cells of every thread.
+    static StatShards* shards = new StatShards();
+    return *shards;
+  }
+
+  // Must hold mutex.
+  int64_t sum(size_t index) const {
+    int64_t total = retired[index];
+    const size_t block = index / ThreadStatCells::kBlockSize;
+    for (const auto* cells : threads) {
+      if (block < cells->blocks.size()) {
+        total += cells->blocks[block][index % ThreadStatCells::kBlockSize].load(
+            std::memory_order_relaxed);
+      }
+    }
+    return total;
+  }
+};
+
+} // namespace
+
+constexpr size_t ThreadStatCells::kBlockSize;
+
+ThreadStatCells::~ThreadStatCells() {
+  auto& shards = StatShards::get();
+  std::lock_guard<std::mutex> lock(shards.mutex);
+  for (size_t b = 0; b < blocks.size(); ++b) {
+    for (size_t i = 0; i < kBlockSize; ++i) {
+      const size_t index = b * kBlockSize + i;
+      if (index < shards.retired.size()) {
+        shards.retired[index] += blocks[b][i].load(std::memory_order_relaxed);
+      }
+    }
+  }
+  if (registered) {
+    shards.threads.erase(
+        std::find(shards.threads.begin(), shards.threads.end(), this));
+  }
+  blocks.clear();
+  destroyed = true;
+}
+
+StatCell* ThreadStatCells::grow(size_t index) {
+  if (destroyed) {
+    // Updates from thread-local destructors running after ours are dropped.
+    static thread_local StatCell dropped;
+    return &dropped;
+  }
+  auto& shards = StatShards::get();
+  std::lock_guard<std::mutex> lock(shards.mutex);
+  if (!registered) {
+    shards.threads.push_back(this);
+    registered = true;
+  }
+  while (blocks.size() <= index / kBlockSize) {
+    std::unique_ptr<StatCell[]> block(new StatCell[kBlockSize]);
+    for (size_t i = 0; i < kBlockSize; ++i) {
+      block[i].store(0, std::memory_order_relaxed);
+    }
+    blocks.push_back(std::move(block));
+  }
+  return &blocks[index / kBlockSize][index % kBlockSize];
+}
+
+} // namespace detail
+
+namespace {
+
+size_t allocateStatId() {
+  auto& shards = detail::StatShards::get();
+  std::lock_guard<std::mutex> lock(shards.mutex);
+  if (!shards.freeIds.empty()) {
+    const size_t index = shards.freeIds.back();
+    shards.freeIds.pop_back();
+    return index;
+  }
+  shards.retired.push_back(0);
+  return shards.retired.size() - 1;
+}
+
+} // namespace
+
+StatValue::StatValue() : index_(allocateStatId()) {
+  // A reused id may still have counts left in the cells of other threads.
+  auto& shards = detail::StatShards::get();
+  std::lock_guard<std::mutex> lock(shards.mutex);
+  offset_ = shards.sum(index_);
+}
+
+StatValue::~StatValue() {
+  auto& shards = detail::StatShards::get();
+  std::lock_guard<std::mutex> lock(shards.mutex);
+  shards.freeIds.push_back(index_);
+}
+
+int64_t StatValue::reset(int64_t value) {
+  auto& shards = detail::StatShards::get();
+  std::lock_guard<std::mutex> lock(shards.mutex);
+  const int64_t total = shards.sum(index_);
+  const int64_t previous = total - offset_;
+  offset_ = total - value;
+  return previous;
+}
+
+int64_t StatValue::get() const {
+  auto& shards = detail::StatShards::get();
+  std::lock_guard<std::mutex> lock(shards.mutex);
+  return shards.sum(index_) - offset_;
+}
+
 ExportedStatMap toMap(const ExportedStatList& stats) {
   ExportedStatMap statMap;
   for (const auto& stat : stats) {
@@ -27,21 +27,72 @@
 
 namespace caffe2 {
 
+namespace detail {
+
+using StatCell = std::atomic<int64_t>;
+
+// The calling thread's shards of all StatValues, indexed by StatValue id and
+// allocated in blocks. Only the owning thread writes to its cells, so plain
+// relaxed loads and stores are enough; StatValue::get() sums them up under
+// a global mutex, which also guards adding blocks.
+struct ThreadStatCells {
+  static constexpr size_t kBlockSize = 256;
+
+  ~ThreadStatCells();
+  StatCell* grow(size_t index);
+
+  std::vector<std::unique_ptr<StatCell[]>> blocks;
+  bool registered{false};
+  bool destroyed{false};
+};
+
+inline StatCell* threadStatCell(size_t index) {
+  static thread_local ThreadStatCells cells;
+  const size_t block = index / ThreadStatCells::kBlockSize;
+  if (block < cells.blocks.size()) {
+    return &cells.blocks[block][index % ThreadStatCells::kBlockSize];
+  }
+  return cells.grow(index);
+}
+
+} // namespace detail
+
+/**
+ * @brief A counter sharded per thread.
+ *
+ * increment() only touches a cell owned by the calling thread, without any
+ * lock or atomic read-modify-write, so hot code can update counters from
+ * many threads without contention. The shards are only summed up by get()
+ * and reset(), e.g. when the registry is published.
+ */
 class StatValue {
-  std::atomic<int64_t> v_{0};
+  const size_t index_;
+  int64_t offset_{0}; // guarded by the global shard mutex
 
  public:
+  StatValue();
+  ~StatValue();
+  StatValue(const StatValue&) = delete;
+  StatValue& operator=(const StatValue&) = delete;
+
+  /**
+   * Adds inc to the counter. Returns the new value of the calling thread's
+   * shard, which is the counter value only for single-threaded updates.
+   */
   int64_t increment(int64_t inc) {
-    return v_ += inc;
+    auto* cell = detail::threadStatCell(index_);
+    const int64_t value = cell->load(std::memory_order_relaxed) + inc;
+    cell->store(value, std::memory_order_relaxed);
+    return value;
   }
 
-  int64_t reset(int64_t value = 0) {
-    return v_.exchange(value);
-  }
+  /**
+   * Sets the counter to value and returns the previous one. Increments
+   * racing with reset() are counted in either of them, none is lost.
+   */
+  int64_t reset(int64_t value = 0);
 
-  int64_t get() const {
-    return v_.load();
-  }
+  int64_t get() const;
 };
 
 struct ExportedStatValue {
@@ -59,7 +110,7 @@ using ExportedStatMap = std::unordered_map<std::string, int64_t>;
 ExportedStatMap toMap(const ExportedStatList& stats);
 
 /**
- * @brief Holds a map of atomic counters keyed by name.
+ * @brief Holds a map of counters keyed by name.
  *
  * The StatRegistry singleton, accessed through StatRegistry::get(), holds
  * counters registered through the macro CAFFE_EXPORTED_STAT. Example of usage:
@@ -119,7 +170,8 @@ ExportedStatMap toMap(const ExportedStatList& stats);
  * The probe will be set up with the following arguments:
  *   - Probe name: field name (e.g. "num_runs")
  *   - Arg #0: instance name (e.g. "first", "second")
- *   - Arg #1: For CAFFE_EXPORTED_STAT, value of the updated counter
+ *   - Arg #1: For CAFFE_EXPORTED_STAT, value of the updated counter in the
+ *             calling thread (see StatValue::increment)
  *             For CAFFE_STAT, -1 since no counter is available
  *   - Args ...: Arguments passed to CAFFE_EVENT, including update value
  *             when provided.
@@ -224,7 +276,6 @@ class StdDevExportedStat : public ExportedStat {
   ExportedStat sumsqoffset_;
   ExportedStat sumoffset_;
   std::atomic<int64_t> first_{std::numeric_limits<int64_t>::min()};
-  int64_t const_min_{std::numeric_limits<int64_t>::min()};
 
  public:
   StdDevExportedStat(const std::string& gn, const std::string& n)
@@ -234,8 +285,12 @@ class StdDevExportedStat : public ExportedStat {
         sumoffset_(gn, n + "/sumoffset") {}
 
   int64_t increment(int64_t value = 1) {
-    first_.compare_exchange_strong(const_min_, value);
-    int64_t offset_value = first_.load();
+    int64_t offset_value = first_.load(std::memory_order_relaxed);
+    if (offset_value == std::numeric_limits<int64_t>::min()) {
+      // Only the first update sets the offset, the others just read it.
+      first_.compare_exchange_strong(offset_value, value);
+      offset_value = first_.load();
+    }
     int64_t orig_value = value;
     value -= offset_value;
     count_.increment();
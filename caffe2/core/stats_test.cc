@@ -133,5 +133,52 @@ TEST(StatsTest, StatsTestSimple) {
       toMap(reg2.publish()), ExportedStatMap({{"i1/s3", 0}, {"i2/s3", 0}}));
 }
 
+TEST(StatsTest, StatsTestConcurrentUpdates) {
+  struct TestStats {
+    CAFFE_STAT_CTOR(TestStats);
+    CAFFE_EXPORTED_STAT(count);
+  };
+  TestStats stats("concurrent");
+  const int kNumThreads = 8;
+  const int kNumUpdates = 10000;
+  int64_t published = 0;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kNumThreads; ++t) {
+    threads.emplace_back([&stats]() {
+      for (int i = 0; i < kNumUpdates; ++i) {
+        CAFFE_EVENT(stats, count);
+      }
+    });
+  }
+  // Resetting while the threads are running must not lose any update.
+  for (int i = 0; i < 10; ++i) {
+    published += toMap(StatRegistry::get().publish(true))["concurrent/count"];
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  // The counts of the exited threads are kept.
+  published += toMap(StatRegistry::get().publish(true))["concurrent/count"];
+  EXPECT_EQ(published, kNumThreads * kNumUpdates);
+  EXPECT_SUBSET(
+      toMap(StatRegistry::get().publish()),
+      ExportedStatMap({{"concurrent/count", 0}}));
+}
+
+TEST(StatsTest, StatsTestReusedCounter) {
+  {
+    StatRegistry reg;
+    reg.add("a")->increment(5);
+  }
+  // A new counter may reuse the shards of the deleted one, it must still
+  // start from zero.
+  StatRegistry reg;
+  auto* b = reg.add("b");
+  EXPECT_EQ(b->get(), 0);
+  b->increment(3);
+  EXPECT_EQ(b->reset(1), 3);
+  EXPECT_EQ(b->get(), 1);
+}
+
 } // namespace
 } // namespace caffe2
@@ -0,0 +1,62 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef CAFFE2_CORE_TEST_UTILS_H_
+#define CAFFE2_CORE_TEST_UTILS_H_
+
+#include <gtest/gtest.h>
+
+#include "caffe2/core/context.h"
+#include "caffe2/core/tensor.h"
+#include "caffe2/core/workspace.h"
+#include "caffe2/utils/math.h"
+
+// Helpers shared by the C++ tests. Only include this from *_test.cc files.
+
+namespace caffe2 {
+namespace testing {
+
+// Creates the blob `name` in ws, holding a float tensor of the given shape
+// filled with samples of a normal distribution with unit variance.
+inline void AddRandomInput(
+    const vector<TIndex>& shape,
+    const string& name,
+    Workspace* ws,
+    float mean = 0) {
+  DeviceOption option;
+  CPUContext context(option);
+  auto* tensor = ws->CreateBlob(name)->GetMutable<TensorCPU>();
+  tensor->Resize(shape);
+  math::RandGaussian<float, CPUContext>(
+      tensor->size(), mean, 1, tensor->mutable_data<float>(), &context);
+}
+
+// Expects two float tensors of the same shape whose elements differ by at
+// most tol.
+inline void
+ExpectNear(const TensorCPU& expected, const TensorCPU& actual, float tol) {
+  ASSERT_EQ(expected.dims(), actual.dims());
+  for (int i = 0; i < expected.size(); ++i) {
+    EXPECT_NEAR(expected.data<float>()[i], actual.data<float>()[i], tol)
+        << "at index " << i;
+  }
+}
+
+} // namespace testing
+} // namespace caffe2
+
+#endif // CAFFE2_CORE_TEST_UTILS_H_
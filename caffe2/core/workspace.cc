@@ -320,14 +320,15 @@ bool Workspace::RunPlan(const PlanDef& plan, ShouldContinue shouldContinue) {
   return RunPlanOnWorkspace(this, plan, shouldContinue);
 }
 
-#if CAFFE2_MOBILE
-ThreadPool* Workspace::GetThreadPool() {
+ThreadPool* Workspace::GetThreadPool() const {
+  if (shared_) {
+    return shared_->GetThreadPool();
+  }
   std::lock_guard<std::mutex> guard(thread_pool_creation_mutex_);
   if (!thread_pool_) {
     thread_pool_ = ThreadPool::defaultThreadPool();
   }
   return thread_pool_.get();
 }
-#endif // CAFFE2_MOBILE
 
 } // namespace caffe2
@@ -19,7 +19,17 @@
 namespace caffe2 {
 REGISTER_CPU_OPERATOR(CreateDB, CreateDBOp<CPUContext>);
 
-OPERATOR_SCHEMA(CreateDB).NumInputs(0).NumOutputs(1);
+OPERATOR_SCHEMA(CreateDB)
+    .NumInputs(0)
+    .NumOutputs(1)
+    .Arg("db_type", "(string, default leveldb) the type of the db")
+    .Arg("db", "(string) the path to the db")
+    .Arg("num_shards", "(int, default 1) number of shards to read the db in")
+    .Arg("shard_id", "(int, default 0) the shard this reader reads")
+    .Arg(
+        "prefetch",
+        "(int, default 0) if positive, read this many records ahead of the "
+        "readers on a background thread");
 
 NO_GRADIENT(CreateDB);
 }  // namespace caffe2
@@ -14,8 +14,10 @@
  * limitations under the License.
  */
 
+#include <chrono>
 #include <cstdio>
 #include <iomanip>
+#include <map>
 #include <sstream>
 #include <thread>
 
@@ -102,6 +104,10 @@ TEST(DBSeekTest, LMDB) {
   DBSeekTestWrapper("lmdb");
 }
 
+TEST(DBSeekTest, MmapDB) {
+  DBSeekTestWrapper("mmapdb");
+}
+
 TEST(DBReaderTest, Reader) {
   std::string name = std::tmpnam(nullptr);
   CreateAndFill("leveldb", name);
@@ -212,5 +218,108 @@ TEST(DBReaderShardedTest, Reader) {
   EXPECT_EQ(value, "05");
 }
 
+static std::vector<string> ReadKeys(const DBReader& reader, int n) {
+  std::vector<string> keys;
+  string key, value;
+  for (int i = 0; i < n; ++i) {
+    reader.Read(&key, &value);
+    EXPECT_EQ(key, value);
+    keys.push_back(key);
+  }
+  return keys;
+}
+
+TEST(DBReaderPrefetchTest, SameRecordsAsPlainReads) {
+  std::string name = std::tmpnam(nullptr);
+  CreateAndFill("minidb", name);
+  for (int num_shards : {1, 3}) {
+    DBReader plain("minidb", name, num_shards, num_shards - 1);
+    DBReader prefetching("minidb", name, num_shards, num_shards - 1);
+    prefetching.SetPrefetch(3);
+    EXPECT_EQ(ReadKeys(prefetching, 25), ReadKeys(plain, 25));
+    // Records read ahead are not lost when prefetching stops.
+    prefetching.SetPrefetch(0);
+    EXPECT_EQ(ReadKeys(prefetching, 5), ReadKeys(plain, 5));
+    prefetching.SetPrefetch(2);
+    prefetching.SeekToFirst();
+    plain.SeekToFirst();
+    EXPECT_EQ(ReadKeys(prefetching, 7), ReadKeys(plain, 7));
+  }
+}
+
+TEST(DBReaderPrefetchTest, ReadBatch) {
+  std::string name = std::tmpnam(nullptr);
+  CreateAndFill("minidb", name);
+  for (int prefetch : {0, 4}) {
+    DBReader reader("minidb", name);
+    reader.SetPrefetch(prefetch);
+    std::vector<string> keys, values;
+    reader.ReadBatch(4, &keys, &values);
+    EXPECT_EQ(keys, std::vector<string>({"00", "01", "02", "03"}));
+    EXPECT_EQ(values, keys);
+    reader.ReadBatch(8, &keys, &values);
+    EXPECT_EQ(
+        keys,
+        std::vector<string>(
+            {"04", "05", "06", "07", "08", "09", "00", "01"}));
+  }
+}
+
+TEST(DBReaderPrefetchTest, ReadBatchPastBufferAfterStop) {
+  std::string name = std::tmpnam(nullptr);
+  CreateAndFill("minidb", name);
+  DBReader reader("minidb", name);
+  reader.SetPrefetch(3);
+  std::vector<string> keys, values;
+  reader.ReadBatch(1, &keys, &values);
+  // Let the prefetch thread fill the ring, then stop it with records still
+  // buffered. The batch takes those first and the rest from the cursor.
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  reader.SetPrefetch(0);
+  // The cursor is only handed out once nothing is buffered.
+  ASSERT_THROW(reader.cursor(), EnforceNotMet);
+  reader.ReadBatch(6, &keys, &values);
+  EXPECT_EQ(
+      keys, std::vector<string>({"01", "02", "03", "04", "05", "06"}));
+  EXPECT_EQ(values, keys);
+}
+
+TEST(DBReaderPrefetchTest, ConcurrentReaders) {
+  std::string name = std::tmpnam(nullptr);
+  CreateAndFill("minidb", name);
+  DBReader reader("minidb", name);
+  reader.SetPrefetch(4);
+  const int kThreads = 4;
+  const int kBatches = 50;
+  std::vector<std::vector<string>> batches(kThreads * kBatches);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&, t]() {
+      std::vector<string> values;
+      for (int b = 0; b < kBatches; ++b) {
+        reader.ReadBatch(5, &batches[t * kBatches + b], &values);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  // Each batch is a run of consecutive records, and the batches together
+  // cover the db evenly.
+  std::map<string, int> counts;
+  for (const auto& batch : batches) {
+    for (int i = 1; i < batch.size(); ++i) {
+      EXPECT_EQ((std::stoi(batch[i - 1]) + 1) % kMaxItems, std::stoi(batch[i]));
+    }
+    for (const auto& key : batch) {
+      counts[key]++;
+    }
+  }
+  EXPECT_EQ(counts.size(), kMaxItems);
+  for (const auto& count : counts) {
+    EXPECT_EQ(count.second, kThreads * kBatches * 5 / kMaxItems);
+  }
+}
+
 }  // namespace db
 }  // namespace caffe2
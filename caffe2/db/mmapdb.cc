@@ -0,0 +1,555 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// MmapDB stores serialized tensors in a flat binary file that can be mapped
+// into memory and read without parsing or copying the tensor contents.
+//
+// File layout:
+//   header (kAlignment bytes): magic and format version.
+//   data: the raw contents of every tensor, each tensor in one contiguous
+//     region that starts at a multiple of kAlignment. The chunks written by
+//     the tensor serializer for the same blob go to their offsets inside the
+//     same region, so a chunked tensor is still contiguous on disk. Values
+//     that are not plain tensors (string tensors, other blob types, or
+//     arbitrary bytes) are stored verbatim.
+//   index: one record per key, sorted by key, holding the BlobProto of the
+//     value with the tensor data stripped, and the offset and size of its
+//     data.
+//   footer: index offset, number of index records and magic.
+//
+// The index is only written when the db is closed. When reading, the file is
+// mapped privately: tensors loaded by LoadOp alias the mapped pages, and
+// writing to such a tensor makes a private copy of the touched pages instead
+// of modifying the file.
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <map>
+
+#include "caffe2/core/db.h"
+#include "caffe2/core/logging.h"
+
+namespace caffe2 {
+namespace db {
+
+namespace {
+
+constexpr char kMagic[8] = {'C', '2', 'M', 'M', 'A', 'P', 'D', 'B'};
+constexpr uint32_t kVersion = 1;
+constexpr size_t kAlignment = 64;
+constexpr size_t kFooterSize = 2 * sizeof(uint64_t) + sizeof(kMagic);
+
+enum EntryKind : uint32_t {
+  // The data is the serialized value.
+  kRawValue = 0,
+  // The data is the contents of a whole tensor and the stub is the BlobProto
+  // of the value without its tensor data.
+  kTensor = 1,
+};
+
+struct Entry {
+  uint32_t kind;
+  string stub;
+  uint64_t offset;
+  uint64_t nbytes;
+};
+
+using Index = std::vector<std::pair<string, Entry>>;
+
+size_t AlignUp(size_t size) {
+  return (size + kAlignment - 1) / kAlignment * kAlignment;
+}
+
+template <typename T>
+void AppendPod(const T& value, string* out) {
+  out->append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+void AppendString(const string& value, string* out) {
+  AppendPod<uint32_t>(value.size(), out);
+  out->append(value);
+}
+
+class IndexReader {
+ public:
+  IndexReader(const char* data, size_t size) : data_(data), end_(data + size) {}
+
+  template <typename T>
+  T ReadPod() {
+    CAFFE_ENFORCE_LE(sizeof(T), end_ - data_, "Truncated mmapdb index.");
+    T value;
+    memcpy(&value, data_, sizeof(T));
+    data_ += sizeof(T);
+    return value;
+  }
+
+  string ReadString() {
+    const auto size = ReadPod<uint32_t>();
+    CAFFE_ENFORCE_LE(size, end_ - data_, "Truncated mmapdb index.");
+    string value(data_, size);
+    data_ += size;
+    return value;
+  }
+
+ private:
+  const char* data_;
+  const char* end_;
+};
+
+void WriteAt(int fd, const void* data, size_t size, uint64_t offset) {
+  const char* ptr = static_cast<const char*>(data);
+  while (size > 0) {
+    auto written = pwrite(fd, ptr, size, offset);
+    CAFFE_ENFORCE_GT(written, 0, "Failed to write mmapdb: ", strerror(errno));
+    ptr += written;
+    size -= written;
+    offset += written;
+  }
+}
+
+void ReadAt(int fd, void* data, size_t size, uint64_t offset) {
+  char* ptr = static_cast<char*>(data);
+  while (size > 0) {
+    auto num_read = pread(fd, ptr, size, offset);
+    CAFFE_ENFORCE_GT(num_read, 0, "Failed to read mmapdb: ", strerror(errno));
+    ptr += num_read;
+    size -= num_read;
+    offset += num_read;
+  }
+}
+
+// Parses the index of a file of the given size, whose footer and index are
+// read with the given function. Returns the offset at which the index starts.
+template <typename ReadFn>
+uint64_t ParseIndex(uint64_t file_size, ReadFn read, Index* index) {
+  CAFFE_ENFORCE_GE(
+      file_size, kAlignment + kFooterSize, "File is too small for mmapdb.");
+  char header[sizeof(kMagic) + sizeof(uint32_t)];
+  read(header, sizeof(header), 0);
+  CAFFE_ENFORCE(
+      memcmp(header, kMagic, sizeof(kMagic)) == 0, "Not an mmapdb file.");
+  uint32_t version;
+  memcpy(&version, header + sizeof(kMagic), sizeof(version));
+  CAFFE_ENFORCE_EQ(version, kVersion, "Unsupported mmapdb version.");
+
+  char footer[kFooterSize];
+  read(footer, kFooterSize, file_size - kFooterSize);
+  CAFFE_ENFORCE(
+      memcmp(footer + 2 * sizeof(uint64_t), kMagic, sizeof(kMagic)) == 0,
+      "The mmapdb file has no index. Was the db closed after writing?");
+  IndexReader footer_reader(footer, kFooterSize);
+  const auto index_offset = footer_reader.ReadPod<uint64_t>();
+  const auto num_entries = footer_reader.ReadPod<uint64_t>();
+  CAFFE_ENFORCE_LE(index_offset, file_size - kFooterSize);
+
+  string buffer(file_size - kFooterSize - index_offset, '\0');
+  read(&buffer[0], buffer.size(), index_offset);
+  IndexReader reader(buffer.data(), buffer.size());
+  index->clear();
+  index->reserve(num_entries);
+  for (uint64_t i = 0; i < num_entries; ++i) {
+    string key = reader.ReadString();
+    Entry entry;
+    entry.kind = reader.ReadPod<uint32_t>();
+    entry.stub = reader.ReadString();
+    entry.offset = reader.ReadPod<uint64_t>();
+    entry.nbytes = reader.ReadPod<uint64_t>();
+    CAFFE_ENFORCE(
+        entry.offset <= index_offset &&
+            entry.nbytes <= index_offset - entry.offset,
+        "Corrupted mmapdb index entry for key ",
+        key);
+    index->emplace_back(std::move(key), std::move(entry));
+  }
+  return index_offset;
+}
+
+} // namespace
+
+class MmapDBCursor : public Cursor {
+ public:
+  MmapDBCursor(
+      std::shared_ptr<void> mapping,
+      std::shared_ptr<const Index> index)
+      : mapping_(std::move(mapping)), index_(std::move(index)), iter_(0) {}
+  ~MmapDBCursor() {}
+
+  void Seek(const string& key) override {
+    iter_ = std::lower_bound(
+                index_->begin(),
+                index_->end(),
+                key,
+                [](const std::pair<string, Entry>& entry, const string& k) {
+                  return entry.first < k;
+                }) -
+        index_->begin();
+  }
+  bool SupportsSeek() override { return true; }
+  void SeekToFirst() override { iter_ = 0; }
+  void Next() override { ++iter_; }
+
+  string key() override {
+    CAFFE_ENFORCE(Valid(), "Cursor is at invalid location!");
+    return index_->at(iter_).first;
+  }
+
+  string value() override {
+    CAFFE_ENFORCE(Valid(), "Cursor is at invalid location!");
+    const auto& entry = index_->at(iter_).second;
+    if (entry.kind == kRawValue) {
+      return string(data(entry), entry.nbytes);
+    }
+    // Rebuild the serialized tensor around a view of the mapped contents.
+    BlobProto proto;
+    CAFFE_ENFORCE(proto.ParseFromString(entry.stub));
+    TensorProto* stub = proto.mutable_tensor();
+    TensorCPU tensor(
+        std::vector<TIndex>(stub->dims().begin(), stub->dims().end()));
+    tensor.ShareExternalPointer(
+        static_cast<void*>(const_cast<char*>(data(entry))),
+        DataTypeToTypeMeta(stub->data_type()),
+        entry.nbytes);
+    TIndex begin = 0;
+    TIndex end = tensor.size();
+    if (stub->has_segment()) {
+      begin = stub->segment().begin();
+      end = stub->segment().end();
+    }
+    TensorProto serialized;
+    TensorSerializer<CPUContext>().Serialize(
+        tensor, stub->name(), &serialized, begin, end - begin);
+    if (!stub->has_segment()) {
+      serialized.clear_segment();
+    }
+    serialized.clear_device_detail();
+    if (stub->has_device_detail()) {
+      serialized.mutable_device_detail()->Swap(stub->mutable_device_detail());
+    }
+    if (stub->has_name()) {
+      serialized.set_name(stub->name());
+    }
+    stub->Swap(&serialized);
+    return proto.SerializeAsString();
+  }
+
+  bool Valid() override { return iter_ < index_->size(); }
+
+  const void* TensorData(BlobProto* proto, std::shared_ptr<void>* owner)
+      override {
+    CAFFE_ENFORCE(Valid(), "Cursor is at invalid location!");
+    const auto& entry = index_->at(iter_).second;
+    if (entry.kind != kTensor) {
+      return nullptr;
+    }
+    CAFFE_ENFORCE(proto->ParseFromString(entry.stub));
+    *owner = mapping_;
+    return data(entry);
+  }
+
+ private:
+  const char* data(const Entry& entry) const {
+    return static_cast<const char*>(mapping_.get()) + entry.offset;
+  }
+
+  std::shared_ptr<void> mapping_;
+  std::shared_ptr<const Index> index_;
+  size_t iter_;
+};
+
+class MmapDB;
+
+class MmapDBTransaction : public Transaction {
+ public:
+  explicit MmapDBTransaction(MmapDB* db) : db_(db) {}
+  ~MmapDBTransaction() {
+    Commit();
+  }
+
+  void Put(const string& key, const string& value) override;
+
+  // Data is written to the file as it is put, and the index when the db is
+  // closed.
+  void Commit() override {}
+
+ private:
+  MmapDB* db_;
+
+  DISABLE_COPY_AND_ASSIGN(MmapDBTransaction);
+};
+
+class MmapDB : public DB {
+ public:
+  MmapDB(const string& source, Mode mode) : DB(source, mode), fd_(-1) {
+    switch (mode) {
+      case NEW:
+        fd_ = open(source.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        CAFFE_ENFORCE_GE(fd_, 0, "Cannot open file: ", source);
+        WriteHeader();
+        break;
+      case WRITE:
+        fd_ = open(source.c_str(), O_RDWR | O_CREAT, 0644);
+        CAFFE_ENFORCE_GE(fd_, 0, "Cannot open file: ", source);
+        if (FileSize() == 0) {
+          WriteHeader();
+        } else {
+          // New data overwrites the old index, which is rewritten on Close().
+          Index index;
+          end_ = ParseIndex(
+              FileSize(),
+              [this](void* data, size_t size, uint64_t offset) {
+                ReadAt(fd_, data, size, offset);
+              },
+              &index);
+          for (auto& entry : index) {
+            entries_.emplace(std::move(entry));
+          }
+        }
+        break;
+      case READ:
+        OpenForRead(source);
+        break;
+    }
+    VLOG(1) << "Opened MmapDB " << source;
+  }
+  ~MmapDB() { Close(); }
+
+  void Close() override {
+    if (fd_ >= 0) {
+      WriteIndex();
+      close(fd_);
+      fd_ = -1;
+    }
+    // Cursors and loaded tensors keep the mapping alive on their own.
+    mapping_.reset();
+    index_.reset();
+  }
+
+  unique_ptr<Cursor> NewCursor() override {
+    CAFFE_ENFORCE_EQ(this->mode_, READ);
+    CAFFE_ENFORCE(mapping_, "The db is closed.");
+    return make_unique<MmapDBCursor>(mapping_, index_);
+  }
+
+  unique_ptr<Transaction> NewTransaction() override {
+    CAFFE_ENFORCE(this->mode_ == NEW || this->mode_ == WRITE);
+    CAFFE_ENFORCE_GE(fd_, 0, "The db is closed.");
+    return make_unique<MmapDBTransaction>(this);
+  }
+
+ private:
+  friend class MmapDBTransaction;
+
+  // A tensor that chunks with the same blob name are written into.
+  struct Region {
+    TensorProto::DataType data_type;
+    std::vector<int64_t> dims;
+    uint64_t offset;
+    uint64_t nbytes;
+  };
+
+  uint64_t FileSize() {
+    struct stat st;
+    CAFFE_ENFORCE_EQ(fstat(fd_, &st), 0, strerror(errno));
+    return st.st_size;
+  }
+
+  void WriteHeader() {
+    char header[kAlignment] = {};
+    memcpy(header, kMagic, sizeof(kMagic));
+    memcpy(header + sizeof(kMagic), &kVersion, sizeof(kVersion));
+    WriteAt(fd_, header, sizeof(header), 0);
+    end_ = kAlignment;
+  }
+
+  void OpenForRead(const string& source) {
+    int fd = open(source.c_str(), O_RDONLY);
+    CAFFE_ENFORCE_GE(fd, 0, "Cannot open file: ", source);
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+      close(fd);
+      CAFFE_THROW("Cannot read mmapdb file: ", source);
+    }
+    const size_t size = st.st_size;
+    // A private writable mapping: tensors aliasing the file may be modified
+    // in place without ever writing back to it.
+    void* addr =
+        mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    CAFFE_ENFORCE(
+        addr != MAP_FAILED, "Cannot mmap file ", source, ": ", strerror(errno));
+    mapping_ = std::shared_ptr<void>(
+        addr, [size](void* ptr) { munmap(ptr, size); });
+    auto index = std::make_shared<Index>();
+    const char* base = static_cast<const char*>(addr);
+    ParseIndex(
+        size,
+        [base](void* data, size_t n, uint64_t offset) {
+          memcpy(data, base + offset, n);
+        },
+        index.get());
+    std::sort(
+        index->begin(),
+        index->end(),
+        [](const std::pair<string, Entry>& a,
+           const std::pair<string, Entry>& b) { return a.first < b.first; });
+    index_ = std::move(index);
+  }
+
+  void WriteIndex() {
+    string buffer;
+    for (const auto& iter : entries_) {
+      AppendString(iter.first, &buffer);
+      AppendPod(iter.second.kind, &buffer);
+      AppendString(iter.second.stub, &buffer);
+      AppendPod(iter.second.offset, &buffer);
+      AppendPod(iter.second.nbytes, &buffer);
+    }
+    AppendPod<uint64_t>(end_, &buffer);
+    AppendPod<uint64_t>(entries_.size(), &buffer);
+    buffer.append(kMagic, sizeof(kMagic));
+    WriteAt(fd_, buffer.data(), buffer.size(), end_);
+    CAFFE_ENFORCE_EQ(ftruncate(fd_, end_ + buffer.size()), 0, strerror(errno));
+  }
+
+  // Reserves nbytes of aligned space in the file.
+  uint64_t Allocate(uint64_t nbytes) {
+    const uint64_t offset = end_;
+    end_ = AlignUp(end_ + nbytes);
+    return offset;
+  }
+
+  // Returns the file offset of the region for the tensor described by stub,
+  // reserving a new one unless a matching region was created for an earlier
+  // chunk of the same blob.
+  uint64_t TensorRegion(
+      const string& blob_name,
+      const TensorProto& stub,
+      uint64_t nbytes) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto& region = regions_[blob_name];
+    const std::vector<int64_t> dims(stub.dims().begin(), stub.dims().end());
+    // Unsegmented tensors are never split, so each gets a fresh region.
+    if (!stub.has_segment() || region.nbytes != nbytes ||
+        region.data_type != stub.data_type() || region.dims != dims) {
+      region.data_type = stub.data_type();
+      region.dims = dims;
+      region.nbytes = nbytes;
+      region.offset = Allocate(nbytes);
+    }
+    return region.offset;
+  }
+
+  void AddEntry(const string& key, Entry entry) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    entries_[key] = std::move(entry);
+  }
+
+  uint64_t AllocateRaw(uint64_t nbytes) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    return Allocate(nbytes);
+  }
+
+  int fd_;
+  // Writing state. Data is written without holding the mutex: every Put owns
+  // the file range it writes to.
+  std::mutex mutex_;
+  uint64_t end_ = 0;
+  std::map<string, Entry> entries_;
+  std::map<string, Region> regions_;
+  // Reading state.
+  std::shared_ptr<void> mapping_;
+  std::shared_ptr<const Index> index_;
+};
+
+void MmapDBTransaction::Put(const string& key, const string& value) {
+  BlobProto proto;
+  bool is_tensor = proto.ParseFromString(value) &&
+      proto.type() == kTensorBlobType && proto.has_tensor() &&
+      !proto.has_content_num_chunks();
+  if (is_tensor) {
+    const auto data_type = proto.tensor().data_type();
+    is_tensor = data_type != TensorProto_DataType_UNDEFINED &&
+        data_type != TensorProto_DataType_STRING &&
+        data_type != TensorProto_DataType_BYTE;
+  }
+  int64_t size = 1;
+  if (is_tensor) {
+    for (const auto dim : proto.tensor().dims()) {
+      size *= dim;
+    }
+    // Empty tensors have nothing to alias.
+    is_tensor = size > 0;
+  }
+  if (!is_tensor) {
+    Entry entry{kRawValue, "", db_->AllocateRaw(value.size()), value.size()};
+    WriteAt(db_->fd_, value.data(), value.size(), entry.offset);
+    db_->AddEntry(key, std::move(entry));
+    return;
+  }
+
+  // Move the tensor contents out of the proto, leaving the stub that is
+  // stored in the index.
+  TensorProto* stub = proto.mutable_tensor();
+  TensorProto chunk;
+  chunk.mutable_float_data()->Swap(stub->mutable_float_data());
+  chunk.mutable_int32_data()->Swap(stub->mutable_int32_data());
+  chunk.mutable_byte_data()->swap(*stub->mutable_byte_data());
+  stub->clear_byte_data();
+  chunk.mutable_double_data()->Swap(stub->mutable_double_data());
+  chunk.mutable_int64_data()->Swap(stub->mutable_int64_data());
+  int64_t begin = 0;
+  int64_t end = size;
+  if (stub->has_segment()) {
+    begin = stub->segment().begin();
+    end = stub->segment().end();
+    CAFFE_ENFORCE(
+        0 <= begin && begin <= end && end <= size,
+        "Invalid tensor segment for key ",
+        key);
+  }
+  chunk.set_data_type(stub->data_type());
+  chunk.add_dims(end - begin);
+  chunk.mutable_device_detail()->set_device_type(CPU);
+  TensorCPU tensor;
+  TensorDeserializer<CPUContext>().Deserialize(chunk, &tensor);
+
+  const auto itemsize = tensor.itemsize();
+  const auto region = db_->TensorRegion(
+      key.substr(0, key.find(kChunkIdSeparator)), *stub, size * itemsize);
+  if (tensor.nbytes() > 0) {
+    WriteAt(
+        db_->fd_,
+        tensor.raw_data(),
+        tensor.nbytes(),
+        region + begin * itemsize);
+  }
+  Entry entry{kTensor, proto.SerializeAsString(), region, size * itemsize};
+  db_->AddEntry(key, std::move(entry));
+}
+
+REGISTER_CAFFE2_DB(MmapDB, MmapDB);
+// For lazy-minded, one can also call with lower-case name.
+REGISTER_CAFFE2_DB(mmapdb, MmapDB);
+
+} // namespace db
+} // namespace caffe2
@@ -0,0 +1,200 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "caffe2/observers/latency_observer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+#include "caffe2/core/logging.h"
+#include "caffe2/core/stats.h"
+
+namespace caffe2 {
+
+namespace {
+
+uint64_t ElapsedNs(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+void ExportHistogram(const std::string& prefix, const LatencyHistogram& h) {
+  auto& registry = StatRegistry::get();
+  registry.add(prefix + "/count")->reset(h.count());
+  registry.add(prefix + "/p50_ns")->reset(h.Percentile(0.5));
+  registry.add(prefix + "/p90_ns")->reset(h.Percentile(0.9));
+  registry.add(prefix + "/p99_ns")->reset(h.Percentile(0.99));
+  registry.add(prefix + "/max_ns")->reset(h.max());
+}
+
+void DescribeHistogram(
+    std::ostringstream& out,
+    const std::string& name,
+    const LatencyHistogram& h) {
+  out << name << ": count " << h.count() << ", p50 " << h.Percentile(0.5)
+      << " ns, p90 " << h.Percentile(0.9) << " ns, p99 " << h.Percentile(0.99)
+      << " ns, max " << h.max() << " ns\n";
+}
+
+} // namespace
+
+constexpr int LatencyHistogram::kSubBucketBits;
+constexpr int LatencyHistogram::kSubBuckets;
+constexpr int LatencyHistogram::kNumBuckets;
+
+LatencyHistogram::LatencyHistogram() {
+  Reset();
+}
+
+void LatencyHistogram::Reset() {
+  for (auto& bucket : buckets_) {
+    bucket.store(0, std::memory_order_relaxed);
+  }
+  count_.store(0, std::memory_order_relaxed);
+  max_.store(0, std::memory_order_relaxed);
+}
+
+int LatencyHistogram::BucketOf(uint64_t ns) {
+  if (ns < kSubBuckets) {
+    return ns;
+  }
+  const int exponent = 63 - __builtin_clzll(ns);
+  const int sub = (ns >> (exponent - kSubBucketBits)) & (kSubBuckets - 1);
+  return (exponent - kSubBucketBits + 1) * kSubBuckets + sub;
+}
+
+uint64_t LatencyHistogram::BucketUpperBound(int bucket) {
+  if (bucket < kSubBuckets) {
+    return bucket;
+  }
+  const int shift = bucket / kSubBuckets - 1;
+  const uint64_t lower = uint64_t(kSubBuckets + bucket % kSubBuckets) << shift;
+  return lower + ((uint64_t(1) << shift) - 1);
+}
+
+void LatencyHistogram::Add(uint64_t ns) {
+  buckets_[BucketOf(ns)].fetch_add(1, std::memory_order_relaxed);
+  count_.fetch_add(1, std::memory_order_relaxed);
+  uint64_t max = max_.load(std::memory_order_relaxed);
+  while (ns > max &&
+         !max_.compare_exchange_weak(max, ns, std::memory_order_relaxed)) {
+  }
+}
+
+uint64_t LatencyHistogram::Percentile(double q) const {
+  const uint64_t total = count();
+  if (total == 0) {
+    return 0;
+  }
+  const uint64_t rank =
+      std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(q * total)));
+  uint64_t seen = 0;
+  for (int i = 0; i < kNumBuckets; ++i) {
+    seen += buckets_[i].load(std::memory_order_relaxed);
+    if (seen >= rank) {
+      return std::min(BucketUpperBound(i), max());
+    }
+  }
+  return max();
+}
+
+void LatencyHistogramOperatorObserver::Start() {
+  active_ = histograms_->sampled.load(std::memory_order_relaxed);
+  if (active_) {
+    start_ = std::chrono::steady_clock::now();
+  }
+}
+
+void LatencyHistogramOperatorObserver::Stop() {
+  if (active_) {
+    const uint64_t ns = ElapsedNs(start_);
+    op_->Add(ns);
+    op_type_->Add(ns);
+  }
+}
+
+LatencyHistogramNetObserver::LatencyHistogramNetObserver(
+    NetBase* subject,
+    int sample_rate,
+    int export_interval,
+    const std::string& stats_name)
+    : ObserverBase<NetBase>(subject),
+      sample_rate_(sample_rate),
+      export_interval_(export_interval),
+      prefix_(stats_name + "/" + subject->Name()),
+      histograms_(std::make_shared<NetLatencyHistograms>()) {
+  CAFFE_ENFORCE_GT(sample_rate_, 0);
+  CAFFE_ENFORCE_GE(export_interval_, 0);
+  const auto& operators = subject->GetOperators();
+  for (int i = 0; i < operators.size(); ++i) {
+    auto* op = operators[i];
+    const auto& def = op->debug_def();
+    op_names_.push_back(
+        caffe2::to_string(i) + "_" +
+        (def.name().empty() ? def.type() : def.name()));
+    histograms_->ops.emplace_back(new LatencyHistogram());
+    auto& op_type = histograms_->op_types[def.type()];
+    if (!op_type) {
+      op_type.reset(new LatencyHistogram());
+    }
+    op->AttachObserver(caffe2::make_unique<LatencyHistogramOperatorObserver>(
+        op, histograms_, histograms_->ops.back().get(), op_type.get()));
+  }
+}
+
+void LatencyHistogramNetObserver::Start() {
+  const bool sampled = runs_++ % sample_rate_ == 0;
+  histograms_->sampled.store(sampled, std::memory_order_relaxed);
+  if (sampled) {
+    start_ = std::chrono::steady_clock::now();
+  }
+}
+
+void LatencyHistogramNetObserver::Stop() {
+  if (!histograms_->sampled.load(std::memory_order_relaxed)) {
+    return;
+  }
+  histograms_->net.Add(ElapsedNs(start_));
+  if (export_interval_ > 0 && ++sampled_runs_ % export_interval_ == 0) {
+    Export();
+  }
+}
+
+void LatencyHistogramNetObserver::Export() {
+  ExportHistogram(prefix_ + "/net", histograms_->net);
+  for (const auto& op_type : histograms_->op_types) {
+    ExportHistogram(prefix_ + "/op_type/" + op_type.first, *op_type.second);
+  }
+  for (int i = 0; i < op_names_.size(); ++i) {
+    ExportHistogram(prefix_ + "/op/" + op_names_[i], *histograms_->ops[i]);
+  }
+}
+
+std::string LatencyHistogramNetObserver::debugInfo() {
+  std::ostringstream out;
+  DescribeHistogram(out, "net " + subject_->Name(), histograms_->net);
+  for (const auto& op_type : histograms_->op_types) {
+    DescribeHistogram(out, "op type " + op_type.first, *op_type.second);
+  }
+  for (int i = 0; i < op_names_.size(); ++i) {
+    DescribeHistogram(out, "op " + op_names_[i], *histograms_->ops[i]);
+  }
+  return out.str();
+}
+
+} // namespace caffe2
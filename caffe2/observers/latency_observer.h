@@ -0,0 +1,157 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CAFFE2_OBSERVERS_LATENCY_OBSERVER_H_
+#define CAFFE2_OBSERVERS_LATENCY_OBSERVER_H_
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "caffe2/core/common.h"
+#include "caffe2/core/net.h"
+#include "caffe2/core/observer.h"
+#include "caffe2/core/operator.h"
+
+namespace caffe2 {
+
+/**
+ * A histogram of latencies in nanoseconds with log-scale buckets: every
+ * power of two is split into kSubBuckets buckets, so percentiles are exact
+ * to within 1 / kSubBuckets of their value. Add() is lock-free and may be
+ * called concurrently.
+ */
+class LatencyHistogram {
+ public:
+  static constexpr int kSubBucketBits = 2;
+  static constexpr int kSubBuckets = 1 << kSubBucketBits;
+  static constexpr int kNumBuckets = (64 - kSubBucketBits + 1) * kSubBuckets;
+
+  LatencyHistogram();
+
+  void Add(uint64_t ns);
+  void Reset();
+
+  uint64_t count() const {
+    return count_.load(std::memory_order_relaxed);
+  }
+  uint64_t max() const {
+    return max_.load(std::memory_order_relaxed);
+  }
+  // Upper bound of the bucket of the q-quantile, 0 < q <= 1, capped by the
+  // maximum. Returns 0 for an empty histogram.
+  uint64_t Percentile(double q) const;
+
+  static int BucketOf(uint64_t ns);
+  static uint64_t BucketUpperBound(int bucket);
+
+ private:
+  std::array<std::atomic<uint64_t>, kNumBuckets> buckets_;
+  std::atomic<uint64_t> count_;
+  std::atomic<uint64_t> max_;
+};
+
+// The histograms of a net and its operators, shared by the observers.
+struct NetLatencyHistograms {
+  std::atomic<bool> sampled{false};
+  LatencyHistogram net;
+  // One per operator, in net order.
+  std::vector<std::unique_ptr<LatencyHistogram>> ops;
+  // Aggregated over all operators of the same type.
+  std::map<std::string, std::unique_ptr<LatencyHistogram>> op_types;
+};
+
+class LatencyHistogramOperatorObserver final
+    : public ObserverBase<OperatorBase> {
+ public:
+  LatencyHistogramOperatorObserver(
+      OperatorBase* subject,
+      std::shared_ptr<NetLatencyHistograms> histograms,
+      LatencyHistogram* op,
+      LatencyHistogram* op_type)
+      : ObserverBase<OperatorBase>(subject),
+        histograms_(std::move(histograms)),
+        op_(op),
+        op_type_(op_type) {}
+
+ private:
+  void Start() override;
+  void Stop() override;
+
+  std::shared_ptr<NetLatencyHistograms> histograms_;
+  LatencyHistogram* op_;
+  LatencyHistogram* op_type_;
+  bool active_{false};
+  std::chrono::steady_clock::time_point start_;
+};
+
+/**
+ * Records latency histograms of every sample_rate-th run of a net, and of
+ * every operator and operator type in those runs. Runs that are not sampled
+ * cost one branch per operator.
+ *
+ * Every export_interval sampled runs, and whenever Export() is called, the
+ * count, p50, p90, p99 and max of every histogram are published to the
+ * StatRegistry under
+ *
+ *   <stats_name>/<net>/net/<stat>
+ *   <stats_name>/<net>/op_type/<type>/<stat>
+ *   <stats_name>/<net>/op/<index>_<name or type>/<stat>
+ *
+ * where <stat> is one of count, p50_ns, p90_ns, p99_ns and max_ns.
+ */
+class LatencyHistogramNetObserver final : public ObserverBase<NetBase> {
+ public:
+  explicit LatencyHistogramNetObserver(
+      NetBase* subject,
+      int sample_rate = 1,
+      int export_interval = 100,
+      const std::string& stats_name = "latency");
+
+  void Export();
+  std::string debugInfo() override;
+
+  const LatencyHistogram& net_histogram() const {
+    return histograms_->net;
+  }
+  const LatencyHistogram& op_histogram(int index) const {
+    return *histograms_->ops.at(index);
+  }
+  const LatencyHistogram& op_type_histogram(const std::string& type) const {
+    return *histograms_->op_types.at(type);
+  }
+
+ private:
+  void Start() override;
+  void Stop() override;
+
+  const int sample_rate_;
+  const int export_interval_;
+  const std::string prefix_;
+  std::vector<std::string> op_names_;
+  std::shared_ptr<NetLatencyHistograms> histograms_;
+  uint64_t runs_{0};
+  uint64_t sampled_runs_{0};
+  std::chrono::steady_clock::time_point start_;
+};
+
+} // namespace caffe2
+
+#endif // CAFFE2_OBSERVERS_LATENCY_OBSERVER_H_
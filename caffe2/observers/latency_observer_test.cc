@@ -0,0 +1,120 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "caffe2/core/common.h"
+#include "caffe2/core/net.h"
+#include "caffe2/core/operator.h"
+#include "caffe2/core/stats.h"
+#include "caffe2/observers/latency_observer.h"
+
+#include <gtest/gtest.h>
+#include <chrono>
+#include <thread>
+
+namespace caffe2 {
+
+namespace {
+
+class LatencySleepOp final : public OperatorBase {
+ public:
+  LatencySleepOp(const OperatorDef& operator_def, Workspace* ws)
+      : OperatorBase(operator_def, ws),
+        ms_(GetSingleArgument<int>("ms", 1)) {}
+
+  bool Run(int /* unused */) override {
+    StartAllObservers();
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms_));
+    StopAllObservers();
+    return true;
+  }
+
+ private:
+  int ms_;
+};
+
+REGISTER_CPU_OPERATOR(LatencySleepOp, LatencySleepOp);
+OPERATOR_SCHEMA(LatencySleepOp).NumInputs(0, 1).NumOutputs(0, 1);
+
+unique_ptr<NetBase> CreateNetTestHelper(Workspace* ws) {
+  NetDef net_def;
+  net_def.set_name("latency_test");
+  for (int ms : {1, 5}) {
+    auto& op = *net_def.add_op();
+    op.set_type("LatencySleepOp");
+    op.add_arg()->CopyFrom(MakeArgument<int>("ms", ms));
+  }
+  return CreateNet(net_def, ws);
+}
+
+} // namespace
+
+TEST(LatencyHistogramTest, Buckets) {
+  for (uint64_t ns : std::vector<uint64_t>{
+           0, 1, 3, 4, 7, 8, 9, 1000, 123456789, uint64_t(-1)}) {
+    const int bucket = LatencyHistogram::BucketOf(ns);
+    ASSERT_LT(bucket, LatencyHistogram::kNumBuckets);
+    EXPECT_GE(LatencyHistogram::BucketUpperBound(bucket), ns);
+    if (bucket > 0) {
+      EXPECT_LT(LatencyHistogram::BucketUpperBound(bucket - 1), ns);
+    }
+  }
+  // Buckets are at most 25% wide.
+  const int bucket = LatencyHistogram::BucketOf(1000000);
+  EXPECT_LE(LatencyHistogram::BucketUpperBound(bucket), 1250000);
+}
+
+TEST(LatencyHistogramTest, Percentiles) {
+  LatencyHistogram h;
+  EXPECT_EQ(h.Percentile(0.5), 0);
+  for (int i = 1; i <= 100; ++i) {
+    h.Add(i * 1000);
+  }
+  EXPECT_EQ(h.count(), 100);
+  EXPECT_EQ(h.max(), 100000);
+  EXPECT_GE(h.Percentile(0.5), 50000);
+  EXPECT_LE(h.Percentile(0.5), 50000 * 1.25);
+  EXPECT_GE(h.Percentile(0.99), 99000);
+  EXPECT_EQ(h.Percentile(1), 100000);
+}
+
+TEST(LatencyObserverTest, SamplesAndExports) {
+  Workspace ws;
+  unique_ptr<NetBase> net(CreateNetTestHelper(&ws));
+  const auto* ob = dynamic_cast_if_rtti<const LatencyHistogramNetObserver*>(
+      net->AttachObserver(make_unique<LatencyHistogramNetObserver>(
+          net.get(), 2, 0, "latency_observer_test")));
+  ASSERT_NE(ob, nullptr);
+  for (int i = 0; i < 5; ++i) {
+    ASSERT_TRUE(net->Run());
+  }
+  // Runs 0, 2 and 4 are sampled.
+  EXPECT_EQ(ob->net_histogram().count(), 3);
+  EXPECT_EQ(ob->op_histogram(0).count(), 3);
+  EXPECT_EQ(ob->op_histogram(1).count(), 3);
+  EXPECT_EQ(ob->op_type_histogram("LatencySleepOp").count(), 6);
+  EXPECT_GE(ob->op_histogram(1).Percentile(0.5), 5000000);
+  EXPECT_GE(ob->net_histogram().max(), 6000000);
+
+  const_cast<LatencyHistogramNetObserver*>(ob)->Export();
+  ExportedStatMap stats = toMap(StatRegistry::get().publish());
+  const string prefix = "latency_observer_test/latency_test/";
+  EXPECT_EQ(stats[prefix + "net/count"], 3);
+  EXPECT_EQ(stats[prefix + "op_type/LatencySleepOp/count"], 6);
+  EXPECT_EQ(stats[prefix + "op/1_LatencySleepOp/count"], 3);
+  EXPECT_GE(stats[prefix + "op/1_LatencySleepOp/p99_ns"], 5000000);
+}
+
+} // namespace caffe2
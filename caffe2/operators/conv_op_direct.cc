@@ -0,0 +1,145 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <vector>
+
+#include "caffe2/core/context.h"
+#include "caffe2/core/operator.h"
+#include "caffe2/operators/conv_pool_op_base.h"
+#include "caffe2/operators/fully_connected_op_packed.h"
+#include "caffe2/perfkernels/packed_gemm.h"
+
+namespace caffe2 {
+
+// Direct 1x1 convolution in NHWC order, without im2col.
+//
+// A 1x1 convolution in NHWC is a GEMM of the input pixels (rows of C
+// channels) with the M x C filter, and every run is a single pass of
+// PackedGemm that also adds the bias. The filter is either a PackedFCWeight
+// blob created by PackFCWeight from the M x 1 x 1 x C filter, or a filter
+// tensor that is packed on every run. The argument `cache_filter` keeps the
+// packed form of a filter tensor across runs, with the same caveats as
+// cache_packed_weight of PackedFullyConnectedOp. With stride 1 and no padding
+// the whole batch is one GEMM; otherwise the pixels of each output row are
+// gathered into a small buffer first, padding with zeros.
+class DirectConvOp final : public ConvPoolOpBase<CPUContext> {
+ public:
+  USE_CONV_POOL_BASE_FUNCTIONS(CPUContext);
+  DirectConvOp(const OperatorDef& operator_def, Workspace* ws)
+      : ConvPoolOpBase<CPUContext>(operator_def, ws),
+        cache_filter_(
+            OperatorBase::GetSingleArgument<bool>("cache_filter", false)) {
+    OPERATOR_NEEDS_FEATURE(
+        order_ == StorageOrder::NHWC, "Direct conv only supports NHWC.");
+    OPERATOR_NEEDS_FEATURE(
+        kernel_.size() == 2 && kernel_h() == 1 && kernel_w() == 1,
+        "Direct conv only supports 1x1 kernels.");
+    OPERATOR_NEEDS_FEATURE(
+        group_ == 1, "Group convolution not supported yet.");
+  }
+  ~DirectConvOp() {}
+
+  bool RunOnDeviceWithOrderNCHW() override {
+    CAFFE_THROW("Direct conv only supports NHWC.");
+  }
+  bool RunOnDeviceWithOrderNHWC() override;
+
+ private:
+  bool cache_filter_;
+  PackedFCWeight cached_;
+  std::vector<float> row_buffer_;
+
+  INPUT_TAGS(INPUT, FILTER, BIAS);
+};
+
+bool DirectConvOp::RunOnDeviceWithOrderNHWC() {
+  const auto& X = Input(INPUT);
+  auto* Y = Output(0);
+  CAFFE_ENFORCE_EQ(X.ndim(), 4);
+  const int N = X.dim32(0), H = X.dim32(1), W = X.dim32(2), C = X.dim32(3);
+
+  const PackedFCWeight* packed_filter = nullptr;
+  if (OperatorBase::InputIsType<PackedFCWeight>(FILTER)) {
+    packed_filter = &OperatorBase::Input<PackedFCWeight>(FILTER);
+    CAFFE_ENFORCE_EQ(packed_filter->K, C);
+  } else {
+    const auto& filter = Input(FILTER);
+    CAFFE_ENFORCE_EQ(filter.ndim(), 4);
+    CAFFE_ENFORCE_EQ(filter.dim32(1), 1);
+    CAFFE_ENFORCE_EQ(filter.dim32(2), 1);
+    CAFFE_ENFORCE_EQ(filter.dim32(3), C);
+    if (!cache_filter_ || !cached_.IsPackedFrom(filter)) {
+      cached_.Pack(filter, filter.dim(0), C);
+    }
+    packed_filter = &cached_;
+  }
+  const TIndex M = packed_filter->N;
+  ConvPoolOpBase<CPUContext>::SetOutputSize(X, Y, M);
+  const int output_h = Y->dim32(1);
+  const int output_w = Y->dim32(2);
+
+  const float* bias = nullptr;
+  if (InputSize() == 3) {
+    const auto& b = Input(BIAS);
+    CAFFE_ENFORCE_EQ(b.ndim(), 1);
+    CAFFE_ENFORCE_EQ(b.dim32(0), M);
+    bias = b.data<float>();
+  }
+  const float* packed = packed_filter->data.data();
+  const float* Xdata = X.data<float>();
+  float* Ydata = Y->mutable_data<float>();
+  if (Y->size() == 0) {
+    return true;
+  }
+
+  if (stride_h() == 1 && stride_w() == 1 && pad_t() == 0 && pad_l() == 0 &&
+      output_h == H && output_w == W) {
+    PackedGemm(TIndex(N) * H * W, M, C, Xdata, packed, bias, Ydata);
+    return true;
+  }
+
+  row_buffer_.resize(output_w * C);
+  for (int n = 0; n < N; ++n) {
+    for (int y = 0; y < output_h; ++y) {
+      const int h = y * stride_h() - pad_t();
+      for (int x = 0; x < output_w; ++x) {
+        const int w = x * stride_w() - pad_l();
+        float* dst = row_buffer_.data() + x * C;
+        if (h >= 0 && h < H && w >= 0 && w < W) {
+          const float* src = Xdata + ((TIndex(n) * H + h) * W + w) * C;
+          std::copy(src, src + C, dst);
+        } else {
+          std::fill(dst, dst + C, 0.f);
+        }
+      }
+      PackedGemm(
+          output_w,
+          M,
+          C,
+          row_buffer_.data(),
+          packed,
+          bias,
+          Ydata + (TIndex(n) * output_h + y) * output_w * M);
+    }
+  }
+  return true;
+}
+
+REGISTER_CPU_OPERATOR_WITH_ENGINE(Conv, DIRECT, DirectConvOp);
+REGISTER_CPU_OPERATOR_WITH_ENGINE(Conv2D, DIRECT, DirectConvOp);
+
+} // namespace caffe2
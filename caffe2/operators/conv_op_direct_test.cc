@@ -0,0 +1,133 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "caffe2/core/operator.h"
+#include "caffe2/core/test_utils.h"
+#include <gtest/gtest.h>
+
+namespace caffe2 {
+
+namespace {
+
+using testing::AddRandomInput;
+using testing::ExpectNear;
+
+unique_ptr<OperatorBase> CreateConv(
+    const string& engine,
+    int stride,
+    int pad,
+    bool bias,
+    const string& W,
+    const string& Y,
+    Workspace* ws) {
+  OperatorDef def;
+  def.set_type("Conv");
+  def.set_engine(engine);
+  def.add_input("X");
+  def.add_input(W);
+  if (bias) {
+    def.add_input("B");
+  }
+  def.add_output(Y);
+  def.add_arg()->CopyFrom(MakeArgument<int>("kernel", 1));
+  def.add_arg()->CopyFrom(MakeArgument<int>("stride", stride));
+  def.add_arg()->CopyFrom(MakeArgument<int>("pad", pad));
+  def.add_arg()->CopyFrom(MakeArgument<string>("order", "NHWC"));
+  return CreateOperator(def, ws);
+}
+
+} // namespace
+
+TEST(DirectConvTest, MatchesDefaultEngine) {
+  for (const int stride : {1, 2}) {
+    for (const int pad : {0, 1}) {
+      for (const bool bias : {false, true}) {
+        Workspace ws;
+        AddRandomInput(vector<TIndex>{2, 7, 5, 11}, "X", &ws);
+        AddRandomInput(vector<TIndex>{13, 1, 1, 11}, "W", &ws);
+        AddRandomInput(vector<TIndex>{13}, "B", &ws);
+        auto def_op = CreateConv("", stride, pad, bias, "W", "Y", &ws);
+        auto direct_op =
+            CreateConv("DIRECT", stride, pad, bias, "W", "Y_direct", &ws);
+        ASSERT_NE(nullptr, def_op.get());
+        ASSERT_NE(nullptr, direct_op.get());
+        EXPECT_EQ(direct_op->engine(), "DIRECT");
+        ASSERT_TRUE(def_op->Run());
+        ASSERT_TRUE(direct_op->Run());
+        ExpectNear(
+            ws.GetBlob("Y")->Get<TensorCPU>(),
+            ws.GetBlob("Y_direct")->Get<TensorCPU>(),
+            1e-4);
+      }
+    }
+  }
+}
+
+TEST(DirectConvTest, PackedFilterMatchesDefaultEngine) {
+  Workspace ws;
+  AddRandomInput(vector<TIndex>{2, 7, 5, 11}, "X", &ws);
+  AddRandomInput(vector<TIndex>{13, 1, 1, 11}, "W", &ws);
+  AddRandomInput(vector<TIndex>{13}, "B", &ws);
+  OperatorDef pack_def;
+  pack_def.set_type("PackFCWeight");
+  pack_def.add_input("W");
+  pack_def.add_output("W_packed");
+  auto pack_op = CreateOperator(pack_def, &ws);
+  auto def_op = CreateConv("", 2, 1, true, "W", "Y", &ws);
+  auto tensor_op = CreateConv("DIRECT", 2, 1, true, "W", "Y_tensor", &ws);
+  auto packed_op =
+      CreateConv("DIRECT", 2, 1, true, "W_packed", "Y_packed", &ws);
+  ASSERT_NE(nullptr, pack_op.get());
+  ASSERT_NE(nullptr, def_op.get());
+  ASSERT_NE(nullptr, tensor_op.get());
+  ASSERT_NE(nullptr, packed_op.get());
+  // The second pass negates W in place: the tensor filter is packed again
+  // on its own, the packed filter once PackFCWeight runs again.
+  for (int pass = 0; pass < 2; ++pass) {
+    if (pass == 1) {
+      auto* W = ws.GetBlob("W")->GetMutable<TensorCPU>();
+      for (int i = 0; i < W->size(); ++i) {
+        W->mutable_data<float>()[i] = -W->data<float>()[i];
+      }
+    }
+    ASSERT_TRUE(pack_op->Run());
+    ASSERT_TRUE(def_op->Run());
+    ASSERT_TRUE(tensor_op->Run());
+    ASSERT_TRUE(packed_op->Run());
+    ExpectNear(
+        ws.GetBlob("Y")->Get<TensorCPU>(),
+        ws.GetBlob("Y_tensor")->Get<TensorCPU>(),
+        1e-4);
+    ExpectNear(
+        ws.GetBlob("Y")->Get<TensorCPU>(),
+        ws.GetBlob("Y_packed")->Get<TensorCPU>(),
+        1e-4);
+  }
+}
+
+TEST(DirectConvTest, EngineListPicksSupportedEngine) {
+  // A net can ask for both CPU engines: each conv runs on the first one that
+  // supports its configuration.
+  Workspace ws;
+  AddRandomInput(vector<TIndex>{1, 4, 4, 8}, "X", &ws);
+  AddRandomInput(vector<TIndex>{8, 1, 1, 8}, "W", &ws);
+  AddRandomInput(vector<TIndex>{8}, "B", &ws);
+  auto op = CreateConv("WINOGRAD,DIRECT", 1, 0, true, "W", "Y", &ws);
+  ASSERT_NE(nullptr, op.get());
+  EXPECT_EQ(op->engine(), "DIRECT");
+}
+
+} // namespace caffe2
@@ -0,0 +1,409 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include "caffe2/core/context.h"
+#include "caffe2/core/operator.h"
+#include "caffe2/operators/conv_op.h"
+#include "caffe2/operators/conv_op_impl.h"
+#include "caffe2/operators/conv_pool_op_base.h"
+#include "caffe2/utils/math.h"
+
+namespace caffe2 {
+
+namespace {
+
+// Transform matrices of the minimal filtering algorithm F(m x m, 3 x 3)
+// (Lavin & Gray, "Fast Algorithms for Convolutional Neural Networks"). An
+// output tile Y (m x m) of a 3 x 3 filter g over an input tile d
+// (alpha x alpha, alpha = m + 2) is
+//
+//   Y = A^T [(G g G^T) .* (B^T d B)] A
+//
+// so a tile costs alpha^2 multiplications per channel pair instead of
+// 9 m^2: 2.25x fewer for F(2x2, 3x3) and 4x fewer for F(4x4, 3x3).
+struct WinogradTransform {
+  int m;
+  int alpha;
+  const float* BT; // alpha x alpha
+  const float* G; // alpha x 3
+  const float* AT; // m x alpha
+};
+
+const float kBT2[] = {
+    1, 0, -1, 0,
+    0, 1, 1, 0,
+    0, -1, 1, 0,
+    0, 1, 0, -1};
+const float kG2[] = {
+    1, 0, 0,
+    0.5, 0.5, 0.5,
+    0.5, -0.5, 0.5,
+    0, 0, 1};
+const float kAT2[] = {
+    1, 1, 1, 0,
+    0, 1, -1, -1};
+
+const float kBT4[] = {
+    4, 0, -5, 0, 1, 0,
+    0, -4, -4, 1, 1, 0,
+    0, 4, -4, -1, 1, 0,
+    0, -2, -1, 2, 1, 0,
+    0, 2, -1, -2, 1, 0,
+    0, 4, 0, -5, 0, 1};
+const float kG4[] = {
+    1.0f / 4, 0, 0,
+    -1.0f / 6, -1.0f / 6, -1.0f / 6,
+    -1.0f / 6, 1.0f / 6, -1.0f / 6,
+    1.0f / 24, 1.0f / 12, 1.0f / 6,
+    1.0f / 24, -1.0f / 12, 1.0f / 6,
+    0, 0, 1};
+const float kAT4[] = {
+    1, 1, 1, 1, 1, 0,
+    0, 1, -1, 2, -2, 0,
+    0, 1, 1, 4, 4, 0,
+    0, 1, -1, 8, -8, 1};
+
+const WinogradTransform kWinogradF2{2, 4, kBT2, kG2, kAT2};
+const WinogradTransform kWinogradF4{4, 6, kBT4, kG4, kAT4};
+
+// Number of tiles transformed and multiplied together. It bounds the
+// transformed input and output buffers to alpha^2 * (C + M) * kTileBlock
+// floats, independent of the image size.
+constexpr int kTileBlock = 128;
+
+// Y (r x r) = L X L^T for L (r x k) and X (k x k).
+inline void
+Sandwich(const float* L, int r, int k, const float* X, float* tmp, float* Y) {
+  for (int i = 0; i < r; ++i) {
+    for (int j = 0; j < k; ++j) {
+      float sum = 0;
+      for (int l = 0; l < k; ++l) {
+        sum += L[i * k + l] * X[l * k + j];
+      }
+      tmp[i * k + j] = sum;
+    }
+  }
+  for (int i = 0; i < r; ++i) {
+    for (int j = 0; j < r; ++j) {
+      float sum = 0;
+      for (int l = 0; l < k; ++l) {
+        sum += tmp[i * k + l] * L[j * k + l];
+      }
+      Y[i * r + j] = sum;
+    }
+  }
+}
+
+// Picks the output tile size m of F(m x m, 3 x 3) for a convolution with C
+// input and M output channels, or returns 0 when im2col + GEMM is expected to
+// be faster. With few channels the per-tile transforms cost more than the
+// multiplications they save. F(4x4, 3x3) saves the most multiplications but
+// wastes work on partial tiles of small outputs, where F(2x2, 3x3) wins.
+int ChooseWinogradTile(int C, int M, int output_h, int output_w) {
+  if (C < 8 || M < 8) {
+    return 0;
+  }
+  if (output_h >= 8 && output_w >= 8) {
+    return 4;
+  }
+  return 2;
+}
+
+} // namespace
+
+// 3x3 filters transformed for F(m x m, 3 x 3), U = G g G^T for every pair
+// of output and input channels. PackWinogradFilter creates it, and the
+// WINOGRAD engine of Conv takes it in place of the filter tensor.
+struct PackedWinogradFilter {
+  int tile{0};
+  int M{0};
+  int C{0};
+  // alpha^2 x M x C.
+  std::vector<float> data;
+  // The tensor data and shape this was transformed from, for cache_filter.
+  const void* source{nullptr};
+  std::vector<TIndex> source_dims;
+
+  void Pack(const TensorCPU& filter, int m) {
+    CAFFE_ENFORCE_EQ(filter.ndim(), 4);
+    CAFFE_ENFORCE_EQ(filter.dim32(2), 3);
+    CAFFE_ENFORCE_EQ(filter.dim32(3), 3);
+    CAFFE_ENFORCE(m == 2 || m == 4, "Winograd tile must be 2 or 4, got ", m);
+    const WinogradTransform& wt = m == 4 ? kWinogradF4 : kWinogradF2;
+    tile = m;
+    M = filter.dim32(0);
+    C = filter.dim32(1);
+    const int alpha2 = wt.alpha * wt.alpha;
+    data.resize(alpha2 * M * C);
+    const float* g = filter.data<float>();
+    float tmp[6 * 3];
+    float u[6 * 6];
+    for (int i = 0; i < M * C; ++i) {
+      Sandwich(wt.G, wt.alpha, 3, g + i * 9, tmp, u);
+      for (int xi = 0; xi < alpha2; ++xi) {
+        data[xi * M * C + i] = u[xi];
+      }
+    }
+    source = filter.raw_data();
+    source_dims = filter.dims();
+  }
+
+  bool IsPackedFrom(const TensorCPU& filter, int m) const {
+    return tile == m && source == filter.raw_data() &&
+        source_dims == filter.dims();
+  }
+};
+
+// Winograd convolution for 3x3 filters with stride 1, in NCHW order.
+//
+// The filter is either a PackedWinogradFilter blob created by
+// PackWinogradFilter, or a filter tensor whose transform U = G g G^T is
+// computed on every run. The argument `cache_filter` keeps the transform of a
+// filter tensor across runs, with the same caveats as cache_packed_weight of
+// PackedFullyConnectedOp. Each run transforms blocks of input tiles, does
+// alpha^2 independent GEMMs of (M x C) * (C x tiles), and transforms the
+// products back into output tiles, adding the bias.
+//
+// The tile size of a filter tensor is chosen by ChooseWinogradTile unless the
+// argument `winograd_tile` is set to 2 or 4. Shapes for which the heuristic
+// prefers im2col run through the default ConvOp. A packed filter always uses
+// the tile it was packed for.
+template <typename T>
+class WinogradConvOp final : public ConvPoolOpBase<CPUContext> {
+ public:
+  USE_CONV_POOL_BASE_FUNCTIONS(CPUContext);
+  WinogradConvOp(const OperatorDef& operator_def, Workspace* ws)
+      : ConvPoolOpBase<CPUContext>(operator_def, ws),
+        tile_(OperatorBase::GetSingleArgument<int>("winograd_tile", 0)),
+        cache_filter_(
+            OperatorBase::GetSingleArgument<bool>("cache_filter", false)) {
+    OPERATOR_NEEDS_FEATURE(
+        order_ == StorageOrder::NCHW, "Winograd conv only supports NCHW.");
+    OPERATOR_NEEDS_FEATURE(
+        kernel_.size() == 2 && kernel_h() == 3 && kernel_w() == 3,
+        "Winograd conv only supports 3x3 kernels.");
+    OPERATOR_NEEDS_FEATURE(
+        stride_h() == 1 && stride_w() == 1,
+        "Winograd conv only supports stride 1.");
+    OPERATOR_NEEDS_FEATURE(
+        dilation_h() == 1 && dilation_w() == 1,
+        "Winograd conv does not support dilation.");
+    OPERATOR_NEEDS_FEATURE(
+        group_ == 1, "Group convolution not supported yet.");
+    CAFFE_ENFORCE(
+        tile_ == 0 || tile_ == 2 || tile_ == 4,
+        "winograd_tile must be 0 (auto), 2 or 4, got ",
+        tile_);
+    fallback_.reset(new ConvOp<T, CPUContext>(operator_def, ws));
+  }
+  ~WinogradConvOp() {}
+
+  bool RunOnDeviceWithOrderNCHW() override;
+  bool RunOnDeviceWithOrderNHWC() override {
+    CAFFE_THROW("Winograd conv only supports NCHW.");
+  }
+
+ private:
+  int tile_;
+  bool cache_filter_;
+  std::unique_ptr<ConvOp<T, CPUContext>> fallback_;
+  PackedWinogradFilter cached_;
+
+  std::vector<T> transformed_input_;
+  std::vector<T> transformed_output_;
+
+  INPUT_TAGS(INPUT, FILTER, BIAS);
+};
+
+template <typename T>
+bool WinogradConvOp<T>::RunOnDeviceWithOrderNCHW() {
+  const auto& X = Input(INPUT);
+  auto* Y = Output(0);
+  CAFFE_ENFORCE_EQ(X.ndim(), 4);
+  const int N = X.dim32(0), C = X.dim32(1), H = X.dim32(2), W = X.dim32(3);
+
+  const PackedWinogradFilter* packed = nullptr;
+  const TensorCPU* filter = nullptr;
+  int M = 0;
+  if (OperatorBase::InputIsType<PackedWinogradFilter>(FILTER)) {
+    packed = &OperatorBase::Input<PackedWinogradFilter>(FILTER);
+    CAFFE_ENFORCE_EQ(packed->C, C);
+    CAFFE_ENFORCE(
+        tile_ == 0 || tile_ == packed->tile,
+        "winograd_tile ",
+        tile_,
+        " does not match the packed filter tile ",
+        packed->tile);
+    M = packed->M;
+  } else {
+    filter = &Input(FILTER);
+    CAFFE_ENFORCE_EQ(filter->ndim(), 4);
+    CAFFE_ENFORCE_EQ(filter->dim32(1), C);
+    CAFFE_ENFORCE_EQ(filter->dim32(2), 3);
+    CAFFE_ENFORCE_EQ(filter->dim32(3), 3);
+    M = filter->dim32(0);
+  }
+  ConvPoolOpBase<CPUContext>::SetOutputSize(X, Y, M);
+  const int output_h = Y->dim32(2);
+  const int output_w = Y->dim32(3);
+
+  if (!packed) {
+    const int tile =
+        tile_ != 0 ? tile_ : ChooseWinogradTile(C, M, output_h, output_w);
+    if (tile == 0) {
+      return fallback_->RunOnDeviceWithOrderNCHW();
+    }
+    if (!cache_filter_ || !cached_.IsPackedFrom(*filter, tile)) {
+      cached_.Pack(*filter, tile);
+    }
+    packed = &cached_;
+  }
+  const WinogradTransform& wt = packed->tile == 4 ? kWinogradF4 : kWinogradF2;
+  const int m = wt.m;
+  const int alpha = wt.alpha;
+  const int alpha2 = alpha * alpha;
+
+  const T* bias = nullptr;
+  if (InputSize() == 3) {
+    const auto& b = Input(BIAS);
+    CAFFE_ENFORCE_EQ(b.ndim(), 1);
+    CAFFE_ENFORCE_EQ(b.dim32(0), M);
+    bias = b.template data<T>();
+  }
+
+  const int tiles_h = (output_h + m - 1) / m;
+  const int tiles_w = (output_w + m - 1) / m;
+  const int num_tiles = tiles_h * tiles_w;
+  transformed_input_.resize(alpha2 * C * kTileBlock);
+  transformed_output_.resize(alpha2 * M * kTileBlock);
+  T* V = transformed_input_.data();
+  T* P = transformed_output_.data();
+  const T* U = packed->data.data();
+
+  float d[6 * 6];
+  float tmp[6 * 6];
+  float v[6 * 6];
+  float y[4 * 4];
+  for (int n = 0; n < N; ++n) {
+    const T* Xdata = X.template data<T>() + n * C * H * W;
+    T* Ydata = Y->template mutable_data<T>() + n * M * output_h * output_w;
+    for (int t0 = 0; t0 < num_tiles; t0 += kTileBlock) {
+      const int tiles = std::min(kTileBlock, num_tiles - t0);
+      // Input transform: V[xi][c][t] = (B^T d B)[xi] for input tile t.
+      for (int c = 0; c < C; ++c) {
+        const T* Xc = Xdata + c * H * W;
+        for (int t = 0; t < tiles; ++t) {
+          const int y0 = (t0 + t) / tiles_w * m - pad_t();
+          const int x0 = (t0 + t) % tiles_w * m - pad_l();
+          for (int i = 0; i < alpha; ++i) {
+            const int h = y0 + i;
+            for (int j = 0; j < alpha; ++j) {
+              const int w = x0 + j;
+              d[i * alpha + j] = (h >= 0 && h < H && w >= 0 && w < W)
+                  ? Xc[h * W + w]
+                  : 0;
+            }
+          }
+          Sandwich(wt.BT, alpha, alpha, d, tmp, v);
+          for (int xi = 0; xi < alpha2; ++xi) {
+            V[(xi * C + c) * tiles + t] = v[xi];
+          }
+        }
+      }
+      // P[xi] = U[xi] * V[xi], (M x C) * (C x tiles).
+      for (int xi = 0; xi < alpha2; ++xi) {
+        math::Gemm<T, CPUContext>(
+            CblasNoTrans,
+            CblasNoTrans,
+            M,
+            tiles,
+            C,
+            1,
+            U + xi * M * C,
+            V + xi * C * tiles,
+            0,
+            P + xi * M * tiles,
+            &context_);
+      }
+      // Output transform: Y = A^T P A for every output tile, plus bias.
+      for (int k = 0; k < M; ++k) {
+        T* Yk = Ydata + k * output_h * output_w;
+        const T b = bias ? bias[k] : T(0);
+        for (int t = 0; t < tiles; ++t) {
+          for (int xi = 0; xi < alpha2; ++xi) {
+            d[xi] = P[(xi * M + k) * tiles + t];
+          }
+          Sandwich(wt.AT, m, alpha, d, tmp, y);
+          const int y0 = (t0 + t) / tiles_w * m;
+          const int x0 = (t0 + t) % tiles_w * m;
+          const int rows = std::min(m, output_h - y0);
+          const int cols = std::min(m, output_w - x0);
+          for (int i = 0; i < rows; ++i) {
+            for (int j = 0; j < cols; ++j) {
+              Yk[(y0 + i) * output_w + x0 + j] = y[i * m + j] + b;
+            }
+          }
+        }
+      }
+    }
+  }
+  return true;
+}
+
+class PackWinogradFilterOp final : public Operator<CPUContext> {
+ public:
+  USE_OPERATOR_FUNCTIONS(CPUContext);
+  PackWinogradFilterOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<CPUContext>(operator_def, ws),
+        tile_(OperatorBase::GetSingleArgument<int>("winograd_tile", 4)) {}
+
+  bool RunOnDevice() override {
+    OperatorBase::Output<PackedWinogradFilter>(0)->Pack(Input(0), tile_);
+    return true;
+  }
+
+ private:
+  int tile_;
+};
+
+CAFFE_KNOWN_TYPE(PackedWinogradFilter);
+
+REGISTER_CPU_OPERATOR_WITH_ENGINE(Conv, WINOGRAD, WinogradConvOp<float>);
+REGISTER_CPU_OPERATOR_WITH_ENGINE(Conv2D, WINOGRAD, WinogradConvOp<float>);
+REGISTER_CPU_OPERATOR(PackWinogradFilter, PackWinogradFilterOp);
+
+OPERATOR_SCHEMA(PackWinogradFilter)
+    .NumInputs(1)
+    .NumOutputs(1)
+    .SetDoc(R"DOC(
+Transforms the 3x3 filter of a Conv into the form used by the WINOGRAD engine
+of Conv, which then takes the output blob in place of the filter, so that the
+filter is not transformed again on every run of the Conv. Run it again
+whenever the filter changes.
+)DOC")
+    .Arg(
+        "winograd_tile",
+        "Output tile size, 2 for F(2x2, 3x3) or 4 for F(4x4, 3x3) (default 4). "
+        "F(2x2, 3x3) is faster for outputs smaller than 8x8.")
+    .Input(0, "filter", "Conv filter tensor of size (M x C x 3 x 3)")
+    .Output(0, "packed_filter", "Transformed filter blob");
+NO_GRADIENT(PackWinogradFilter);
+
+} // namespace caffe2
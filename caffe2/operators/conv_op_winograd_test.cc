@@ -0,0 +1,209 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "caffe2/core/operator.h"
+#include "caffe2/core/test_utils.h"
+#include "caffe2/utils/math.h"
+#include <gtest/gtest.h>
+
+namespace caffe2 {
+
+namespace {
+
+using testing::AddRandomInput;
+using testing::ExpectNear;
+
+void RunConv(
+    const string& engine,
+    int pad,
+    int tile,
+    const string& W,
+    const string& Y,
+    Workspace* ws) {
+  OperatorDef def;
+  def.set_type("Conv");
+  def.set_engine(engine);
+  def.add_input("X");
+  def.add_input(W);
+  def.add_input("B");
+  def.add_output(Y);
+  def.add_arg()->CopyFrom(MakeArgument<int>("kernel", 3));
+  def.add_arg()->CopyFrom(MakeArgument<int>("pad", pad));
+  def.add_arg()->CopyFrom(MakeArgument<int>("winograd_tile", tile));
+  unique_ptr<OperatorBase> op(CreateOperator(def, ws));
+  ASSERT_NE(nullptr, op.get());
+  ASSERT_TRUE(op->Run());
+}
+
+void PackFilter(int tile, Workspace* ws) {
+  OperatorDef def;
+  def.set_type("PackWinogradFilter");
+  def.add_input("W");
+  def.add_output("W_packed");
+  def.add_arg()->CopyFrom(MakeArgument<int>("winograd_tile", tile));
+  unique_ptr<OperatorBase> op(CreateOperator(def, ws));
+  ASSERT_NE(nullptr, op.get());
+  ASSERT_TRUE(op->Run());
+}
+
+} // namespace
+
+TEST(WinogradConvTest, MatchesDefaultEngine) {
+  // Output sizes that are and are not multiples of the tile sizes, and tile
+  // counts that span several tile blocks.
+  for (const int size : {5, 8, 13, 30}) {
+    for (const int pad : {0, 1}) {
+      for (const int tile : {0, 2, 4}) {
+        Workspace ws;
+        AddRandomInput(vector<TIndex>{2, 9, size, size}, "X", &ws);
+        AddRandomInput(vector<TIndex>{10, 9, 3, 3}, "W", &ws);
+        AddRandomInput(vector<TIndex>{10}, "B", &ws);
+        RunConv("", pad, 0, "W", "Y", &ws);
+        RunConv("WINOGRAD", pad, tile, "W", "Y_winograd", &ws);
+        ExpectNear(
+            ws.GetBlob("Y")->Get<TensorCPU>(),
+            ws.GetBlob("Y_winograd")->Get<TensorCPU>(),
+            1e-3);
+      }
+    }
+  }
+}
+
+TEST(WinogradConvTest, FallsBackForFewChannels) {
+  Workspace ws;
+  AddRandomInput(vector<TIndex>{1, 3, 10, 10}, "X", &ws);
+  AddRandomInput(vector<TIndex>{4, 3, 3, 3}, "W", &ws);
+  AddRandomInput(vector<TIndex>{4}, "B", &ws);
+  RunConv("", 1, 0, "W", "Y", &ws);
+  RunConv("WINOGRAD", 1, 0, "W", "Y_winograd", &ws);
+  ExpectNear(
+      ws.GetBlob("Y")->Get<TensorCPU>(),
+      ws.GetBlob("Y_winograd")->Get<TensorCPU>(),
+      1e-3);
+}
+
+TEST(WinogradConvTest, RetransformsNewFilter) {
+  Workspace ws;
+  AddRandomInput(vector<TIndex>{1, 8, 12, 12}, "X", &ws);
+  AddRandomInput(vector<TIndex>{8, 8, 3, 3}, "W", &ws);
+  AddRandomInput(vector<TIndex>{8}, "B", &ws);
+  OperatorDef def;
+  def.set_type("Conv");
+  def.set_engine("WINOGRAD");
+  def.add_input("X");
+  def.add_input("W");
+  def.add_input("B");
+  def.add_output("Y_winograd");
+  def.add_arg()->CopyFrom(MakeArgument<int>("kernel", 3));
+  def.add_arg()->CopyFrom(MakeArgument<int>("cache_filter", 1));
+  unique_ptr<OperatorBase> op(CreateOperator(def, &ws));
+  ASSERT_NE(nullptr, op.get());
+  ASSERT_TRUE(op->Run());
+  // A reshaped filter is transformed again.
+  AddRandomInput(vector<TIndex>{16, 8, 3, 3}, "W", &ws);
+  AddRandomInput(vector<TIndex>{16}, "B", &ws);
+  ASSERT_TRUE(op->Run());
+  RunConv("", 0, 0, "W", "Y", &ws);
+  ExpectNear(
+      ws.GetBlob("Y")->Get<TensorCPU>(),
+      ws.GetBlob("Y_winograd")->Get<TensorCPU>(),
+      1e-3);
+}
+
+TEST(WinogradConvTest, TransformsFilterOnEveryRun) {
+  Workspace ws;
+  AddRandomInput(vector<TIndex>{1, 8, 12, 12}, "X", &ws);
+  AddRandomInput(vector<TIndex>{8, 8, 3, 3}, "W", &ws);
+  AddRandomInput(vector<TIndex>{8}, "B", &ws);
+  RunConv("WINOGRAD", 1, 0, "W", "Y_winograd", &ws);
+  // Scaling W in place keeps its data pointer and shape.
+  DeviceOption option;
+  CPUContext context(option);
+  auto* W = ws.GetBlob("W")->GetMutable<TensorCPU>();
+  math::Scale<float, CPUContext>(
+      W->size(), -2, W->data<float>(), W->mutable_data<float>(), &context);
+  RunConv("WINOGRAD", 1, 0, "W", "Y_winograd", &ws);
+  RunConv("", 1, 0, "W", "Y", &ws);
+  ExpectNear(
+      ws.GetBlob("Y")->Get<TensorCPU>(),
+      ws.GetBlob("Y_winograd")->Get<TensorCPU>(),
+      1e-3);
+}
+
+TEST(WinogradConvTest, PackedFilterMatchesDefaultEngine) {
+  for (const int tile : {2, 4}) {
+    for (const int pad : {0, 1}) {
+      Workspace ws;
+      AddRandomInput(vector<TIndex>{2, 9, 13, 13}, "X", &ws);
+      AddRandomInput(vector<TIndex>{10, 9, 3, 3}, "W", &ws);
+      AddRandomInput(vector<TIndex>{10}, "B", &ws);
+      PackFilter(tile, &ws);
+      RunConv("", pad, 0, "W", "Y", &ws);
+      RunConv("WINOGRAD", pad, 0, "W_packed", "Y_winograd", &ws);
+      ExpectNear(
+          ws.GetBlob("Y")->Get<TensorCPU>(),
+          ws.GetBlob("Y_winograd")->Get<TensorCPU>(),
+          1e-3);
+    }
+  }
+}
+
+TEST(WinogradConvTest, PackedFilterKeepsItsTile) {
+  // Few channels, which a filter tensor would run through the default
+  // engine: the packed filter still runs the tile it was packed for.
+  Workspace ws;
+  AddRandomInput(vector<TIndex>{1, 3, 10, 10}, "X", &ws);
+  AddRandomInput(vector<TIndex>{4, 3, 3, 3}, "W", &ws);
+  AddRandomInput(vector<TIndex>{4}, "B", &ws);
+  PackFilter(2, &ws);
+  RunConv("", 1, 0, "W", "Y", &ws);
+  RunConv("WINOGRAD", 1, 0, "W_packed", "Y_winograd", &ws);
+  ExpectNear(
+      ws.GetBlob("Y")->Get<TensorCPU>(),
+      ws.GetBlob("Y_winograd")->Get<TensorCPU>(),
+      1e-3);
+
+  OperatorDef def;
+  def.set_type("Conv");
+  def.set_engine("WINOGRAD");
+  def.add_input("X");
+  def.add_input("W_packed");
+  def.add_output("Y_winograd");
+  def.add_arg()->CopyFrom(MakeArgument<int>("kernel", 3));
+  def.add_arg()->CopyFrom(MakeArgument<int>("winograd_tile", 4));
+  unique_ptr<OperatorBase> op(CreateOperator(def, &ws));
+  ASSERT_NE(nullptr, op.get());
+  EXPECT_THROW(op->Run(), EnforceNotMet);
+}
+
+TEST(WinogradConvTest, UnsupportedConfigUsesDefaultEngine) {
+  Workspace ws;
+  AddRandomInput(vector<TIndex>{1, 8, 12, 12}, "X", &ws);
+  AddRandomInput(vector<TIndex>{8, 8, 3, 3}, "W", &ws);
+  OperatorDef def;
+  def.set_type("Conv");
+  def.set_engine("WINOGRAD");
+  def.add_input("X");
+  def.add_input("W");
+  def.add_output("Y");
+  def.add_arg()->CopyFrom(MakeArgument<int>("kernel", 3));
+  def.add_arg()->CopyFrom(MakeArgument<int>("stride", 2));
+  unique_ptr<OperatorBase> op(CreateOperator(def, &ws));
+  ASSERT_NE(nullptr, op.get());
+  EXPECT_EQ(op->engine(), "");
+}
+
+} // namespace caffe2
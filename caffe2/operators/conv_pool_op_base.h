@@ -382,32 +382,54 @@ class ConvPoolOpBase : public Operator<Context> {
     const TensorShape W = inputs[1];
     const TensorShape Y = TensorInferenceForConv(def, inputs)[0];
 
+    // Every output element is a dot product over the kernel and the input
+    // channels of its group, which is exactly one output channel of W in
+    // both storage orders.
+    const uint64_t kernel_volume = nElemFromDim(W, 1);
+    c.flops = nElemFromDim(Y) * kernel_volume * 2;
+    c.bytes_moved = nBytesOfShape(X) + nBytesOfShape(W) + nBytesOfShape(Y);
+    if (inputs.size() > 2) {
+      c.flops += nElemFromDim(Y);
+      c.bytes_moved += nBytesOfShape(inputs[2]);
+    }
+    return c;
+  }
+
+  static struct OpSchema::Cost CostInferenceForPool(
+      const OperatorDef& def,
+      const vector<TensorShape>& inputs) {
+    struct OpSchema::Cost c;
+    const TensorShape X = inputs[0];
+    const TensorShape Y = TensorInferenceForPool(def, inputs)[0];
+
     ArgumentHelper helper(def);
     const auto order =
         StringToStorageOrder(helper.GetSingleArgument<string>("order", "NCHW"));
-
-    unsigned long long Y_h;
-    unsigned long long Y_w;
-    unsigned long long kernel_h;
-    unsigned long long kernel_w;
-    unsigned long long in_channels;
-    unsigned long long out_channels;
-    if (order == StorageOrder::NHWC) {
-      Y_h = Y.dims(1);
-      Y_w = Y.dims(2);
-      kernel_h = W.dims(1);
-      kernel_w = W.dims(2);
-      in_channels = W.dims(3);
-      out_channels = W.dims(0);
+    const int spatial_begin = order == StorageOrder::NHWC ? 1 : 2;
+    const int num_spatial = X.dims_size() - 2;
+    uint64_t kernel_volume = 1;
+    if (helper.GetSingleArgument<int>("global_pooling", 0)) {
+      for (int i = 0; i < num_spatial; ++i) {
+        kernel_volume *= X.dims(spatial_begin + i);
+      }
     } else {
-      Y_h = Y.dims(2);
-      Y_w = Y.dims(3);
-      kernel_h = W.dims(2);
-      kernel_w = W.dims(3);
-      in_channels = W.dims(1);
-      out_channels = W.dims(0);
+      vector<int> kernel = helper.GetRepeatedArgument<int>("kernels");
+      if (kernel.empty()) {
+        if (helper.HasArgument("kernel")) {
+          kernel.resize(
+              num_spatial, helper.GetSingleArgument<int>("kernel", 1));
+        } else {
+          kernel.push_back(helper.GetSingleArgument<int>("kernel_h", 1));
+          kernel.push_back(helper.GetSingleArgument<int>("kernel_w", 1));
+        }
+      }
+      for (const auto k : kernel) {
+        kernel_volume *= k;
+      }
     }
-    c.flops = Y_h * Y_w * kernel_w * kernel_h * in_channels * out_channels * 2;
+    // One comparison or addition per window element.
+    c.flops = nElemFromDim(Y) * kernel_volume;
+    c.bytes_moved = nBytesOfShape(X) + nBytesOfShape(Y);
     return c;
   }
 
@@ -0,0 +1,137 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <gtest/gtest.h>
+
+#include "caffe2/core/operator.h"
+#include "caffe2/utils/proto_utils.h"
+
+namespace caffe2 {
+
+namespace {
+
+OpSchema::Cost InferCost(
+    const OperatorDef& def,
+    const vector<vector<int>>& input_dims) {
+  const OpSchema* schema = OpSchemaRegistry::Schema(def.type());
+  CAFFE_ENFORCE(schema);
+  CAFFE_ENFORCE(schema->HasCostInferenceFunction());
+  vector<TensorShape> shapes;
+  for (const auto& dims : input_dims) {
+    shapes.push_back(CreateTensorShape(dims, TensorProto::FLOAT));
+  }
+  return schema->InferCost(def, shapes);
+}
+
+} // namespace
+
+TEST(CostInferenceTest, FC) {
+  auto def = CreateOperatorDef("FC", "", {"X", "W", "b"}, {"Y"});
+  auto c = InferCost(def, {{4, 8}, {16, 8}, {16}});
+  EXPECT_EQ(c.flops, 4 * 16 * (2 * 8 + 1));
+  EXPECT_EQ(c.bytes_moved, (4 * 8 + 16 * 8 + 16 + 4 * 16) * sizeof(float));
+}
+
+TEST(CostInferenceTest, Conv) {
+  auto def = CreateOperatorDef(
+      "Conv",
+      "",
+      {"X", "W", "b"},
+      {"Y"},
+      {MakeArgument<int>("kernel", 3), MakeArgument<int>("pad", 1)});
+  // 2 images, 3 -> 4 channels, 5x5.
+  auto c = InferCost(def, {{2, 3, 5, 5}, {4, 3, 3, 3}, {4}});
+  const uint64_t y_size = 2 * 4 * 5 * 5;
+  EXPECT_EQ(c.flops, y_size * (3 * 3 * 3 * 2 + 1));
+  EXPECT_EQ(
+      c.bytes_moved,
+      (2 * 3 * 5 * 5 + 4 * 3 * 3 * 3 + 4 + y_size) * sizeof(float));
+}
+
+TEST(CostInferenceTest, MatMul) {
+  auto def = CreateOperatorDef(
+      "MatMul", "", {"A", "B"}, {"Y"}, {MakeArgument<int>("trans_b", 1)});
+  auto c = InferCost(def, {{4, 8}, {16, 8}});
+  EXPECT_EQ(c.flops, 2 * 4 * 16 * 8);
+  EXPECT_EQ(c.bytes_moved, (4 * 8 + 16 * 8 + 4 * 16) * sizeof(float));
+}
+
+TEST(CostInferenceTest, MaxPool) {
+  auto def = CreateOperatorDef(
+      "MaxPool",
+      "",
+      {"X"},
+      {"Y"},
+      {MakeArgument<int>("kernel", 2), MakeArgument<int>("stride", 2)});
+  auto c = InferCost(def, {{1, 3, 8, 8}});
+  EXPECT_EQ(c.flops, 3 * 4 * 4 * 2 * 2);
+  EXPECT_EQ(c.bytes_moved, (3 * 8 * 8 + 3 * 4 * 4) * sizeof(float));
+}
+
+TEST(CostInferenceTest, Elementwise) {
+  auto c =
+      InferCost(CreateOperatorDef("Add", "", {"A", "B"}, {"C"}), {{6}, {6}});
+  EXPECT_EQ(c.flops, 6);
+  EXPECT_EQ(c.bytes_moved, 18 * sizeof(float));
+  c = InferCost(
+      CreateOperatorDef("Sum", "", {"A", "B", "C"}, {"D"}), {{6}, {6}, {6}});
+  EXPECT_EQ(c.flops, 12);
+  EXPECT_EQ(c.bytes_moved, 24 * sizeof(float));
+}
+
+TEST(CostInferenceTest, SparseLengthsSum) {
+  auto def = CreateOperatorDef(
+      "SparseLengthsSum", "", {"DATA", "INDICES", "LENGTHS"}, {"Y"});
+  const OpSchema* schema = OpSchemaRegistry::Schema("SparseLengthsSum");
+  ASSERT_TRUE(schema && schema->HasCostInferenceFunction());
+  vector<TensorShape> shapes{
+      CreateTensorShape(vector<int>{1000, 16}, TensorProto::FLOAT),
+      CreateTensorShape(vector<int>{20}, TensorProto::INT64),
+      CreateTensorShape(vector<int>{4}, TensorProto::INT32)};
+  auto c = schema->InferCost(def, shapes);
+  // Only the 20 looked up rows are read.
+  EXPECT_EQ(c.flops, 20 * 16);
+  EXPECT_EQ(
+      c.bytes_moved, (20 * 16 + 4 * 16) * sizeof(float) + 20 * 8 + 4 * 4);
+}
+
+TEST(CostInferenceTest, NetCost) {
+  NetDef net;
+  *net.add_op() = CreateOperatorDef("FC", "", {"X", "W", "b"}, {"Y"});
+  *net.add_op() = CreateOperatorDef("Relu", "", {"Y"}, {"Y"});
+  *net.add_op() = CreateOperatorDef("Copy", "", {"Y"}, {"Z"});
+  *net.add_op() = CreateOperatorDef("Relu", "", {"unknown"}, {"Z"});
+  auto cost = InferNetCostFromMap(
+      {{"X", {4, 8}}, {"W", {16, 8}}, {"b", {16}}}, net);
+  ASSERT_EQ(cost.op_costs.size(), 4);
+  EXPECT_TRUE(cost.op_cost_known[0]);
+  EXPECT_EQ(cost.op_costs[0].flops, 4 * 16 * (2 * 8 + 1));
+  // The shape of Y comes from the shape inference of FC.
+  EXPECT_TRUE(cost.op_cost_known[1]);
+  EXPECT_EQ(cost.op_costs[1].flops, 4 * 16 * 2);
+  // Copy has no cost inference function.
+  EXPECT_FALSE(cost.op_cost_known[2]);
+  // The input of the last op has no known shape.
+  EXPECT_FALSE(cost.op_cost_known[3]);
+  EXPECT_EQ(
+      cost.total.flops, cost.op_costs[0].flops + cost.op_costs[1].flops);
+  EXPECT_EQ(
+      cost.total.bytes_moved,
+      cost.op_costs[0].bytes_moved + cost.op_costs[1].bytes_moved);
+}
+
+} // namespace caffe2
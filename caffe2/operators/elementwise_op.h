@@ -393,19 +393,25 @@ bool DivGradientOp<Context>::RunOnDevice() {
 }
 
 // For arithmetic operators, Eigen provides a good way to vectorize even
-// when broadcasting.
+// when broadcasting. Large inputs are additionally split into contiguous
+// chunks that run in parallel through CPUContext::ParallelFor.
 #define EIGEN_FUNCTOR(name, eigen_op, input_type, output_type)               \
   struct Eigen##name##Functor {                                              \
     template <int b_is_scalar, typename T, typename R>                       \
-    inline void Run(size_t n, const T* a, const T* b, R* out, CPUContext*) { \
-      if (b_is_scalar) {                                                     \
-        EigenVectorArrayMap<R>(out, n) =                                     \
-            eigen_op((ConstEigenVectorArrayMap<T>(a, n)), (b[0]));           \
-      } else {                                                               \
-        EigenVectorArrayMap<R>(out, n) = eigen_op(                           \
-            (ConstEigenVectorArrayMap<T>(a, n)),                             \
-            (ConstEigenVectorArrayMap<T>(b, n)));                            \
-      }                                                                      \
+    inline void                                                              \
+    Run(size_t n, const T* a, const T* b, R* out, CPUContext* context) {     \
+      auto f = [&](TIndex begin, TIndex end) {                               \
+        if (b_is_scalar) {                                                   \
+          EigenVectorArrayMap<R>(out + begin, end - begin) = eigen_op(       \
+              (ConstEigenVectorArrayMap<T>(a + begin, end - begin)),         \
+              (b[0]));                                                       \
+        } else {                                                             \
+          EigenVectorArrayMap<R>(out + begin, end - begin) = eigen_op(       \
+              (ConstEigenVectorArrayMap<T>(a + begin, end - begin)),         \
+              (ConstEigenVectorArrayMap<T>(b + begin, end - begin)));        \
+        }                                                                    \
+      };                                                                     \
+      context->ParallelFor(n, CPUContext::ParallelForGrain(1), f);           \
     }                                                                        \
     template <typename T, typename R>                                        \
     void RunWithBroadcast(                                                   \
@@ -414,10 +420,13 @@ bool DivGradientOp<Context>::RunOnDevice() {
         R* out,                                                              \
         size_t pre,                                                          \
         size_t n,                                                            \
-        CPUContext*) {                                                       \
-      EigenArrayMap<R>(out, n, pre) = eigen_op(                              \
-          (ConstEigenArrayMap<T>(a, n, pre).colwise()),                      \
-          (ConstEigenVectorArrayMap<T>(b, n)));                              \
+        CPUContext* context) {                                               \
+      auto f = [&](TIndex begin, TIndex end) {                               \
+        EigenArrayMap<R>(out + begin * n, n, end - begin) = eigen_op(        \
+            (ConstEigenArrayMap<T>(a + begin * n, n, end - begin).colwise()), \
+            (ConstEigenVectorArrayMap<T>(b, n)));                            \
+      };                                                                     \
+      context->ParallelFor(pre, CPUContext::ParallelForGrain(n), f);         \
     }                                                                        \
     template <typename T, typename R>                                        \
     void RunWithBroadcast2(                                                  \
@@ -427,12 +436,16 @@ bool DivGradientOp<Context>::RunOnDevice() {
         size_t pre,                                                          \
         size_t n,                                                            \
         size_t post,                                                         \
-        CPUContext*) {                                                       \
-      for (int i = 0; i < pre; ++i) {                                        \
-        EigenArrayMap<R>(out + i * n * post, post, n) = eigen_op(            \
-            (ConstEigenArrayMap<T>(a + i * n * post, post, n).rowwise()),    \
-            (Eigen::Map<const Eigen::Array<T, 1, Eigen::Dynamic>>(b, n)));   \
-      }                                                                      \
+        CPUContext* context) {                                               \
+      /* Rows of `post` elements; row r is combined with b[r % n]. */        \
+      auto f = [&](TIndex begin, TIndex end) {                               \
+        for (TIndex r = begin; r < end; ++r) {                               \
+          EigenVectorArrayMap<R>(out + r * post, post) = eigen_op(           \
+              (ConstEigenVectorArrayMap<T>(a + r * post, post)),             \
+              (b[r % n]));                                                   \
+        }                                                                    \
+      };                                                                     \
+      context->ParallelFor(pre * n, CPUContext::ParallelForGrain(post), f);  \
     }                                                                        \
   };                                                                         \
   REGISTER_CPU_OPERATOR(                                                     \
@@ -25,6 +25,13 @@ OPERATOR_SCHEMA(Sum)
     .NumOutputs(1)
     .AllowInplace({{0, 0}})
     .InputsCanCrossDevices()
+    .CostInferenceFunction([](const OperatorDef& def,
+                              const vector<TensorShape>& in) {
+      // One addition per element for every input after the first.
+      auto c = PointwiseCostInference<1>(def, in);
+      c.flops *= in.size() - 1;
+      return c;
+    })
     .IdenticalTypeAndShapeOfInput(0)
     .SetDoc(R"DOC(
 Element-wise sum of each of the input tensors. The first input tensor can be
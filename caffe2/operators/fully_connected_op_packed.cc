@@ -0,0 +1,107 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "caffe2/operators/fully_connected_op_packed.h"
+
+namespace caffe2 {
+
+bool PackedFullyConnectedOp::RunOnDevice() {
+  const auto& X = Input(0);
+  const auto& b = Input(2);
+  auto* Y = Output(0);
+  CAFFE_ENFORCE(b.ndim() == 1, b.ndim());
+  const PackedFCWeight* packed = nullptr;
+  if (OperatorBase::InputIsType<PackedFCWeight>(1)) {
+    packed = &OperatorBase::Input<PackedFCWeight>(1);
+  } else {
+    const auto& W = Input(1);
+    if (!cache_packed_weight_ || !cached_.IsPackedFrom(W)) {
+      const auto canonical_axis_w = W.canonical_axis_index(axis_w_);
+      const auto N = W.size_to_dim(canonical_axis_w);
+      cached_.Pack(W, N, W.size_from_dim(canonical_axis_w));
+    }
+    packed = &cached_;
+  }
+
+  const auto canonical_axis = X.canonical_axis_index(axis_);
+  const auto M = X.size_to_dim(canonical_axis);
+  const auto K = X.size_from_dim(canonical_axis);
+  const auto N = packed->N;
+  CAFFE_ENFORCE_EQ(
+      K, packed->K, "Dimension mismatch: X: ", X.dims(), ", N: ", N);
+  CAFFE_ENFORCE_EQ(N, b.size(), "Dimension mismatch: b: ", b.dims());
+
+  Y_shape_cache_ = X.dims();
+  Y_shape_cache_.resize(canonical_axis + 1);
+  Y_shape_cache_[canonical_axis] = N;
+  Y->Resize(Y_shape_cache_);
+  if (X.size() == 0) {
+    Y->mutable_data<float>();
+    return true;
+  }
+  PackedGemm(
+      M,
+      N,
+      K,
+      X.data<float>(),
+      packed->data.data(),
+      b.data<float>(),
+      Y->mutable_data<float>());
+  return true;
+}
+
+class PackFCWeightOp final : public Operator<CPUContext> {
+ public:
+  USE_OPERATOR_FUNCTIONS(CPUContext);
+  PackFCWeightOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<CPUContext>(operator_def, ws),
+        axis_w_(OperatorBase::GetSingleArgument<int32_t>("axis_w", 1)) {}
+
+  bool RunOnDevice() override {
+    const auto& W = Input(0);
+    const auto canonical_axis_w = W.canonical_axis_index(axis_w_);
+    OperatorBase::Output<PackedFCWeight>(0)->Pack(
+        W, W.size_to_dim(canonical_axis_w), W.size_from_dim(canonical_axis_w));
+    return true;
+  }
+
+ private:
+  size_t axis_w_{1};
+};
+
+CAFFE_KNOWN_TYPE(PackedFCWeight);
+
+REGISTER_CPU_OPERATOR_WITH_ENGINE(FC, PACKED, PackedFullyConnectedOp);
+REGISTER_CPU_OPERATOR(PackFCWeight, PackFCWeightOp);
+
+OPERATOR_SCHEMA(PackFCWeight)
+    .NumInputs(1)
+    .NumOutputs(1)
+    .SetDoc(R"DOC(
+Packs the weight matrix W of an FC into the panel layout used by the PACKED
+engine of FC, which then takes the output blob in place of W, so that W is
+not packed again on every run of the FC. Run it again whenever W changes.
+
+The DIRECT engine of Conv also takes the output in place of a 1x1 filter in
+NHWC order (M x 1 x 1 x C), packed with the default axis_w.
+)DOC")
+    .Arg("axis_w", "Same as the axis_w argument of FC (default 1)")
+    .Input(0, "W", "FC weight tensor, coerced into a 2D matrix of size (NxK)")
+    .Output(0, "packed_W", "Packed weight blob");
+NO_GRADIENT(PackFCWeight);
+
+} // namespace caffe2
@@ -0,0 +1,88 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef CAFFE2_OPERATORS_FULLY_CONNECTED_OP_PACKED_H_
+#define CAFFE2_OPERATORS_FULLY_CONNECTED_OP_PACKED_H_
+
+#include <vector>
+
+#include "caffe2/core/context.h"
+#include "caffe2/core/operator.h"
+#include "caffe2/perfkernels/packed_gemm.h"
+
+namespace caffe2 {
+
+// An FC weight matrix W (N x K) in the panel layout of PackGemmB.
+struct PackedFCWeight {
+  TIndex N{0};
+  TIndex K{0};
+  std::vector<float> data;
+  // The tensor data and shape this was packed from. Engines that cache the
+  // packed weight across runs repack W when they change.
+  const void* source{nullptr};
+  std::vector<TIndex> source_dims;
+
+  void Pack(const TensorCPU& W, TIndex n, TIndex k) {
+    N = n;
+    K = k;
+    data.resize(PackedGemmBSize(N, K));
+    PackGemmB(N, K, W.data<float>(), data.data());
+    source = W.raw_data();
+    source_dims = W.dims();
+  }
+
+  bool IsPackedFrom(const TensorCPU& W) const {
+    return source == W.raw_data() && source_dims == W.dims();
+  }
+};
+
+// FC for inference with fixed weights. W is packed into panels, and every
+// run is a single pass of a register-blocked kernel over the packed
+// panels that also adds the bias, instead of a BLAS call that repacks W and
+// a second GEMM for the bias.
+//
+// W is either a PackedFCWeight blob created by PackFCWeight, or a weight
+// tensor that is packed on every run. With the cache_packed_weight argument
+// set, a weight tensor is only packed on the first run and then only
+// repacked when the tensor is reallocated or reshaped. A tensor has no
+// version, so weights overwritten in place (FeedBlob, Load, CopyFrom into a
+// same-shape tensor) are not noticed: only set it for weights that never
+// change after the first run.
+class PackedFullyConnectedOp final : public Operator<CPUContext> {
+ public:
+  USE_OPERATOR_FUNCTIONS(CPUContext);
+  PackedFullyConnectedOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<CPUContext>(operator_def, ws),
+        axis_(OperatorBase::GetSingleArgument<int32_t>("axis", 1)),
+        axis_w_(OperatorBase::GetSingleArgument<int32_t>("axis_w", 1)),
+        cache_packed_weight_(OperatorBase::GetSingleArgument<bool>(
+            "cache_packed_weight",
+            false)) {}
+
+  bool RunOnDevice() override;
+
+ private:
+  size_t axis_{1};
+  size_t axis_w_{1};
+  bool cache_packed_weight_;
+  PackedFCWeight cached_;
+  vector<TIndex> Y_shape_cache_;
+};
+
+} // namespace caffe2
+
+#endif // CAFFE2_OPERATORS_FULLY_CONNECTED_OP_PACKED_H_
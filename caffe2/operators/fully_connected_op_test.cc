@@ -18,12 +18,17 @@
 
 #include "caffe2/operators/fully_connected_op.h"
 #include "caffe2/core/flags.h"
+#include "caffe2/core/test_utils.h"
+#include "caffe2/operators/fully_connected_op_packed.h"
 #include <gtest/gtest.h>
 
 CAFFE2_DECLARE_string(caffe_test_root);
 
 namespace caffe2 {
 
+using testing::AddRandomInput;
+using testing::ExpectNear;
+
 static void AddConstInput(const vector<TIndex>& shape, const float value,
                           const string& name, Workspace* ws) {
   DeviceOption option;
@@ -85,4 +90,112 @@ TEST(FullyConnectedTest, FCTransposedTest) {
   }
 }
 
+static void RunFC(
+    const string& engine,
+    const string& W,
+    const string& Y,
+    Workspace* ws) {
+  OperatorDef def;
+  def.set_type("FC");
+  def.set_engine(engine);
+  def.add_input("X");
+  def.add_input(W);
+  def.add_input("B");
+  def.add_output(Y);
+  unique_ptr<OperatorBase> op(CreateOperator(def, ws));
+  ASSERT_NE(nullptr, op.get());
+  ASSERT_TRUE(op->Run());
+}
+
+TEST(FullyConnectedTest, FCPackedEngineTest) {
+  // Sizes that exercise partial row tiles and panels.
+  for (const int M : {1, 3, 6}) {
+    for (const int N : {5, 8, 19}) {
+      Workspace ws;
+      AddRandomInput(vector<TIndex>{M, 13}, "X", &ws);
+      AddRandomInput(vector<TIndex>{N, 13}, "W", &ws);
+      AddRandomInput(vector<TIndex>{N}, "B", &ws);
+      RunFC("", "W", "Y", &ws);
+      RunFC("PACKED", "W", "Y_packed", &ws);
+      ExpectNear(
+          ws.GetBlob("Y")->Get<TensorCPU>(),
+          ws.GetBlob("Y_packed")->Get<TensorCPU>(),
+          1e-4);
+
+      OperatorDef pack;
+      pack.set_type("PackFCWeight");
+      pack.add_input("W");
+      pack.add_output("W_packed");
+      unique_ptr<OperatorBase> op(CreateOperator(pack, &ws));
+      ASSERT_TRUE(op->Run());
+      EXPECT_TRUE(ws.GetBlob("W_packed")->IsType<PackedFCWeight>());
+      RunFC("PACKED", "W_packed", "Y_prepacked", &ws);
+      ExpectNear(
+          ws.GetBlob("Y")->Get<TensorCPU>(),
+          ws.GetBlob("Y_prepacked")->Get<TensorCPU>(),
+          1e-4);
+    }
+  }
+}
+
+TEST(FullyConnectedTest, FCPackedEngineRepacksNewWeights) {
+  Workspace ws;
+  AddRandomInput(vector<TIndex>{4, 10}, "X", &ws);
+  AddRandomInput(vector<TIndex>{6, 10}, "W", &ws);
+  AddRandomInput(vector<TIndex>{6}, "B", &ws);
+  OperatorDef def;
+  def.set_type("FC");
+  def.set_engine("PACKED");
+  def.add_input("X");
+  def.add_input("W");
+  def.add_input("B");
+  def.add_output("Y_packed");
+  def.add_arg()->CopyFrom(MakeArgument<int>("cache_packed_weight", 1));
+  unique_ptr<OperatorBase> op(CreateOperator(def, &ws));
+  ASSERT_TRUE(op->Run());
+  // A new weight tensor gets packed again.
+  AddRandomInput(vector<TIndex>{6, 5, 2}, "W", &ws);
+  ASSERT_TRUE(op->Run());
+  RunFC("", "W", "Y", &ws);
+  ExpectNear(
+      ws.GetBlob("Y")->Get<TensorCPU>(),
+      ws.GetBlob("Y_packed")->Get<TensorCPU>(),
+      1e-4);
+}
+
+TEST(FullyConnectedTest, PackedGemmBSizeDoesNotOverflow) {
+  // A 65536 x 40000 weight matrix has more than 2^31 elements.
+  EXPECT_EQ(PackedGemmBSize(65536, 40000), TIndex(65536) * 40000);
+  EXPECT_EQ(PackedGemmBSize(65535, 40000), TIndex(65536) * 40000);
+}
+
+TEST(FullyConnectedTest, FCPackedEngineSeesWeightsUpdatedInPlace) {
+  Workspace ws;
+  AddRandomInput(vector<TIndex>{4, 10}, "X", &ws);
+  AddRandomInput(vector<TIndex>{6, 10}, "W", &ws);
+  AddRandomInput(vector<TIndex>{6}, "B", &ws);
+  OperatorDef def;
+  def.set_type("FC");
+  def.set_engine("PACKED");
+  def.add_input("X");
+  def.add_input("W");
+  def.add_input("B");
+  def.add_output("Y_packed");
+  unique_ptr<OperatorBase> op(CreateOperator(def, &ws));
+  ASSERT_TRUE(op->Run());
+  // Overwrite W without reallocating it, as a same-shape load would.
+  auto* W = ws.GetBlob("W")->GetMutable<TensorCPU>();
+  const void* data = W->raw_data();
+  for (int i = 0; i < W->size(); ++i) {
+    W->mutable_data<float>()[i] = i * 0.1f;
+  }
+  ASSERT_EQ(data, W->raw_data());
+  ASSERT_TRUE(op->Run());
+  RunFC("", "W", "Y", &ws);
+  ExpectNear(
+      ws.GetBlob("Y")->Get<TensorCPU>(),
+      ws.GetBlob("Y_packed")->Get<TensorCPU>(),
+      1e-4);
+}
+
 }  // namespace caffe2
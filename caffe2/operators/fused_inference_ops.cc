@@ -0,0 +1,227 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cmath>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "caffe2/core/context.h"
+#include "caffe2/core/operator.h"
+#include "caffe2/utils/math.h"
+
+namespace caffe2 {
+
+namespace {
+
+const char kFusedPrefix[] = "Fused";
+
+} // namespace
+
+// FusedConv and FusedFC: a Conv or FC with an optional inference SpatialBN
+// folded into its weights and an optional Relu or Sigmoid applied to its
+// output, as produced by the FuseInferenceOps transform.
+//
+// The producer runs as a nested operator with the same arguments and engine,
+// so every engine of Conv and FC is available. With fold_bn, the folded
+// weights and bias are computed on every run and kept in a workspace private
+// to this op, layered over the net's workspace so that the producer still
+// finds its other blobs there. The argument `cache_folded_weights` keeps them
+// across runs until one of the source tensors is reallocated or reshaped,
+// with the same caveats as cache_packed_weight of PackedFullyConnectedOp.
+// The activation is applied in place on the output right after the producer,
+// while it is still in cache, instead of by a separate op writing a separate
+// tensor.
+class FusedProducerOp final : public Operator<CPUContext> {
+ public:
+  USE_OPERATOR_FUNCTIONS(CPUContext);
+  FusedProducerOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<CPUContext>(operator_def, ws),
+        fold_bn_(OperatorBase::GetSingleArgument<int>("fold_bn", 0)),
+        epsilon_(OperatorBase::GetSingleArgument<float>("epsilon", 1e-5)),
+        cache_folded_weights_(OperatorBase::GetSingleArgument<bool>(
+            "cache_folded_weights",
+            false)),
+        activation_(
+            OperatorBase::GetSingleArgument<string>("activation", "")) {
+    CAFFE_ENFORCE(
+        activation_.empty() || activation_ == "Relu" ||
+            activation_ == "Sigmoid",
+        "Unsupported fused activation: ",
+        activation_);
+    const int producer_inputs = InputSize() - (fold_bn_ ? 4 : 0);
+    CAFFE_ENFORCE(
+        producer_inputs == 2 || producer_inputs == 3,
+        operator_def.type(),
+        " takes X, W, an optional bias and, with fold_bn, the scale, bias, "
+        "mean and var of a SpatialBN");
+    has_bias_ = producer_inputs == 3;
+
+    CAFFE_ENFORCE_EQ(
+        operator_def.type().compare(0, sizeof(kFusedPrefix) - 1, kFusedPrefix),
+        0);
+    OperatorDef producer_def = operator_def;
+    producer_def.set_type(operator_def.type().substr(sizeof(kFusedPrefix) - 1));
+    producer_def.clear_input();
+    producer_def.add_input(operator_def.input(0));
+    if (fold_bn_) {
+      const string prefix = "__fused/" + operator_def.output(0) + "/";
+      folded_ws_.reset(new Workspace(ws));
+      folded_weight_ = folded_ws_->CreateLocalBlob(prefix + "W");
+      folded_bias_ = folded_ws_->CreateLocalBlob(prefix + "b");
+      producer_def.add_input(prefix + "W");
+      producer_def.add_input(prefix + "b");
+    } else {
+      for (int i = 1; i < operator_def.input_size(); ++i) {
+        producer_def.add_input(operator_def.input(i));
+      }
+    }
+    producer_ = CreateOperator(producer_def, fold_bn_ ? folded_ws_.get() : ws);
+  }
+
+  bool RunOnDevice() override {
+    if (fold_bn_) {
+      FoldBatchNorm();
+    }
+    CAFFE_ENFORCE(producer_->Run(), "Fused producer failed");
+    auto* Y = Output(0);
+    if (activation_ == "Relu") {
+      EigenVectorArrayMap<float> y(Y->mutable_data<float>(), Y->size());
+      y = y.cwiseMax(0.f);
+    } else if (activation_ == "Sigmoid") {
+      EigenVectorArrayMap<float> y(Y->mutable_data<float>(), Y->size());
+      y = 1. / (1. + (-y).exp());
+    }
+    return true;
+  }
+
+ private:
+  // W'[m] = W[m] * s[m] and b' = (b - mean) * s + bn_bias, with
+  // s = bn_scale / sqrt(var + epsilon), for every output channel m.
+  void FoldBatchNorm() {
+    std::vector<std::pair<const void*, vector<TIndex>>> sources;
+    for (int i = 1; i < InputSize(); ++i) {
+      sources.emplace_back(Input(i).raw_data(), Input(i).dims());
+    }
+    if (cache_folded_weights_ && sources == folded_sources_) {
+      return;
+    }
+    const int bn = has_bias_ ? 3 : 2;
+    const auto& W = Input(1);
+    const auto& scale = Input(bn);
+    const auto& bn_bias = Input(bn + 1);
+    const auto& mean = Input(bn + 2);
+    const auto& var = Input(bn + 3);
+    const int M = scale.size();
+    CAFFE_ENFORCE_GT(W.ndim(), 1);
+    CAFFE_ENFORCE_EQ(W.dim32(0), M, "W must have one row per BN channel");
+    CAFFE_ENFORCE_EQ(bn_bias.size(), M);
+    CAFFE_ENFORCE_EQ(mean.size(), M);
+    CAFFE_ENFORCE_EQ(var.size(), M);
+    const float* b = nullptr;
+    if (has_bias_) {
+      CAFFE_ENFORCE_EQ(Input(2).size(), M);
+      b = Input(2).data<float>();
+    }
+
+    // New tensors rather than updates in place: engines that cache a
+    // transformed form of W key it on the data pointer.
+    std::unique_ptr<TensorCPU> weight(new TensorCPU(W.dims()));
+    std::unique_ptr<TensorCPU> bias(new TensorCPU(vector<TIndex>{M}));
+    const int inner = W.size() / M;
+    const float* w = W.data<float>();
+    float* w_folded = weight->mutable_data<float>();
+    float* b_folded = bias->mutable_data<float>();
+    for (int m = 0; m < M; ++m) {
+      const float s =
+          scale.data<float>()[m] / std::sqrt(var.data<float>()[m] + epsilon_);
+      for (int i = 0; i < inner; ++i) {
+        w_folded[m * inner + i] = w[m * inner + i] * s;
+      }
+      b_folded[m] = ((b ? b[m] : 0.f) - mean.data<float>()[m]) * s +
+          bn_bias.data<float>()[m];
+    }
+    folded_weight_->Reset(weight.release());
+    folded_bias_->Reset(bias.release());
+    folded_sources_ = std::move(sources);
+  }
+
+  bool fold_bn_;
+  float epsilon_;
+  bool cache_folded_weights_;
+  string activation_;
+  bool has_bias_;
+  // Declared before producer_, which reads its blobs.
+  unique_ptr<Workspace> folded_ws_;
+  unique_ptr<OperatorBase> producer_;
+  Blob* folded_weight_{nullptr};
+  Blob* folded_bias_{nullptr};
+  std::vector<std::pair<const void*, vector<TIndex>>> folded_sources_;
+};
+
+REGISTER_CPU_OPERATOR(FusedConv, FusedProducerOp);
+REGISTER_CPU_OPERATOR(FusedFC, FusedProducerOp);
+
+OPERATOR_SCHEMA(FusedConv)
+    .NumInputs(2, 7)
+    .NumOutputs(1)
+    .SetDoc(R"DOC(
+Inference-only Conv with an optional SpatialBN folded into its weights and an
+optional activation applied to its output, as created by the
+FuseInferenceOps transform. It accepts all the arguments and engines of Conv.
+With fold_bn, the SpatialBN is folded into the weights on every run.
+)DOC")
+    .Arg("fold_bn", "If 1, the last four inputs are the SpatialBN parameters")
+    .Arg("epsilon", "Epsilon of the folded SpatialBN (default 1e-5)")
+    .Arg(
+        "cache_folded_weights",
+        "If 1, only fold again when an input tensor is reallocated or "
+        "reshaped. Parameters overwritten in place are not noticed.")
+    .Arg("activation", "Empty, \"Relu\" or \"Sigmoid\"")
+    .Input(0, "X", "Input data blob, as for Conv")
+    .Input(1, "filter", "Filter blob, as for Conv")
+    .Input(2, "bias", "Optional bias blob, as for Conv")
+    .Input(3, "scale", "With fold_bn, the scale of the SpatialBN")
+    .Input(4, "bn_bias", "With fold_bn, the bias of the SpatialBN")
+    .Input(5, "mean", "With fold_bn, the running mean of the SpatialBN")
+    .Input(6, "var", "With fold_bn, the running variance of the SpatialBN")
+    .Output(0, "Y", "Output data blob");
+
+OPERATOR_SCHEMA(FusedFC)
+    .NumInputs(2, 7)
+    .NumOutputs(1)
+    .SetDoc(R"DOC(
+Inference-only FC with an optional SpatialBN folded into its weights and an
+optional activation applied to its output, as created by the
+FuseInferenceOps transform. It accepts all the arguments and engines of FC.
+Inputs and arguments are the same as for FusedConv.
+)DOC")
+    .Arg("fold_bn", "If 1, the last four inputs are the SpatialBN parameters")
+    .Arg("epsilon", "Epsilon of the folded SpatialBN (default 1e-5)")
+    .Arg(
+        "cache_folded_weights",
+        "If 1, only fold again when an input tensor is reallocated or "
+        "reshaped. Parameters overwritten in place are not noticed.")
+    .Arg("activation", "Empty, \"Relu\" or \"Sigmoid\"")
+    .Input(0, "X", "Input data blob, as for FC")
+    .Input(1, "W", "Weight blob, as for FC")
+    .Input(2, "b", "Bias blob, as for FC")
+    .Output(0, "Y", "Output data blob");
+
+NO_GRADIENT(FusedConv);
+NO_GRADIENT(FusedFC);
+
+} // namespace caffe2
@@ -17,12 +17,13 @@
 #include <atomic>
 #include <limits>
 #include <mutex>
+#include <memory>
 #include <sstream>
-#include <unordered_map>
 #include <vector>
 #include "caffe2/core/blob_serialization.h"
 #include "caffe2/core/operator.h"
 #include "caffe2/core/tensor.h"
+#include "caffe2/utils/flat_hash_map.h"
 
 namespace caffe2 {
 namespace {
@@ -52,39 +53,95 @@ struct IndexBase {
   const TypeMeta& Type() const { return meta_; }
 
   TIndexValue Size() {
-    std::lock_guard<std::mutex> guard(dictMutex_);
     return nextId_;
   }
 
  protected:
+  // Hands out the next id, or throws if max_elements has been reached.
+  TIndexValue NextId() {
+    TIndexValue id = nextId_.load();
+    do {
+      if (id >= maxElements_) {
+        CAFFE_THROW("Dict max size reached");
+      }
+    } while (!nextId_.compare_exchange_weak(id, id + 1));
+    return id;
+  }
+
   int64_t maxElements_;
   TypeMeta meta_;
-  TIndexValue nextId_{1}; // guarded by dictMutex_
+  std::atomic<TIndexValue> nextId_{1};
   std::atomic<bool> frozen_{false};
-  std::mutex dictMutex_;
 };
 
+// The keys are spread over kNumShards open-addressing tables, each guarded
+// by its own mutex, so that concurrent IndexGet calls rarely wait on each
+// other. A batch of keys is looked up grouped by shard: every shard it
+// touches is locked once, and the slots of the next keys are prefetched
+// while the current one is probed. Only the keys that were not found are
+// then inserted one by one. Frozen indices are read without any locking.
 template<typename T>
 struct Index: IndexBase {
   explicit Index(TIndexValue maxElements)
-    : IndexBase(maxElements, TypeMeta::Make<T>()) {}
+    : IndexBase(maxElements, TypeMeta::Make<T>()),
+      shards_(new Shard[kNumShards]) {}
 
   void Get(const T* keys, TIndexValue* values, size_t numKeys) {
+    std::vector<uint64_t> hashes(numKeys);
+    for (size_t i = 0; i < numKeys; ++i) {
+      hashes[i] = shards_[0].dict.hash_key(keys[i]);
+    }
     if (frozen_) {
-      FrozenGet(keys, values, numKeys);
+      FrozenGet(keys, hashes.data(), values, numKeys);
       return;
     }
-    std::lock_guard<std::mutex> lock(dictMutex_);
-    for (int i = 0; i < numKeys; ++i) {
-      auto it = dict_.find(keys[i]);
-      if (it != dict_.end()) {
+
+    // Counting sort of the key positions by shard.
+    std::vector<size_t> shardBegin(kNumShards + 1, 0);
+    for (size_t i = 0; i < numKeys; ++i) {
+      ++shardBegin[ShardOf(hashes[i]) + 1];
+    }
+    for (int s = 0; s < kNumShards; ++s) {
+      shardBegin[s + 1] += shardBegin[s];
+    }
+    std::vector<size_t> order(numKeys);
+    {
+      std::vector<size_t> next(shardBegin.begin(), shardBegin.end() - 1);
+      for (size_t i = 0; i < numKeys; ++i) {
+        order[next[ShardOf(hashes[i])]++] = i;
+      }
+    }
+
+    for (int s = 0; s < kNumShards; ++s) {
+      if (shardBegin[s] == shardBegin[s + 1]) {
+        continue;
+      }
+      auto& shard = shards_[s];
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      for (size_t j = shardBegin[s]; j < shardBegin[s + 1]; ++j) {
+        if (j + kPrefetchDistance < shardBegin[s + 1]) {
+          shard.dict.prefetch(hashes[order[j + kPrefetchDistance]]);
+        }
+        const size_t i = order[j];
+        auto it = shard.dict.find(keys[i], hashes[i]);
+        values[i] = it != shard.dict.end() ? it->second : 0;
+      }
+    }
+
+    // New keys are inserted in input order, so that they get increasing ids.
+    for (size_t i = 0; i < numKeys; ++i) {
+      if (values[i] != 0) {
+        continue;
+      }
+      auto& shard = shards_[ShardOf(hashes[i])];
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      auto it = shard.dict.find(keys[i], hashes[i]);
+      if (it != shard.dict.end()) {
         values[i] = it->second;
-      } else if (nextId_ < maxElements_) {
-        auto newValue = nextId_++;
-        dict_.insert({keys[i], newValue});
-        values[i] = newValue;
       } else {
-        CAFFE_THROW("Dict max size reached");
+        auto newValue = NextId();
+        shard.dict.insert({keys[i], newValue}, hashes[i]);
+        values[i] = newValue;
       }
     }
   }
@@ -93,17 +150,23 @@ struct Index: IndexBase {
     CAFFE_ENFORCE(
         numKeys <= maxElements_,
         "Cannot load index: Tensor is larger than max_elements.");
-    decltype(dict_) dict;
+    std::vector<Dict> dicts(kNumShards);
+    for (auto& dict : dicts) {
+      dict.reserve(numKeys / kNumShards + 1);
+    }
     for (int i = 0; i < numKeys; ++i) {
+      const auto hash = dicts[0].hash_key(keys[i]);
       CAFFE_ENFORCE(
-          dict.insert({keys[i], i + 1}).second,
+          dicts[ShardOf(hash)].insert({keys[i], i + 1}, hash).second,
           "Repeated elements found: cannot load into dictionary.");
     }
     // assume no `get` is inflight while this happens
     {
-      std::lock_guard<std::mutex> lock(dictMutex_);
-      // let the old dict get destructed outside of the lock
-      dict_.swap(dict);
+      auto locks = LockAll();
+      // let the old dicts get destructed outside of the locks
+      for (int s = 0; s < kNumShards; ++s) {
+        shards_[s].dict.swap(dicts[s]);
+      }
       nextId_ = numKeys + 1;
     }
     return true;
@@ -111,26 +174,66 @@ struct Index: IndexBase {
 
   template<typename Ctx>
   bool Store(Tensor<Ctx>* out) {
-    std::lock_guard<std::mutex> lock(dictMutex_);
+    auto locks = LockAll();
     out->Resize(nextId_ - 1);
     auto outData = out->template mutable_data<T>();
-    for (const auto& entry : dict_) {
-      outData[entry.second - 1] = entry.first;
+    for (int s = 0; s < kNumShards; ++s) {
+      for (const auto& entry : shards_[s].dict) {
+        outData[entry.second - 1] = entry.first;
+      }
     }
     return true;
   }
 
  private:
-  void FrozenGet(const T* keys, TIndexValue* values, size_t numKeys) {
-    for (int i = 0; i < numKeys; ++i) {
-      auto it = dict_.find(keys[i]);
-      values[i] = it != dict_.end() ? it->second : 0;
+  using Dict = FlatHashMap<T, TIndexValue>;
+
+  static constexpr int kNumShards = 64;
+  static constexpr size_t kPrefetchDistance = 8;
+
+  struct Shard {
+    std::mutex mutex;
+    Dict dict;
+  };
+
+  // The slot within a shard comes from the low bits of the hash, so the
+  // shard is picked from the high half.
+  static int ShardOf(uint64_t hash) {
+    return (hash >> 32) % kNumShards;
+  }
+
+  std::vector<std::unique_lock<std::mutex>> LockAll() {
+    std::vector<std::unique_lock<std::mutex>> locks;
+    for (int s = 0; s < kNumShards; ++s) {
+      locks.emplace_back(shards_[s].mutex);
+    }
+    return locks;
+  }
+
+  void FrozenGet(
+      const T* keys,
+      const uint64_t* hashes,
+      TIndexValue* values,
+      size_t numKeys) {
+    for (size_t i = 0; i < numKeys; ++i) {
+      if (i + kPrefetchDistance < numKeys) {
+        const auto hash = hashes[i + kPrefetchDistance];
+        shards_[ShardOf(hash)].dict.prefetch(hash);
+      }
+      const auto& dict = shards_[ShardOf(hashes[i])].dict;
+      auto it = dict.find(keys[i], hashes[i]);
+      values[i] = it != dict.end() ? it->second : 0;
     }
   }
 
-  std::unordered_map<T, TIndexValue> dict_;
+  std::unique_ptr<Shard[]> shards_;
 };
 
+template <typename T>
+constexpr int Index<T>::kNumShards;
+template <typename T>
+constexpr size_t Index<T>::kPrefetchDistance;
+
 // TODO(azzolini): support sizes larger than int32
 template<class T>
 class IndexCreateOp: public Operator<CPUContext> {
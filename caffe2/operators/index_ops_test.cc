@@ -0,0 +1,127 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <memory>
+#include <thread>
+
+#include "caffe2/core/blob_serialization.h"
+#include "caffe2/core/operator.h"
+#include <gtest/gtest.h>
+
+namespace caffe2 {
+
+namespace {
+
+class IndexOpsTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    RunOp("LongIndexCreate", {}, "index");
+  }
+
+  void RunOp(
+      const string& type,
+      const vector<string>& inputs,
+      const string& output) {
+    OperatorDef def;
+    def.set_type(type);
+    for (const auto& input : inputs) {
+      def.add_input(input);
+    }
+    def.add_output(output);
+    unique_ptr<OperatorBase> op(CreateOperator(def, &ws_));
+    EXPECT_TRUE(op->Run());
+  }
+
+  void SetKeys(const string& name, const vector<int64_t>& keys) {
+    auto* tensor = ws_.CreateBlob(name)->GetMutable<TensorCPU>();
+    tensor->Resize(keys.size());
+    std::copy(keys.begin(), keys.end(), tensor->mutable_data<int64_t>());
+  }
+
+  vector<int64_t> Get(const string& keys, const string& index = "index") {
+    const string output = keys + "_" + index + "_ids";
+    RunOp("IndexGet", {index, keys}, output);
+    const auto& ids = ws_.GetBlob(output)->Get<TensorCPU>();
+    return vector<int64_t>(
+        ids.data<int64_t>(), ids.data<int64_t>() + ids.size());
+  }
+
+  Workspace ws_;
+};
+
+} // namespace
+
+TEST_F(IndexOpsTest, NewKeysGetIdsInInputOrder) {
+  SetKeys("keys", {10, 20, 10, 30, 40, 20});
+  EXPECT_EQ(Get("keys"), (vector<int64_t>{1, 2, 1, 3, 4, 2}));
+  SetKeys("more", {40, 50, 10, 60});
+  EXPECT_EQ(Get("more"), (vector<int64_t>{4, 5, 1, 6}));
+
+  RunOp("IndexFreeze", {"index"}, "index");
+  SetKeys("frozen", {60, 70, 20});
+  EXPECT_EQ(Get("frozen"), (vector<int64_t>{6, 0, 2}));
+}
+
+TEST_F(IndexOpsTest, ConcurrentGetAssignsUniqueIds) {
+  const int kNumThreads = 4;
+  const int kNumKeys = 20000;
+  vector<string> names;
+  for (int t = 0; t < kNumThreads; ++t) {
+    // Every thread looks up all the keys, in a different order.
+    vector<int64_t> keys(kNumKeys);
+    for (int i = 0; i < kNumKeys; ++i) {
+      keys[i] = int64_t((i * (2 * t + 1)) % kNumKeys) << 20;
+    }
+    names.push_back("keys" + caffe2::to_string(t));
+    SetKeys(names.back(), keys);
+  }
+  vector<vector<int64_t>> ids(kNumThreads);
+  vector<std::thread> threads;
+  for (int t = 0; t < kNumThreads; ++t) {
+    ws_.CreateBlob(names[t] + "_index_ids");
+    threads.emplace_back([&, t]() { ids[t] = Get(names[t]); });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  RunOp("IndexStore", {"index"}, "stored");
+  const auto& stored = ws_.GetBlob("stored")->Get<TensorCPU>();
+  ASSERT_EQ(stored.size(), kNumKeys);
+  for (int t = 0; t < kNumThreads; ++t) {
+    const auto& keys = ws_.GetBlob(names[t])->Get<TensorCPU>();
+    for (int i = 0; i < kNumKeys; ++i) {
+      ASSERT_GE(ids[t][i], 1);
+      ASSERT_LE(ids[t][i], kNumKeys);
+      EXPECT_EQ(stored.data<int64_t>()[ids[t][i] - 1], keys.data<int64_t>()[i]);
+    }
+  }
+}
+
+TEST_F(IndexOpsTest, SerializationRoundTrip) {
+  SetKeys("keys", {5, 3, 9, 3, 1});
+  const auto ids = Get("keys");
+  RunOp("IndexFreeze", {"index"}, "index");
+
+  ws_.CreateBlob("restored")
+      ->Deserialize(ws_.GetBlob("index")->Serialize("index"));
+  SetKeys("query", {1, 2, 3, 5, 9});
+  EXPECT_EQ(
+      Get("query", "restored"), (vector<int64_t>{ids[4], 0, ids[1], 1, 3}));
+}
+
+} // namespace caffe2
@@ -0,0 +1,305 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "caffe2/operators/lengths_reducer_fused_rowwise_ops.h"
+#include "caffe2/core/registry.h"
+
+namespace caffe2 {
+
+namespace {
+
+template <int BIT_RATE>
+std::vector<TensorShape> FloatToFusedRowwiseQuantizedShapes(
+    const OperatorDef& /* unused */,
+    const vector<TensorShape>& in) {
+  vector<TensorShape> out;
+  if (in[0].dims_size() == 2) {
+    out.push_back(CreateTensorShape(
+        vector<TIndex>{in[0].dims(0),
+                       FusedRowwiseQuantization<BIT_RATE>::FusedBlockSize(
+                           in[0].dims(1))},
+        TensorProto_DataType_UINT8));
+  } else {
+    TensorShape unknown;
+    unknown.set_unknown_shape(true);
+    out.push_back(unknown);
+  }
+  return out;
+}
+
+template <int BIT_RATE>
+std::vector<TensorShape> FusedRowwiseQuantizedToFloatShapes(
+    const OperatorDef& /* unused */,
+    const vector<TensorShape>& in) {
+  vector<TensorShape> out;
+  if (in[0].dims_size() == 2) {
+    out.push_back(CreateTensorShape(
+        vector<TIndex>{in[0].dims(0),
+                       FusedRowwiseQuantization<BIT_RATE>::BlockSize(
+                           in[0].dims(1))},
+        TensorProto_DataType_FLOAT));
+  } else {
+    TensorShape unknown;
+    unknown.set_unknown_shape(true);
+    out.push_back(unknown);
+  }
+  return out;
+}
+
+} // namespace
+
+REGISTER_CPU_OPERATOR(
+    FloatToFused8BitRowwiseQuantized,
+    FloatToFusedRowwiseQuantizedOp<8, CPUContext>);
+REGISTER_CPU_OPERATOR(
+    Fused8BitRowwiseQuantizedToFloat,
+    FusedRowwiseQuantizedToFloatOp<8, CPUContext>);
+REGISTER_CPU_OPERATOR(
+    SparseLengthsSumFused8BitRowwise,
+    SparseLengthsFusedRowwiseOp<CPUContext, 8>);
+REGISTER_CPU_OPERATOR(
+    SparseLengthsWeightedSumFused8BitRowwise,
+    SparseLengthsFusedRowwiseOp<CPUContext, 8, 1>);
+REGISTER_CPU_OPERATOR(
+    SparseLengthsMeanFused8BitRowwise,
+    SparseLengthsFusedRowwiseOp<CPUContext, 8, 0, 1>);
+
+OPERATOR_SCHEMA(FloatToFused8BitRowwiseQuantized)
+    .NumInputs(1)
+    .NumOutputs(1)
+    .TensorInferenceFunction(FloatToFusedRowwiseQuantizedShapes<8>)
+    .SetDoc(R"DOC(Applies 8-bit row-wise quantization to a float matrix
+    and stores every row's scale and bias in the row itself. For i-th row
+    r_i we compute scale_i = (max_i - min_i) / 255 and bias_i = min_i and
+    quantize each element as round((r_ij - bias_i) / scale_i). Every output
+    row holds the quantized values (one byte per value) followed by scale_i
+    and bias_i as two floats, so SparseLengthsSumFused8BitRowwise needs a
+    single memory access per looked up row.)DOC")
+    .Input(0, "input", "Float32 input data")
+    .Output(0, "output", "Fused scale, bias and quantized data");
+
+OPERATOR_SCHEMA(Fused8BitRowwiseQuantizedToFloat)
+    .NumInputs(1)
+    .NumOutputs(1)
+    .TensorInferenceFunction(FusedRowwiseQuantizedToFloatShapes<8>)
+    .SetDoc(R"DOC(Restores a float matrix from the output of
+    FloatToFused8BitRowwiseQuantized by computing q_ij * scale_i + bias_i for
+    every element.)DOC")
+    .Input(
+        0,
+        "scale_bias_quantized_input",
+        "Fused scale, bias and quantized data")
+    .Output(0, "float_output", "Float32 data");
+
+OPERATOR_SCHEMA(SparseLengthsSumFused8BitRowwise)
+    .NumInputs(3)
+    .NumOutputs(1)
+    .SetDoc(R"DOC(Variation of SparseLengthsSum operator, where DATA is
+    stored in the fused 8-bit row-wise format produced by
+    FloatToFused8BitRowwiseQuantized.)DOC")
+    .Input(
+        0,
+        "DATA",
+        "uint8 tensor obtained with "
+        "operator FloatToFused8BitRowwiseQuantized")
+    .Input(
+        1,
+        "INDICES",
+        "Integer vector containing indices of the first "
+        "dimension of DATA for the slices that are being aggregated")
+    .Input(
+        2,
+        "LENGTHS",
+        "Vector with the same sum of elements as the first dimension of DATA")
+    .Output(0, "output", "output");
+
+OPERATOR_SCHEMA(SparseLengthsWeightedSumFused8BitRowwise)
+    .NumInputs(4)
+    .NumOutputs(1)
+    .SetDoc(R"DOC(Variation of SparseLengthsWeightedSum operator, where
+    DATA is stored in the fused 8-bit row-wise format produced by
+    FloatToFused8BitRowwiseQuantized.)DOC")
+    .Input(
+        0,
+        "DATA",
+        "uint8 tensor obtained with "
+        "operator FloatToFused8BitRowwiseQuantized")
+    .Input(
+        1,
+        "SCALARS",
+        "Scalar multipliers for the input slices. Must "
+        "be a vector with the length matching the length of INDICES")
+    .Input(
+        2,
+        "INDICES",
+        "Integer vector containing indices of the first "
+        "dimension of DATA for the slices that are being aggregated")
+    .Input(
+        3,
+        "LENGTHS",
+        "Vector with the same sum of elements as the first dimension of DATA")
+    .Output(0, "output", "output");
+
+OPERATOR_SCHEMA(SparseLengthsMeanFused8BitRowwise)
+    .NumInputs(3)
+    .NumOutputs(1)
+    .SetDoc(R"DOC(Variation of SparseLengthsMean operator, where DATA is
+    stored in the fused 8-bit row-wise format produced by
+    FloatToFused8BitRowwiseQuantized.)DOC")
+    .Input(
+        0,
+        "DATA",
+        "uint8 tensor obtained with "
+        "operator FloatToFused8BitRowwiseQuantized")
+    .Input(
+        1,
+        "INDICES",
+        "Integer vector containing indices of the first "
+        "dimension of DATA for the slices that are being aggregated")
+    .Input(
+        2,
+        "LENGTHS",
+        "Vector with the same sum of elements as the first dimension of DATA")
+    .Output(0, "output", "output");
+
+NO_GRADIENT(FloatToFused8BitRowwiseQuantized);
+NO_GRADIENT(Fused8BitRowwiseQuantizedToFloat);
+NO_GRADIENT(SparseLengthsSumFused8BitRowwise);
+NO_GRADIENT(SparseLengthsWeightedSumFused8BitRowwise);
+NO_GRADIENT(SparseLengthsMeanFused8BitRowwise);
+
+REGISTER_CPU_OPERATOR(
+    FloatToFused4BitRowwiseQuantized,
+    FloatToFusedRowwiseQuantizedOp<4, CPUContext>);
+REGISTER_CPU_OPERATOR(
+    Fused4BitRowwiseQuantizedToFloat,
+    FusedRowwiseQuantizedToFloatOp<4, CPUContext>);
+REGISTER_CPU_OPERATOR(
+    SparseLengthsSumFused4BitRowwise,
+    SparseLengthsFusedRowwiseOp<CPUContext, 4>);
+REGISTER_CPU_OPERATOR(
+    SparseLengthsWeightedSumFused4BitRowwise,
+    SparseLengthsFusedRowwiseOp<CPUContext, 4, 1>);
+REGISTER_CPU_OPERATOR(
+    SparseLengthsMeanFused4BitRowwise,
+    SparseLengthsFusedRowwiseOp<CPUContext, 4, 0, 1>);
+
+OPERATOR_SCHEMA(FloatToFused4BitRowwiseQuantized)
+    .NumInputs(1)
+    .NumOutputs(1)
+    .TensorInferenceFunction(FloatToFusedRowwiseQuantizedShapes<4>)
+    .SetDoc(R"DOC(Applies 4-bit row-wise quantization to a float matrix
+    and stores every row's scale and bias in the row itself. For i-th row
+    r_i we compute scale_i = (max_i - min_i) / 15 and bias_i = min_i and
+    quantize each element as round((r_ij - bias_i) / scale_i). Every output
+    row holds the quantized values (two values per byte, the even element
+    in the low nibble) followed by scale_i and bias_i as two floats, so
+    SparseLengthsSumFused4BitRowwise needs a single memory access per looked
+    up row. The number of columns has to be even.)DOC")
+    .Input(0, "input", "Float32 input data")
+    .Output(0, "output", "Fused scale, bias and quantized data");
+
+OPERATOR_SCHEMA(Fused4BitRowwiseQuantizedToFloat)
+    .NumInputs(1)
+    .NumOutputs(1)
+    .TensorInferenceFunction(FusedRowwiseQuantizedToFloatShapes<4>)
+    .SetDoc(R"DOC(Restores a float matrix from the output of
+    FloatToFused4BitRowwiseQuantized by computing q_ij * scale_i + bias_i for
+    every element.)DOC")
+    .Input(
+        0,
+        "scale_bias_quantized_input",
+        "Fused scale, bias and quantized data")
+    .Output(0, "float_output", "Float32 data");
+
+OPERATOR_SCHEMA(SparseLengthsSumFused4BitRowwise)
+    .NumInputs(3)
+    .NumOutputs(1)
+    .SetDoc(R"DOC(Variation of SparseLengthsSum operator, where DATA is
+    stored in the fused 4-bit row-wise format produced by
+    FloatToFused4BitRowwiseQuantized.)DOC")
+    .Input(
+        0,
+        "DATA",
+        "uint8 tensor obtained with "
+        "operator FloatToFused4BitRowwiseQuantized")
+    .Input(
+        1,
+        "INDICES",
+        "Integer vector containing indices of the first "
+        "dimension of DATA for the slices that are being aggregated")
+    .Input(
+        2,
+        "LENGTHS",
+        "Vector with the same sum of elements as the first dimension of DATA")
+    .Output(0, "output", "output");
+
+OPERATOR_SCHEMA(SparseLengthsWeightedSumFused4BitRowwise)
+    .NumInputs(4)
+    .NumOutputs(1)
+    .SetDoc(R"DOC(Variation of SparseLengthsWeightedSum operator, where
+    DATA is stored in the fused 4-bit row-wise format produced by
+    FloatToFused4BitRowwiseQuantized.)DOC")
+    .Input(
+        0,
+        "DATA",
+        "uint8 tensor obtained with "
+        "operator FloatToFused4BitRowwiseQuantized")
+    .Input(
+        1,
+        "SCALARS",
+        "Scalar multipliers for the input slices. Must "
+        "be a vector with the length matching the length of INDICES")
+    .Input(
+        2,
+        "INDICES",
+        "Integer vector containing indices of the first "
+        "dimension of DATA for the slices that are being aggregated")
+    .Input(
+        3,
+        "LENGTHS",
+        "Vector with the same sum of elements as the first dimension of DATA")
+    .Output(0, "output", "output");
+
+OPERATOR_SCHEMA(SparseLengthsMeanFused4BitRowwise)
+    .NumInputs(3)
+    .NumOutputs(1)
+    .SetDoc(R"DOC(Variation of SparseLengthsMean operator, where DATA is
+    stored in the fused 4-bit row-wise format produced by
+    FloatToFused4BitRowwiseQuantized.)DOC")
+    .Input(
+        0,
+        "DATA",
+        "uint8 tensor obtained with "
+        "operator FloatToFused4BitRowwiseQuantized")
+    .Input(
+        1,
+        "INDICES",
+        "Integer vector containing indices of the first "
+        "dimension of DATA for the slices that are being aggregated")
+    .Input(
+        2,
+        "LENGTHS",
+        "Vector with the same sum of elements as the first dimension of DATA")
+    .Output(0, "output", "output");
+
+NO_GRADIENT(FloatToFused4BitRowwiseQuantized);
+NO_GRADIENT(Fused4BitRowwiseQuantizedToFloat);
+NO_GRADIENT(SparseLengthsSumFused4BitRowwise);
+NO_GRADIENT(SparseLengthsWeightedSumFused4BitRowwise);
+NO_GRADIENT(SparseLengthsMeanFused4BitRowwise);
+
+} // namespace caffe2
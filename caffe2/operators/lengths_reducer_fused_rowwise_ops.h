@@ -0,0 +1,246 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CAFFE2_OPERATORS_LENGTHS_REDUCER_FUSED_ROWWISE_OPS_H_
+#define CAFFE2_OPERATORS_LENGTHS_REDUCER_FUSED_ROWWISE_OPS_H_
+// SparseLengthsSumFused8BitRowwise / SparseLengthsSumFused4BitRowwise
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "caffe2/core/context.h"
+#include "caffe2/core/logging.h"
+#include "caffe2/core/operator.h"
+#include "caffe2/perfkernels/fused_4bit_rowwise_embedding_lookup.h"
+#include "caffe2/perfkernels/fused_8bit_rowwise_embedding_lookup.h"
+#include "caffe2/utils/math.h"
+
+namespace caffe2 {
+
+// Fused rowwise quantized rows store the quantized values followed by a
+// float scale and a float bias. With BIT_RATE 8 every value takes a byte,
+// with BIT_RATE 4 two values are packed into one byte, the even element in
+// the low nibble.
+template <int BIT_RATE>
+struct FusedRowwiseQuantization {
+  static_assert(BIT_RATE == 8 || BIT_RATE == 4, "Unsupported bit rate");
+  static constexpr int kElementsPerByte = 8 / BIT_RATE;
+  static constexpr int kMaxValue = (1 << BIT_RATE) - 1;
+
+  static TIndex PackedBlockSize(TIndex block_size) {
+    return (block_size + kElementsPerByte - 1) / kElementsPerByte;
+  }
+  static TIndex FusedBlockSize(TIndex block_size) {
+    return PackedBlockSize(block_size) + 2 * sizeof(float);
+  }
+  // Inverse of FusedBlockSize, exact because the quantize op only accepts
+  // block sizes that are multiples of kElementsPerByte.
+  static TIndex BlockSize(TIndex fused_block_size) {
+    return (fused_block_size - 2 * sizeof(float)) * kElementsPerByte;
+  }
+};
+
+template <int BIT_RATE, class Context>
+class FloatToFusedRowwiseQuantizedOp : public Operator<Context> {
+ public:
+  using Quantization = FusedRowwiseQuantization<BIT_RATE>;
+  USE_OPERATOR_CONTEXT_FUNCTIONS;
+  USE_SIMPLE_CTOR_DTOR(FloatToFusedRowwiseQuantizedOp);
+
+  bool RunOnDevice() override {
+    auto& input = Input(DATA_FLOAT);
+    auto* output = Output(DATA_FUSED_SCALE_BIAS);
+    CAFFE_ENFORCE_EQ(2, input.ndim(), "Expect input to be a matrix");
+
+    const auto input_rows = input.dim(0);
+    const auto input_columns = input.dim(1);
+    CAFFE_ENFORCE_EQ(
+        0,
+        input_columns % Quantization::kElementsPerByte,
+        "Expect the number of columns to be a multiple of ",
+        Quantization::kElementsPerByte);
+    const auto output_columns = Quantization::FusedBlockSize(input_columns);
+    output->Resize(input_rows, output_columns);
+
+    const float* input_data = input.template data<float>();
+    uint8_t* output_data = output->template mutable_data<uint8_t>();
+    const auto packed_columns = Quantization::PackedBlockSize(input_columns);
+
+    for (TIndex row = 0; row < input_rows; ++row) {
+      ConstEigenVectorArrayMap<float> input_row(
+          input_data + row * input_columns, input_columns);
+      uint8_t* output_row = output_data + row * output_columns;
+
+      const float minimum_element = input_row.minCoeff();
+      const float maximum_element = input_row.maxCoeff();
+      const float range = maximum_element - minimum_element;
+      float scale_bias[2];
+      scale_bias[0] = range < 1e-10f ? 1.0f : range / Quantization::kMaxValue;
+      scale_bias[1] = minimum_element;
+      const float inverse_scale = 1.0f / scale_bias[0];
+
+      memset(output_row, 0, packed_columns);
+      for (TIndex column = 0; column < input_columns; ++column) {
+        const float normalized =
+            (input_row(column) - minimum_element) * inverse_scale;
+        const int quantized = std::max(
+            0,
+            std::min<int>(
+                std::lrintf(normalized), Quantization::kMaxValue));
+        output_row[column / Quantization::kElementsPerByte] |= quantized
+            << ((column % Quantization::kElementsPerByte) * BIT_RATE);
+      }
+      memcpy(output_row + packed_columns, scale_bias, sizeof(scale_bias));
+    }
+    return true;
+  }
+
+ private:
+  INPUT_TAGS(DATA_FLOAT);
+  OUTPUT_TAGS(DATA_FUSED_SCALE_BIAS);
+};
+
+template <int BIT_RATE, class Context>
+class FusedRowwiseQuantizedToFloatOp : public Operator<Context> {
+ public:
+  using Quantization = FusedRowwiseQuantization<BIT_RATE>;
+  USE_OPERATOR_CONTEXT_FUNCTIONS;
+  USE_SIMPLE_CTOR_DTOR(FusedRowwiseQuantizedToFloatOp);
+
+  bool RunOnDevice() override {
+    auto& input = Input(DATA_FUSED_SCALE_BIAS);
+    auto* output = Output(DATA_FLOAT);
+    CAFFE_ENFORCE_EQ(2, input.ndim(), "Expect input to be a matrix");
+    CAFFE_ENFORCE_GT(
+        input.dim(1),
+        2 * sizeof(float),
+        "Expect rows to hold data followed by a float scale and bias");
+
+    const auto input_rows = input.dim(0);
+    const auto input_columns = input.dim(1);
+    const auto output_columns = Quantization::BlockSize(input_columns);
+    const auto packed_columns = input_columns - 2 * sizeof(float);
+    output->Resize(input_rows, output_columns);
+
+    const uint8_t* input_data = input.template data<uint8_t>();
+    float* output_data = output->template mutable_data<float>();
+
+    for (TIndex row = 0; row < input_rows; ++row) {
+      const uint8_t* input_row = input_data + row * input_columns;
+      float scale_bias[2];
+      memcpy(scale_bias, input_row + packed_columns, sizeof(scale_bias));
+      float* output_row = output_data + row * output_columns;
+      for (TIndex column = 0; column < output_columns; ++column) {
+        const int quantized =
+            (input_row[column / Quantization::kElementsPerByte] >>
+             ((column % Quantization::kElementsPerByte) * BIT_RATE)) &
+            Quantization::kMaxValue;
+        output_row[column] = quantized * scale_bias[0] + scale_bias[1];
+      }
+    }
+    return true;
+  }
+
+ private:
+  INPUT_TAGS(DATA_FUSED_SCALE_BIAS);
+  OUTPUT_TAGS(DATA_FLOAT);
+};
+
+template <
+    class Context,
+    int BIT_RATE,
+    bool USE_WEIGHTS = 0,
+    bool USE_MEAN = 0>
+class SparseLengthsFusedRowwiseOp : public Operator<Context> {
+ public:
+  using Quantization = FusedRowwiseQuantization<BIT_RATE>;
+  USE_OPERATOR_CONTEXT_FUNCTIONS;
+  USE_SIMPLE_CTOR_DTOR(SparseLengthsFusedRowwiseOp);
+
+  bool RunOnDevice() override {
+    return DispatchHelper<TensorTypes<int32_t, int64_t>>::call(
+        this, Input(INDICES));
+  }
+
+  template <typename IndexType>
+  bool DoRunWithType() {
+    const auto& data = Input(DATA);
+    const auto& indices = Input(INDICES);
+    const auto& lengths = Input(LENGTHS);
+    auto* output = Output(0);
+
+    CAFFE_ENFORCE_EQ(2, data.ndim(), "DATA must be a matrix");
+    CAFFE_ENFORCE_EQ(1, indices.ndim(), "INDICES must be a vector");
+    CAFFE_ENFORCE_EQ(1, lengths.ndim(), "LENGTHS must be a vector");
+    CAFFE_ENFORCE_GT(
+        data.dim(1),
+        2 * sizeof(float),
+        "DATA rows must hold data followed by a float scale and bias");
+
+    const float* weights = nullptr;
+    if (USE_WEIGHTS) {
+      const auto& weights_input = Input(WEIGHTS);
+      CAFFE_ENFORCE_EQ(1, weights_input.ndim(), "WEIGHTS must be a vector");
+      CAFFE_ENFORCE_EQ(
+          weights_input.size(),
+          indices.size(),
+          "WEIGHTS should have the same length as INDICES.");
+      weights = weights_input.template data<float>();
+    }
+
+    const TIndex block_size = Quantization::BlockSize(data.dim(1));
+    output->Resize(lengths.dim(0), block_size);
+
+    if (BIT_RATE == 8) {
+      Fused8BitRowwiseEmbeddingLookup(
+          block_size,
+          output->dim(0),
+          indices.size(),
+          data.dim(0),
+          data.template data<uint8_t>(),
+          indices.template data<IndexType>(),
+          lengths.template data<int>(),
+          weights,
+          USE_MEAN,
+          output->template mutable_data<float>());
+    } else {
+      Fused4BitRowwiseEmbeddingLookup(
+          block_size,
+          output->dim(0),
+          indices.size(),
+          data.dim(0),
+          data.template data<uint8_t>(),
+          indices.template data<IndexType>(),
+          lengths.template data<int>(),
+          weights,
+          USE_MEAN,
+          output->template mutable_data<float>());
+    }
+    return true;
+  }
+
+  enum {
+    DATA = 0,
+    WEIGHTS = 1,
+    INDICES = 1 + USE_WEIGHTS,
+    LENGTHS = 2 + USE_WEIGHTS,
+  };
+};
+
+} // namespace caffe2
+
+#endif // CAFFE2_OPERATORS_LENGTHS_REDUCER_FUSED_ROWWISE_OPS_H_
@@ -86,23 +86,77 @@ class CPUSparseLengthsReductionOp : public Operator<CPUContext> {
       in_weight = weightInput.template data<T>();
     }
 
-    // delegate work to perfkernel that branches based on architecture
-    EmbeddingLookup(
-        D,
-        M,
+    // Large batches are split into contiguous ranges of segments that are
+    // reduced in parallel. The work is counted in rows: the rows each segment
+    // looks up, plus one for writing its output.
+    const TIndex grain = CPUContext::ParallelForGrain(D);
+    if (M <= 1 || (indices_size + M) / grain < 2) {
+      // delegate work to perfkernel that branches based on architecture
+      EmbeddingLookup(
+          D,
+          M,
+          indices_size,
+          N,
+          in_data,
+          indices,
+          lengths,
+          in_weight,
+          nullptr, // scale_bias field is only used in SparseLengths8BitsRowwiseOp
+          USE_MEAN,
+          out_data);
+      return true;
+    }
+
+    // offsets_[m] is the position in INDICES of the first index of segment m.
+    offsets_.resize(M + 1);
+    offsets_[0] = 0;
+    for (TIndex m = 0; m < M; ++m) {
+      CAFFE_ENFORCE_GE(lengths[m], 0, "LENGTHS must be non-negative");
+      offsets_[m + 1] = offsets_[m] + lengths[m];
+    }
+    CAFFE_ENFORCE_EQ(
+        offsets_[M],
         indices_size,
-        N,
-        in_data,
-        indices,
-        lengths,
-        in_weight,
-        nullptr, // scale_bias field is only used in SparseLengths8BitsRowwiseOp
-        USE_MEAN,
-        out_data);
+        "Your input seems to be incorrect: the sum of lengths values should be "
+        "the size of the indices tensor, but it appears not.");
+
+    // The first segment whose rows start at or after `row`, so that the row
+    // ranges of the chunks map to adjacent ranges of segments.
+    auto first_segment = [&](TIndex row) {
+      TIndex lo = 0, hi = M;
+      while (lo < hi) {
+        const TIndex mid = lo + (hi - lo) / 2;
+        if (offsets_[mid] + mid < row) {
+          lo = mid + 1;
+        } else {
+          hi = mid;
+        }
+      }
+      return lo;
+    };
+    context_.ParallelFor(
+        indices_size + M, grain, [&](TIndex row_begin, TIndex row_end) {
+          const TIndex begin = first_segment(row_begin);
+          const TIndex end = first_segment(row_end);
+          if (begin == end) {
+            return;
+          }
+          EmbeddingLookup(
+              D,
+              end - begin,
+              offsets_[end] - offsets_[begin],
+              N,
+              in_data,
+              indices + offsets_[begin],
+              lengths + begin,
+              in_weight ? in_weight + offsets_[begin] : nullptr,
+              nullptr,
+              USE_MEAN,
+              out_data + begin * D);
+        });
     return true;
   }
 
- private:
   enum {
     DATA = 0, // Data input.
     WEIGHT = 1, // Weight input used in SparseLengthsWeightedSum
@@ -111,6 +165,8 @@ class CPUSparseLengthsReductionOp : public Operator<CPUContext> {
     LENGTHS = 2 + USE_WEIGHT, // 2 in SparseLengths[Sum, Mean],
                               // 3 in SparseLengthsWeightedSum
   };
+
+  std::vector<TIndex> offsets_;
 };
 
 } // namespace caffe2
@@ -0,0 +1,143 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <limits>
+#include <random>
+
+#include "caffe2/core/flags.h"
+#include "caffe2/core/scope_guard.h"
+#include "caffe2/operators/lengths_reducer_ops.h"
+#include <gtest/gtest.h>
+
+CAFFE2_DECLARE_int(caffe2_threadpool_num_threads);
+
+namespace caffe2 {
+
+namespace {
+
+template <typename T>
+void FillTensor(
+    const vector<TIndex>& shape,
+    const vector<T>& values,
+    const string& name,
+    Workspace* ws) {
+  auto* tensor = ws->CreateBlob(name)->GetMutable<TensorCPU>();
+  tensor->Resize(shape);
+  std::copy(values.begin(), values.end(), tensor->mutable_data<T>());
+}
+
+// Runs op_type once on a single thread and once split across the workspace
+// thread pool and checks that both give the same result.
+void CheckParallelMatchesSerial(const string& op_type, bool use_weights) {
+  const int kRows = 100;
+  const int kBlockSize = 24;
+  const int kSegments = 257;
+  std::mt19937 gen(0);
+  std::uniform_real_distribution<float> value(-1, 1);
+  // Skewed lengths, including empty segments.
+  std::uniform_int_distribution<int> length(0, 3);
+
+  auto old_num_threads = FLAGS_caffe2_threadpool_num_threads;
+  auto old_min_work = FLAGS_caffe2_parallel_for_min_work;
+  auto g = MakeGuard([&]() {
+    FLAGS_caffe2_threadpool_num_threads = old_num_threads;
+    FLAGS_caffe2_parallel_for_min_work = old_min_work;
+  });
+  // Split into several chunks even on machines with few cores.
+  FLAGS_caffe2_threadpool_num_threads = 4;
+  Workspace ws;
+  vector<float> data(kRows * kBlockSize);
+  for (auto& x : data) {
+    x = value(gen);
+  }
+  vector<int> lengths(kSegments);
+  int num_indices = 0;
+  for (int i = 0; i < kSegments; ++i) {
+    lengths[i] = i % 50 == 0 ? 40 : length(gen);
+    num_indices += lengths[i];
+  }
+  vector<int64_t> indices(num_indices);
+  vector<float> weights(num_indices);
+  for (int i = 0; i < num_indices; ++i) {
+    indices[i] = gen() % kRows;
+    weights[i] = value(gen);
+  }
+  FillTensor<float>({kRows, kBlockSize}, data, "data", &ws);
+  FillTensor<int>({kSegments}, lengths, "lengths", &ws);
+  FillTensor<int64_t>({num_indices}, indices, "indices", &ws);
+  FillTensor<float>({num_indices}, weights, "weights", &ws);
+
+  OperatorDef def;
+  def.set_type(op_type);
+  def.add_input("data");
+  if (use_weights) {
+    def.add_input("weights");
+  }
+  def.add_input("indices");
+  def.add_input("lengths");
+  def.add_output("out");
+
+  FLAGS_caffe2_parallel_for_min_work = std::numeric_limits<int64_t>::max();
+  ASSERT_TRUE(ws.RunOperatorOnce(def));
+  TensorCPU serial(ws.GetBlob("out")->Get<TensorCPU>());
+
+  FLAGS_caffe2_parallel_for_min_work = 1;
+  ASSERT_TRUE(ws.RunOperatorOnce(def));
+  const auto& parallel = ws.GetBlob("out")->Get<TensorCPU>();
+
+  ASSERT_EQ(serial.dims(), parallel.dims());
+  for (int i = 0; i < serial.size(); ++i) {
+    EXPECT_FLOAT_EQ(serial.data<float>()[i], parallel.data<float>()[i]);
+  }
+}
+
+} // namespace
+
+TEST(LengthsReducerOpsTest, ParallelSparseLengthsSum) {
+  CheckParallelMatchesSerial("SparseLengthsSum", false);
+}
+
+TEST(LengthsReducerOpsTest, ParallelSparseLengthsWeightedSum) {
+  CheckParallelMatchesSerial("SparseLengthsWeightedSum", true);
+}
+
+TEST(LengthsReducerOpsTest, ParallelSparseLengthsMean) {
+  CheckParallelMatchesSerial("SparseLengthsMean", false);
+}
+
+TEST(LengthsReducerOpsTest, ParallelRejectsBadIndex) {
+  auto old_num_threads = FLAGS_caffe2_threadpool_num_threads;
+  auto old_min_work = FLAGS_caffe2_parallel_for_min_work;
+  auto g = MakeGuard([&]() {
+    FLAGS_caffe2_threadpool_num_threads = old_num_threads;
+    FLAGS_caffe2_parallel_for_min_work = old_min_work;
+  });
+  FLAGS_caffe2_threadpool_num_threads = 4;
+  Workspace ws;
+  FillTensor<float>({2, 4}, vector<float>(8, 1), "data", &ws);
+  FillTensor<int>({3}, {1, 1, 1}, "lengths", &ws);
+  FillTensor<int64_t>({3}, {0, 1, 2}, "indices", &ws);
+  OperatorDef def;
+  def.set_type("SparseLengthsSum");
+  def.add_input("data");
+  def.add_input("indices");
+  def.add_input("lengths");
+  def.add_output("out");
+  FLAGS_caffe2_parallel_for_min_work = 1;
+  EXPECT_THROW(ws.RunOperatorOnce(def), EnforceNotMet);
+}
+
+} // namespace caffe2
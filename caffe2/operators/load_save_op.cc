@@ -98,7 +98,11 @@ to specify the type of the input db/dbs.
         "source_blob_names",
         "(list of strings) if set, used instead of output "
         "blob names, to specify which blobs in the db shall be loaded. Must be "
-        "the same length as number of output blobs.");
+        "the same length as number of output blobs.")
+    .Arg(
+        "num_threads",
+        "(int, default 1) number of threads used to read and deserialize "
+        "several dbs in parallel, one db per thread.");
 
 OPERATOR_SCHEMA(Save)
     .NumInputs(1, INT_MAX)
@@ -123,7 +127,16 @@ db specified by the arguments.
         "(list of strings) if set, used instead of original "
         "blob names. Must be the same length as number of blobs.")
     .Arg("db", "(string) the path to the db to load.")
-    .Arg("db_type", "(string) the type of the db.");
+    .Arg("db_type", "(string) the type of the db.")
+    .Arg(
+        "chunk_size",
+        "(int, default -1) number of tensor elements per serialized chunk. "
+        "-1 uses caffe2_tensor_chunk_size and 0 disables chunking.")
+    .Arg(
+        "num_threads",
+        "(int, default 0) if positive, serialize the chunks of all CPU "
+        "tensors on this many threads and write every chunk to the db as soon "
+        "as it is ready, bounding memory to num_threads chunks.");
 
 OPERATOR_SCHEMA(Checkpoint)
     .NumInputs(1, INT_MAX)
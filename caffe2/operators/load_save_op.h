@@ -17,8 +17,11 @@
 #ifndef CAFFE2_OPERATORS_LOAD_SAVE_OP_H_
 #define CAFFE2_OPERATORS_LOAD_SAVE_OP_H_
 
+#include <atomic>
 #include <cstdio>
 #include <map>
+#include <mutex>
+#include <thread>
 #include <unordered_set>
 
 #include "caffe2/core/blob_serialization.h"
@@ -102,7 +105,8 @@ class LoadOp final : public Operator<Context> {
         allow_incomplete_(
             OperatorBase::GetSingleArgument<bool>("allow_incomplete", false)),
         blob_names_(
-            OperatorBase::GetRepeatedArgument<string>("source_blob_names")) {
+            OperatorBase::GetRepeatedArgument<string>("source_blob_names")),
+        num_threads_(OperatorBase::GetSingleArgument<int>("num_threads", 1)) {
     if (InputSize() == 0) {
       CAFFE_ENFORCE_GT(db_type_.size(), 0, "Must specify a db type.");
       if (db_names_.empty()) {
@@ -149,15 +153,16 @@ class LoadOp final : public Operator<Context> {
   void SetCurrentDevice(BlobProto* proto);
 
   bool RunOnDevice() override {
-    int total_loaded_blobs = 0;
-    std::unordered_map<string, BlobState> blob_states;
-    if (InputSize() > 0) {
-      for (int i = 0; i < InputSize(); ++i) {
+    const int num_dbs = InputSize() > 0 ? InputSize() : db_names_.size();
+    // Every db is read by one thread into its own blob states. A key can only
+    // come from one db, so the states of different dbs never overlap.
+    std::vector<std::unordered_map<string, BlobState>> db_blob_states(num_dbs);
+    std::vector<int> db_loaded_blobs(num_dbs, 0);
+    auto load = [&](int i) {
+      if (InputSize() > 0) {
         const db::DBReader& reader = OperatorBase::Input<db::DBReader>(i);
-        extract(i, reader.cursor(), &blob_states, &total_loaded_blobs);
-      }
-    } else {
-      for (int i = 0; i < db_names_.size(); ++i) {
+        extract(i, reader.cursor(), &db_blob_states[i], &db_loaded_blobs[i]);
+      } else {
         string full_db_name = absolute_path_
             ? db_names_[i]
             : (ws_->RootFolder() + "/" + db_names_[i]);
@@ -165,10 +170,49 @@ class LoadOp final : public Operator<Context> {
             caffe2::db::CreateDB(db_type_, full_db_name, caffe2::db::READ));
         CAFFE_ENFORCE(in_db.get(), "Cannot open db: ", full_db_name);
         std::unique_ptr<Cursor> cursor(in_db->NewCursor());
-        extract(i, cursor.get(), &blob_states, &total_loaded_blobs);
+        extract(i, cursor.get(), &db_blob_states[i], &db_loaded_blobs[i]);
+      }
+    };
+    const int num_threads = std::min(std::max(num_threads_, 1), num_dbs);
+    if (num_threads <= 1) {
+      for (int i = 0; i < num_dbs; ++i) {
+        load(i);
+      }
+    } else {
+      std::atomic<int> next_db{0};
+      std::vector<std::exception_ptr> errors(num_threads);
+      auto task = [&](std::exception_ptr* error) {
+        try {
+          for (int i = next_db++; i < num_dbs; i = next_db++) {
+            load(i);
+          }
+        } catch (...) {
+          *error = std::current_exception();
+          next_db = num_dbs;
+        }
+      };
+      std::vector<std::thread> threads;
+      for (int t = 1; t < num_threads; ++t) {
+        threads.emplace_back(task, &errors[t]);
+      }
+      task(&errors[0]);
+      for (auto& thread : threads) {
+        thread.join();
+      }
+      for (const auto& error : errors) {
+        if (error) {
+          std::rethrow_exception(error);
+        }
       }
     }
 
+    int total_loaded_blobs = 0;
+    std::unordered_map<string, BlobState> blob_states;
+    for (int i = 0; i < num_dbs; ++i) {
+      total_loaded_blobs += db_loaded_blobs[i];
+      blob_states.insert(db_blob_states[i].begin(), db_blob_states[i].end());
+    }
+
     validateBlobStates(blob_states);
     // Loaded all the needed blobs.
     if (load_all_ || total_loaded_blobs == OutputSize()) {
@@ -224,22 +268,17 @@ class LoadOp final : public Operator<Context> {
     int loaded_blobs = 0;
     for (; cursor->Valid(); cursor->Next()) {
       const auto key = buildBlobNameFromDbKey(cursor->key());
-      if (key_to_dbid_.count(key) && key_to_dbid_[key] != db_id) {
-        CAFFE_THROW("Duplicate Key ", key, " is found!\n");
-      } else {
-        key_to_dbid_[key] = db_id;
+      Blob* blob = nullptr;
+      {
+        std::lock_guard<std::mutex> guard(mutex_);
+        claimKey(key, db_id);
+        blob = ws_->CreateBlob(key);
       }
 
       BlobProto proto;
-      CAFFE_ENFORCE(
-          proto.ParseFromString(cursor->value()), "Couldn't parse Proto");
-      if (!keep_device_) {
-        // If we are not keeping the device as the one specified in the
-        // proto, we will set the current device.
-        SetCurrentDevice(&proto);
-      }
-      Blob* blob = ws_->CreateBlob(key);
-      ProcessBlob(blob, proto, blob_states, key, &loaded_blobs);
+      std::shared_ptr<void> owner;
+      const void* data = ReadValue(cursor, &proto, &owner);
+      ProcessBlob(blob, proto, data, owner, blob_states, key, &loaded_blobs);
     }
     *total_loaded_blobs += loaded_blobs;
   }
@@ -257,23 +296,18 @@ class LoadOp final : public Operator<Context> {
       if (!output_indices_.count(key)) {
         VLOG(1) << "Key " << key << " not used. Skipping.";
       } else {
-        if (key_to_dbid_.count(key) && key_to_dbid_[key] != db_id) {
-          CAFFE_THROW("Duplicate Key ", key, " is found!\n");
-        } else {
-          key_to_dbid_[key] = db_id;
+        {
+          std::lock_guard<std::mutex> guard(mutex_);
+          claimKey(key, db_id);
         }
 
         VLOG(2) << "Deserializing blob " << key;
         BlobProto proto;
-        CAFFE_ENFORCE(proto.ParseFromString(cursor->value()));
-        if (!keep_device_) {
-          // If we are not keeping the device as the one specified in the
-          // proto, we will set the current device.
-          SetCurrentDevice(&proto);
-        }
-        auto blobIndex = output_indices_[key];
+        std::shared_ptr<void> owner;
+        const void* data = ReadValue(cursor, &proto, &owner);
+        auto blobIndex = output_indices_.at(key);
         Blob* blob = outputs.at(blobIndex);
-        ProcessBlob(blob, proto, blob_states, key, &loaded_blobs);
+        ProcessBlob(blob, proto, data, owner, blob_states, key, &loaded_blobs);
 
         if (*total_loaded_blobs + loaded_blobs == OutputSize()) {
           break;
@@ -284,6 +318,44 @@ class LoadOp final : public Operator<Context> {
     *total_loaded_blobs += loaded_blobs;
   }
 
+  // Reads the current value of the cursor into proto. If the db exposes the
+  // tensor contents in memory and the tensor is going to be loaded on CPU,
+  // returns a pointer to them instead of copying them into proto; owner then
+  // keeps that memory alive.
+  const void* ReadValue(
+      Cursor* cursor,
+      BlobProto* proto,
+      std::shared_ptr<void>* owner) {
+    const void* data = cursor->TensorData(proto, owner);
+    if (data) {
+      if (!keep_device_) {
+        SetCurrentDevice(proto);
+      }
+      if (proto->tensor().device_detail().device_type() == CPU) {
+        return data;
+      }
+      proto->Clear();
+      owner->reset();
+    }
+    CAFFE_ENFORCE(
+        proto->ParseFromString(cursor->value()), "Couldn't parse Proto");
+    if (!keep_device_) {
+      // If we are not keeping the device as the one specified in the
+      // proto, we will set the current device.
+      SetCurrentDevice(proto);
+    }
+    return nullptr;
+  }
+
+  // Records that key is loaded from db_id. Must hold mutex_.
+  void claimKey(const string& key, int db_id) {
+    auto it = key_to_dbid_.find(key);
+    if (it != key_to_dbid_.end() && it->second != db_id) {
+      CAFFE_THROW("Duplicate Key ", key, " is found!\n");
+    }
+    key_to_dbid_[key] = db_id;
+  }
+
   string buildBlobNameFromDbKey(const string& dbKey) {
     string key = dbKey.substr(0, dbKey.find(kChunkIdSeparator));
     if (!strip_prefix_.empty()) {
@@ -302,6 +374,8 @@ class LoadOp final : public Operator<Context> {
   void ProcessBlob(
       Blob* blob,
       const BlobProto& proto,
+      const void* data,
+      const std::shared_ptr<void>& owner,
       std::unordered_map<string, BlobState>* blob_states_ptr,
       const string& key,
       int* loaded_blobs) {
@@ -314,7 +388,11 @@ class LoadOp final : public Operator<Context> {
       // different GPU.
       blob->Reset();
     }
-    blob->Deserialize(proto);
+    if (data) {
+      AliasTensor(blob, proto.tensor(), data, owner, blob_states.count(key));
+    } else {
+      blob->Deserialize(proto);
+    }
     if (proto.has_content_num_chunks()) {
       if (!blob_states.count(key)) {
         blob_states[key] = BlobState(proto.content_num_chunks());
@@ -390,6 +468,32 @@ class LoadOp final : public Operator<Context> {
     }
   }
 
+  // Makes the blob a CPU tensor that shares the memory of the whole tensor
+  // at data. All the chunks of a tensor point to the same memory, so only the
+  // first one needs to do anything.
+  void AliasTensor(
+      Blob* blob,
+      const TensorProto& proto,
+      const void* data,
+      const std::shared_ptr<void>& owner,
+      bool seen) {
+    auto* tensor = blob->GetMutable<TensorCPU>();
+    if (seen) {
+      CAFFE_ENFORCE(
+          tensor->raw_data() == data,
+          "Cannot mix aliased and copied chunks of tensor ",
+          proto.name());
+      return;
+    }
+    tensor->Resize(
+        std::vector<TIndex>(proto.dims().begin(), proto.dims().end()));
+    tensor->ShareExternalPointer(
+        const_cast<void*>(data),
+        DataTypeToTypeMeta(proto.data_type()),
+        0,
+        [owner](void*) {});
+  }
+
   void validateBlobStates(
       const std::unordered_map<string, BlobState>& blob_states) {
     for (const auto& iter : blob_states) {
@@ -418,6 +522,10 @@ class LoadOp final : public Operator<Context> {
   std::map<string, int> output_indices_;
   std::map<string, int> key_to_dbid_;
   std::vector<std::string> blob_names_;
+  int num_threads_;
+  // Guards key_to_dbid_ and blob creation in the workspace when several dbs
+  // are loaded in parallel.
+  std::mutex mutex_;
 };
 
 template <class Context>
@@ -434,7 +542,11 @@ class SaveOp final : public Operator<Context> {
         db_name_(OperatorBase::GetSingleArgument<string>("db", "")),
         db_type_(OperatorBase::GetSingleArgument<string>("db_type", "")),
         blob_names_(
-            OperatorBase::GetRepeatedArgument<string>("blob_name_overrides")) {
+            OperatorBase::GetRepeatedArgument<string>("blob_name_overrides")),
+        chunk_size_(OperatorBase::GetSingleArgument<int>(
+            "chunk_size",
+            kDefaultChunkSize)),
+        num_threads_(OperatorBase::GetSingleArgument<int>("num_threads", 0)) {
     CAFFE_ENFORCE_GT(db_name_.size(), 0, "Must specify a db name.");
     CAFFE_ENFORCE_GT(db_type_.size(), 0, "Must specify a db type.");
     CAFFE_ENFORCE(
@@ -486,20 +598,113 @@ class SaveOp final : public Operator<Context> {
     };
 
     const vector<const Blob*>& inputs = OperatorBase::Inputs();
-    for (int i = 0; i < inputs.size(); ++i) {
-      inputs[i]->Serialize(blob_names_[i], acceptor);
+    if (num_threads_ > 0) {
+      streamingSave(inputs, acceptor);
+    } else {
+      for (int i = 0; i < inputs.size(); ++i) {
+        inputs[i]->Serialize(blob_names_[i], acceptor, chunk_size_);
+      }
     }
     out_db->Close();
     return true;
   }
 
  private:
+  // Serializes the chunks of all the CPU tensors on num_threads_ threads and
+  // hands every chunk to the acceptor as soon as it is ready, so no more than
+  // num_threads_ serialized chunks are held in memory at any time. Other blobs
+  // are serialized whole by one of the threads.
+  void streamingSave(
+      const vector<const Blob*>& inputs,
+      const BlobSerializerBase::SerializationAcceptor& acceptor) {
+    const int chunk_size = chunk_size_ == kDefaultChunkSize
+        ? FLAGS_caffe2_tensor_chunk_size
+        : chunk_size_;
+    // (input index, first element of the chunk), or -1 for a whole blob.
+    std::vector<std::pair<int, TIndex>> chunks;
+    for (int i = 0; i < inputs.size(); ++i) {
+      if (!inputs[i]->template IsType<TensorCPU>()) {
+        chunks.emplace_back(i, -1);
+        continue;
+      }
+      const auto size = inputs[i]->template Get<TensorCPU>().size();
+      const TIndex step = chunk_size == kNoChunking ? size + 1 : chunk_size;
+      CAFFE_ENFORCE_GT(step, 0, "Invalid chunk size: ", chunk_size);
+      // Empty tensors still need their shape serialized in one chunk.
+      for (TIndex begin = 0; begin < std::max(size, TIndex(1));
+           begin += step) {
+        chunks.emplace_back(i, begin);
+      }
+    }
+
+    std::atomic<size_t> next_chunk{0};
+    auto task = [&](std::exception_ptr* error) {
+      try {
+        serializeChunks(inputs, chunks, chunk_size, acceptor, &next_chunk);
+      } catch (...) {
+        *error = std::current_exception();
+        // Let the other threads run out of work.
+        next_chunk = chunks.size();
+      }
+    };
+    const size_t num_threads =
+        std::min(static_cast<size_t>(num_threads_), chunks.size());
+    std::vector<std::exception_ptr> errors(num_threads);
+    std::vector<std::thread> threads;
+    for (size_t t = 1; t < num_threads; ++t) {
+      threads.emplace_back(task, &errors[t]);
+    }
+    if (num_threads > 0) {
+      task(&errors[0]);
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    for (const auto& error : errors) {
+      if (error) {
+        std::rethrow_exception(error);
+      }
+    }
+  }
+
+  void serializeChunks(
+      const vector<const Blob*>& inputs,
+      const std::vector<std::pair<int, TIndex>>& chunks,
+      int chunk_size,
+      const BlobSerializerBase::SerializationAcceptor& acceptor,
+      std::atomic<size_t>* next_chunk) {
+    TensorSerializer<CPUContext> serializer;
+    for (size_t c = (*next_chunk)++; c < chunks.size(); c = (*next_chunk)++) {
+      const auto& name = blob_names_[chunks[c].first];
+      const Blob* blob = inputs[chunks[c].first];
+      const TIndex begin = chunks[c].second;
+      if (begin < 0) {
+        blob->Serialize(name, acceptor, chunk_size_);
+        continue;
+      }
+      const auto& tensor = blob->template Get<TensorCPU>();
+      const TIndex step =
+          chunk_size == kNoChunking ? tensor.size() + 1 : chunk_size;
+      BlobProto blob_proto;
+      blob_proto.set_name(name);
+      blob_proto.set_type(kTensorBlobType);
+      blob_proto.mutable_tensor()->set_name(name);
+      serializer.Serialize(
+          tensor, name, blob_proto.mutable_tensor(), begin, step);
+      acceptor(
+          MakeString(name, kChunkIdSeparator, begin / step),
+          blob_proto.SerializeAsString());
+    }
+  }
+
   Workspace* ws_;
   bool absolute_path_;
   string strip_prefix_;
   string db_name_;
   string db_type_;
   std::vector<std::string> blob_names_;
+  int chunk_size_;
+  int num_threads_;
 };
 
 template <typename... Ts>
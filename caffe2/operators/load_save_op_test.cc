@@ -0,0 +1,283 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <cstdio>
+
+#include "caffe2/core/flags.h"
+#include "caffe2/operators/load_save_op.h"
+#include <gtest/gtest.h>
+
+namespace caffe2 {
+
+namespace {
+
+void AddArg(const string& name, const string& value, OperatorDef* def) {
+  auto* arg = def->add_arg();
+  arg->set_name(name);
+  arg->set_s(value);
+}
+
+void AddArg(const string& name, int value, OperatorDef* def) {
+  auto* arg = def->add_arg();
+  arg->set_name(name);
+  arg->set_i(value);
+}
+
+OperatorDef DBOpDef(
+    const string& type,
+    const string& db_type,
+    const vector<string>& blobs) {
+  OperatorDef def;
+  def.set_type(type);
+  for (const auto& blob : blobs) {
+    if (type == "Save") {
+      def.add_input(blob);
+    } else {
+      def.add_output(blob);
+    }
+  }
+  AddArg("db_type", db_type, &def);
+  AddArg("absolute_path", 1, &def);
+  return def;
+}
+
+void RunOp(const OperatorDef& def, Workspace* ws) {
+  auto op = CreateOperator(def, ws);
+  ASSERT_NE(nullptr, op.get());
+  EXPECT_TRUE(op->Run());
+}
+
+void RunDBOp(
+    const string& type,
+    const string& db,
+    const vector<string>& blobs,
+    Workspace* ws) {
+  auto def = DBOpDef(type, "mmapdb", blobs);
+  AddArg("db", db, &def);
+  RunOp(def, ws);
+}
+
+void FillRange(const string& name, int size, float offset, Workspace* ws) {
+  auto* tensor = ws->CreateBlob(name)->GetMutable<TensorCPU>();
+  tensor->Resize(size);
+  for (int i = 0; i < size; ++i) {
+    tensor->mutable_data<float>()[i] = offset + i;
+  }
+}
+
+void CheckRange(const string& name, int size, float offset, Workspace* ws) {
+  ASSERT_TRUE(ws->HasBlob(name));
+  const auto& tensor = ws->GetBlob(name)->Get<TensorCPU>();
+  ASSERT_EQ(tensor.size(), size);
+  for (int i = 0; i < size; ++i) {
+    EXPECT_EQ(tensor.data<float>()[i], offset + i);
+  }
+}
+
+} // namespace
+
+TEST(LoadSaveOpTest, MmapDBAliasesTensors) {
+  // Split the float tensor into several chunks.
+  const auto chunk_size = FLAGS_caffe2_tensor_chunk_size;
+  FLAGS_caffe2_tensor_chunk_size = 7;
+  const string db = std::tmpnam(nullptr);
+  {
+    Workspace ws;
+    auto* x = ws.CreateBlob("x")->GetMutable<TensorCPU>();
+    x->Resize(5, 6);
+    for (int i = 0; i < x->size(); ++i) {
+      x->mutable_data<float>()[i] = i * 0.5f;
+    }
+    auto* y = ws.CreateBlob("y")->GetMutable<TensorCPU>();
+    y->Resize(3);
+    for (int i = 0; i < y->size(); ++i) {
+      y->mutable_data<int64_t>()[i] = int64_t(1) << (40 + i);
+    }
+    auto* s = ws.CreateBlob("s")->GetMutable<TensorCPU>();
+    s->Resize(2);
+    s->mutable_data<string>()[0] = "foo";
+    s->mutable_data<string>()[1] = "bar";
+    auto* e = ws.CreateBlob("e")->GetMutable<TensorCPU>();
+    e->Resize(0, 4);
+    e->mutable_data<float>();
+    RunDBOp("Save", db, {"x", "y", "s", "e"}, &ws);
+  }
+  FLAGS_caffe2_tensor_chunk_size = chunk_size;
+
+  Workspace ws;
+  RunDBOp("Load", db, {"x", "y", "s", "e"}, &ws);
+  // The db is closed, the loaded tensors keep the mapping alive.
+  const auto& x = ws.GetBlob("x")->Get<TensorCPU>();
+  EXPECT_TRUE(x.shares_data());
+  EXPECT_EQ(x.dims(), vector<TIndex>({5, 6}));
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(x.raw_data()) % 64, 0);
+  for (int i = 0; i < x.size(); ++i) {
+    EXPECT_EQ(x.data<float>()[i], i * 0.5f);
+  }
+  const auto& y = ws.GetBlob("y")->Get<TensorCPU>();
+  EXPECT_TRUE(y.shares_data());
+  for (int i = 0; i < y.size(); ++i) {
+    EXPECT_EQ(y.data<int64_t>()[i], int64_t(1) << (40 + i));
+  }
+  // String and empty tensors are stored as serialized protos and copied.
+  const auto& s = ws.GetBlob("s")->Get<TensorCPU>();
+  EXPECT_FALSE(s.shares_data());
+  EXPECT_EQ(s.data<string>()[0], "foo");
+  EXPECT_EQ(s.data<string>()[1], "bar");
+  const auto& e = ws.GetBlob("e")->Get<TensorCPU>();
+  EXPECT_EQ(e.dims(), vector<TIndex>({0, 4}));
+
+  // Writing to an aliased tensor does not change the file.
+  ws.GetBlob("x")->GetMutable<TensorCPU>()->mutable_data<float>()[0] = -1;
+  Workspace ws2;
+  RunDBOp("Load", db, {"x"}, &ws2);
+  EXPECT_EQ(ws2.GetBlob("x")->Get<TensorCPU>().data<float>()[0], 0);
+  EXPECT_EQ(x.data<float>()[0], -1);
+  std::remove(db.c_str());
+}
+
+TEST(LoadSaveOpTest, MmapDBAppend) {
+  const string db = std::tmpnam(nullptr);
+  Workspace ws;
+  auto* a = ws.CreateBlob("a")->GetMutable<TensorCPU>();
+  a->Resize(4);
+  for (int i = 0; i < a->size(); ++i) {
+    a->mutable_data<int>()[i] = i;
+  }
+  RunDBOp("Save", db, {"a"}, &ws);
+  {
+    // Append a raw value to the existing db.
+    auto out = db::CreateDB("mmapdb", db, db::WRITE);
+    auto transaction = out->NewTransaction();
+    transaction->Put("raw", "value");
+    transaction->Commit();
+  }
+
+  auto in = db::CreateDB("mmapdb", db, db::READ);
+  auto cursor = in->NewCursor();
+  EXPECT_EQ(cursor->key(), MakeString("a", kChunkIdSeparator, 0));
+  // value() rebuilds the serialized tensor.
+  BlobProto proto;
+  ASSERT_TRUE(proto.ParseFromString(cursor->value()));
+  Blob blob;
+  blob.Deserialize(proto);
+  const auto& loaded = blob.Get<TensorCPU>();
+  ASSERT_EQ(loaded.size(), 4);
+  for (int i = 0; i < loaded.size(); ++i) {
+    EXPECT_EQ(loaded.data<int>()[i], i);
+  }
+  cursor->Next();
+  EXPECT_EQ(cursor->key(), "raw");
+  EXPECT_EQ(cursor->value(), "value");
+  std::shared_ptr<void> owner;
+  EXPECT_EQ(cursor->TensorData(&proto, &owner), nullptr);
+  cursor->Next();
+  EXPECT_FALSE(cursor->Valid());
+  std::remove(db.c_str());
+}
+
+TEST(LoadSaveOpTest, StreamingSave) {
+  const string db = std::tmpnam(nullptr);
+  {
+    Workspace ws;
+    FillRange("a", 1000, 0, &ws);
+    FillRange("b", 10, 2000, &ws);
+    FillRange("c", 0, 0, &ws);
+    *ws.CreateBlob("s")->GetMutable<std::string>() = "text";
+    auto def = DBOpDef("Save", "minidb", {"a", "b", "c", "s"});
+    AddArg("db", db, &def);
+    AddArg("chunk_size", 64, &def);
+    AddArg("num_threads", 4, &def);
+    RunOp(def, &ws);
+  }
+
+  // Every chunk of "a" is a separate entry.
+  auto in = db::CreateDB("minidb", db, db::READ);
+  auto cursor = in->NewCursor();
+  int num_entries = 0;
+  for (; cursor->Valid(); cursor->Next()) {
+    ++num_entries;
+  }
+  EXPECT_EQ(num_entries, 16 + 1 + 1 + 1);
+
+  Workspace ws;
+  auto def = DBOpDef("Load", "minidb", {"a", "b", "c", "s"});
+  AddArg("db", db, &def);
+  RunOp(def, &ws);
+  CheckRange("a", 1000, 0, &ws);
+  CheckRange("b", 10, 2000, &ws);
+  CheckRange("c", 0, 0, &ws);
+  EXPECT_EQ(ws.GetBlob("s")->Get<std::string>(), "text");
+  std::remove(db.c_str());
+}
+
+TEST(LoadSaveOpTest, ParallelLoad) {
+  const int kNumDBs = 4;
+  vector<string> dbs;
+  vector<string> blobs;
+  for (int i = 0; i < kNumDBs; ++i) {
+    dbs.push_back(std::tmpnam(nullptr));
+    const string blob = "x" + caffe2::to_string(i);
+    blobs.push_back(blob);
+    Workspace ws;
+    FillRange(blob, 100 + i, 10 * i, &ws);
+    auto def = DBOpDef("Save", "minidb", {blob});
+    AddArg("db", dbs.back(), &def);
+    AddArg("chunk_size", 16, &def);
+    RunOp(def, &ws);
+  }
+
+  for (bool load_all : {false, true}) {
+    Workspace ws;
+    auto def = DBOpDef("Load", "minidb", load_all ? vector<string>() : blobs);
+    auto* arg = def.add_arg();
+    arg->set_name("dbs");
+    for (const auto& db : dbs) {
+      arg->add_strings(db);
+    }
+    AddArg("num_threads", kNumDBs, &def);
+    AddArg("load_all", load_all, &def);
+    RunOp(def, &ws);
+    for (int i = 0; i < kNumDBs; ++i) {
+      CheckRange(blobs[i], 100 + i, 10 * i, &ws);
+    }
+  }
+
+  // The same blob in two dbs is an error.
+  {
+    Workspace ws;
+    FillRange("x0", 3, 0, &ws);
+    auto def = DBOpDef("Save", "minidb", {"x0"});
+    AddArg("db", dbs[1], &def);
+    RunOp(def, &ws);
+  }
+  Workspace ws;
+  auto def = DBOpDef("Load", "minidb", {});
+  auto* arg = def.add_arg();
+  arg->set_name("dbs");
+  arg->add_strings(dbs[0]);
+  arg->add_strings(dbs[1]);
+  AddArg("num_threads", 2, &def);
+  AddArg("load_all", 1, &def);
+  auto op = CreateOperator(def, &ws);
+  EXPECT_THROW(op->Run(), EnforceNotMet);
+  for (const auto& db : dbs) {
+    std::remove(db.c_str());
+  }
+}
+
+} // namespace caffe2
@@ -48,6 +48,23 @@ REGISTER_BLOB_SERIALIZER(
     TypeMeta::Id<MapType32To64>(),
     MapSerializer<int32_t, int64_t>);
 
+REGISTER_BLOB_DESERIALIZER(
+    (caffe2::FlatHashMap<int64_t, int64_t>),
+    MapDeserializer<int64_t, int64_t>);
+
+REGISTER_BLOB_DESERIALIZER(
+    (caffe2::FlatHashMap<int64_t, int32_t>),
+    MapDeserializer<int64_t, int32_t>);
+
+REGISTER_BLOB_DESERIALIZER(
+    (caffe2::FlatHashMap<int32_t, int32_t>),
+    MapDeserializer<int32_t, int32_t>);
+
+REGISTER_BLOB_DESERIALIZER(
+    (caffe2::FlatHashMap<int32_t, int64_t>),
+    MapDeserializer<int32_t, int64_t>);
+
+// Maps saved before MapType was a FlatHashMap.
 REGISTER_BLOB_DESERIALIZER(
     (std::unordered_map<int64_t, int64_t>),
     MapDeserializer<int64_t, int64_t>);
@@ -67,6 +84,7 @@ REGISTER_BLOB_DESERIALIZER(
 REGISTER_CPU_OPERATOR(CreateMap, CreateMapOp<CPUContext>);
 REGISTER_CPU_OPERATOR(KeyValueToMap, KeyValueToMapOp<CPUContext>);
 REGISTER_CPU_OPERATOR(MapToKeyValue, MapToKeyValueOp<CPUContext>);
+REGISTER_CPU_OPERATOR(MapLookup, MapLookupOp<CPUContext>);
 
 OPERATOR_SCHEMA(CreateMap)
     .NumInputs(0)
@@ -91,5 +109,18 @@ OPERATOR_SCHEMA(MapToKeyValue)
     .Input(0, "map blob", "Blob reference to the map")
     .Output(0, "key blob", "Blob reference to the key")
     .Output(1, "value blob", "Blob reference to the value");
+
+OPERATOR_SCHEMA(MapLookup)
+    .NumInputs(2)
+    .NumOutputs(1)
+    .SetDoc(R"DOC(
+Looks up every key of a tensor in a map blob, and returns a tensor of the same
+shape with the corresponding values. Fails on keys that are not in the map,
+unless default_value is given.
+)DOC")
+    .Arg("default_value", "Value returned for keys that are not in the map")
+    .Input(0, "map blob", "Blob reference to the map")
+    .Input(1, "keys", "Tensor of keys, of the key type of the map")
+    .Output(0, "values", "Tensor of values, of the value type of the map");
 }
 } // namespace caffe2
@@ -18,16 +18,17 @@
 #define CAFFE2_OPERATORS_MAP_OPS_H_
 
 #include <algorithm>
+#include <cstring>
 #include <iterator>
 #include <string>
 #include <typeinfo>
-#include <unordered_map>
 #include <utility>
 #include <vector>
 
 #include "caffe2/core/blob_serialization.h"
 #include "caffe2/core/context.h"
 #include "caffe2/core/operator.h"
+#include "caffe2/utils/flat_hash_map.h"
 
 namespace caffe2 {
 
@@ -48,8 +49,13 @@ struct TypeNameTraits<int32_t> {
 
 template <typename KEY_T, typename VALUE_T>
 struct MapTypeTraits {
-  using MapType = std::unordered_map<KEY_T, VALUE_T>;
+  using MapType = FlatHashMap<KEY_T, VALUE_T>;
   static string MapTypeName() {
+    return string("(caffe2::FlatHashMap<") + TypeNameTraits<KEY_T>::name +
+        ", " + TypeNameTraits<VALUE_T>::name + ">)";
+  }
+  // Blob type of maps saved when MapType was a std::unordered_map.
+  static string LegacyMapTypeName() {
     return string("(std::unordered_map<") + TypeNameTraits<KEY_T>::name + ", " +
         TypeNameTraits<VALUE_T>::name + ">)";
   }
@@ -60,6 +66,31 @@ using MapType64To32 = MapTypeTraits<int64_t, int32_t>::MapType;
 using MapType32To32 = MapTypeTraits<int32_t, int32_t>::MapType;
 using MapType32To64 = MapTypeTraits<int32_t, int64_t>::MapType;
 
+// How many keys ahead the map slots are prefetched in batched operations.
+constexpr int kMapPrefetchDistance = 8;
+
+// Inserts num_keys key/value pairs into the map. Keys that are already in
+// the map keep their value.
+template <typename MAP_T>
+void InsertKeyValues(
+    const typename MAP_T::key_type* keys,
+    const typename MAP_T::mapped_type* values,
+    TIndex num_keys,
+    MAP_T* map) {
+  // The table must not grow while prefetching.
+  map->reserve(map->size() + num_keys);
+  std::vector<uint64_t> hashes(num_keys);
+  for (TIndex i = 0; i < num_keys; ++i) {
+    hashes[i] = map->hash_key(keys[i]);
+  }
+  for (TIndex i = 0; i < num_keys; ++i) {
+    if (i + kMapPrefetchDistance < num_keys) {
+      map->prefetch(hashes[i + kMapPrefetchDistance]);
+    }
+    map->insert({keys[i], values[i]}, hashes[i]);
+  }
+}
+
 template <class Context>
 class CreateMapOp final : public Operator<Context> {
  public:
@@ -143,10 +174,7 @@ class KeyValueToMapOp final : public Operator<Context> {
     auto* value_data = value_input.template data<VALUE_T>();
 
     auto* map_data = OperatorBase::Output<MapType>(MAP);
-
-    for (int i = 0; i < key_input.size(); ++i) {
-      map_data->emplace(key_data[i], value_data[i]);
-    }
+    InsertKeyValues(key_data, value_data, key_input.size(), map_data);
 
     return true;
   }
@@ -205,6 +233,73 @@ class MapToKeyValueOp final : public Operator<Context> {
   OUTPUT_TAGS(KEYS, VALUES);
 };
 
+template <class Context>
+class MapLookupOp final : public Operator<Context> {
+ public:
+  USE_OPERATOR_CONTEXT_FUNCTIONS;
+  MapLookupOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<Context>(operator_def, ws),
+        has_default_value_(OperatorBase::HasArgument("default_value")),
+        default_value_(
+            OperatorBase::GetSingleArgument<int64_t>("default_value", 0)) {}
+  ~MapLookupOp() {}
+
+  bool RunOnDevice() override {
+    return DispatchHelper<TensorTypes<
+        MapType64To64,
+        MapType64To32,
+        MapType32To32,
+        MapType32To64>>::call(this, OperatorBase::InputBlob(MAP));
+  }
+
+  template <typename MAP_T>
+  bool DoRunWithType() {
+    using key_type = typename MAP_T::key_type;
+    using mapped_type = typename MAP_T::mapped_type;
+    const auto& map_data = OperatorBase::Input<MAP_T>(MAP);
+    const auto& key_input = Input(KEYS);
+    CAFFE_ENFORCE(
+        key_input.template IsType<key_type>(),
+        "Keys of type ",
+        key_input.meta().name(),
+        " do not match the map");
+    auto* value_output = Output(VALUES);
+    value_output->ResizeLike(key_input);
+    const auto* key_data = key_input.template data<key_type>();
+    auto* value_data = value_output->template mutable_data<mapped_type>();
+    const TIndex num_keys = key_input.size();
+
+    hashes_.resize(num_keys);
+    for (TIndex i = 0; i < num_keys; ++i) {
+      hashes_[i] = map_data.hash_key(key_data[i]);
+    }
+    for (TIndex i = 0; i < num_keys; ++i) {
+      if (i + kMapPrefetchDistance < num_keys) {
+        map_data.prefetch(hashes_[i + kMapPrefetchDistance]);
+      }
+      auto it = map_data.find(key_data[i], hashes_[i]);
+      if (it != map_data.end()) {
+        value_data[i] = it->second;
+      } else {
+        CAFFE_ENFORCE(
+            has_default_value_, "Key ", key_data[i], " is not in the map");
+        value_data[i] = static_cast<mapped_type>(default_value_);
+      }
+    }
+    return true;
+  }
+
+ private:
+  bool has_default_value_;
+  int64_t default_value_;
+  std::vector<uint64_t> hashes_;
+
+  INPUT_TAGS(MAP, KEYS);
+  OUTPUT_TAGS(VALUES);
+};
+
+// Maps are saved as the raw array of their keys followed by the raw array
+// of their values, in the order of the table slots.
 template <typename KEY_T, typename VALUE_T>
 class MapSerializer : public BlobSerializerBase {
  public:
@@ -216,31 +311,21 @@ class MapSerializer : public BlobSerializerBase {
       BlobSerializerBase::SerializationAcceptor acceptor) override {
     CAFFE_ENFORCE(blob.IsType<MapType>());
     const MapType& map_data = blob.template Get<MapType>();
-    TIndex sz = map_data.size();
-    Tensor<CPUContext> key_tensor;
-    key_tensor.Resize(sz);
-    Tensor<CPUContext> value_tensor;
-    value_tensor.Resize(sz);
-    auto* key_data = key_tensor.mutable_data<KEY_T>();
-    auto* value_data = value_tensor.mutable_data<VALUE_T>();
+    const size_t sz = map_data.size();
+    string content(sz * (sizeof(KEY_T) + sizeof(VALUE_T)), '\0');
+    char* key_data = &content[0];
+    char* value_data = key_data + sz * sizeof(KEY_T);
     for (const auto& it : map_data) {
-      *key_data = it.first;
-      *value_data = it.second;
-      key_data++;
-      value_data++;
+      memcpy(key_data, &it.first, sizeof(KEY_T));
+      memcpy(value_data, &it.second, sizeof(VALUE_T));
+      key_data += sizeof(KEY_T);
+      value_data += sizeof(VALUE_T);
     }
 
-    TensorProtos tensor_protos;
-    TensorSerializer<CPUContext> ser;
-    ser.Serialize(
-        key_tensor, name, tensor_protos.add_protos(), 0, key_tensor.size());
-    ser.Serialize(
-        value_tensor, name, tensor_protos.add_protos(), 0, value_tensor.size());
-
     BlobProto blob_proto;
     blob_proto.set_name(name);
     blob_proto.set_type(MapTypeTraits<KEY_T, VALUE_T>::MapTypeName());
-    blob_proto.set_content(tensor_protos.SerializeAsString());
+    blob_proto.mutable_content()->swap(content);
     acceptor(name, blob_proto.SerializeAsString());
   }
 };
@@ -251,6 +336,31 @@ class MapDeserializer : public BlobDeserializerBase {
   using MapType = typename MapTypeTraits<KEY_T, VALUE_T>::MapType;
 
   void Deserialize(const BlobProto& proto, Blob* blob) override {
+    auto* map_ptr = blob->template GetMutable<MapType>();
+    if (proto.type() == MapTypeTraits<KEY_T, VALUE_T>::LegacyMapTypeName()) {
+      DeserializeLegacy(proto, map_ptr);
+      return;
+    }
+    const string& content = proto.content();
+    const size_t entry_size = sizeof(KEY_T) + sizeof(VALUE_T);
+    CAFFE_ENFORCE_EQ(
+        content.size() % entry_size, 0, "Corrupted map blob ", proto.name());
+    const size_t sz = content.size() / entry_size;
+    vector<KEY_T> keys(sz);
+    vector<VALUE_T> values(sz);
+    if (sz > 0) {
+      memcpy(keys.data(), content.data(), sz * sizeof(KEY_T));
+      memcpy(
+          values.data(),
+          content.data() + sz * sizeof(KEY_T),
+          sz * sizeof(VALUE_T));
+    }
+    InsertKeyValues(keys.data(), values.data(), sz, map_ptr);
+  }
+
+ private:
+  // Maps saved as a TensorProtos holding a key and a value tensor.
+  void DeserializeLegacy(const BlobProto& proto, MapType* map_ptr) {
     TensorProtos tensor_protos;
     CAFFE_ENFORCE(
         tensor_protos.ParseFromString(proto.content()),
@@ -259,13 +369,12 @@ class MapDeserializer : public BlobDeserializerBase {
     Tensor<CPUContext> key_tensor, value_tensor;
     deser.Deserialize(tensor_protos.protos(0), &key_tensor);
     deser.Deserialize(tensor_protos.protos(1), &value_tensor);
-    auto* key_data = key_tensor.data<KEY_T>();
-    auto* value_data = value_tensor.data<VALUE_T>();
-
-    auto* map_ptr = blob->template GetMutable<MapType>();
-    for (int i = 0; i < key_tensor.size(); ++i) {
-      map_ptr->emplace(key_data[i], value_data[i]);
-    }
+    CAFFE_ENFORCE_EQ(key_tensor.size(), value_tensor.size());
+    InsertKeyValues(
+        key_tensor.data<KEY_T>(),
+        value_tensor.data<VALUE_T>(),
+        key_tensor.size(),
+        map_ptr);
   }
 };
 
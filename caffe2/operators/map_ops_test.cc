@@ -0,0 +1,121 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "caffe2/operators/map_ops.h"
+#include <gtest/gtest.h>
+
+namespace caffe2 {
+
+namespace {
+
+void SetTensor(Workspace* ws, const string& name, const vector<int64_t>& data) {
+  auto* tensor = ws->CreateBlob(name)->GetMutable<TensorCPU>();
+  tensor->Resize(data.size());
+  std::copy(data.begin(), data.end(), tensor->mutable_data<int64_t>());
+}
+
+void RunOp(
+    Workspace* ws,
+    const string& type,
+    const vector<string>& inputs,
+    const string& output,
+    const vector<Argument>& args = {}) {
+  OperatorDef def;
+  def.set_type(type);
+  for (const auto& input : inputs) {
+    def.add_input(input);
+  }
+  def.add_output(output);
+  for (const auto& arg : args) {
+    def.add_arg()->CopyFrom(arg);
+  }
+  unique_ptr<OperatorBase> op(CreateOperator(def, ws));
+  EXPECT_TRUE(op->Run());
+}
+
+vector<int64_t> GetTensor(Workspace* ws, const string& name) {
+  const auto& tensor = ws->GetBlob(name)->Get<TensorCPU>();
+  return vector<int64_t>(
+      tensor.data<int64_t>(), tensor.data<int64_t>() + tensor.size());
+}
+
+} // namespace
+
+TEST(MapOpsTest, LookupAndSerialize) {
+  Workspace ws;
+  vector<int64_t> keys, values;
+  for (int64_t i = 0; i < 1000; ++i) {
+    keys.push_back(i * 7919);
+    values.push_back(i);
+  }
+  SetTensor(&ws, "keys", keys);
+  SetTensor(&ws, "values", values);
+  RunOp(&ws, "KeyValueToMap", {"keys", "values"}, "map");
+  EXPECT_EQ(ws.GetBlob("map")->Get<MapType64To64>().size(), 1000);
+
+  SetTensor(&ws, "query", {7919 * 5, 3, 7919 * 999});
+  RunOp(
+      &ws,
+      "MapLookup",
+      {"map", "query"},
+      "found",
+      {MakeArgument<int64_t>("default_value", -1)});
+  EXPECT_EQ(GetTensor(&ws, "found"), (vector<int64_t>{5, -1, 999}));
+  // Without a default value, missing keys are an error.
+  OperatorDef def;
+  def.set_type("MapLookup");
+  def.add_input("map");
+  def.add_input("query");
+  def.add_output("found");
+  EXPECT_THROW(CreateOperator(def, &ws)->Run(), EnforceNotMet);
+
+  string serialized = ws.GetBlob("map")->Serialize("map");
+  BlobProto proto;
+  proto.ParseFromString(serialized);
+  EXPECT_EQ(proto.type(), "(caffe2::FlatHashMap<int64_t, int64_t>)");
+  EXPECT_EQ(proto.content().size(), 1000 * 2 * sizeof(int64_t));
+  ws.CreateBlob("restored")->Deserialize(serialized);
+  RunOp(&ws, "MapLookup", {"restored", "keys"}, "restored_values");
+  EXPECT_EQ(GetTensor(&ws, "restored_values"), values);
+}
+
+TEST(MapOpsTest, DeserializeLegacyFormat) {
+  TensorCPU keys(vector<TIndex>{3});
+  TensorCPU values(vector<TIndex>{3});
+  for (int i = 0; i < 3; ++i) {
+    keys.mutable_data<int32_t>()[i] = 10 + i;
+    values.mutable_data<int64_t>()[i] = 100 + i;
+  }
+  TensorProtos tensor_protos;
+  TensorSerializer<CPUContext> ser;
+  ser.Serialize(keys, "map", tensor_protos.add_protos(), 0, 3);
+  ser.Serialize(values, "map", tensor_protos.add_protos(), 0, 3);
+  BlobProto proto;
+  proto.set_name("map");
+  proto.set_type("(std::unordered_map<int32_t, int64_t>)");
+  proto.set_content(tensor_protos.SerializeAsString());
+
+  Blob blob;
+  blob.Deserialize(proto.SerializeAsString());
+  const auto& map = blob.Get<MapType32To64>();
+  EXPECT_EQ(map.size(), 3);
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_EQ(map.find(10 + i)->second, 100 + i);
+  }
+}
+
+} // namespace caffe2
@@ -20,9 +20,39 @@ namespace caffe2 {
 
 REGISTER_CPU_OPERATOR(MatMul, MatMulOp<float, CPUContext>);
 
+namespace {
+OpSchema::Cost CostInferenceForMatMul(
+    const OperatorDef& def,
+    const vector<TensorShape>& in) {
+  struct OpSchema::Cost c;
+  ArgumentHelper arg_helper(def);
+  int axis_a = arg_helper.GetSingleArgument<int>("axis_a", 1);
+  int axis_b = arg_helper.GetSingleArgument<int>("axis_b", 1);
+  bool trans_a = arg_helper.GetSingleArgument<bool>("trans_a", false);
+  bool trans_b = arg_helper.GetSingleArgument<bool>("trans_b", false);
+  int canonical_axis_a = canonical_axis_index_(axis_a, in[0].dims().size());
+  int canonical_axis_b = canonical_axis_index_(axis_b, in[1].dims().size());
+
+  const auto A = GetDimsVector(in[0]);
+  const auto B = GetDimsVector(in[1]);
+  const uint64_t M = trans_a ? size_from_dim_(canonical_axis_a, A)
+                             : size_to_dim_(canonical_axis_a, A);
+  const uint64_t K = trans_a ? size_to_dim_(canonical_axis_a, A)
+                             : size_from_dim_(canonical_axis_a, A);
+  const uint64_t N = trans_b ? size_to_dim_(canonical_axis_b, B)
+                             : size_from_dim_(canonical_axis_b, B);
+
+  c.flops = 2 * M * N * K;
+  c.bytes_moved = nBytesOfShape(in[0]) + nBytesOfShape(in[1]) +
+      M * N * DataTypeToTypeMeta(in[0].data_type()).itemsize();
+  return c;
+}
+} // namespace
+
 OPERATOR_SCHEMA(MatMul)
     .NumInputs(2, 3)
     .NumOutputs(1)
+    .CostInferenceFunction(CostInferenceForMatMul)
     .TensorInferenceFunction([](const OperatorDef& def,
                                 const vector<TensorShape>& in) {
       vector<TensorShape> out(1);
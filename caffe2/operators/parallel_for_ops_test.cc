@@ -0,0 +1,148 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <gtest/gtest.h>
+
+#include "caffe2/core/operator.h"
+#include "caffe2/core/scope_guard.h"
+#include "caffe2/utils/proto_utils.h"
+
+CAFFE2_DECLARE_int(caffe2_threadpool_num_threads);
+
+namespace caffe2 {
+
+namespace {
+
+// Runs `def` on the given inputs and returns a copy of its first output. A
+// minimum work of 1 splits every loop between the threads of the workspace
+// pool; a huge one keeps everything on the calling thread.
+TensorCPU RunOp(
+    const OperatorDef& def,
+    const vector<std::pair<string, vector<TIndex>>>& inputs,
+    int64_t min_work) {
+  const int64_t old_min_work = FLAGS_caffe2_parallel_for_min_work;
+  const int old_num_threads = FLAGS_caffe2_threadpool_num_threads;
+  auto guard = MakeGuard([&]() {
+    FLAGS_caffe2_parallel_for_min_work = old_min_work;
+    FLAGS_caffe2_threadpool_num_threads = old_num_threads;
+  });
+  FLAGS_caffe2_parallel_for_min_work = min_work;
+  FLAGS_caffe2_threadpool_num_threads = 4;
+  Workspace ws;
+  for (const auto& input : inputs) {
+    auto* tensor = ws.CreateBlob(input.first)->GetMutable<TensorCPU>();
+    tensor->Resize(input.second);
+    float* data = tensor->mutable_data<float>();
+    for (TIndex i = 0; i < tensor->size(); ++i) {
+      data[i] = static_cast<float>((i * 37) % 101) / 10.0f - 5.0f;
+    }
+  }
+  auto op = CreateOperator(def, &ws);
+  EXPECT_TRUE(op->Run());
+  return TensorCPU(ws.GetBlob(def.output(0))->Get<TensorCPU>());
+}
+
+void ExpectParallelMatchesSerial(
+    const OperatorDef& def,
+    const vector<std::pair<string, vector<TIndex>>>& inputs) {
+  const auto serial = RunOp(def, inputs, std::numeric_limits<int64_t>::max());
+  const auto parallel = RunOp(def, inputs, 1);
+  ASSERT_EQ(serial.dims(), parallel.dims());
+  for (TIndex i = 0; i < serial.size(); ++i) {
+    EXPECT_NEAR(serial.data<float>()[i], parallel.data<float>()[i], 1e-5)
+        << def.type() << " differs at " << i;
+  }
+}
+
+} // namespace
+
+TEST(ParallelForOpsTest, Add) {
+  ExpectParallelMatchesSerial(
+      CreateOperatorDef("Add", "", {"A", "B"}, {"C"}),
+      {{"A", {7, 33}}, {"B", {7, 33}}});
+}
+
+TEST(ParallelForOpsTest, MulBroadcast) {
+  ExpectParallelMatchesSerial(
+      CreateOperatorDef(
+          "Mul", "", {"A", "B"}, {"C"}, {MakeArgument<int>("broadcast", 1)}),
+      {{"A", {9, 5, 7}}, {"B", {5, 7}}});
+}
+
+TEST(ParallelForOpsTest, SubBroadcastWithAxis) {
+  ExpectParallelMatchesSerial(
+      CreateOperatorDef(
+          "Sub",
+          "",
+          {"A", "B"},
+          {"C"},
+          {MakeArgument<int>("broadcast", 1), MakeArgument<int>("axis", 1)}),
+      {{"A", {9, 5, 7}}, {"B", {5}}});
+}
+
+TEST(ParallelForOpsTest, ReduceSums) {
+  for (const char* type :
+       {"ReduceFrontSum", "ReduceBackSum", "ReduceFrontMean",
+        "ReduceBackMean"}) {
+    ExpectParallelMatchesSerial(
+        CreateOperatorDef(type, "", {"X"}, {"Y"}), {{"X", {13, 11}}});
+  }
+}
+
+TEST(ParallelForOpsTest, Transpose) {
+  ExpectParallelMatchesSerial(
+      CreateOperatorDef(
+          "Transpose",
+          "",
+          {"X"},
+          {"Y"},
+          {MakeArgument<vector<int>>("axes", {2, 0, 1})}),
+      {{"X", {5, 6, 7}}});
+  ExpectParallelMatchesSerial(
+      CreateOperatorDef(
+          "Transpose",
+          "",
+          {"X"},
+          {"Y"},
+          {MakeArgument<vector<int>>("axes", {1, 0, 2})}),
+      {{"X", {5, 6, 7}}});
+}
+
+TEST(ParallelForOpsTest, Pooling) {
+  for (const char* type : {"MaxPool", "AveragePool"}) {
+    for (const char* order : {"NCHW", "NHWC"}) {
+      ExpectParallelMatchesSerial(
+          CreateOperatorDef(
+              type,
+              "",
+              {"X"},
+              {"Y"},
+              {MakeArgument<int>("kernel", 3),
+               MakeArgument<int>("stride", 2),
+               MakeArgument<int>("pad", 1),
+               MakeArgument<string>("order", order)}),
+          {{"X", {2, 3, 9, 9}}});
+    }
+  }
+}
+
+TEST(ParallelForOpsTest, Softmax) {
+  ExpectParallelMatchesSerial(
+      CreateOperatorDef("Softmax", "", {"X"}, {"Y"}), {{"X", {17, 10}}});
+}
+
+} // namespace caffe2
@@ -15,6 +15,9 @@
  */
 
 // TODO(ataei): reduce the apparent redundancy of all the code below.
+#include <functional>
+#include <numeric>
+
 #include "caffe2/operators/pool_op.h"
 #include "caffe2/utils/cpu_neon.h"
 
@@ -510,98 +513,106 @@ bool PoolOp<T, Context, PoolType>::RunOnDeviceWithOrderNCHW() {
     return true;
   }
 
-  switch (kernel_.size()) {
-    case 1:
-      for (int n = 0; n < X.dim32(0); ++n) {
-        for (int c = 0; c < channels; ++c) {
-          for (int ph = 0; ph < pooled_height; ++ph) {
-            int hstart = ph * stride_h() - pad_t();
-            int hend = min(hstart + kernel_h(), height);
-            hstart = max(hstart, 0);
-            T Yh = PoolType::initialize();
-            for (int h = hstart; h < hend; ++h) {
-              PoolType::process(Xdata[h], Yh);
+  // Every (image, channel) plane is pooled independently, so the planes are
+  // split between threads.
+  const int x_plane_size = height * width * depth;
+  const int y_plane_size = pooled_height * pooled_width * pooled_depth;
+  const int kernel_size = std::accumulate(
+      kernel_.begin(), kernel_.end(), 1, std::multiplies<int>());
+  context_.ParallelFor(
+      X.dim32(0) * channels,
+      CPUContext::ParallelForGrain(y_plane_size * kernel_size),
+      [&](TIndex begin, TIndex end) {
+        const T* Xplane = Xdata + begin * x_plane_size;
+        T* Yplane = Ydata + begin * y_plane_size;
+        switch (kernel_.size()) {
+          case 1:
+            for (TIndex plane = begin; plane < end; ++plane) {
+              for (int ph = 0; ph < pooled_height; ++ph) {
+                int hstart = ph * stride_h() - pad_t();
+                int hend = min(hstart + kernel_h(), height);
+                hstart = max(hstart, 0);
+                T Yh = PoolType::initialize();
+                for (int h = hstart; h < hend; ++h) {
+                  PoolType::process(Xplane[h], Yh);
+                }
+                PoolType::finalize(hend - hstart, Yh);
+                Yplane[ph] = Yh;
+              }
+              // Do offset.
+              Xplane += x_plane_size;
+              Yplane += y_plane_size;
             }
-            PoolType::finalize(hend - hstart, Yh);
-            Ydata[ph] = Yh;
-          }
-          // Do offset.
-          Xdata += height;
-          Ydata += pooled_height;
-        }
-      }
-      break;
-    case 2:
-      for (int n = 0; n < X.dim32(0); ++n) {
-        for (int c = 0; c < channels; ++c) {
-          for (int ph = 0; ph < pooled_height; ++ph) {
-            int hstart = ph * stride_h() - pad_t();
-            int hend = min(hstart + kernel_h(), height);
-            hstart = max(hstart, 0);
-            for (int pw = 0; pw < pooled_width; ++pw) {
-              int wstart = pw * stride_w() - pad_l();
-              int wend = min(wstart + kernel_w(), width);
-              wstart = max(wstart, 0);
-              const int pool_index = ph * pooled_width + pw;
-              T Yh = PoolType::initialize();
-              for (int h = hstart; h < hend; ++h) {
-                for (int w = wstart; w < wend; ++w) {
-                  const int input_index = h * width + w;
-                  PoolType::process(Xdata[input_index], Yh);
+            break;
+          case 2:
+            for (TIndex plane = begin; plane < end; ++plane) {
+              for (int ph = 0; ph < pooled_height; ++ph) {
+                int hstart = ph * stride_h() - pad_t();
+                int hend = min(hstart + kernel_h(), height);
+                hstart = max(hstart, 0);
+                for (int pw = 0; pw < pooled_width; ++pw) {
+                  int wstart = pw * stride_w() - pad_l();
+                  int wend = min(wstart + kernel_w(), width);
+                  wstart = max(wstart, 0);
+                  const int pool_index = ph * pooled_width + pw;
+                  T Yh = PoolType::initialize();
+                  for (int h = hstart; h < hend; ++h) {
+                    for (int w = wstart; w < wend; ++w) {
+                      const int input_index = h * width + w;
+                      PoolType::process(Xplane[input_index], Yh);
+                    }
+                  }
+                  PoolType::finalize((hend - hstart) * (wend - wstart), Yh);
+                  Yplane[pool_index] = Yh;
                 }
               }
-              PoolType::finalize((hend - hstart) * (wend - wstart), Yh);
-              Ydata[pool_index] = Yh;
+              // Do offset.
+              Xplane += x_plane_size;
+              Yplane += y_plane_size;
             }
-          }
-          // Do offset.
-          Xdata += height * width;
-          Ydata += pooled_height * pooled_width;
-        }
-      }
-      break;
-    case 3:
-      for (int n = 0; n < X.dim32(0); ++n) {
-        for (int c = 0; c < channels; ++c) {
-          for (int ph = 0; ph < pooled_height; ++ph) {
-            int hstart = ph * stride_h() - pad_t();
-            int hend = min(hstart + kernel_h(), height);
-            hstart = max(hstart, 0);
-            for (int pw = 0; pw < pooled_width; ++pw) {
-              int wstart = pw * stride_w() - pad_l();
-              int wend = min(wstart + kernel_w(), width);
-              wstart = max(wstart, 0);
-              for (int pd = 0; pd < pooled_depth; ++pd) {
-                int dstart = pd * stride_[2] - pads_[2];
-                int dend = min(dstart + kernel_[2], depth);
-                dstart = max(dstart, 0);
-                const int pool_index =
-                    ph * pooled_width * pooled_depth + pw * pooled_depth + pd;
-                T Yh = PoolType::initialize();
-                for (int h = hstart; h < hend; ++h) {
-                  for (int w = wstart; w < wend; ++w) {
-                    for (int d = dstart; d < dend; ++d) {
-                      const int input_index = h * width * depth + w * depth + d;
-                      PoolType::process(Xdata[input_index], Yh);
+            break;
+          case 3:
+            for (TIndex plane = begin; plane < end; ++plane) {
+              for (int ph = 0; ph < pooled_height; ++ph) {
+                int hstart = ph * stride_h() - pad_t();
+                int hend = min(hstart + kernel_h(), height);
+                hstart = max(hstart, 0);
+                for (int pw = 0; pw < pooled_width; ++pw) {
+                  int wstart = pw * stride_w() - pad_l();
+                  int wend = min(wstart + kernel_w(), width);
+                  wstart = max(wstart, 0);
+                  for (int pd = 0; pd < pooled_depth; ++pd) {
+                    int dstart = pd * stride_[2] - pads_[2];
+                    int dend = min(dstart + kernel_[2], depth);
+                    dstart = max(dstart, 0);
+                    const int pool_index = ph * pooled_width * pooled_depth +
+                        pw * pooled_depth + pd;
+                    T Yh = PoolType::initialize();
+                    for (int h = hstart; h < hend; ++h) {
+                      for (int w = wstart; w < wend; ++w) {
+                        for (int d = dstart; d < dend; ++d) {
+                          const int input_index =
+                              h * width * depth + w * depth + d;
+                          PoolType::process(Xplane[input_index], Yh);
+                        }
+                      }
                     }
+                    PoolType::finalize(
+                        (hend - hstart) * (wend - wstart) * (dend - dstart),
+                        Yh);
+                    Yplane[pool_index] = Yh;
                   }
                 }
-                PoolType::finalize(
-                    (hend - hstart) * (wend - wstart) * (dend - dstart), Yh);
-                Ydata[pool_index] = Yh;
               }
+              // Do offset.
+              Xplane += x_plane_size;
+              Yplane += y_plane_size;
             }
-          }
-          // Do offset.
-          Xdata += height * width * depth;
-          Ydata += pooled_height * pooled_width * pooled_depth;
+            break;
+          default:
+            CAFFE_THROW("Unsupported pooling size : ", kernel_.size());
         }
-      }
-      break;
-    default:
-      CAFFE_THROW("Unsupported pooling size : ", kernel_.size());
-      return false;
-  }
+      });
   return true;
 }
 
@@ -622,87 +633,97 @@ bool PoolOp<T, Context, PoolType>::RunOnDeviceWithOrderNHWC() {
   int pooled_height = Y->dim32(1);
   int pooled_width = kernel_.size() > 1 ? Y->dim32(2) : 1;
   int pooled_depth = kernel_.size() > 2 ? Y->dim32(3) : 1;
-  // The main loop
-  switch (kernel_.size()) {
-    case 1:
-      for (int n = 0; n < X.dim32(0); ++n) {
-        for (int ph = 0; ph < pooled_height; ++ph) {
-          int hstart = ph * stride_h() - pad_t();
-          int hend = min(hstart + kernel_h(), height);
-          hstart = max(hstart, 0);
-          const int y_col = n * pooled_height + ph;
-          Ymat.col(y_col).setConstant(PoolType::initialize());
-          for (int h = hstart; h < hend; ++h) {
-            const int x_col = n * height + h;
-            PoolType::process(x_col, y_col, Xmat, Ymat);
-          }
-          PoolType::finalize((hend - hstart), y_col, Ymat);
-        }
-      }
-      break;
-    case 2:
-      for (int n = 0; n < X.dim32(0); ++n) {
-        for (int ph = 0; ph < pooled_height; ++ph) {
-          int hstart = ph * stride_h() - pad_t();
-          int hend = min(hstart + kernel_h(), height);
-          hstart = max(hstart, 0);
-          for (int pw = 0; pw < pooled_width; ++pw) {
-            int wstart = pw * stride_w() - pad_l();
-            int wend = min(wstart + kernel_w(), width);
-            wstart = max(wstart, 0);
-            const int y_col = (n * pooled_height + ph) * pooled_width + pw;
-            Ymat.col(y_col).setConstant(PoolType::initialize());
-            for (int h = hstart; h < hend; ++h) {
-              for (int w = wstart; w < wend; ++w) {
-                const int x_col = (n * height + h) * width + w;
+  // The main loop runs over (image, output row) pairs, which are split
+  // between threads.
+  const int kernel_size = std::accumulate(
+      kernel_.begin(), kernel_.end(), 1, std::multiplies<int>());
+  context_.ParallelFor(
+      X.dim32(0) * pooled_height,
+      CPUContext::ParallelForGrain(
+          pooled_width * pooled_depth * channels * kernel_size),
+      [&](TIndex begin, TIndex end) {
+        switch (kernel_.size()) {
+          case 1:
+            for (TIndex y_row = begin; y_row < end; ++y_row) {
+              const int n = y_row / pooled_height;
+              const int ph = y_row % pooled_height;
+              int hstart = ph * stride_h() - pad_t();
+              int hend = min(hstart + kernel_h(), height);
+              hstart = max(hstart, 0);
+              const int y_col = n * pooled_height + ph;
+              Ymat.col(y_col).setConstant(PoolType::initialize());
+              for (int h = hstart; h < hend; ++h) {
+                const int x_col = n * height + h;
                 PoolType::process(x_col, y_col, Xmat, Ymat);
               }
+              PoolType::finalize((hend - hstart), y_col, Ymat);
             }
-            PoolType::finalize((hend - hstart) * (wend - wstart), y_col, Ymat);
-          }
-        }
-      }
-      break;
-    case 3:
-      for (int n = 0; n < X.dim32(0); ++n) {
-        for (int ph = 0; ph < pooled_height; ++ph) {
-          int hstart = ph * stride_h() - pad_t();
-          int hend = min(hstart + kernel_h(), height);
-          hstart = max(hstart, 0);
-          for (int pw = 0; pw < pooled_width; ++pw) {
-            int wstart = pw * stride_w() - pad_l();
-            int wend = min(wstart + kernel_w(), width);
-            wstart = max(wstart, 0);
-            for (int pd = 0; pd < pooled_depth; ++pd) {
-              int dstart = pd * stride_[2] - pads_[2];
-              int dend = min(dstart + kernel_[2], depth);
-              dstart = max(dstart, 0);
-              const int y_col = ((n * pooled_height + ph) * pooled_width + pw) *
-                      pooled_depth +
-                  pd;
-              Ymat.col(y_col).setConstant(PoolType::initialize());
-              for (int h = hstart; h < hend; ++h) {
-                for (int w = wstart; w < wend; ++w) {
-                  for (int d = dstart; d < dend; ++d) {
-                    const int x_col =
-                        ((n * height + h) * width + w) * depth + d;
+            break;
+          case 2:
+            for (TIndex y_row = begin; y_row < end; ++y_row) {
+              const int n = y_row / pooled_height;
+              const int ph = y_row % pooled_height;
+              int hstart = ph * stride_h() - pad_t();
+              int hend = min(hstart + kernel_h(), height);
+              hstart = max(hstart, 0);
+              for (int pw = 0; pw < pooled_width; ++pw) {
+                int wstart = pw * stride_w() - pad_l();
+                int wend = min(wstart + kernel_w(), width);
+                wstart = max(wstart, 0);
+                const int y_col = (n * pooled_height + ph) * pooled_width + pw;
+                Ymat.col(y_col).setConstant(PoolType::initialize());
+                for (int h = hstart; h < hend; ++h) {
+                  for (int w = wstart; w < wend; ++w) {
+                    const int x_col = (n * height + h) * width + w;
                     PoolType::process(x_col, y_col, Xmat, Ymat);
                   }
                 }
+                PoolType::finalize(
+                    (hend - hstart) * (wend - wstart), y_col, Ymat);
               }
-              PoolType::finalize(
-                  (hend - hstart) * (wend - wstart) * (dend - dstart),
-                  y_col,
-                  Ymat);
             }
-          }
+            break;
+          case 3:
+            for (TIndex y_row = begin; y_row < end; ++y_row) {
+              const int n = y_row / pooled_height;
+              const int ph = y_row % pooled_height;
+              int hstart = ph * stride_h() - pad_t();
+              int hend = min(hstart + kernel_h(), height);
+              hstart = max(hstart, 0);
+              for (int pw = 0; pw < pooled_width; ++pw) {
+                int wstart = pw * stride_w() - pad_l();
+                int wend = min(wstart + kernel_w(), width);
+                wstart = max(wstart, 0);
+                for (int pd = 0; pd < pooled_depth; ++pd) {
+                  int dstart = pd * stride_[2] - pads_[2];
+                  int dend = min(dstart + kernel_[2], depth);
+                  dstart = max(dstart, 0);
+                  const int y_col =
+                      ((n * pooled_height + ph) * pooled_width + pw) *
+                          pooled_depth +
+                      pd;
+                  Ymat.col(y_col).setConstant(PoolType::initialize());
+                  for (int h = hstart; h < hend; ++h) {
+                    for (int w = wstart; w < wend; ++w) {
+                      for (int d = dstart; d < dend; ++d) {
+                        const int x_col =
+                            ((n * height + h) * width + w) * depth + d;
+                        PoolType::process(x_col, y_col, Xmat, Ymat);
+                      }
+                    }
+                  }
+                  PoolType::finalize(
+                      (hend - hstart) * (wend - wstart) * (dend - dstart),
+                      y_col,
+                      Ymat);
+                }
+              }
+            }
+            break;
+          default:
+            CAFFE_THROW("Unsupported pooling size : ", kernel_.size());
         }
-      }
-      break;
-    default:
-      CAFFE_THROW("Unsupported pooling size : ", kernel_.size());
-      return false;
-  }
+      });
   return true;
 }
 const char* kAveragePoolDoc = R"DOC(
@@ -775,6 +796,8 @@ REGISTER_CPU_OPERATOR(
 OPERATOR_SCHEMA(AveragePool)
     .NumInputs(1)
     .NumOutputs(1)
+    .CostInferenceFunction(OpSchema::CostInferenceFunctionType(
+        ConvPoolOpBase<CPUContext>::CostInferenceForPool))
     .TensorInferenceFunction(ConvPoolOpBase<CPUContext>::TensorInferenceForPool)
     .FillUsing(AveragePoolDocGenerator(""));
 
@@ -785,6 +808,8 @@ REGISTER_CPU_OPERATOR(
 OPERATOR_SCHEMA(AveragePool1D)
     .NumInputs(1)
     .NumOutputs(1)
+    .CostInferenceFunction(OpSchema::CostInferenceFunctionType(
+        ConvPoolOpBase<CPUContext>::CostInferenceForPool))
     .TensorInferenceFunction(ConvPoolOpBase<CPUContext>::TensorInferenceForPool)
     .FillUsing(AveragePoolDocGenerator("1D"));
 
@@ -795,6 +820,8 @@ REGISTER_CPU_OPERATOR(
 OPERATOR_SCHEMA(AveragePool2D)
     .NumInputs(1)
     .NumOutputs(1)
+    .CostInferenceFunction(OpSchema::CostInferenceFunctionType(
+        ConvPoolOpBase<CPUContext>::CostInferenceForPool))
     .TensorInferenceFunction(ConvPoolOpBase<CPUContext>::TensorInferenceForPool)
     .FillUsing(AveragePoolDocGenerator("2D"));
 
@@ -805,6 +832,8 @@ REGISTER_CPU_OPERATOR(
 OPERATOR_SCHEMA(AveragePool3D)
     .NumInputs(1)
     .NumOutputs(1)
+    .CostInferenceFunction(OpSchema::CostInferenceFunctionType(
+        ConvPoolOpBase<CPUContext>::CostInferenceForPool))
     .TensorInferenceFunction(ConvPoolOpBase<CPUContext>::TensorInferenceForPool)
     .FillUsing(AveragePoolDocGenerator("3D"));
 
@@ -813,6 +842,8 @@ REGISTER_CPU_OPERATOR(MaxPool, PoolOp<float, CPUContext, MaxPool<float>>);
 OPERATOR_SCHEMA(MaxPool)
     .NumInputs(1)
     .NumOutputs(1)
+    .CostInferenceFunction(OpSchema::CostInferenceFunctionType(
+        ConvPoolOpBase<CPUContext>::CostInferenceForPool))
     .TensorInferenceFunction(ConvPoolOpBase<CPUContext>::TensorInferenceForPool)
     .FillUsing(MaxPoolDocGenerator(""));
 
@@ -821,6 +852,8 @@ REGISTER_CPU_OPERATOR(MaxPool1D, PoolOp<float, CPUContext, MaxPool<float>>);
 OPERATOR_SCHEMA(MaxPool1D)
     .NumInputs(1)
     .NumOutputs(1)
+    .CostInferenceFunction(OpSchema::CostInferenceFunctionType(
+        ConvPoolOpBase<CPUContext>::CostInferenceForPool))
     .TensorInferenceFunction(ConvPoolOpBase<CPUContext>::TensorInferenceForPool)
     .FillUsing(MaxPoolDocGenerator("1D"));
 
@@ -829,6 +862,8 @@ REGISTER_CPU_OPERATOR(MaxPool2D, PoolOp<float, CPUContext, MaxPool<float>>);
 OPERATOR_SCHEMA(MaxPool2D)
     .NumInputs(1)
     .NumOutputs(1)
+    .CostInferenceFunction(OpSchema::CostInferenceFunctionType(
+        ConvPoolOpBase<CPUContext>::CostInferenceForPool))
     .TensorInferenceFunction(ConvPoolOpBase<CPUContext>::TensorInferenceForPool)
     .FillUsing(MaxPoolDocGenerator("2D"));
 
@@ -837,6 +872,8 @@ REGISTER_CPU_OPERATOR(MaxPool3D, PoolOp<float, CPUContext, MaxPool<float>>);
 OPERATOR_SCHEMA(MaxPool3D)
     .NumInputs(1)
     .NumOutputs(1)
+    .CostInferenceFunction(OpSchema::CostInferenceFunctionType(
+        ConvPoolOpBase<CPUContext>::CostInferenceForPool))
     .TensorInferenceFunction(ConvPoolOpBase<CPUContext>::TensorInferenceForPool)
     .FillUsing(MaxPoolDocGenerator("3D"));
 } // namespace caffe2
@@ -47,11 +47,16 @@ std::unique_ptr<RecurrentNetworkExecutorBase> createRNNExecutor<CPUContext>(
  * Run forwardpass with T timesteps.
  */
 bool ThreadedRecurrentNetworkExecutor::Run(int T) {
+  CAFFE_ENFORCE_EQ(
+      false, failed_, "Tried to execute a previously failed RNN executor");
   CAFFE_ENFORCE(timestep_ops_.size() >= T);
   countdown_ = T * timestep_ops_[0].size();
   finished_timesteps_ = 0;
 
   CHECK(task_queue_.size() == 0);
+  CHECK(parked_jobs_.empty());
+  // At most every op of every timestep is parked at the same time.
+  parked_jobs_.reserve(countdown_);
 
   for (auto& rnn_op : timestep_ops_[0]) {
     // Launch "frontier"-ops first.
@@ -68,6 +73,8 @@ bool ThreadedRecurrentNetworkExecutor::Run(int T) {
  * Run backward pass with T timesteps.
  */
 bool ThreadedRecurrentNetworkExecutor::RunBackwards(int T) {
+  CAFFE_ENFORCE_EQ(
+      false, failed_, "Tried to execute a previously failed RNN executor");
   CAFFE_ENFORCE(timestep_ops_.size() >= T);
   countdown_ = T * timestep_ops_[0].size();
   finished_timesteps_ = 0;
@@ -86,10 +93,14 @@ bool ThreadedRecurrentNetworkExecutor::RunBackwards(int T) {
 }
 
 /**
- * Runs a single op and updates its dependencies when finished. If
- * dependent ops are ready to run, adds them to the task_queue.
+ * Runs a single op and updates its dependencies when finished. The first
+ * dependent op that becomes ready is returned in `next` to be run by the same
+ * thread; dependencies are sorted by distance, so this is the nearest op of
+ * the same timestep when there is one. Other ready ops go to the task_queue.
  */
-void ThreadedRecurrentNetworkExecutor::RunOp(OpTask job, int thread_id) {
+bool ThreadedRecurrentNetworkExecutor::RunOp(
+    const OpTask& job,
+    OpTask* next) {
   bool first_timestep =
       ((job.forward() && job.timestep == 0) ||
        (job.backward() && job.timestep == job.T - 1));
@@ -120,6 +131,7 @@ void ThreadedRecurrentNetworkExecutor::RunOp(OpTask job, int thread_id) {
 
   // Knock down dependencies and start next ops, if this
   // was last dependency fulfilled.
+  bool has_next = false;
   for (int depidx : rnn_op.dependencies) {
     int t = job.timestep;
     bool for_next_timestep = depidx <= rnn_op.order;
@@ -140,7 +152,21 @@ void ThreadedRecurrentNetworkExecutor::RunOp(OpTask job, int thread_id) {
     }
 
     if (proc_inputs == num_req_inputs || num_req_inputs == 0) {
-      task_queue_.Push(OpTask(t, depidx, job.T, job.direction));
+      if (!has_next) {
+        *next = OpTask(t, depidx, job.T, job.direction);
+        has_next = true;
+      } else {
+        task_queue_.Push(OpTask(t, depidx, job.T, job.direction));
+      }
+    }
+  }
+
+  // Count the finished timestep before the countdown, so that the caller
+  // cannot start another run while this one is still being accounted.
+  if (job.op_idx == timestep_ops_template_.size() - 1) {
+    finished_timesteps_.fetch_add(1);
+    if (max_parallel_timesteps_ > 0) {
+      ReleaseParkedJobs();
     }
   }
 
@@ -151,11 +177,50 @@ void ThreadedRecurrentNetworkExecutor::RunOp(OpTask job, int thread_id) {
     std::unique_lock<std::mutex> lk(countdown_mtx_);
     cv_.notify_one();
   }
+  return has_next;
+}
+
+bool ThreadedRecurrentNetworkExecutor::IsThrottled(const OpTask& job) {
+  int t = (job.direction == 1 ? job.timestep : job.T - job.timestep + 1);
+  return t - finished_timesteps_ >= max_parallel_timesteps_;
+}
+
+/**
+ * Check for limited timestep parallelism. If too many timesteps would be
+ * started concurrently, the job is parked until ReleaseParkedJobs() is called
+ * by the op that finishes a timestep, instead of cycling it through the
+ * task_queue.
+ */
+bool ThreadedRecurrentNetworkExecutor::ParkIfThrottled(const OpTask& job) {
+  if (max_parallel_timesteps_ <= 0 || !IsThrottled(job)) {
+    return false;
+  }
+  std::lock_guard<std::mutex> lk(parked_mtx_);
+  // Check again under the lock: the finished timestep counter is updated
+  // before the parked jobs are released under this lock.
+  if (!IsThrottled(job)) {
+    return false;
+  }
+  parked_jobs_.push_back(job);
+  return true;
+}
+
+void ThreadedRecurrentNetworkExecutor::ReleaseParkedJobs() {
+  std::lock_guard<std::mutex> lk(parked_mtx_);
+  size_t num_parked = 0;
+  for (const auto& job : parked_jobs_) {
+    if (IsThrottled(job)) {
+      parked_jobs_[num_parked++] = job;
+    } else {
+      task_queue_.Push(job);
+    }
+  }
+  parked_jobs_.resize(num_parked);
 }
 
 /**
  * Run-loop for executor threads: pop tasks from task_queue and execute
- * them with RunOp().
+ * them with RunOp(), following the chain of ops that RunOp() hands back.
  */
 void ThreadedRecurrentNetworkExecutor::WorkerFunction() {
   size_t num_jobs = 0;
@@ -168,23 +233,15 @@ void ThreadedRecurrentNetworkExecutor::WorkerFunction() {
       break;
     }
 
-    // Check for limited timestep parallelism, and if too many timesteps would
-    // be started concurrently, return the task to task queue.
-    if (max_parallel_timesteps_ > 0) {
-      int t = (job.direction == 1 ? job.timestep : job.T - job.timestep + 1);
-      if (t - finished_timesteps_ >= max_parallel_timesteps_) {
-        // Return to queue
-        task_queue_.Push(job);
-        continue;
-      }
-    }
-
     try {
-      RunOp(job, id);
-      if (job.op_idx == timestep_ops_template_.size() - 1) {
-        finished_timesteps_.fetch_add(1);
+      OpTask next;
+      while (!ParkIfThrottled(job)) {
+        num_jobs++;
+        if (!RunOp(job, &next)) {
+          break;
+        }
+        job = next;
       }
-      num_jobs++;
     } catch (::caffe2::EnforceNotMet& enf) {
       std::unique_lock<std::mutex> lk(countdown_mtx_);
       LOG(ERROR) << "Crash at thread " << id << " timestep " << job.timestep
@@ -193,6 +250,9 @@ void ThreadedRecurrentNetworkExecutor::WorkerFunction() {
       task_queue_.NoMoreJobs();
       failed_ = true;
       cv_.notify_one();
+      // Jobs parked for this run will never be released.
+      std::lock_guard<std::mutex> parked_lk(parked_mtx_);
+      parked_jobs_.clear();
       return;
     }
   }
@@ -204,9 +264,6 @@ void ThreadedRecurrentNetworkExecutor::WorkerFunction() {
  * finished, or a failure. Called by Run() and RunBackwards().
  */
 void ThreadedRecurrentNetworkExecutor::_Exec() {
-  CAFFE_ENFORCE_EQ(
-      false, failed_, "Tried to execute a previously failed RNN executor");
-
   // Start threads if not started
   std::unique_lock<std::mutex> lk(countdown_mtx_);
   while (workers_.size() < num_threads_) {
@@ -486,6 +486,16 @@ std::unique_ptr<RecurrentNetworkExecutorBase> createRNNExecutor(
     std::string timestep_blob,
     ArgumentHelper rnn_args);
 
+/**
+ * CPU executor. A persistent pool of workers, started on the first run and
+ * kept for the lifetime of the executor, runs (timestep, op) jobs as soon as
+ * their dependencies are fulfilled. A worker that finishes an op continues
+ * with the nearest dependent op that became ready, usually the next op of the
+ * same timestep, and queues the other ready ops for idle workers. Ops of
+ * different layers and timesteps thus run as a wavefront, without a queue
+ * round-trip per op. Jobs that would exceed the limit set by
+ * SetMaxParallelTimesteps() are parked until a timestep finishes.
+ */
 class ThreadedRecurrentNetworkExecutor : public RecurrentNetworkExecutorBase {
  public:
   ThreadedRecurrentNetworkExecutor(
@@ -522,9 +532,20 @@ class ThreadedRecurrentNetworkExecutor : public RecurrentNetworkExecutorBase {
 
   void WorkerFunction();
 
-  void RunOp(OpTask job, int thread_id);
+  // Runs the op of the job. Returns true and sets `next` if a dependent op
+  // became ready that the caller should run next.
+  bool RunOp(const OpTask& job, OpTask* next);
+
+  bool IsThrottled(const OpTask& job);
+
+  // Parks the job if it would start too many timesteps in parallel.
+  bool ParkIfThrottled(const OpTask& job);
+
+  void ReleaseParkedJobs();
 
   SimpleQueue<OpTask> task_queue_;
+  std::mutex parked_mtx_;
+  std::vector<OpTask> parked_jobs_;
   std::atomic<int> countdown_;
   std::atomic<bool> failed_;
   std::atomic<int> finished_timesteps_;
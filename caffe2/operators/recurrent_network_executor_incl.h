@@ -77,10 +77,10 @@ struct OpTask {
     CHECK(timestep >= 0 && timestep < _T);
   }
 
-  inline bool backward() {
+  inline bool backward() const {
     return direction == -1;
   }
-  inline bool forward() {
+  inline bool forward() const {
     return direction == 1;
   }
 };
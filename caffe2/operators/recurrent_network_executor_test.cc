@@ -0,0 +1,213 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <gtest/gtest.h>
+
+#include "caffe2/core/operator.h"
+#include "caffe2/core/workspace.h"
+#include "caffe2/utils/proto_utils.h"
+
+namespace caffe2 {
+
+namespace {
+
+const int kLayers = 3;
+const int kBatchSize = 2;
+const int kHiddenSize = 4;
+
+// Fails on timestep `fail_at`, passing its first input through otherwise.
+class FailAtTimestepOp final : public Operator<CPUContext> {
+ public:
+  FailAtTimestepOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<CPUContext>(operator_def, ws),
+        fail_at_(OperatorBase::GetSingleArgument<int>("fail_at", -1)) {}
+
+  bool RunOnDevice() override {
+    const int t = Input(1).data<int32_t>()[0];
+    CAFFE_ENFORCE_NE(t, fail_at_, "Failing at timestep ", t);
+    Output(0)->CopyFrom(Input(0), &context_);
+    return true;
+  }
+
+ private:
+  int fail_at_;
+};
+
+REGISTER_CPU_OPERATOR(RNNExecutorTestFailAt, FailAtTimestepOp);
+OPERATOR_SCHEMA(RNNExecutorTestFailAt).NumInputs(2).NumOutputs(1);
+
+void FillTensor(Workspace* ws, const string& name, vector<TIndex> dims) {
+  auto* tensor = ws->CreateBlob(name)->GetMutable<TensorCPU>();
+  tensor->Resize(dims);
+  float* data = tensor->mutable_data<float>();
+  for (TIndex i = 0; i < tensor->size(); ++i) {
+    data[i] = ((i * 7 + name.size()) % 13 - 6) / 13.0f;
+  }
+}
+
+// Forward-only stack of kLayers tanh RNN cells:
+//   h_l[t] = tanh(FC(h_{l-1}[t], Wx_l) + FC(h_l[t - 1], Wh_l))
+// With fail_at >= 0, the step net fails on that timestep.
+OperatorDef CreateRecurrentNetworkOp(
+    bool enable_rnn_executor,
+    int threads,
+    int fail_at = -1) {
+  NetDef step_net;
+  step_net.set_name("rnn_step");
+  vector<string> link_internal{"input_t"};
+  vector<string> link_external{"input"};
+  vector<int> link_offset{0};
+  vector<string> states;
+  vector<int> state_ids;
+  vector<string> inputs{"input"};
+  string below = "input_t";
+  for (int l = 0; l < kLayers; ++l) {
+    const string suffix = "_" + caffe2::to_string(l);
+    const string hidden = "hidden" + suffix;
+    for (const char* param : {"Wx", "bx", "Wh", "bh"}) {
+      step_net.add_external_input(param + suffix);
+    }
+    step_net.add_op()->CopyFrom(CreateOperatorDef(
+        "FC",
+        "",
+        {below, "Wx" + suffix, "bx" + suffix},
+        {"xw" + suffix},
+        {MakeArgument<int>("axis", 2)}));
+    step_net.add_op()->CopyFrom(CreateOperatorDef(
+        "FC",
+        "",
+        {hidden + "_prev", "Wh" + suffix, "bh" + suffix},
+        {"hw" + suffix},
+        {MakeArgument<int>("axis", 2)}));
+    step_net.add_op()->CopyFrom(CreateOperatorDef(
+        "Add", "", {"xw" + suffix, "hw" + suffix}, {"pre" + suffix}));
+    step_net.add_op()->CopyFrom(
+        CreateOperatorDef("Tanh", "", {"pre" + suffix}, {hidden + "_t"}));
+    link_internal.push_back(hidden + "_prev");
+    link_external.push_back(hidden + "_states");
+    link_offset.push_back(0);
+    link_internal.push_back(hidden + "_t");
+    link_external.push_back(hidden + "_states");
+    link_offset.push_back(1);
+    states.push_back(hidden + "_states");
+    state_ids.push_back(inputs.size());
+    inputs.push_back(hidden + "_init");
+    below = hidden + "_t";
+  }
+  if (fail_at >= 0) {
+    step_net.add_op()->CopyFrom(CreateOperatorDef(
+        "RNNExecutorTestFailAt",
+        "",
+        {below, "timestep"},
+        {"checked_t"},
+        {MakeArgument<int>("fail_at", fail_at)}));
+  }
+
+  Argument step_net_arg;
+  step_net_arg.set_name("step_net");
+  step_net_arg.mutable_n()->CopyFrom(step_net);
+  const string last = "hidden_" + caffe2::to_string(kLayers - 1);
+  return CreateOperatorDef(
+      "RecurrentNetwork",
+      "",
+      inputs,
+      {"output", "step_workspaces"},
+      {step_net_arg,
+       MakeArgument<vector<string>>("recurrent_states", states),
+       MakeArgument<vector<int>>("initial_recurrent_state_ids", state_ids),
+       MakeArgument<vector<string>>("link_internal", link_internal),
+       MakeArgument<vector<string>>("link_external", link_external),
+       MakeArgument<vector<int>>("link_offset", link_offset),
+       MakeArgument<vector<int>>(
+           "link_window", vector<int>(link_offset.size(), 1)),
+       MakeArgument<vector<string>>("alias_src", {last + "_states"}),
+       MakeArgument<vector<string>>("alias_dst", {"output"}),
+       MakeArgument<vector<int>>("alias_offset", {1}),
+       MakeArgument<int>("enable_rnn_executor", enable_rnn_executor),
+       MakeArgument<int>("rnn_executor.num_threads", threads)});
+}
+
+// Runs the op on sequences of the given lengths, in order, and returns the
+// outputs of all runs.
+vector<vector<float>> RunRecurrentNetwork(
+    bool enable_rnn_executor,
+    int threads,
+    const vector<int>& seq_lengths) {
+  Workspace ws;
+  for (int l = 0; l < kLayers; ++l) {
+    const string suffix = "_" + caffe2::to_string(l);
+    FillTensor(&ws, "hidden" + suffix + "_init", {1, kBatchSize, kHiddenSize});
+    FillTensor(&ws, "Wx" + suffix, {kHiddenSize, kHiddenSize});
+    FillTensor(&ws, "bx" + suffix, {kHiddenSize});
+    FillTensor(&ws, "Wh" + suffix, {kHiddenSize, kHiddenSize});
+    FillTensor(&ws, "bh" + suffix, {kHiddenSize});
+  }
+  ws.CreateBlob("input");
+  auto op = CreateOperator(
+      CreateRecurrentNetworkOp(enable_rnn_executor, threads), &ws);
+  vector<vector<float>> outputs;
+  for (int seq_length : seq_lengths) {
+    FillTensor(&ws, "input", {seq_length, kBatchSize, kHiddenSize});
+    EXPECT_TRUE(op->Run());
+    const auto& output = ws.GetBlob("output")->Get<TensorCPU>();
+    EXPECT_EQ(output.dim(0), seq_length);
+    outputs.emplace_back(
+        output.data<float>(), output.data<float>() + output.size());
+  }
+  return outputs;
+}
+
+} // namespace
+
+TEST(RecurrentNetworkExecutorTest, MatchesStepNets) {
+  // Forward-only runs rotate over a few step workspaces, so long sequences
+  // also exercise the limit on the number of timesteps run in parallel.
+  const vector<int> seq_lengths{1, 7, 33, 2, 64};
+  const auto expected = RunRecurrentNetwork(false, 1, seq_lengths);
+  for (int threads : {1, 2, 4}) {
+    const auto outputs = RunRecurrentNetwork(true, threads, seq_lengths);
+    ASSERT_EQ(outputs.size(), expected.size());
+    for (size_t i = 0; i < outputs.size(); ++i) {
+      ASSERT_EQ(outputs[i].size(), expected[i].size());
+      for (size_t j = 0; j < outputs[i].size(); ++j) {
+        EXPECT_FLOAT_EQ(outputs[i][j], expected[i][j])
+            << "threads " << threads << " run " << i << " element " << j;
+      }
+    }
+  }
+}
+
+TEST(RecurrentNetworkExecutorTest, FailedRunThrowsOnNextRun) {
+  // A long sequence parks jobs of later timesteps, which the failure leaves
+  // behind.
+  const int seq_length = 64;
+  Workspace ws;
+  for (int l = 0; l < kLayers; ++l) {
+    const string suffix = "_" + caffe2::to_string(l);
+    FillTensor(&ws, "hidden" + suffix + "_init", {1, kBatchSize, kHiddenSize});
+    FillTensor(&ws, "Wx" + suffix, {kHiddenSize, kHiddenSize});
+    FillTensor(&ws, "bx" + suffix, {kHiddenSize});
+    FillTensor(&ws, "Wh" + suffix, {kHiddenSize, kHiddenSize});
+    FillTensor(&ws, "bh" + suffix, {kHiddenSize});
+  }
+  FillTensor(&ws, "input", {seq_length, kBatchSize, kHiddenSize});
+  auto op = CreateOperator(CreateRecurrentNetworkOp(true, 4, 8), &ws);
+  EXPECT_THROW(op->Run(), EnforceNotMet);
+  EXPECT_THROW(op->Run(), EnforceNotMet);
+}
+
+} // namespace caffe2
@@ -31,13 +31,20 @@ void SumReduceDimsOp<CPUContext, true, false>::Compute(
     int cols,
     const T* in_data,
     T* out_data) {
-  for (int j = 0; j < cols; j++) {
-    T sum = in_data[j];
-    for (int i = 1; i < rows; i++) {
-      sum += in_data[i * cols + j];
-    }
-    out_data[j] = sum;
-  }
+  // Every chunk of columns is accumulated row by row, which keeps the reads
+  // contiguous.
+  context_.ParallelFor(
+      cols, CPUContext::ParallelForGrain(rows), [&](TIndex begin, TIndex end) {
+        for (TIndex j = begin; j < end; j++) {
+          out_data[j] = in_data[j];
+        }
+        for (int i = 1; i < rows; i++) {
+          const T* row = in_data + i * cols;
+          for (TIndex j = begin; j < end; j++) {
+            out_data[j] += row[j];
+          }
+        }
+      });
 }
 
 // ReduceBackSum: rowwise sum
@@ -48,14 +55,17 @@ void SumReduceDimsOp<CPUContext, false, false>::Compute(
     int cols,
     const T* in_data,
     T* out_data) {
-  for (int i = 0; i < rows; i++) {
-    int offset = i * cols;
-    T sum = in_data[offset];
-    for (int j = 1; j < cols; j++) {
-      sum += in_data[offset + j];
-    }
-    out_data[i] = sum;
-  }
+  context_.ParallelFor(
+      rows, CPUContext::ParallelForGrain(cols), [&](TIndex begin, TIndex end) {
+        for (TIndex i = begin; i < end; i++) {
+          const T* row = in_data + i * cols;
+          T sum = row[0];
+          for (int j = 1; j < cols; j++) {
+            sum += row[j];
+          }
+          out_data[i] = sum;
+        }
+      });
 }
 
 // ReduceFrontSumGradient
@@ -172,13 +182,23 @@ void SumReduceDimsOp<CPUContext, true, true>::Compute(
     int cols,
     const T* in_data,
     T* out_data) {
-  for (int j = 0; j < cols; j++) {
-    T sum = in_data[j];
-    for (int i = 1; i < rows; i++) {
-      sum += in_data[i * cols + j];
-    }
-    out_data[j] = sum / rows;
-  }
+  // Every chunk of columns is accumulated row by row, which keeps the reads
+  // contiguous.
+  context_.ParallelFor(
+      cols, CPUContext::ParallelForGrain(rows), [&](TIndex begin, TIndex end) {
+        for (TIndex j = begin; j < end; j++) {
+          out_data[j] = in_data[j];
+        }
+        for (int i = 1; i < rows; i++) {
+          const T* row = in_data + i * cols;
+          for (TIndex j = begin; j < end; j++) {
+            out_data[j] += row[j];
+          }
+        }
+        for (TIndex j = begin; j < end; j++) {
+          out_data[j] /= rows;
+        }
+      });
 }
 
 // ReduceBackMean: rowwise mean
@@ -189,14 +209,17 @@ void SumReduceDimsOp<CPUContext, false, true>::Compute(
     int cols,
     const T* in_data,
     T* out_data) {
-  for (int i = 0; i < rows; i++) {
-    int offset = i * cols;
-    T sum = in_data[offset];
-    for (int j = 1; j < cols; j++) {
-      sum += in_data[offset + j];
-    }
-    out_data[i] = sum / cols;
-  }
+  context_.ParallelFor(
+      rows, CPUContext::ParallelForGrain(cols), [&](TIndex begin, TIndex end) {
+        for (TIndex i = begin; i < end; i++) {
+          const T* row = in_data + i * cols;
+          T sum = row[0];
+          for (int j = 1; j < cols; j++) {
+            sum += row[j];
+          }
+          out_data[i] = sum / cols;
+        }
+      });
 }
 
 // ReduceFrontMeanGradient
@@ -2020,8 +2020,30 @@ i.e. `len(LENGTHS)`. Other dimensions are inherited from the input tensor.
         "OUTPUT",
         "Aggregated output tensor. Has the first dimension of K "
         "(the number of segments).");
+    schema.CostInferenceFunction(
+        OpSchema::CostInferenceFunctionType(CostInference));
     ReducerDef::PopulateSchema(schema);
   }
+  static OpSchema::Cost CostInference(
+      const OperatorDef& /* unused */,
+      const vector<TensorShape>& inputs) {
+    struct OpSchema::Cost c;
+    const TensorShape& data = inputs[0];
+    const TensorShape& indices = inputs[Reducer::kInputCount];
+    const TensorShape& lengths = inputs[Reducer::kInputCount + 1];
+    const uint64_t block_size = nElemFromDim(data, 1);
+    const uint64_t num_looked_up = nElemFromDim(indices) * block_size;
+    // One addition per looked up element, and one multiplication more for
+    // reducers that take weights. Only the looked up rows of DATA are read.
+    c.flops = num_looked_up * Reducer::kInputCount;
+    c.bytes_moved =
+        num_looked_up * DataTypeToTypeMeta(data.data_type()).itemsize() +
+        nElemFromDim(lengths) * block_size * sizeof(T);
+    for (int i = 1; i < inputs.size(); ++i) {
+      c.bytes_moved += nBytesOfShape(inputs[i]);
+    }
+    return c;
+  }
   using Reducer = typename ReducerDef::template Reducer<T, Context>;
   using ReducerGradient =
       typename ReducerDef::template ReducerGradient<T, Context>;
@@ -56,6 +56,7 @@ OPERATOR_SCHEMA(Sigmoid)
   .NumInputs(1)
   .NumOutputs(1)
   .AllowInplace({{0, 0}})
+  .CostInferenceFunction(PointwiseCostInference<4>)
   .IdenticalTypeAndShape()
   .SetDoc(R"DOC(
 Sigmoid takes one input data (Tensor<T>) and produces one output data
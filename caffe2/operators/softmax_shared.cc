@@ -30,42 +30,59 @@ void SoftmaxCPU(
     const float* sum_multiplier,
     bool logarithmic,
     float* rowmax) {
-  math::RowwiseMax<float, CPUContext>(N, D, Xdata, rowmax, &context);
-  // Put the intermediate result X - max(X) into Y
-  context.template Copy<float, CPUContext, CPUContext>(N * D, Xdata, Ydata);
-  // Subtract the max (for numerical reasons)
-  math::Gemm<float, CPUContext>(
-      CblasNoTrans,
-      CblasNoTrans,
-      N,
-      D,
-      1,
-      -1,
-      rowmax,
-      sum_multiplier,
-      1,
-      Ydata,
-      &context);
-  // Exponentiation
-  math::Exp<float, CPUContext>(N * D, Ydata, Ydata, &context);
-  math::Gemv<float, CPUContext>(
-      CblasNoTrans, N, D, 1, Ydata, sum_multiplier, 0, scale, &context);
-  // Do division
-  // TODO(Yangqing): maybe implement it more beautifully?
-  if (!logarithmic) {
-    for (int i = 0; i < N; ++i) {
-      for (int j = 0; j < D; ++j) {
-        Ydata[i * D + j] /= scale[i];
-      }
-    }
-  } else {
-    for (int i = 0; i < N; ++i) {
-      for (int j = 0; j < D; ++j) {
-        Ydata[i * D + j] =
-            Xdata[i * D + j] - rowmax[i] - log(fmaxf(scale[i], 1e-20f));
-      }
-    }
-  }
+  // Rows are independent, so large batches are split into chunks of rows.
+  context.ParallelFor(
+      N, CPUContext::ParallelForGrain(4 * D), [&](TIndex begin, TIndex end) {
+        const int rows = end - begin;
+        const float* X = Xdata + begin * D;
+        float* Y = Ydata + begin * D;
+        float* chunk_scale = scale + begin;
+        float* chunk_rowmax = rowmax + begin;
+        math::RowwiseMax<float, CPUContext>(rows, D, X, chunk_rowmax, &context);
+        // Put the intermediate result X - max(X) into Y
+        context.template Copy<float, CPUContext, CPUContext>(rows * D, X, Y);
+        // Subtract the max (for numerical reasons)
+        math::Gemm<float, CPUContext>(
+            CblasNoTrans,
+            CblasNoTrans,
+            rows,
+            D,
+            1,
+            -1,
+            chunk_rowmax,
+            sum_multiplier,
+            1,
+            Y,
+            &context);
+        // Exponentiation
+        math::Exp<float, CPUContext>(rows * D, Y, Y, &context);
+        math::Gemv<float, CPUContext>(
+            CblasNoTrans,
+            rows,
+            D,
+            1,
+            Y,
+            sum_multiplier,
+            0,
+            chunk_scale,
+            &context);
+        // Do division
+        // TODO(Yangqing): maybe implement it more beautifully?
+        if (!logarithmic) {
+          for (int i = 0; i < rows; ++i) {
+            for (int j = 0; j < D; ++j) {
+              Y[i * D + j] /= chunk_scale[i];
+            }
+          }
+        } else {
+          for (int i = 0; i < rows; ++i) {
+            for (int j = 0; j < D; ++j) {
+              Y[i * D + j] = X[i * D + j] - chunk_rowmax[i] -
+                  log(fmaxf(chunk_scale[i], 1e-20f));
+            }
+          }
+        }
+      });
 }
 
 } // namespace caffe2
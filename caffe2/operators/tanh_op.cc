@@ -61,6 +61,7 @@ OPERATOR_SCHEMA(Tanh)
   .NumInputs(1)
   .NumOutputs(1)
   .AllowInplace({{0, 0}})
+  .CostInferenceFunction(PointwiseCostInference<4>)
   .IdenticalTypeAndShape()
   .SetDoc(R"DOC(
 Calculates the hyperbolic tangent of the given input tensor element-wise. This
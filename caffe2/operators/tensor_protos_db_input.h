@@ -45,6 +45,8 @@ class TensorProtosDBInput final : public PrefetchOperator<Context> {
   bool shape_inferred_ = false;
   string key_;
   string value_;
+  vector<string> keys_;
+  vector<string> values_;
 };
 
 template <class Context>
@@ -77,10 +79,12 @@ bool TensorProtosDBInput<Context>::Prefetch() {
     }
   } else {
     vector<TensorCPU> temp_tensors(OutputSize());
+    // Take the whole batch from the reader at once so that concurrent input
+    // ops contend for the reader once per batch rather than once per item.
+    reader.ReadBatch(batch_size_, &keys_, &values_);
     for (int item_id = 0; item_id < batch_size_; ++item_id) {
-      reader.Read(&key_, &value_);
       TensorProtos protos;
-      CAFFE_ENFORCE(protos.ParseFromString(value_));
+      CAFFE_ENFORCE(protos.ParseFromString(values_[item_id]));
       CAFFE_ENFORCE(protos.protos_size() == OutputSize());
       if (!shape_inferred_) {
         // First, set the shape of all the blobs.
@@ -132,6 +132,19 @@ static void EmbeddingLookupGenericSlow(
       const float* scale_bias,                                     \
       bool normalize_by_lengths,                                   \
       OutType* out) {                                              \
+    AVX512_DO(                                                     \
+        EmbeddingLookup_##IndexType##_##InType##_##OutType,        \
+        block_size,                                                \
+        output_size,                                               \
+        index_size,                                                \
+        data_size,                                                 \
+        input,                                                     \
+        indices,                                                   \
+        lengths,                                                   \
+        weights,                                                   \
+        scale_bias,                                                \
+        normalize_by_lengths,                                      \
+        out);                                                      \
     AVX2_FMA_DO(                                                   \
         EmbeddingLookup_##IndexType##_##InType##_##OutType,        \
         block_size,                                                \
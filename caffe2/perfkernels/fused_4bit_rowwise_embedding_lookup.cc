@@ -0,0 +1,179 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "caffe2/perfkernels/fused_4bit_rowwise_embedding_lookup.h"
+
+#include <cstring>
+
+#include "caffe2/core/types.h"
+#include "caffe2/perfkernels/common.h"
+#include "caffe2/utils/cpuid.h"
+
+namespace caffe2 {
+
+// Base implementation does runtime dispatch for each segment of reduction
+template <typename IndexType, typename InType, typename OutType>
+static void Fused4BitRowwiseEmbeddingLookupGenericSlow(
+    const TIndex block_size,
+    const TIndex output_size,
+    const TIndex index_size,
+    const TIndex data_size,
+    const InType* input,
+    const IndexType* indices,
+    const int* lengths,
+    const float* weights, // optional, can be null for sum reducer
+    bool normalize_by_lengths,
+    OutType* out) {
+  // Two elements per byte, then a float scale and a float bias.
+  const TIndex packed_block_size = (block_size + 1) / 2;
+  const TIndex fused_block_size = packed_block_size + 8;
+  TIndex current = 0;
+  for (int m = 0; m < output_size; ++m) {
+    memset(out, 0, sizeof(OutType) * block_size);
+    for (int i = 0; i < lengths[m]; ++i) {
+      CAFFE_ENFORCE_LT(current, index_size);
+      TIndex idx = indices[current];
+      CAFFE_ENFORCE(
+          0 <= idx && idx < data_size,
+          "Index ",
+          current,
+          " is out of bounds: ",
+          idx,
+          ", range 0 to ",
+          data_size);
+#ifdef __GNUC__
+      if (current + 1 < index_size) {
+        __builtin_prefetch(
+            input + fused_block_size * indices[current + 1], 0, 1);
+      }
+#endif // __GNUC__
+
+      const InType* row = input + fused_block_size * idx;
+      float scale_bias[2];
+      memcpy(scale_bias, row + packed_block_size, sizeof(scale_bias));
+
+      float weight = 1.0f;
+      if (weights) {
+        weight = weights[current];
+      }
+      const float scale = weight * scale_bias[0];
+      const float bias = weight * scale_bias[1];
+
+      for (TIndex j = 0; j < block_size; ++j) {
+        const uint8_t q = (row[j / 2] >> ((j % 2) * 4)) & 0xf;
+        out[j] += scale * q + bias;
+      }
+
+      ++current;
+    }
+    if (normalize_by_lengths && lengths[m]) {
+      const float len_inv = 1.f / lengths[m];
+      for (TIndex j = 0; j < block_size; ++j) {
+        out[j] *= len_inv;
+      }
+    }
+    out += block_size;
+  }
+  CAFFE_ENFORCE_EQ(
+      current,
+      index_size,
+      "Your input seems to be incorrect: the sum of lengths values should be "
+      "the size of the indices tensor, but it appears not.");
+}
+
+// Proxy back to generic implementation
+#define FUSED_4BIT_ROWWISE_EMBEDDING_SPECIALIZATION(                        \
+    IndexType, InType, OutType)                                             \
+  void                                                                      \
+      Fused4BitRowwiseEmbeddingLookup_##IndexType##_##InType##_##OutType##__base( \
+          const TIndex block_size,                                          \
+          const TIndex output_size,                                         \
+          const TIndex index_size,                                          \
+          const TIndex data_size,                                           \
+          const InType* input,                                              \
+          const IndexType* indices,                                         \
+          const int* lengths,                                               \
+          const float* weights,                                             \
+          bool normalize_by_lengths,                                        \
+          OutType* out) {                                                   \
+    Fused4BitRowwiseEmbeddingLookupGenericSlow<IndexType, InType, OutType>( \
+        block_size,                                                         \
+        output_size,                                                        \
+        index_size,                                                         \
+        data_size,                                                          \
+        input,                                                              \
+        indices,                                                            \
+        lengths,                                                            \
+        weights,                                                            \
+        normalize_by_lengths,                                               \
+        out);                                                               \
+  }                                                                         \
+  template <>                                                               \
+  void Fused4BitRowwiseEmbeddingLookup(                                     \
+      const TIndex block_size,                                              \
+      const TIndex output_size,                                             \
+      const TIndex index_size,                                              \
+      const TIndex data_size,                                               \
+      const InType* input,                                                  \
+      const IndexType* indices,                                             \
+      const int* lengths,                                                   \
+      const float* weights,                                                 \
+      bool normalize_by_lengths,                                            \
+      OutType* out) {                                                       \
+    AVX512_DO(                                                              \
+        Fused4BitRowwiseEmbeddingLookup_##IndexType##_##InType##_##OutType, \
+        block_size,                                                         \
+        output_size,                                                        \
+        index_size,                                                         \
+        data_size,                                                          \
+        input,                                                              \
+        indices,                                                            \
+        lengths,                                                            \
+        weights,                                                            \
+        normalize_by_lengths,                                               \
+        out);                                                               \
+    AVX2_FMA_DO(                                                            \
+        Fused4BitRowwiseEmbeddingLookup_##IndexType##_##InType##_##OutType, \
+        block_size,                                                         \
+        output_size,                                                        \
+        index_size,                                                         \
+        data_size,                                                          \
+        input,                                                              \
+        indices,                                                            \
+        lengths,                                                            \
+        weights,                                                            \
+        normalize_by_lengths,                                               \
+        out);                                                               \
+    BASE_DO(                                                                \
+        Fused4BitRowwiseEmbeddingLookup_##IndexType##_##InType##_##OutType, \
+        block_size,                                                         \
+        output_size,                                                        \
+        index_size,                                                         \
+        data_size,                                                          \
+        input,                                                              \
+        indices,                                                            \
+        lengths,                                                            \
+        weights,                                                            \
+        normalize_by_lengths,                                               \
+        out);                                                               \
+  }
+
+FUSED_4BIT_ROWWISE_EMBEDDING_SPECIALIZATION(int32_t, uint8_t, float);
+FUSED_4BIT_ROWWISE_EMBEDDING_SPECIALIZATION(int64_t, uint8_t, float);
+
+#undef FUSED_4BIT_ROWWISE_EMBEDDING_SPECIALIZATION
+
+} // namespace caffe2
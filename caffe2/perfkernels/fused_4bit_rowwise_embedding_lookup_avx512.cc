@@ -0,0 +1,176 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <immintrin.h>
+#include <cstring>
+
+#include "caffe2/core/common.h"
+#include "caffe2/core/types.h"
+
+namespace caffe2 {
+
+namespace {
+
+// Unpacks 16 consecutive 4-bit values starting at byte `p` into floats.
+inline __m512 Load4BitAsFloat(const uint8_t* p) {
+  const __m128i bytes = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(p));
+  const __m128i mask = _mm_set1_epi8(0xf);
+  const __m128i lo = _mm_and_si128(bytes, mask);
+  const __m128i hi = _mm_and_si128(_mm_srli_epi16(bytes, 4), mask);
+  // Interleave so that element 2k (low nibble) precedes 2k + 1 (high nibble).
+  return _mm512_cvtepi32_ps(_mm512_cvtepu8_epi32(_mm_unpacklo_epi8(lo, hi)));
+}
+
+template <typename IndexType>
+void Fused4BitRowwiseEmbeddingLookupAVX512(
+    const TIndex block_size,
+    const TIndex output_size,
+    const TIndex index_size,
+    const TIndex data_size,
+    const uint8_t* input,
+    const IndexType* indices,
+    const int* lengths,
+    const float* weights,
+    bool normalize_by_lengths,
+    float* out) {
+  const IndexType prefdist_T0 = 16;
+  const TIndex packed_block_size = (block_size + 1) / 2;
+  const TIndex fused_block_size = packed_block_size + 8;
+  IndexType dataInd = 0;
+  for (IndexType rangeIndex = 0; rangeIndex < output_size; ++rangeIndex) {
+    float* op = &out[rangeIndex * block_size];
+    TIndex j = 0;
+    for (; j + 16 <= block_size; j += 16) {
+      _mm512_storeu_ps(op + j, _mm512_setzero_ps());
+    }
+    for (; j < block_size; j++) {
+      op[j] = 0.0f;
+    }
+    for (IndexType start = dataInd; dataInd < start + lengths[rangeIndex];
+         ++dataInd) {
+      const IndexType idx = indices[dataInd];
+      CAFFE_ENFORCE(
+          idx >= 0 && idx < data_size,
+          "Index ",
+          dataInd,
+          " is out of bounds: ",
+          idx,
+          ", range 0 to ",
+          data_size);
+      const uint8_t* ip = &input[idx * fused_block_size];
+      float scale_bias[2];
+      memcpy(scale_bias, ip + packed_block_size, sizeof(scale_bias));
+      float wgt = 1.f;
+      if (weights) {
+        wgt = weights[dataInd];
+      }
+      const float bio = wgt * scale_bias[1];
+      wgt = wgt * scale_bias[0];
+      const __m512 vbio = _mm512_set1_ps(bio);
+      const __m512 vwgt = _mm512_set1_ps(wgt);
+
+      const IndexType next_T0 = (dataInd < index_size - prefdist_T0)
+          ? (dataInd + prefdist_T0)
+          : dataInd;
+      const IndexType idx_pref_T0 = indices[next_T0];
+      CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
+      const uint8_t* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+
+      j = 0;
+      for (; j + 16 <= block_size; j += 16) {
+        _mm512_storeu_ps(
+            &op[j],
+            _mm512_fmadd_ps(
+                vwgt,
+                Load4BitAsFloat(&ip[j / 2]),
+                _mm512_add_ps(_mm512_loadu_ps(&op[j]), vbio)));
+        // 16 elements are 8 bytes, so prefetch once per 64 byte cache line.
+        if (j % 128 == 0) {
+          _mm_prefetch(
+              reinterpret_cast<const char*>(&ip_next_T0[j / 2]), _MM_HINT_T0);
+        }
+      }
+      for (; j < block_size; j++) {
+        const uint8_t q = (ip[j / 2] >> ((j % 2) * 4)) & 0xf;
+        op[j] += wgt * q + bio;
+      }
+    }
+    if (normalize_by_lengths && lengths[rangeIndex]) {
+      float len_inv = 1.0f / lengths[rangeIndex];
+      __m512 vlen_inv = _mm512_set1_ps(len_inv);
+      j = 0;
+      for (; j + 16 <= block_size; j += 16) {
+        _mm512_storeu_ps(
+            &op[j], _mm512_mul_ps(_mm512_loadu_ps(&op[j]), vlen_inv));
+      }
+      for (; j < block_size; j++) {
+        op[j] = len_inv * op[j];
+      }
+    }
+  }
+}
+
+} // namespace
+
+void Fused4BitRowwiseEmbeddingLookup_int32_t_uint8_t_float__avx512(
+    const TIndex block_size,
+    const TIndex output_size,
+    const TIndex index_size,
+    const TIndex data_size,
+    const uint8_t* input,
+    const int32_t* indices,
+    const int* lengths,
+    const float* weights,
+    bool normalize_by_lengths,
+    float* out) {
+  Fused4BitRowwiseEmbeddingLookupAVX512<int32_t>(
+      block_size,
+      output_size,
+      index_size,
+      data_size,
+      input,
+      indices,
+      lengths,
+      weights,
+      normalize_by_lengths,
+      out);
+}
+
+void Fused4BitRowwiseEmbeddingLookup_int64_t_uint8_t_float__avx512(
+    const TIndex block_size,
+    const TIndex output_size,
+    const TIndex index_size,
+    const TIndex data_size,
+    const uint8_t* input,
+    const int64_t* indices,
+    const int* lengths,
+    const float* weights,
+    bool normalize_by_lengths,
+    float* out) {
+  Fused4BitRowwiseEmbeddingLookupAVX512<int64_t>(
+      block_size,
+      output_size,
+      index_size,
+      data_size,
+      input,
+      indices,
+      lengths,
+      weights,
+      normalize_by_lengths,
+      out);
+}
+
+} // namespace caffe2
@@ -0,0 +1,54 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "caffe2/core/common.h"
+
+namespace caffe2 {
+
+/**
+ * Embedding lookup with reduction over fused rowwise-quantized 8-bit rows.
+ *
+ * Every row of `input` holds block_size uint8 values followed by a float
+ * scale and a float bias, i.e. it is block_size + 8 bytes long, and the
+ * dequantized value of the k-th element is scale * input[k] + bias. Keeping
+ * the scale and bias in the row saves the extra cache miss a separate
+ * scale_bias array costs per lookup.
+ *
+ * `input` of size data_size * (block_size + 8)
+ * `indices` of size index_size
+ * `lengths` of size output_size
+ * `weights` nullptr or array of size index_size
+ * `out` of size output_size * block_size
+ * sum(lengths[i]) == index_size
+ *
+ * Behavior is otherwise the same as EmbeddingLookup.
+ */
+template <typename IndexType, typename InType, typename OutType>
+void Fused8BitRowwiseEmbeddingLookup(
+    const TIndex block_size,
+    const TIndex output_size,
+    const TIndex index_size,
+    const TIndex data_size,
+    const InType* input,
+    const IndexType* indices,
+    const int* lengths,
+    const float* weights, // optional, can be null for non-weighted sum
+    bool normalize_by_lengths,
+    OutType* out);
+
+} // namespace caffe2
@@ -21,62 +21,67 @@ import argparse
 import sys
 
 
-def unroll(uf, IndexType, InType, OutType, use_weights, isa):
-
-    def sizeof(InType):
-        size = 0
-        if InType == "float":
-            size = 4
-        elif InType == "float16":
-            size = 2
-        elif InType == "uint8_t":
-            size = 1
-        else:
-            assert False
-
-        return size
 
-    def compute(regid, InType, use_weights, isa, prefetch):
-        code = []
 
-        if InType == "float":
-            code.append("vop%d = _mm256_fmadd_ps(vwgt,  \
-                  _mm256_loadu_ps(ip + (%d)), vop%d);" % (regid, regid, regid))
-
-        elif InType == "float16":
-            code.append("vop%d = _mm256_fmadd_ps(vwgt,  \
-                   _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (%d)))), \
-                   vop%d);"
-                        % (regid, regid, regid))
-        elif InType == "uint8_t":
-            code.append("vop%d = _mm256_fmadd_ps(vwgt,  \
-                   _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (%d))))), \
-                   _mm256_add_ps(vop%d, vbio));"
-                        % (regid, regid, regid))
+# Per-ISA vector type, intrinsic prefix, number of floats per register and
+# suffix of the generated functions (matching the *_DO macros in common.h).
+ISAS = {
+    "avx2": {
+        "vec": "__m256",
+        "mm": "_mm256",
+        "width": 8,
+        "suffix": "__avx2_fma",
+    },
+    "avx512": {
+        "vec": "__m512",
+        "mm": "_mm512",
+        "width": 16,
+        "suffix": "__avx512",
+    },
+}
+
+
+def load_fp32(InType, isa, addr):
+    mm = ISAS[isa]["mm"]
+    if InType == "float":
+        return "%s_loadu_ps(%s)" % (mm, addr)
+    elif InType == "float16":
+        if isa == "avx2":
+            return "_mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(%s)))" % addr
         else:
-            assert False
+            return "_mm512_cvtph_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(%s)))" % addr
+    elif InType == "uint8_t":
+        if isa == "avx2":
+            return "_mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(%s))))" % addr
+        else:
+            return "_mm512_cvtepi32_ps(_mm512_cvtepu8_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(%s))))" % addr
+    else:
+        assert False
 
 
-        if prefetch == True:
-            code.append("_mm_prefetch((&ip_next_T0[%d]), _MM_HINT_T0);" % (regid))
-        else:
-            code.append("// skip unecassery prefetch of (&ip_next_T0[%d])" % (regid))
+def sizeof(InType):
+    size = 0
+    if InType == "float":
+        size = 4
+    elif InType == "float16":
+        size = 2
+    elif InType == "uint8_t":
+        size = 1
+    else:
+        assert False
 
-        return code
+    return size
 
-    code = []
-    code.append("// unrolling " + str(uf) + " times")
-    code.append(IndexType + " dataInd = 0;")
-    code.append("for (" + IndexType +
-                " rangeIndex = 0; rangeIndex < output_size; ++rangeIndex) {")
-    code.append(OutType + " *op = &out[rangeIndex * block_size];")
-    for i in range(0, uf):
-        j = 8 * i
-        code.append("__m256 vop" + str(j) + " = _mm256_setzero_ps();")
 
-    # inner loop
-    code.append("for (" + IndexType +
-                " start = dataInd; dataInd < start + lengths[rangeIndex]; ++dataInd) {")
+def row_setup(IndexType, InType, OutType, isa, fused,
+              assert_scale_bias=False):
+    # Reads the weight (and for 8-bit rows the scale and bias) of the current
+    # index and points ip / ip_next_T0 at the current and prefetched rows.
+    vec = ISAS[isa]["vec"]
+    mm = ISAS[isa]["mm"]
+    row_size = "fused_block_size" if fused else "block_size"
+
+    code = []
     code.append("const  " + IndexType + " idx = indices[dataInd];")
     code.append(
         'CAFFE_ENFORCE(idx >=0 && idx < data_size, "Index ", dataInd, " is out of bounds: ", idx, ", range 0 to ", data_size);')
@@ -87,27 +92,74 @@ def unroll(uf, IndexType, InType, OutType, use_weights, isa):
         code.append("if (weights) {")
         code.append("wgt = weights[dataInd];")
         code.append("}")
-        code.append("bio = wgt * scale_bias[2 * idx + 1];");
-        code.append("wgt = wgt * scale_bias[2 * idx];");
-        code.append("__m256 vbio = _mm256_set1_ps(bio);")
+        if fused:
+            code.append(
+                "const float* scale_bias = reinterpret_cast<const float*>(&input[idx * fused_block_size + block_size]);")
+            code.append("bio = wgt * scale_bias[1];")
+            code.append("wgt = wgt * scale_bias[0];")
+        else:
+            if assert_scale_bias:
+                code.append("assert(scale_bias);")
+            code.append("bio = wgt * scale_bias[2 * idx + 1];")
+            code.append("wgt = wgt * scale_bias[2 * idx];")
+        code.append("%s vbio = %s_set1_ps(bio);" % (vec, mm))
     else:
         code.append(OutType + " wgt = 1.f;")
         code.append("if (weights) {")
         code.append("wgt = weights[dataInd];")
         code.append("}")
-    code.append("__m256 vwgt = _mm256_set1_ps(wgt);")
+    code.append("%s vwgt = %s_set1_ps(wgt);" % (vec, mm))
 
-    code.append("const  " + InType + " *ip = &input[idx * block_size];")
+    code.append("const  " + InType + " *ip = &input[idx * " + row_size + "];")
     code.append("const  " + IndexType +
-                " next_T0 = (dataInd < index_size - prefdist_T0) ? (dataInd + prefdist_T0) : dataInd;");
+                " next_T0 = (dataInd < index_size - prefdist_T0) ? (dataInd + prefdist_T0) : dataInd;")
     code.append("const  " + IndexType + " idx_pref_T0 = indices[next_T0];")
     code.append(
         "CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);")
     code.append("const  " + InType +
-                " *ip_next_T0 = &input[idx_pref_T0 * block_size];")
+                " *ip_next_T0 = &input[idx_pref_T0 * " + row_size + "];")
+    return code
+
+
+def unroll(uf, IndexType, InType, OutType, use_weights, isa, fused):
+    vec = ISAS[isa]["vec"]
+    mm = ISAS[isa]["mm"]
+    width = ISAS[isa]["width"]
+
+    def compute(regid, InType, use_weights, isa, prefetch):
+        code = []
+
+        if InType == "uint8_t":
+            code.append("vop%d = %s_fmadd_ps(vwgt, %s, %s_add_ps(vop%d, vbio));"
+                        % (regid, mm, load_fp32(InType, isa, "ip + (%d)" % regid), mm, regid))
+        else:
+            code.append("vop%d = %s_fmadd_ps(vwgt, %s, vop%d);"
+                        % (regid, mm, load_fp32(InType, isa, "ip + (%d)" % regid), regid))
+
+        if prefetch == True:
+            code.append("_mm_prefetch((&ip_next_T0[%d]), _MM_HINT_T0);" % (regid))
+        else:
+            code.append("// skip unecassery prefetch of (&ip_next_T0[%d])" % (regid))
+
+        return code
+
+    code = []
+    code.append("// unrolling " + str(uf) + " times")
+    code.append(IndexType + " dataInd = 0;")
+    code.append("for (" + IndexType +
+                " rangeIndex = 0; rangeIndex < output_size; ++rangeIndex) {")
+    code.append(OutType + " *op = &out[rangeIndex * block_size];")
+    for i in range(0, uf):
+        j = width * i
+        code.append("%s vop%d = %s_setzero_ps();" % (vec, j, mm))
+
+    # inner loop
+    code.append("for (" + IndexType +
+                " start = dataInd; dataInd < start + lengths[rangeIndex]; ++dataInd) {")
+    code.extend(row_setup(IndexType, InType, OutType, isa, fused))
 
     for i in range(0, uf):
-        j = 8 * i
+        j = width * i
         cachelinesize = 64
         byteoffset = sizeof(InType) * j
         prefetch = ((byteoffset % cachelinesize) == 0)
@@ -116,45 +168,35 @@ def unroll(uf, IndexType, InType, OutType, use_weights, isa):
 
     code.append("if (normalize_by_lengths == false) {")
     for i in range(0, uf):
-        j = 8 * i
-        code.append(
-            "_mm256_storeu_ps(&op[" + str(j) + "], vop" + str(j) + ");")
+        j = width * i
+        code.append("%s_storeu_ps(&op[%d], vop%d);" % (mm, j, j))
     code.append("} else if (lengths[rangeIndex]) {")
     # inv of length
     code.append(
-        "__m256 vlen_inv = _mm256_set1_ps(1.0f / lengths[rangeIndex]);")
+        "%s vlen_inv = %s_set1_ps(1.0f / lengths[rangeIndex]);" % (vec, mm))
     for i in range(0, uf):
-        j = 8 * i
-        code.append(
-            "_mm256_storeu_ps(&op[" + str(j) + "], _mm256_mul_ps(" + "vop" + str(j) + ", vlen_inv));")
+        j = width * i
+        code.append("%s_storeu_ps(&op[%d], %s_mul_ps(vop%d, vlen_inv));"
+                    % (mm, j, mm, j))
     code.append("}")
 
     code.append("}")
     return code
 
 
-def generic(IndexType, InType, OutType, use_weights, isa):
+def generic(IndexType, InType, OutType, use_weights, isa, fused):
+    vec = ISAS[isa]["vec"]
+    mm = ISAS[isa]["mm"]
+    width = ISAS[isa]["width"]
 
     def compute(InType, use_weights, isa):
         code = []
-        if InType == "float":
-            code.append("_mm256_storeu_ps(&op[j], \
-                                 _mm256_fmadd_ps(vwgt,_mm256_loadu_ps(&ip[j]), _mm256_loadu_ps(&op[j])) \
-                                   );")
-        elif InType == "float16":
-            code.append("_mm256_storeu_ps(&op[j], \
-                   _mm256_fmadd_ps(vwgt, \
-                     _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&ip[j]))), _mm256_loadu_ps(&op[j])) \
-                                   );")
-        elif InType == "uint8_t":
-            code.append("_mm256_storeu_ps(&op[j], \
-                   _mm256_fmadd_ps(vwgt, \
-                     _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(&ip[j])))), \
-                     _mm256_add_ps(_mm256_loadu_ps(&op[j]), vbio) ) \
-                                   );")
+        if InType == "uint8_t":
+            code.append("%s_storeu_ps(&op[j], %s_fmadd_ps(vwgt, %s, %s_add_ps(%s_loadu_ps(&op[j]), vbio)));"
+                        % (mm, mm, load_fp32(InType, isa, "&ip[j]"), mm, mm))
         else:
-            assert False
-
+            code.append("%s_storeu_ps(&op[j], %s_fmadd_ps(vwgt, %s, %s_loadu_ps(&op[j])));"
+                        % (mm, mm, load_fp32(InType, isa, "&ip[j]"), mm))
 
         code.append("_mm_prefetch((&ip_next_T0[j]), _MM_HINT_T0);")
 
@@ -168,8 +210,8 @@ def generic(IndexType, InType, OutType, use_weights, isa):
 
     # initialize to 0
     code.append("TIndex j = 0;")
-    code.append("for(; j + 8 <= block_size; j += 8) {")
-    code.append("_mm256_storeu_ps(op + j, _mm256_setzero_ps());")
+    code.append("for(; j + %d <= block_size; j += %d) {" % (width, width))
+    code.append("%s_storeu_ps(op + j, %s_setzero_ps());" % (mm, mm))
     code.append("}")
     code.append("for(; j < block_size; j++) {")
     code.append("op[j] = 0.0f;")
@@ -178,44 +220,15 @@ def generic(IndexType, InType, OutType, use_weights, isa):
     # inner loop
     code.append("for (" + IndexType +
                 " start = dataInd; dataInd < start + lengths[rangeIndex]; ++dataInd) {")
-    code.append("const  " + IndexType + " idx = indices[dataInd];")
-    code.append(
-        'CAFFE_ENFORCE(idx >=0 && idx < data_size, "Index ", dataInd, " is out of bounds: ", idx, ", range 0 to ", data_size);')
-
-    if InType == "uint8_t":
-        code.append(OutType + " wgt = 1.f;")
-        code.append(OutType + " bio;")
-        code.append("if (weights) {")
-        code.append("wgt = weights[dataInd];")
-        code.append("}")
-        code.append("assert (scale_bias);")
-        code.append("bio = wgt * scale_bias[2 * idx + 1];");
-        code.append("wgt = wgt * scale_bias[2 * idx];");
-        code.append("__m256 vbio = _mm256_set1_ps(bio);")
-    else:
-        code.append(OutType + " wgt = 1.f;")
-        code.append("if (weights) {")
-        code.append("wgt = weights[dataInd];")
-        code.append("}")
-    code.append("__m256 vwgt = _mm256_set1_ps(wgt);")
-
-    code.append("const  " + InType + " *ip = &input[idx * block_size];")
-    code.append("const  " + IndexType +
-                " next_T0 = (dataInd < index_size - prefdist_T0) ? (dataInd + prefdist_T0) : dataInd;");
-    code.append("const  " + IndexType + " idx_pref_T0 = indices[next_T0];")
-    code.append(
-        "CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);")
-    code.append("const  " + InType +
-                " *ip_next_T0 = &input[idx_pref_T0 * block_size];")
+    code.extend(row_setup(IndexType, InType, OutType, isa, fused, True))
 
     # compute and store main loop
     code.append("j = 0;")
-    code.append("for(; j + 8 <= block_size; j += 8) {")
+    code.append("for(; j + %d <= block_size; j += %d) {" % (width, width))
     code.extend(compute(InType, use_weights, isa))
     code.append("}")
     # leftover
     if InType == "float16":
-        #code.append("float16 vtmp1[8] __attribute__((aligned(64)));")
         code.append("float16 vtmp1[8] CAFFE2_ALIGNED(64);")
     code.append("for(; j < block_size; j++) {")
     if InType == "float":
@@ -235,11 +248,11 @@ def generic(IndexType, InType, OutType, use_weights, isa):
 
     code.append("if (normalize_by_lengths && lengths[rangeIndex]) {")
     code.append("float len_inv = 1.0f / lengths[rangeIndex];")
-    code.append("__m256 vlen_inv = _mm256_set1_ps(len_inv);")
+    code.append("%s vlen_inv = %s_set1_ps(len_inv);" % (vec, mm))
     code.append("j = 0;")
-    code.append("for(; j + 8 <= block_size; j += 8) {")
-    code.append(
-        "_mm256_storeu_ps(&op[j], _mm256_mul_ps(_mm256_loadu_ps(&op[j]), vlen_inv));")
+    code.append("for(; j + %d <= block_size; j += %d) {" % (width, width))
+    code.append("%s_storeu_ps(&op[j], %s_mul_ps(%s_loadu_ps(&op[j]), vlen_inv));"
+                % (mm, mm, mm))
     code.append("}")
     code.append("for(; j < block_size; j++) {")
     code.append("op[j] = len_inv * op[j];")
@@ -255,19 +268,34 @@ def generic(IndexType, InType, OutType, use_weights, isa):
 # start main code
 parser = argparse.ArgumentParser()
 parser.add_argument('-f', nargs=1, help="file name")
+parser.add_argument('--isa', default="avx2", choices=sorted(ISAS.keys()),
+                    help="instruction set to generate the kernels for")
+parser.add_argument('--fused', action="store_true",
+                    help="generate kernels for fused rowwise 8-bit rows, "
+                    "which keep the float scale and bias at the end of "
+                    "every row instead of in a separate scale_bias array")
 opts = parser.parse_args()
-filename = "embedding_lookup_avx2.cc"
+isa = opts.isa
+if opts.fused:
+    filename = "embedding_lookup_fused_8bit_rowwise_%s.cc" % isa
+else:
+    filename = "embedding_lookup_%s.cc" % isa
 if opts.f:
     filename = (opts.f)[0]
 fout = open(filename, 'w')
 
-options = [["int32_t", "float",   "float"],
-           ["int64_t", "float",   "float"],
-           ["int32_t", "float16", "float"],
-           ["int64_t", "float16", "float"],
-           ["int32_t", "uint8_t",  "float"],
-           ["int64_t", "uint8_t",  "float"],
-          ]
+if opts.fused:
+    options = [["int32_t", "uint8_t",  "float"],
+               ["int64_t", "uint8_t",  "float"],
+              ]
+else:
+    options = [["int32_t", "float",   "float"],
+               ["int64_t", "float",   "float"],
+               ["int32_t", "float16", "float"],
+               ["int64_t", "float16", "float"],
+               ["int32_t", "uint8_t",  "float"],
+               ["int64_t", "uint8_t",  "float"],
+              ]
 
 code = []
 # includes
@@ -304,8 +332,10 @@ code.append("namespace caffe2 {\n")
 for o in options:
     [IndexType, InType, OutType] = o
 
-    fn = "void EmbeddingLookup_" + IndexType + \
-        "_" + InType + "_" + OutType + "__avx2_fma"
+    prefix = "Fused8BitRowwiseEmbeddingLookup_" if opts.fused \
+        else "EmbeddingLookup_"
+    fn = "void " + prefix + IndexType + \
+        "_" + InType + "_" + OutType + ISAS[isa]["suffix"]
     code.append(fn + "(")
     code.append("const TIndex block_size,")
     code.append("const TIndex output_size,")
@@ -315,29 +345,33 @@ for o in options:
     code.append("const " + IndexType + "* indices,")
     code.append("const int* lengths,")
     code.append("const float* weights,")
-    code.append("const float* scale_bias,")
+    if not opts.fused:
+        code.append("const float* scale_bias,")
     code.append("bool normalize_by_lengths,")
     code.append(OutType + "* out)")
 
     code.append("{")
     code.append("const " + IndexType + " prefdist_T0 = 16;")
-    #code.append("printf(\"calling " + fn + "\\n\");");
-    if InType != "uint8_t":
+    if opts.fused:
+        # Every row stores block_size bytes followed by a float scale and a
+        # float bias.
+        code.append("const " + IndexType + " fused_block_size = block_size + 8;")
+    elif InType != "uint8_t":
         code.append("CAFFE_ENFORCE(scale_bias == nullptr, \"scale_bias must be nullptr\");");
     else:
         code.append("CAFFE_ENFORCE(scale_bias != nullptr, \"scale_bias must not be nullptr\");");
 
-    code.append("if (block_size == 128) {")
-    code.extend(unroll(16, IndexType, InType, OutType, True, "AVX2"))
-    code.append("} else if (block_size == 64) {")
-    code.extend(unroll(8, IndexType, InType, OutType, True, "AVX2"))
-    code.append("} else if (block_size == 32) {")
-    code.extend(unroll(4, IndexType, InType, OutType, True, "AVX2"))
-    code.append("} else if (block_size == 16) {")
-    code.extend(unroll(2, IndexType, InType, OutType, True, "AVX2"))
+    width = ISAS[isa]["width"]
+    for block_size in [128, 64, 32, 16]:
+        if block_size == 128:
+            code.append("if (block_size == 128) {")
+        else:
+            code.append("} else if (block_size == %d) {" % block_size)
+        code.extend(unroll(block_size // width, IndexType, InType, OutType,
+                           True, isa, opts.fused))
     code.append("} else {")
     code.append("// generic code")
-    code.extend(generic(IndexType, InType, OutType, True, "AVX2"))
+    code.extend(generic(IndexType, InType, OutType, True, isa, opts.fused))
     code.append("}")
 
 
@@ -0,0 +1,80 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "caffe2/perfkernels/packed_gemm.h"
+
+#include <algorithm>
+
+#include "caffe2/core/macros.h"
+#include "caffe2/perfkernels/common.h"
+#include "caffe2/utils/cpuid.h"
+
+namespace caffe2 {
+
+void PackGemmB(TIndex N, TIndex K, const float* W, float* packed) {
+  const int P = kPackedGemmPanelWidth;
+  for (TIndex n0 = 0; n0 < N; n0 += P) {
+    float* panel = packed + n0 * K;
+    for (TIndex k = 0; k < K; ++k) {
+      for (int j = 0; j < P; ++j) {
+        panel[k * P + j] = n0 + j < N ? W[(n0 + j) * K + k] : 0;
+      }
+    }
+  }
+}
+
+void PackedGemm__base(
+    TIndex M,
+    TIndex N,
+    TIndex K,
+    const float* A,
+    const float* packed,
+    const float* bias,
+    float* C) {
+  const int P = kPackedGemmPanelWidth;
+  for (TIndex n0 = 0; n0 < N; n0 += P) {
+    const float* panel = packed + n0 * K;
+    const int cols = std::min<TIndex>(P, N - n0);
+    for (TIndex m = 0; m < M; ++m) {
+      const float* a = A + m * K;
+      float acc[kPackedGemmPanelWidth] = {0};
+      for (TIndex k = 0; k < K; ++k) {
+        for (int j = 0; j < P; ++j) {
+          acc[j] += a[k] * panel[k * P + j];
+        }
+      }
+      float* c = C + m * N + n0;
+      for (int j = 0; j < cols; ++j) {
+        c[j] = bias ? acc[j] + bias[n0 + j] : acc[j];
+      }
+    }
+  }
+}
+
+void PackedGemm(
+    TIndex M,
+    TIndex N,
+    TIndex K,
+    const float* A,
+    const float* packed,
+    const float* bias,
+    float* C) {
+  AVX2_FMA_DO(PackedGemm, M, N, K, A, packed, bias, C);
+  BASE_DO(PackedGemm, M, N, K, A, packed, bias, C);
+}
+
+} // namespace caffe2
@@ -0,0 +1,52 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include "caffe2/core/common.h"
+
+namespace caffe2 {
+
+// Width of the panels of a matrix packed by PackGemmB: the eight floats of
+// an AVX register.
+constexpr int kPackedGemmPanelWidth = 8;
+
+// Number of floats of the packed form of an N x K weight matrix.
+inline TIndex PackedGemmBSize(TIndex N, TIndex K) {
+  return (N + kPackedGemmPanelWidth - 1) / kPackedGemmPanelWidth *
+      kPackedGemmPanelWidth * K;
+}
+
+// Packs the row-major N x K matrix W, i.e. B = W^T as used by FC, into
+// panels of kPackedGemmPanelWidth rows of W. Within a panel, the values
+// are stored column by column, so that the GEMM kernel reads every panel
+// sequentially. The last panel is padded with zeros.
+void PackGemmB(TIndex N, TIndex K, const float* W, float* packed);
+
+// Computes C = A * B + bias, where A is a row-major M x K matrix, B is given
+// by the output of PackGemmB, and C is a row-major M x N matrix. bias has N
+// elements and may be null.
+void PackedGemm(
+    TIndex M,
+    TIndex N,
+    TIndex K,
+    const float* A,
+    const float* packed,
+    const float* bias,
+    float* C);
+
+} // namespace caffe2
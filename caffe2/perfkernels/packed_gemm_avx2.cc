@@ -0,0 +1,158 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "caffe2/perfkernels/packed_gemm.h"
+
+#include <algorithm>
+
+#include <immintrin.h>
+
+namespace caffe2 {
+
+namespace {
+
+constexpr int kMaxRows = 4;
+constexpr int kMaxPanels = 2;
+
+// Computes a tile of kRows rows of C and kPanels panels of columns, keeping
+// the whole tile in registers across K. Tiles with few accumulators split
+// the K loop over several sets of them, so that enough independent FMAs are
+// in flight.
+template <int kRows, int kPanels>
+void PackedGemmTile(
+    TIndex N,
+    TIndex K,
+    int cols,
+    const float* A,
+    const float* panel,
+    const float* bias,
+    float* C) {
+  const int P = kPackedGemmPanelWidth;
+  constexpr int kSplit = kRows * kPanels >= 4 ? 1 : 4 / (kRows * kPanels);
+  __m256 acc[kSplit][kRows][kPanels];
+  for (int s = 0; s < kSplit; ++s) {
+    for (int r = 0; r < kRows; ++r) {
+      for (int p = 0; p < kPanels; ++p) {
+        acc[s][r][p] = _mm256_setzero_ps();
+      }
+    }
+  }
+  auto step = [&](int s, TIndex k) {
+    __m256 b[kPanels];
+    for (int p = 0; p < kPanels; ++p) {
+      b[p] = _mm256_loadu_ps(panel + p * K * P + k * P);
+    }
+    for (int r = 0; r < kRows; ++r) {
+      const __m256 a = _mm256_broadcast_ss(A + r * K + k);
+      for (int p = 0; p < kPanels; ++p) {
+        acc[s][r][p] = _mm256_fmadd_ps(a, b[p], acc[s][r][p]);
+      }
+    }
+  };
+  TIndex k = 0;
+  // Unrolled by hand, so that acc stays in registers. The indices are taken
+  // modulo kSplit only to keep the dead branches in bounds.
+  for (; k + kSplit <= K; k += kSplit) {
+    step(0, k);
+    if (kSplit > 1) {
+      step(1 % kSplit, k + 1);
+    }
+    if (kSplit > 2) {
+      step(2 % kSplit, k + 2);
+      step(3 % kSplit, k + 3);
+    }
+  }
+  for (; k < K; ++k) {
+    step(0, k);
+  }
+  for (int s = 1; s < kSplit; ++s) {
+    for (int r = 0; r < kRows; ++r) {
+      for (int p = 0; p < kPanels; ++p) {
+        acc[0][r][p] = _mm256_add_ps(acc[0][r][p], acc[s][r][p]);
+      }
+    }
+  }
+  for (int p = 0; p < kPanels; ++p) {
+    const int panelCols = std::min(P, cols - p * P);
+    __m256 bias_p = _mm256_setzero_ps();
+    if (bias) {
+      if (panelCols == P) {
+        bias_p = _mm256_loadu_ps(bias + p * P);
+      } else {
+        float tmp[kPackedGemmPanelWidth] = {0};
+        std::copy(bias + p * P, bias + p * P + panelCols, tmp);
+        bias_p = _mm256_loadu_ps(tmp);
+      }
+    }
+    for (int r = 0; r < kRows; ++r) {
+      const __m256 c = _mm256_add_ps(acc[0][r][p], bias_p);
+      float* out = C + r * N + p * P;
+      if (panelCols == P) {
+        _mm256_storeu_ps(out, c);
+      } else {
+        float tmp[kPackedGemmPanelWidth];
+        _mm256_storeu_ps(tmp, c);
+        std::copy(tmp, tmp + panelCols, out);
+      }
+    }
+  }
+}
+
+using PackedGemmTileFn = void (*)(
+    TIndex N,
+    TIndex K,
+    int cols,
+    const float* A,
+    const float* panel,
+    const float* bias,
+    float* C);
+
+// Indexed by [rows - 1][panels - 1].
+const PackedGemmTileFn kTiles[kMaxRows][kMaxPanels] = {
+    {PackedGemmTile<1, 1>, PackedGemmTile<1, 2>},
+    {PackedGemmTile<2, 1>, PackedGemmTile<2, 2>},
+    {PackedGemmTile<3, 1>, PackedGemmTile<3, 2>},
+    {PackedGemmTile<4, 1>, PackedGemmTile<4, 2>},
+};
+
+} // namespace
+
+void PackedGemm__avx2_fma(
+    TIndex M,
+    TIndex N,
+    TIndex K,
+    const float* A,
+    const float* packed,
+    const float* bias,
+    float* C) {
+  const int P = kPackedGemmPanelWidth;
+  // Tiles of a single panel read the packed matrix as one sequential
+  // stream, which is what bounds small batches.
+  const int maxPanels = M < 3 ? 1 : kMaxPanels;
+  for (TIndex n0 = 0; n0 < N; n0 += maxPanels * P) {
+    const int cols = std::min<TIndex>(maxPanels * P, N - n0);
+    const int panels = (cols + P - 1) / P;
+    const float* b = bias ? bias + n0 : nullptr;
+    for (TIndex m = 0; m < M; m += kMaxRows) {
+      const int rows = std::min<TIndex>(kMaxRows, M - m);
+      kTiles[rows - 1][panels - 1](
+          N, K, cols, A + m * K, packed + n0 * K, b, C + m * N + n0);
+    }
+  }
+}
+
+} // namespace caffe2
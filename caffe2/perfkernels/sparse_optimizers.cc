@@ -0,0 +1,581 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "caffe2/perfkernels/sparse_optimizers.h"
+
+#include <cmath>
+
+#include "caffe2/core/types.h"
+#include "caffe2/perfkernels/common.h"
+#include "caffe2/utils/cpuid.h"
+
+namespace caffe2 {
+
+namespace {
+
+template <typename SIndex>
+TIndex SparseAdagradGeneric(
+    const TIndex num_indices,
+    const TIndex block_size,
+    const TIndex num_rows,
+    const TIndex row_begin,
+    const TIndex row_end,
+    const SIndex* indices,
+    const float* grad,
+    const float* param,
+    const float* moment,
+    float* param_out,
+    float* moment_out,
+    float epsilon,
+    float lr) {
+  for (TIndex i = 0; i < num_indices; ++i) {
+    const TIndex idx = indices[i];
+    if (idx < 0 || idx >= num_rows) {
+      return i;
+    }
+    if (idx < row_begin || idx >= row_end) {
+      continue;
+    }
+    const float* g = grad + i * block_size;
+    const TIndex offset = idx * block_size;
+    for (TIndex j = 0; j < block_size; ++j) {
+      const float gj = g[j];
+      const float hj = moment_out[offset + j] = moment[offset + j] + gj * gj;
+      param_out[offset + j] =
+          param[offset + j] + lr * gj / (std::sqrt(hj) + epsilon);
+    }
+  }
+  return num_indices;
+}
+
+template <typename SIndex>
+TIndex RowWiseSparseAdagradGeneric(
+    const TIndex num_indices,
+    const TIndex block_size,
+    const TIndex num_rows,
+    const TIndex row_begin,
+    const TIndex row_end,
+    const SIndex* indices,
+    const float* grad,
+    const float* param,
+    const float* moment,
+    float* param_out,
+    float* moment_out,
+    float epsilon,
+    float lr) {
+  for (TIndex i = 0; i < num_indices; ++i) {
+    const TIndex idx = indices[i];
+    if (idx < 0 || idx >= num_rows) {
+      return i;
+    }
+    if (idx < row_begin || idx >= row_end) {
+      continue;
+    }
+    const float* g = grad + i * block_size;
+    const TIndex offset = idx * block_size;
+    float hs = 0;
+    for (TIndex j = 0; j < block_size; ++j) {
+      hs += g[j] * g[j];
+    }
+    const float hi = moment_out[idx] = moment[idx] + hs / block_size;
+    const float step = lr / (std::sqrt(hi) + epsilon);
+    for (TIndex j = 0; j < block_size; ++j) {
+      param_out[offset + j] = param[offset + j] + g[j] * step;
+    }
+  }
+  return num_indices;
+}
+
+template <typename SIndex>
+TIndex SparseAdamGeneric(
+    const TIndex num_indices,
+    const TIndex block_size,
+    const TIndex num_rows,
+    const TIndex row_begin,
+    const TIndex row_end,
+    const SIndex* indices,
+    const float* grad,
+    const float* param,
+    const float* moment1,
+    const float* moment2,
+    float* param_out,
+    float* moment1_out,
+    float* moment2_out,
+    float beta1,
+    float beta2,
+    float epsilon,
+    float lr) {
+  for (TIndex i = 0; i < num_indices; ++i) {
+    const TIndex idx = indices[i];
+    if (idx < 0 || idx >= num_rows) {
+      return i;
+    }
+    if (idx < row_begin || idx >= row_end) {
+      continue;
+    }
+    const float* g = grad + i * block_size;
+    const TIndex offset = idx * block_size;
+    for (TIndex j = 0; j < block_size; ++j) {
+      const float gj = g[j];
+      const float mj = moment1_out[offset + j] =
+          moment1[offset + j] * beta1 + gj * (1 - beta1);
+      const float vj = moment2_out[offset + j] =
+          moment2[offset + j] * beta2 + gj * gj * (1 - beta2);
+      param_out[offset + j] =
+          param[offset + j] + lr * mj / (std::sqrt(vj) + epsilon);
+    }
+  }
+  return num_indices;
+}
+
+template <typename SIndex>
+TIndex SparseFtrlGeneric(
+    const TIndex num_indices,
+    const TIndex block_size,
+    const TIndex num_rows,
+    const TIndex row_begin,
+    const TIndex row_end,
+    const SIndex* indices,
+    const float* grad,
+    const float* param,
+    const float* n_z,
+    float* param_out,
+    float* n_z_out,
+    float alpha_inv,
+    float beta,
+    float lambda1,
+    float lambda2) {
+  for (TIndex i = 0; i < num_indices; ++i) {
+    const TIndex idx = indices[i];
+    if (idx < 0 || idx >= num_rows) {
+      return i;
+    }
+    if (idx < row_begin || idx >= row_end) {
+      continue;
+    }
+    const float* g = grad + i * block_size;
+    const TIndex offset = idx * block_size;
+    for (TIndex j = 0; j < block_size; ++j) {
+      const float gj = g[j];
+      const float n = n_z[2 * (offset + j)];
+      const float z = n_z[2 * (offset + j) + 1];
+      const float new_n = n + gj * gj;
+      const float sigma = (std::sqrt(new_n) - std::sqrt(n)) * alpha_inv;
+      const float new_z = z + gj - sigma * param[offset + j];
+      n_z_out[2 * (offset + j)] = new_n;
+      n_z_out[2 * (offset + j) + 1] = new_z;
+      if (std::abs(new_z) > lambda1) {
+        const float sign = new_z < 0 ? -1.0f : 1.0f;
+        param_out[offset + j] = (lambda1 * sign - new_z) /
+            ((beta + std::sqrt(new_n)) * alpha_inv + lambda2);
+      } else {
+        param_out[offset + j] = 0;
+      }
+    }
+  }
+  return num_indices;
+}
+
+} // namespace
+
+#define SPARSE_OPTIMIZERS_SPECIALIZATION(SIndex) \
+  TIndex SparseAdagrad_##SIndex##__base(         \
+      const TIndex num_indices,                  \
+      const TIndex block_size,                   \
+      const TIndex num_rows,                     \
+      const TIndex row_begin,                    \
+      const TIndex row_end,                      \
+      const SIndex* indices,                     \
+      const float* grad,                         \
+      const float* param,                        \
+      const float* moment,                       \
+      float* param_out,                          \
+      float* moment_out,                         \
+      float epsilon,                             \
+      float lr) {                                \
+    return SparseAdagradGeneric<SIndex>(         \
+        num_indices,                             \
+        block_size,                              \
+        num_rows,                                \
+        row_begin,                               \
+        row_end,                                 \
+        indices,                                 \
+        grad,                                    \
+        param,                                   \
+        moment,                                  \
+        param_out,                               \
+        moment_out,                              \
+        epsilon,                                 \
+        lr);                                     \
+  }                                              \
+  template <>                                    \
+  TIndex SparseAdagrad<SIndex>(                  \
+      const TIndex num_indices,                  \
+      const TIndex block_size,                   \
+      const TIndex num_rows,                     \
+      const TIndex row_begin,                    \
+      const TIndex row_end,                      \
+      const SIndex* indices,                     \
+      const float* grad,                         \
+      const float* param,                        \
+      const float* moment,                       \
+      float* param_out,                          \
+      float* moment_out,                         \
+      float epsilon,                             \
+      float lr) {                                \
+    AVX512_DO(                                   \
+        SparseAdagrad_##SIndex,                  \
+        num_indices,                             \
+        block_size,                              \
+        num_rows,                                \
+        row_begin,                               \
+        row_end,                                 \
+        indices,                                 \
+        grad,                                    \
+        param,                                   \
+        moment,                                  \
+        param_out,                               \
+        moment_out,                              \
+        epsilon,                                 \
+        lr);                                     \
+    AVX2_FMA_DO(                                 \
+        SparseAdagrad_##SIndex,                  \
+        num_indices,                             \
+        block_size,                              \
+        num_rows,                                \
+        row_begin,                               \
+        row_end,                                 \
+        indices,                                 \
+        grad,                                    \
+        param,                                   \
+        moment,                                  \
+        param_out,                               \
+        moment_out,                              \
+        epsilon,                                 \
+        lr);                                     \
+    BASE_DO(                                     \
+        SparseAdagrad_##SIndex,                  \
+        num_indices,                             \
+        block_size,                              \
+        num_rows,                                \
+        row_begin,                               \
+        row_end,                                 \
+        indices,                                 \
+        grad,                                    \
+        param,                                   \
+        moment,                                  \
+        param_out,                               \
+        moment_out,                              \
+        epsilon,                                 \
+        lr);                                     \
+  }                                              \
+  TIndex RowWiseSparseAdagrad_##SIndex##__base(  \
+      const TIndex num_indices,                  \
+      const TIndex block_size,                   \
+      const TIndex num_rows,                     \
+      const TIndex row_begin,                    \
+      const TIndex row_end,                      \
+      const SIndex* indices,                     \
+      const float* grad,                         \
+      const float* param,                        \
+      const float* moment,                       \
+      float* param_out,                          \
+      float* moment_out,                         \
+      float epsilon,                             \
+      float lr) {                                \
+    return RowWiseSparseAdagradGeneric<SIndex>(  \
+        num_indices,                             \
+        block_size,                              \
+        num_rows,                                \
+        row_begin,                               \
+        row_end,                                 \
+        indices,                                 \
+        grad,                                    \
+        param,                                   \
+        moment,                                  \
+        param_out,                               \
+        moment_out,                              \
+        epsilon,                                 \
+        lr);                                     \
+  }                                              \
+  template <>                                    \
+  TIndex RowWiseSparseAdagrad<SIndex>(           \
+      const TIndex num_indices,                  \
+      const TIndex block_size,                   \
+      const TIndex num_rows,                     \
+      const TIndex row_begin,                    \
+      const TIndex row_end,                      \
+      const SIndex* indices,                     \
+      const float* grad,                         \
+      const float* param,                        \
+      const float* moment,                       \
+      float* param_out,                          \
+      float* moment_out,                         \
+      float epsilon,                             \
+      float lr) {                                \
+    AVX512_DO(                                   \
+        RowWiseSparseAdagrad_##SIndex,           \
+        num_indices,                             \
+        block_size,                              \
+        num_rows,                                \
+        row_begin,                               \
+        row_end,                                 \
+        indices,                                 \
+        grad,                                    \
+        param,                                   \
+        moment,                                  \
+        param_out,                               \
+        moment_out,                              \
+        epsilon,                                 \
+        lr);                                     \
+    AVX2_FMA_DO(                                 \
+        RowWiseSparseAdagrad_##SIndex,           \
+        num_indices,                             \
+        block_size,                              \
+        num_rows,                                \
+        row_begin,                               \
+        row_end,                                 \
+        indices,                                 \
+        grad,                                    \
+        param,                                   \
+        moment,                                  \
+        param_out,                               \
+        moment_out,                              \
+        epsilon,                                 \
+        lr);                                     \
+    BASE_DO(                                     \
+        RowWiseSparseAdagrad_##SIndex,           \
+        num_indices,                             \
+        block_size,                              \
+        num_rows,                                \
+        row_begin,                               \
+        row_end,                                 \
+        indices,                                 \
+        grad,                                    \
+        param,                                   \
+        moment,                                  \
+        param_out,                               \
+        moment_out,                              \
+        epsilon,                                 \
+        lr);                                     \
+  }                                              \
+  TIndex SparseAdam_##SIndex##__base(            \
+      const TIndex num_indices,                  \
+      const TIndex block_size,                   \
+      const TIndex num_rows,                     \
+      const TIndex row_begin,                    \
+      const TIndex row_end,                      \
+      const SIndex* indices,                     \
+      const float* grad,                         \
+      const float* param,                        \
+      const float* moment1,                      \
+      const float* moment2,                      \
+      float* param_out,                          \
+      float* moment1_out,                        \
+      float* moment2_out,                        \
+      float beta1,                               \
+      float beta2,                               \
+      float epsilon,                             \
+      float lr) {                                \
+    return SparseAdamGeneric<SIndex>(            \
+        num_indices,                             \
+        block_size,                              \
+        num_rows,                                \
+        row_begin,                               \
+        row_end,                                 \
+        indices,                                 \
+        grad,                                    \
+        param,                                   \
+        moment1,                                 \
+        moment2,                                 \
+        param_out,                               \
+        moment1_out,                             \
+        moment2_out,                             \
+        beta1,                                   \
+        beta2,                                   \
+        epsilon,                                 \
+        lr);                                     \
+  }                                              \
+  template <>                                    \
+  TIndex SparseAdam<SIndex>(                     \
+      const TIndex num_indices,                  \
+      const TIndex block_size,                   \
+      const TIndex num_rows,                     \
+      const TIndex row_begin,                    \
+      const TIndex row_end,                      \
+      const SIndex* indices,                     \
+      const float* grad,                         \
+      const float* param,                        \
+      const float* moment1,                      \
+      const float* moment2,                      \
+      float* param_out,                          \
+      float* moment1_out,                        \
+      float* moment2_out,                        \
+      float beta1,                               \
+      float beta2,                               \
+      float epsilon,                             \
+      float lr) {                                \
+    AVX512_DO(                                   \
+        SparseAdam_##SIndex,                     \
+        num_indices,                             \
+        block_size,                              \
+        num_rows,                                \
+        row_begin,                               \
+        row_end,                                 \
+        indices,                                 \
+        grad,                                    \
+        param,                                   \
+        moment1,                                 \
+        moment2,                                 \
+        param_out,                               \
+        moment1_out,                             \
+        moment2_out,                             \
+        beta1,                                   \
+        beta2,                                   \
+        epsilon,                                 \
+        lr);                                     \
+    AVX2_FMA_DO(                                 \
+        SparseAdam_##SIndex,                     \
+        num_indices,                             \
+        block_size,                              \
+        num_rows,                                \
+        row_begin,                               \
+        row_end,                                 \
+        indices,                                 \
+        grad,                                    \
+        param,                                   \
+        moment1,                                 \
+        moment2,                                 \
+        param_out,                               \
+        moment1_out,                             \
+        moment2_out,                             \
+        beta1,                                   \
+        beta2,                                   \
+        epsilon,                                 \
+        lr);                                     \
+    BASE_DO(                                     \
+        SparseAdam_##SIndex,                     \
+        num_indices,                             \
+        block_size,                              \
+        num_rows,                                \
+        row_begin,                               \
+        row_end,                                 \
+        indices,                                 \
+        grad,                                    \
+        param,                                   \
+        moment1,                                 \
+        moment2,                                 \
+        param_out,                               \
+        moment1_out,                             \
+        moment2_out,                             \
+        beta1,                                   \
+        beta2,                                   \
+        epsilon,                                 \
+        lr);                                     \
+  }                                              \
+  TIndex SparseFtrl_##SIndex##__base(            \
+      const TIndex num_indices,                  \
+      const TIndex block_size,                   \
+      const TIndex num_rows,                     \
+      const TIndex row_begin,                    \
+      const TIndex row_end,                      \
+      const SIndex* indices,                     \
+      const float* grad,                         \
+      const float* param,                        \
+      const float* n_z,                          \
+      float* param_out,                          \
+      float* n_z_out,                            \
+      float alpha_inv,                           \
+      float beta,                                \
+      float lambda1,                             \
+      float lambda2) {                           \
+    return SparseFtrlGeneric<SIndex>(            \
+        num_indices,                             \
+        block_size,                              \
+        num_rows,                                \
+        row_begin,                               \
+        row_end,                                 \
+        indices,                                 \
+        grad,                                    \
+        param,                                   \
+        n_z,                                     \
+        param_out,                               \
+        n_z_out,                                 \
+        alpha_inv,                               \
+        beta,                                    \
+        lambda1,                                 \
+        lambda2);                                \
+  }                                              \
+  template <>                                    \
+  TIndex SparseFtrl<SIndex>(                     \
+      const TIndex num_indices,                  \
+      const TIndex block_size,                   \
+      const TIndex num_rows,                     \
+      const TIndex row_begin,                    \
+      const TIndex row_end,                      \
+      const SIndex* indices,                     \
+      const float* grad,                         \
+      const float* param,                        \
+      const float* n_z,                          \
+      float* param_out,                          \
+      float* n_z_out,                            \
+      float alpha_inv,                           \
+      float beta,                                \
+      float lambda1,                             \
+      float lambda2) {                           \
+    AVX2_FMA_DO(                                 \
+        SparseFtrl_##SIndex,                     \
+        num_indices,                             \
+        block_size,                              \
+        num_rows,                                \
+        row_begin,                               \
+        row_end,                                 \
+        indices,                                 \
+        grad,                                    \
+        param,                                   \
+        n_z,                                     \
+        param_out,                               \
+        n_z_out,                                 \
+        alpha_inv,                               \
+        beta,                                    \
+        lambda1,                                 \
+        lambda2);                                \
+    BASE_DO(                                     \
+        SparseFtrl_##SIndex,                     \
+        num_indices,                             \
+        block_size,                              \
+        num_rows,                                \
+        row_begin,                               \
+        row_end,                                 \
+        indices,                                 \
+        grad,                                    \
+        param,                                   \
+        n_z,                                     \
+        param_out,                               \
+        n_z_out,                                 \
+        alpha_inv,                               \
+        beta,                                    \
+        lambda1,                                 \
+        lambda2);                                \
+  }
+
+SPARSE_OPTIMIZERS_SPECIALIZATION(int32_t);
+SPARSE_OPTIMIZERS_SPECIALIZATION(int64_t);
+
+#undef SPARSE_OPTIMIZERS_SPECIALIZATION
+
+} // namespace caffe2
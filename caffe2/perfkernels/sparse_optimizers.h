@@ -0,0 +1,127 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include "caffe2/core/common.h"
+
+namespace caffe2 {
+
+/**
+ * Fused gradient and update kernels of the sparse optimizers.
+ *
+ * Every kernel applies the update of indices[0], ..., indices[num_indices - 1]
+ * in order to a parameter of num_rows rows of block_size floats. Row i of
+ * `grad` is the gradient of row indices[i]. Only rows in [row_begin, row_end)
+ * are updated and the other ones are skipped, so disjoint row ranges can be
+ * updated by concurrent threads with the same result as a single pass over
+ * [0, num_rows), duplicate indices included. The outputs may alias the
+ * inputs. The rows of upcoming indices are prefetched.
+ *
+ * The kernels return num_indices, or the position of the first index that
+ * is outside [0, num_rows), in which case that index and the following ones
+ * are not applied.
+ */
+
+// Adagrad, with one moment per parameter:
+//   moment += g^2
+//   param += lr * g / (sqrt(moment) + epsilon)
+template <typename SIndex>
+TIndex SparseAdagrad(
+    const TIndex num_indices,
+    const TIndex block_size,
+    const TIndex num_rows,
+    const TIndex row_begin,
+    const TIndex row_end,
+    const SIndex* indices,
+    const float* grad,
+    const float* param,
+    const float* moment,
+    float* param_out,
+    float* moment_out,
+    float epsilon,
+    float lr);
+
+// Adagrad with one moment per row:
+//   moment[row] += mean(g^2)
+//   param += lr * g / (sqrt(moment[row]) + epsilon)
+template <typename SIndex>
+TIndex RowWiseSparseAdagrad(
+    const TIndex num_indices,
+    const TIndex block_size,
+    const TIndex num_rows,
+    const TIndex row_begin,
+    const TIndex row_end,
+    const SIndex* indices,
+    const float* grad,
+    const float* param,
+    const float* moment,
+    float* param_out,
+    float* moment_out,
+    float epsilon,
+    float lr);
+
+// Adam, with the bias correction folded into lr:
+//   moment1 = beta1 * moment1 + (1 - beta1) * g
+//   moment2 = beta2 * moment2 + (1 - beta2) * g^2
+//   param += lr * moment1 / (sqrt(moment2) + epsilon)
+template <typename SIndex>
+TIndex SparseAdam(
+    const TIndex num_indices,
+    const TIndex block_size,
+    const TIndex num_rows,
+    const TIndex row_begin,
+    const TIndex row_end,
+    const SIndex* indices,
+    const float* grad,
+    const float* param,
+    const float* moment1,
+    const float* moment2,
+    float* param_out,
+    float* moment1_out,
+    float* moment2_out,
+    float beta1,
+    float beta2,
+    float epsilon,
+    float lr);
+
+// FTRL-proximal. n_z holds the accumulators n and z of every parameter
+// interleaved, i.e. rows of 2 * block_size floats:
+//   n' = n + g^2
+//   z += g - (sqrt(n') - sqrt(n)) * alpha_inv * param
+//   param = |z| > lambda1
+//       ? (lambda1 * sign(z) - z) / ((beta + sqrt(n')) * alpha_inv + lambda2)
+//       : 0
+template <typename SIndex>
+TIndex SparseFtrl(
+    const TIndex num_indices,
+    const TIndex block_size,
+    const TIndex num_rows,
+    const TIndex row_begin,
+    const TIndex row_end,
+    const SIndex* indices,
+    const float* grad,
+    const float* param,
+    const float* n_z,
+    float* param_out,
+    float* n_z_out,
+    float alpha_inv,
+    float beta,
+    float lambda1,
+    float lambda2);
+
+} // namespace caffe2
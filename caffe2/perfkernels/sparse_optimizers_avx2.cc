@@ -0,0 +1,535 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "caffe2/perfkernels/sparse_optimizers.h"
+
+#include <cmath>
+
+#include <immintrin.h>
+
+namespace caffe2 {
+
+namespace {
+
+// Number of indices ahead whose rows are prefetched.
+constexpr TIndex kPrefetchDistance = 16;
+
+// Prefetches every cache line of row `idx` of `data`.
+inline void PrefetchRow(const float* data, TIndex idx, TIndex row_size) {
+  const char* row = reinterpret_cast<const char*>(data + idx * row_size);
+  const TIndex bytes = row_size * sizeof(float);
+  for (TIndex b = 0; b < bytes; b += 64) {
+    _mm_prefetch(row + b, _MM_HINT_T0);
+  }
+}
+
+// Returns the row of the index kPrefetchDistance positions after i if it is
+// updated by this shard, and -1 otherwise.
+template <typename SIndex>
+inline TIndex RowToPrefetch(
+    const SIndex* indices,
+    TIndex i,
+    TIndex num_indices,
+    TIndex row_begin,
+    TIndex row_end) {
+  if (i + kPrefetchDistance >= num_indices) {
+    return -1;
+  }
+  const TIndex next = indices[i + kPrefetchDistance];
+  return next >= row_begin && next < row_end ? next : -1;
+}
+
+// Mask of the first n (< 8) lanes.
+inline __m256i TailMask(TIndex n) {
+  return _mm256_cmpgt_epi32(
+      _mm256_set1_epi32(n), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+}
+
+inline float HorizontalSum(__m256 v) {
+  __m128 s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+  s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+  s = _mm_add_ss(s, _mm_movehdup_ps(s));
+  return _mm_cvtss_f32(s);
+}
+
+template <typename SIndex>
+TIndex SparseAdagradImpl(
+    const TIndex num_indices,
+    const TIndex block_size,
+    const TIndex num_rows,
+    const TIndex row_begin,
+    const TIndex row_end,
+    const SIndex* indices,
+    const float* grad,
+    const float* param,
+    const float* moment,
+    float* param_out,
+    float* moment_out,
+    float epsilon,
+    float lr) {
+  const __m256 eps = _mm256_set1_ps(epsilon);
+  const __m256 rate = _mm256_set1_ps(lr);
+  auto update = [&](const float* g,
+                    const float* w,
+                    const float* h,
+                    float* nw,
+                    float* nh,
+                    __m256i mask,
+                    bool full) {
+    const __m256 gj = full ? _mm256_loadu_ps(g) : _mm256_maskload_ps(g, mask);
+    const __m256 hj0 =
+        full ? _mm256_loadu_ps(h) : _mm256_maskload_ps(h, mask);
+    const __m256 wj = full ? _mm256_loadu_ps(w) : _mm256_maskload_ps(w, mask);
+    const __m256 hj = _mm256_fmadd_ps(gj, gj, hj0);
+    const __m256 nwj = _mm256_add_ps(
+        wj,
+        _mm256_div_ps(
+            _mm256_mul_ps(rate, gj), _mm256_add_ps(_mm256_sqrt_ps(hj), eps)));
+    if (full) {
+      _mm256_storeu_ps(nh, hj);
+      _mm256_storeu_ps(nw, nwj);
+    } else {
+      _mm256_maskstore_ps(nh, mask, hj);
+      _mm256_maskstore_ps(nw, mask, nwj);
+    }
+  };
+  const __m256i tail = TailMask(block_size % 8);
+  for (TIndex i = 0; i < num_indices; ++i) {
+    const TIndex idx = indices[i];
+    if (idx < 0 || idx >= num_rows) {
+      return i;
+    }
+    if (idx < row_begin || idx >= row_end) {
+      continue;
+    }
+    const TIndex next =
+        RowToPrefetch(indices, i, num_indices, row_begin, row_end);
+    if (next >= 0) {
+      PrefetchRow(param, next, block_size);
+      PrefetchRow(moment, next, block_size);
+    }
+    const float* g = grad + i * block_size;
+    const TIndex offset = idx * block_size;
+    TIndex j = 0;
+    for (; j + 8 <= block_size; j += 8) {
+      update(
+          g + j,
+          param + offset + j,
+          moment + offset + j,
+          param_out + offset + j,
+          moment_out + offset + j,
+          tail,
+          true);
+    }
+    if (j < block_size) {
+      update(
+          g + j,
+          param + offset + j,
+          moment + offset + j,
+          param_out + offset + j,
+          moment_out + offset + j,
+          tail,
+          false);
+    }
+  }
+  return num_indices;
+}
+
+template <typename SIndex>
+TIndex RowWiseSparseAdagradImpl(
+    const TIndex num_indices,
+    const TIndex block_size,
+    const TIndex num_rows,
+    const TIndex row_begin,
+    const TIndex row_end,
+    const SIndex* indices,
+    const float* grad,
+    const float* param,
+    const float* moment,
+    float* param_out,
+    float* moment_out,
+    float epsilon,
+    float lr) {
+  const __m256i tail = TailMask(block_size % 8);
+  for (TIndex i = 0; i < num_indices; ++i) {
+    const TIndex idx = indices[i];
+    if (idx < 0 || idx >= num_rows) {
+      return i;
+    }
+    if (idx < row_begin || idx >= row_end) {
+      continue;
+    }
+    const TIndex next =
+        RowToPrefetch(indices, i, num_indices, row_begin, row_end);
+    if (next >= 0) {
+      PrefetchRow(param, next, block_size);
+      _mm_prefetch(
+          reinterpret_cast<const char*>(moment + next), _MM_HINT_T0);
+    }
+    const float* g = grad + i * block_size;
+    const TIndex offset = idx * block_size;
+    __m256 acc = _mm256_setzero_ps();
+    TIndex j = 0;
+    for (; j + 8 <= block_size; j += 8) {
+      const __m256 gj = _mm256_loadu_ps(g + j);
+      acc = _mm256_fmadd_ps(gj, gj, acc);
+    }
+    if (j < block_size) {
+      const __m256 gj = _mm256_maskload_ps(g + j, tail);
+      acc = _mm256_fmadd_ps(gj, gj, acc);
+    }
+    const float hi = moment_out[idx] =
+        moment[idx] + HorizontalSum(acc) / block_size;
+    const __m256 step = _mm256_set1_ps(lr / (std::sqrt(hi) + epsilon));
+    j = 0;
+    for (; j + 8 <= block_size; j += 8) {
+      _mm256_storeu_ps(
+          param_out + offset + j,
+          _mm256_fmadd_ps(
+              _mm256_loadu_ps(g + j),
+              step,
+              _mm256_loadu_ps(param + offset + j)));
+    }
+    if (j < block_size) {
+      _mm256_maskstore_ps(
+          param_out + offset + j,
+          tail,
+          _mm256_fmadd_ps(
+              _mm256_maskload_ps(g + j, tail),
+              step,
+              _mm256_maskload_ps(param + offset + j, tail)));
+    }
+  }
+  return num_indices;
+}
+
+template <typename SIndex>
+TIndex SparseAdamImpl(
+    const TIndex num_indices,
+    const TIndex block_size,
+    const TIndex num_rows,
+    const TIndex row_begin,
+    const TIndex row_end,
+    const SIndex* indices,
+    const float* grad,
+    const float* param,
+    const float* moment1,
+    const float* moment2,
+    float* param_out,
+    float* moment1_out,
+    float* moment2_out,
+    float beta1,
+    float beta2,
+    float epsilon,
+    float lr) {
+  const __m256 b1 = _mm256_set1_ps(beta1);
+  const __m256 b2 = _mm256_set1_ps(beta2);
+  const __m256 one_minus_b1 = _mm256_set1_ps(1 - beta1);
+  const __m256 one_minus_b2 = _mm256_set1_ps(1 - beta2);
+  const __m256 eps = _mm256_set1_ps(epsilon);
+  const __m256 rate = _mm256_set1_ps(lr);
+  auto update = [&](TIndex gi, TIndex pi, __m256i mask, bool full) {
+    auto load = [&](const float* p) {
+      return full ? _mm256_loadu_ps(p) : _mm256_maskload_ps(p, mask);
+    };
+    auto store = [&](float* p, __m256 v) {
+      if (full) {
+        _mm256_storeu_ps(p, v);
+      } else {
+        _mm256_maskstore_ps(p, mask, v);
+      }
+    };
+    const __m256 g = load(grad + gi);
+    const __m256 m = _mm256_fmadd_ps(
+        g, one_minus_b1, _mm256_mul_ps(load(moment1 + pi), b1));
+    const __m256 v = _mm256_fmadd_ps(
+        _mm256_mul_ps(g, g),
+        one_minus_b2,
+        _mm256_mul_ps(load(moment2 + pi), b2));
+    const __m256 w = _mm256_add_ps(
+        load(param + pi),
+        _mm256_div_ps(
+            _mm256_mul_ps(rate, m), _mm256_add_ps(_mm256_sqrt_ps(v), eps)));
+    store(moment1_out + pi, m);
+    store(moment2_out + pi, v);
+    store(param_out + pi, w);
+  };
+  const __m256i tail = TailMask(block_size % 8);
+  for (TIndex i = 0; i < num_indices; ++i) {
+    const TIndex idx = indices[i];
+    if (idx < 0 || idx >= num_rows) {
+      return i;
+    }
+    if (idx < row_begin || idx >= row_end) {
+      continue;
+    }
+    const TIndex next =
+        RowToPrefetch(indices, i, num_indices, row_begin, row_end);
+    if (next >= 0) {
+      PrefetchRow(param, next, block_size);
+      PrefetchRow(moment1, next, block_size);
+      PrefetchRow(moment2, next, block_size);
+    }
+    TIndex j = 0;
+    for (; j + 8 <= block_size; j += 8) {
+      update(i * block_size + j, idx * block_size + j, tail, true);
+    }
+    if (j < block_size) {
+      update(i * block_size + j, idx * block_size + j, tail, false);
+    }
+  }
+  return num_indices;
+}
+
+template <typename SIndex>
+TIndex SparseFtrlImpl(
+    const TIndex num_indices,
+    const TIndex block_size,
+    const TIndex num_rows,
+    const TIndex row_begin,
+    const TIndex row_end,
+    const SIndex* indices,
+    const float* grad,
+    const float* param,
+    const float* n_z,
+    float* param_out,
+    float* n_z_out,
+    float alpha_inv,
+    float beta,
+    float lambda1,
+    float lambda2) {
+  const __m256 alpha_inv_v = _mm256_set1_ps(alpha_inv);
+  const __m256 beta_v = _mm256_set1_ps(beta);
+  const __m256 lambda1_v = _mm256_set1_ps(lambda1);
+  const __m256 lambda2_v = _mm256_set1_ps(lambda2);
+  const __m256 sign_mask = _mm256_set1_ps(-0.0f);
+  for (TIndex i = 0; i < num_indices; ++i) {
+    const TIndex idx = indices[i];
+    if (idx < 0 || idx >= num_rows) {
+      return i;
+    }
+    if (idx < row_begin || idx >= row_end) {
+      continue;
+    }
+    const TIndex next =
+        RowToPrefetch(indices, i, num_indices, row_begin, row_end);
+    if (next >= 0) {
+      PrefetchRow(param, next, block_size);
+      PrefetchRow(n_z, next, 2 * block_size);
+    }
+    const float* g = grad + i * block_size;
+    const TIndex offset = idx * block_size;
+    TIndex j = 0;
+    for (; j + 8 <= block_size; j += 8) {
+      const float* nz = n_z + 2 * (offset + j);
+      // De-interleave the (n, z) pairs of 8 parameters.
+      const __m256 lo = _mm256_loadu_ps(nz);
+      const __m256 hi = _mm256_loadu_ps(nz + 8);
+      const __m256 n = _mm256_castpd_ps(_mm256_permute4x64_pd(
+          _mm256_castps_pd(_mm256_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0))),
+          _MM_SHUFFLE(3, 1, 2, 0)));
+      const __m256 z = _mm256_castpd_ps(_mm256_permute4x64_pd(
+          _mm256_castps_pd(_mm256_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1))),
+          _MM_SHUFFLE(3, 1, 2, 0)));
+      const __m256 gj = _mm256_loadu_ps(g + j);
+      const __m256 wj = _mm256_loadu_ps(param + offset + j);
+
+      const __m256 new_n = _mm256_fmadd_ps(gj, gj, n);
+      const __m256 sqrt_new_n = _mm256_sqrt_ps(new_n);
+      const __m256 sigma = _mm256_mul_ps(
+          _mm256_sub_ps(sqrt_new_n, _mm256_sqrt_ps(n)), alpha_inv_v);
+      const __m256 new_z =
+          _mm256_fnmadd_ps(sigma, wj, _mm256_add_ps(z, gj));
+      // lambda1 * sign(z) - z, over (beta + sqrt(n)) * alpha_inv + lambda2,
+      // where |z| > lambda1, and 0 elsewhere.
+      const __m256 signed_lambda1 = _mm256_or_ps(
+          _mm256_and_ps(new_z, sign_mask), lambda1_v);
+      const __m256 new_w = _mm256_div_ps(
+          _mm256_sub_ps(signed_lambda1, new_z),
+          _mm256_fmadd_ps(
+              _mm256_add_ps(beta_v, sqrt_new_n), alpha_inv_v, lambda2_v));
+      const __m256 active = _mm256_cmp_ps(
+          _mm256_andnot_ps(sign_mask, new_z), lambda1_v, _CMP_GT_OQ);
+      _mm256_storeu_ps(param_out + offset + j, _mm256_and_ps(active, new_w));
+
+      // Interleave the new pairs again.
+      const __m256 n_z_lo = _mm256_unpacklo_ps(new_n, new_z);
+      const __m256 n_z_hi = _mm256_unpackhi_ps(new_n, new_z);
+      float* nz_out = n_z_out + 2 * (offset + j);
+      _mm256_storeu_ps(nz_out, _mm256_permute2f128_ps(n_z_lo, n_z_hi, 0x20));
+      _mm256_storeu_ps(
+          nz_out + 8, _mm256_permute2f128_ps(n_z_lo, n_z_hi, 0x31));
+    }
+    for (; j < block_size; ++j) {
+      const float gj = g[j];
+      const float n = n_z[2 * (offset + j)];
+      const float z = n_z[2 * (offset + j) + 1];
+      const float new_n = n + gj * gj;
+      const float sigma = (std::sqrt(new_n) - std::sqrt(n)) * alpha_inv;
+      const float new_z = z + gj - sigma * param[offset + j];
+      n_z_out[2 * (offset + j)] = new_n;
+      n_z_out[2 * (offset + j) + 1] = new_z;
+      if (std::abs(new_z) > lambda1) {
+        const float sign = new_z < 0 ? -1.0f : 1.0f;
+        param_out[offset + j] = (lambda1 * sign - new_z) /
+            ((beta + std::sqrt(new_n)) * alpha_inv + lambda2);
+      } else {
+        param_out[offset + j] = 0;
+      }
+    }
+  }
+  return num_indices;
+}
+
+} // namespace
+
+#define SPARSE_OPTIMIZERS_AVX2_FMA(SIndex)          \
+  TIndex SparseAdagrad_##SIndex##__avx2_fma(        \
+      const TIndex num_indices,                     \
+      const TIndex block_size,                      \
+      const TIndex num_rows,                        \
+      const TIndex row_begin,                       \
+      const TIndex row_end,                         \
+      const SIndex* indices,                        \
+      const float* grad,                            \
+      const float* param,                           \
+      const float* moment,                          \
+      float* param_out,                             \
+      float* moment_out,                            \
+      float epsilon,                                \
+      float lr) {                                   \
+    return SparseAdagradImpl<SIndex>(               \
+        num_indices,                                \
+        block_size,                                 \
+        num_rows,                                   \
+        row_begin,                                  \
+        row_end,                                    \
+        indices,                                    \
+        grad,                                       \
+        param,                                      \
+        moment,                                     \
+        param_out,                                  \
+        moment_out,                                 \
+        epsilon,                                    \
+        lr);                                        \
+  }                                                 \
+  TIndex RowWiseSparseAdagrad_##SIndex##__avx2_fma( \
+      const TIndex num_indices,                     \
+      const TIndex block_size,                      \
+      const TIndex num_rows,                        \
+      const TIndex row_begin,                       \
+      const TIndex row_end,                         \
+      const SIndex* indices,                        \
+      const float* grad,                            \
+      const float* param,                           \
+      const float* moment,                          \
+      float* param_out,                             \
+      float* moment_out,                            \
+      float epsilon,                                \
+      float lr) {                                   \
+    return RowWiseSparseAdagradImpl<SIndex>(        \
+        num_indices,                                \
+        block_size,                                 \
+        num_rows,                                   \
+        row_begin,                                  \
+        row_end,                                    \
+        indices,                                    \
+        grad,                                       \
+        param,                                      \
+        moment,                                     \
+        param_out,                                  \
+        moment_out,                                 \
+        epsilon,                                    \
+        lr);                                        \
+  }                                                 \
+  TIndex SparseAdam_##SIndex##__avx2_fma(           \
+      const TIndex num_indices,                     \
+      const TIndex block_size,                      \
+      const TIndex num_rows,                        \
+      const TIndex row_begin,                       \
+      const TIndex row_end,                         \
+      const SIndex* indices,                        \
+      const float* grad,                            \
+      const float* param,                           \
+      const float* moment1,                         \
+      const float* moment2,                         \
+      float* param_out,                             \
+      float* moment1_out,                           \
+      float* moment2_out,                           \
+      float beta1,                                  \
+      float beta2,                                  \
+      float epsilon,                                \
+      float lr) {                                   \
+    return SparseAdamImpl<SIndex>(                  \
+        num_indices,                                \
+        block_size,                                 \
+        num_rows,                                   \
+        row_begin,                                  \
+        row_end,                                    \
+        indices,                                    \
+        grad,                                       \
+        param,                                      \
+        moment1,                                    \
+        moment2,                                    \
+        param_out,                                  \
+        moment1_out,                                \
+        moment2_out,                                \
+        beta1,                                      \
+        beta2,                                      \
+        epsilon,                                    \
+        lr);                                        \
+  }                                                 \
+  TIndex SparseFtrl_##SIndex##__avx2_fma(           \
+      const TIndex num_indices,                     \
+      const TIndex block_size,                      \
+      const TIndex num_rows,                        \
+      const TIndex row_begin,                       \
+      const TIndex row_end,                         \
+      const SIndex* indices,                        \
+      const float* grad,                            \
+      const float* param,                           \
+      const float* n_z,                             \
+      float* param_out,                             \
+      float* n_z_out,                               \
+      float alpha_inv,                              \
+      float beta,                                   \
+      float lambda1,                                \
+      float lambda2) {                              \
+    return SparseFtrlImpl<SIndex>(                  \
+        num_indices,                                \
+        block_size,                                 \
+        num_rows,                                   \
+        row_begin,                                  \
+        row_end,                                    \
+        indices,                                    \
+        grad,                                       \
+        param,                                      \
+        n_z,                                        \
+        param_out,                                  \
+        n_z_out,                                    \
+        alpha_inv,                                  \
+        beta,                                       \
+        lambda1,                                    \
+        lambda2);                                   \
+  }
+
+SPARSE_OPTIMIZERS_AVX2_FMA(int32_t);
+SPARSE_OPTIMIZERS_AVX2_FMA(int64_t);
+
+#undef SPARSE_OPTIMIZERS_AVX2_FMA
+
+} // namespace caffe2
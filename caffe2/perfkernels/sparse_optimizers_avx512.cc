@@ -0,0 +1,335 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "caffe2/perfkernels/sparse_optimizers.h"
+
+#include <cmath>
+
+#include <immintrin.h>
+
+namespace caffe2 {
+
+namespace {
+
+// Number of indices ahead whose rows are prefetched.
+constexpr TIndex kPrefetchDistance = 16;
+
+// Prefetches every cache line of row `idx` of `data`.
+inline void PrefetchRow(const float* data, TIndex idx, TIndex row_size) {
+  const char* row = reinterpret_cast<const char*>(data + idx * row_size);
+  const TIndex bytes = row_size * sizeof(float);
+  for (TIndex b = 0; b < bytes; b += 64) {
+    _mm_prefetch(row + b, _MM_HINT_T0);
+  }
+}
+
+// Returns the row of the index kPrefetchDistance positions after i if it is
+// updated by this shard, and -1 otherwise.
+template <typename SIndex>
+inline TIndex RowToPrefetch(
+    const SIndex* indices,
+    TIndex i,
+    TIndex num_indices,
+    TIndex row_begin,
+    TIndex row_end) {
+  if (i + kPrefetchDistance >= num_indices) {
+    return -1;
+  }
+  const TIndex next = indices[i + kPrefetchDistance];
+  return next >= row_begin && next < row_end ? next : -1;
+}
+
+// Mask of the lanes of elements [j, min(j + 16, n)).
+inline __mmask16 LaneMask(TIndex j, TIndex n) {
+  return n - j >= 16 ? __mmask16(0xffff) : __mmask16((1u << (n - j)) - 1);
+}
+
+template <typename SIndex>
+TIndex SparseAdagradImpl(
+    const TIndex num_indices,
+    const TIndex block_size,
+    const TIndex num_rows,
+    const TIndex row_begin,
+    const TIndex row_end,
+    const SIndex* indices,
+    const float* grad,
+    const float* param,
+    const float* moment,
+    float* param_out,
+    float* moment_out,
+    float epsilon,
+    float lr) {
+  const __m512 eps = _mm512_set1_ps(epsilon);
+  const __m512 rate = _mm512_set1_ps(lr);
+  for (TIndex i = 0; i < num_indices; ++i) {
+    const TIndex idx = indices[i];
+    if (idx < 0 || idx >= num_rows) {
+      return i;
+    }
+    if (idx < row_begin || idx >= row_end) {
+      continue;
+    }
+    const TIndex next =
+        RowToPrefetch(indices, i, num_indices, row_begin, row_end);
+    if (next >= 0) {
+      PrefetchRow(param, next, block_size);
+      PrefetchRow(moment, next, block_size);
+    }
+    const float* g = grad + i * block_size;
+    const TIndex offset = idx * block_size;
+    for (TIndex j = 0; j < block_size; j += 16) {
+      const __mmask16 mask = LaneMask(j, block_size);
+      const __m512 gj = _mm512_maskz_loadu_ps(mask, g + j);
+      const __m512 hj = _mm512_fmadd_ps(
+          gj, gj, _mm512_maskz_loadu_ps(mask, moment + offset + j));
+      const __m512 wj = _mm512_add_ps(
+          _mm512_maskz_loadu_ps(mask, param + offset + j),
+          _mm512_div_ps(
+              _mm512_mul_ps(rate, gj), _mm512_add_ps(_mm512_sqrt_ps(hj), eps)));
+      _mm512_mask_storeu_ps(moment_out + offset + j, mask, hj);
+      _mm512_mask_storeu_ps(param_out + offset + j, mask, wj);
+    }
+  }
+  return num_indices;
+}
+
+template <typename SIndex>
+TIndex RowWiseSparseAdagradImpl(
+    const TIndex num_indices,
+    const TIndex block_size,
+    const TIndex num_rows,
+    const TIndex row_begin,
+    const TIndex row_end,
+    const SIndex* indices,
+    const float* grad,
+    const float* param,
+    const float* moment,
+    float* param_out,
+    float* moment_out,
+    float epsilon,
+    float lr) {
+  for (TIndex i = 0; i < num_indices; ++i) {
+    const TIndex idx = indices[i];
+    if (idx < 0 || idx >= num_rows) {
+      return i;
+    }
+    if (idx < row_begin || idx >= row_end) {
+      continue;
+    }
+    const TIndex next =
+        RowToPrefetch(indices, i, num_indices, row_begin, row_end);
+    if (next >= 0) {
+      PrefetchRow(param, next, block_size);
+      _mm_prefetch(
+          reinterpret_cast<const char*>(moment + next), _MM_HINT_T0);
+    }
+    const float* g = grad + i * block_size;
+    const TIndex offset = idx * block_size;
+    __m512 acc = _mm512_setzero_ps();
+    for (TIndex j = 0; j < block_size; j += 16) {
+      const __m512 gj =
+          _mm512_maskz_loadu_ps(LaneMask(j, block_size), g + j);
+      acc = _mm512_fmadd_ps(gj, gj, acc);
+    }
+    const float hi = moment_out[idx] =
+        moment[idx] + _mm512_reduce_add_ps(acc) / block_size;
+    const __m512 step = _mm512_set1_ps(lr / (std::sqrt(hi) + epsilon));
+    for (TIndex j = 0; j < block_size; j += 16) {
+      const __mmask16 mask = LaneMask(j, block_size);
+      _mm512_mask_storeu_ps(
+          param_out + offset + j,
+          mask,
+          _mm512_fmadd_ps(
+              _mm512_maskz_loadu_ps(mask, g + j),
+              step,
+              _mm512_maskz_loadu_ps(mask, param + offset + j)));
+    }
+  }
+  return num_indices;
+}
+
+template <typename SIndex>
+TIndex SparseAdamImpl(
+    const TIndex num_indices,
+    const TIndex block_size,
+    const TIndex num_rows,
+    const TIndex row_begin,
+    const TIndex row_end,
+    const SIndex* indices,
+    const float* grad,
+    const float* param,
+    const float* moment1,
+    const float* moment2,
+    float* param_out,
+    float* moment1_out,
+    float* moment2_out,
+    float beta1,
+    float beta2,
+    float epsilon,
+    float lr) {
+  const __m512 b1 = _mm512_set1_ps(beta1);
+  const __m512 b2 = _mm512_set1_ps(beta2);
+  const __m512 one_minus_b1 = _mm512_set1_ps(1 - beta1);
+  const __m512 one_minus_b2 = _mm512_set1_ps(1 - beta2);
+  const __m512 eps = _mm512_set1_ps(epsilon);
+  const __m512 rate = _mm512_set1_ps(lr);
+  for (TIndex i = 0; i < num_indices; ++i) {
+    const TIndex idx = indices[i];
+    if (idx < 0 || idx >= num_rows) {
+      return i;
+    }
+    if (idx < row_begin || idx >= row_end) {
+      continue;
+    }
+    const TIndex next =
+        RowToPrefetch(indices, i, num_indices, row_begin, row_end);
+    if (next >= 0) {
+      PrefetchRow(param, next, block_size);
+      PrefetchRow(moment1, next, block_size);
+      PrefetchRow(moment2, next, block_size);
+    }
+    const float* g = grad + i * block_size;
+    const TIndex offset = idx * block_size;
+    for (TIndex j = 0; j < block_size; j += 16) {
+      const __mmask16 mask = LaneMask(j, block_size);
+      const TIndex p = offset + j;
+      const __m512 gj = _mm512_maskz_loadu_ps(mask, g + j);
+      const __m512 m = _mm512_fmadd_ps(
+          gj,
+          one_minus_b1,
+          _mm512_mul_ps(_mm512_maskz_loadu_ps(mask, moment1 + p), b1));
+      const __m512 v = _mm512_fmadd_ps(
+          _mm512_mul_ps(gj, gj),
+          one_minus_b2,
+          _mm512_mul_ps(_mm512_maskz_loadu_ps(mask, moment2 + p), b2));
+      const __m512 w = _mm512_add_ps(
+          _mm512_maskz_loadu_ps(mask, param + p),
+          _mm512_div_ps(
+              _mm512_mul_ps(rate, m), _mm512_add_ps(_mm512_sqrt_ps(v), eps)));
+      _mm512_mask_storeu_ps(moment1_out + p, mask, m);
+      _mm512_mask_storeu_ps(moment2_out + p, mask, v);
+      _mm512_mask_storeu_ps(param_out + p, mask, w);
+    }
+  }
+  return num_indices;
+}
+
+} // namespace
+
+#define SPARSE_OPTIMIZERS_AVX512(SIndex)          \
+  TIndex SparseAdagrad_##SIndex##__avx512(        \
+      const TIndex num_indices,                   \
+      const TIndex block_size,                    \
+      const TIndex num_rows,                      \
+      const TIndex row_begin,                     \
+      const TIndex row_end,                       \
+      const SIndex* indices,                      \
+      const float* grad,                          \
+      const float* param,                         \
+      const float* moment,                        \
+      float* param_out,                           \
+      float* moment_out,                          \
+      float epsilon,                              \
+      float lr) {                                 \
+    return SparseAdagradImpl<SIndex>(             \
+        num_indices,                              \
+        block_size,                               \
+        num_rows,                                 \
+        row_begin,                                \
+        row_end,                                  \
+        indices,                                  \
+        grad,                                     \
+        param,                                    \
+        moment,                                   \
+        param_out,                                \
+        moment_out,                               \
+        epsilon,                                  \
+        lr);                                      \
+  }                                               \
+  TIndex RowWiseSparseAdagrad_##SIndex##__avx512( \
+      const TIndex num_indices,                   \
+      const TIndex block_size,                    \
+      const TIndex num_rows,                      \
+      const TIndex row_begin,                     \
+      const TIndex row_end,                       \
+      const SIndex* indices,                      \
+      const float* grad,                          \
+      const float* param,                         \
+      const float* moment,                        \
+      float* param_out,                           \
+      float* moment_out,                          \
+      float epsilon,                              \
+      float lr) {                                 \
+    return RowWiseSparseAdagradImpl<SIndex>(      \
+        num_indices,                              \
+        block_size,                               \
+        num_rows,                                 \
+        row_begin,                                \
+        row_end,                                  \
+        indices,                                  \
+        grad,                                     \
+        param,                                    \
+        moment,                                   \
+        param_out,                                \
+        moment_out,                               \
+        epsilon,                                  \
+        lr);                                      \
+  }                                               \
+  TIndex SparseAdam_##SIndex##__avx512(           \
+      const TIndex num_indices,                   \
+      const TIndex block_size,                    \
+      const TIndex num_rows,                      \
+      const TIndex row_begin,                     \
+      const TIndex row_end,                       \
+      const SIndex* indices,                      \
+      const float* grad,                          \
+      const float* param,                         \
+      const float* moment1,                       \
+      const float* moment2,                       \
+      float* param_out,                           \
+      float* moment1_out,                         \
+      float* moment2_out,                         \
+      float beta1,                                \
+      float beta2,                                \
+      float epsilon,                              \
+      float lr) {                                 \
+    return SparseAdamImpl<SIndex>(                \
+        num_indices,                              \
+        block_size,                               \
+        num_rows,                                 \
+        row_begin,                                \
+        row_end,                                  \
+        indices,                                  \
+        grad,                                     \
+        param,                                    \
+        moment1,                                  \
+        moment2,                                  \
+        param_out,                                \
+        moment1_out,                              \
+        moment2_out,                              \
+        beta1,                                    \
+        beta2,                                    \
+        epsilon,                                  \
+        lr);                                      \
+  }
+
+SPARSE_OPTIMIZERS_AVX512(int32_t);
+SPARSE_OPTIMIZERS_AVX512(int64_t);
+
+#undef SPARSE_OPTIMIZERS_AVX512
+
+} // namespace caffe2
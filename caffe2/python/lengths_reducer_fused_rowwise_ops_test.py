@@ -0,0 +1,117 @@
+# Copyright (c) 2016-present, Facebook, Inc.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+##############################################################################
+
+from __future__ import absolute_import
+from __future__ import division
+from __future__ import print_function
+from __future__ import unicode_literals
+
+from caffe2.python import core, workspace
+import caffe2.python.hypothesis_test_util as hu
+
+import numpy as np
+from hypothesis import given
+import hypothesis.strategies as st
+import numpy as np
+
+
+def FakeQuantizationFusedRowwise(data, bit_rate):
+    max_value = (1 << bit_rate) - 1
+    min_el = np.min(data, axis=1)
+    max_el = np.max(data, axis=1)
+    scale = (max_el - min_el) / max_value
+    scale[scale < 1e-10] = 1.
+    bias = min_el
+    data = data.T
+    data = np.round((data - bias) / scale) * scale + bias
+    return data.T
+
+
+class TestLengthsReducerFusedRowwise(hu.HypothesisTestCase):
+
+    @given(bit_rate=st.sampled_from([4, 8]),
+           num_rows=st.integers(1, 20),
+           half_block_size=st.integers(1, 70))
+    def test_quantize_op(self, bit_rate, num_rows, half_block_size):
+        input_data = np.random.rand(
+            num_rows, 2 * half_block_size).astype(np.float32)
+        input_data[0, :] = 3.
+        workspace.FeedBlob('input_data', input_data)
+        workspace.RunOperatorOnce(core.CreateOperator(
+            'FloatToFused%dBitRowwiseQuantized' % bit_rate,
+            ['input_data'],
+            ['quantized_data']))
+        quantized_data = workspace.FetchBlob('quantized_data')
+        self.assertEqual(quantized_data.dtype, np.uint8)
+        self.assertEqual(
+            quantized_data.shape[1],
+            2 * half_block_size * bit_rate // 8 + 8)
+        workspace.RunOperatorOnce(core.CreateOperator(
+            'Fused%dBitRowwiseQuantizedToFloat' % bit_rate,
+            ['quantized_data'],
+            ['dequantized_data']))
+        np.testing.assert_array_almost_equal(
+            workspace.FetchBlob('dequantized_data'),
+            FakeQuantizationFusedRowwise(input_data, bit_rate),
+            decimal=5)
+
+    @given(bit_rate=st.sampled_from([4, 8]),
+           block_size=st.sampled_from([2, 16, 32, 34, 64, 128, 130]),
+           num_rows=st.integers(1, 50),
+           num_segments=st.integers(1, 10),
+           index_type=st.sampled_from([np.int32, np.int64]),
+           **hu.gcs_cpu_only)
+    def test_sparse_lengths_ops(self, bit_rate, block_size, num_rows,
+                                num_segments, index_type, gc, dc):
+        input_data = np.random.rand(num_rows, block_size).astype(np.float32)
+        lengths = np.random.randint(
+            0, 5, size=num_segments).astype(np.int32)
+        indices = np.random.randint(
+            0, num_rows, size=np.sum(lengths)).astype(index_type)
+        weights = np.random.rand(np.sum(lengths)).astype(np.float32)
+
+        workspace.FeedBlob('input_data', input_data)
+        workspace.FeedBlob('lengths', lengths)
+        workspace.FeedBlob('indices', indices)
+        workspace.FeedBlob('weights', weights)
+        workspace.RunOperatorOnce(core.CreateOperator(
+            'FloatToFused%dBitRowwiseQuantized' % bit_rate,
+            ['input_data'],
+            ['quantized_data']))
+        workspace.RunOperatorOnce(core.CreateOperator(
+            'Fused%dBitRowwiseQuantizedToFloat' % bit_rate,
+            ['quantized_data'],
+            ['dequantized_data']))
+
+        for op_type, inputs in [
+            ('SparseLengthsSum', ['indices', 'lengths']),
+            ('SparseLengthsWeightedSum', ['weights', 'indices', 'lengths']),
+            ('SparseLengthsMean', ['indices', 'lengths']),
+        ]:
+            workspace.RunOperatorOnce(core.CreateOperator(
+                op_type, ['dequantized_data'] + inputs, ['reference']))
+            workspace.RunOperatorOnce(core.CreateOperator(
+                '%sFused%dBitRowwise' % (op_type, bit_rate),
+                ['quantized_data'] + inputs,
+                ['result']))
+            np.testing.assert_array_almost_equal(
+                workspace.FetchBlob('result'),
+                workspace.FetchBlob('reference'),
+                decimal=4)
+
+
+if __name__ == "__main__":
+    import unittest
+    unittest.main()
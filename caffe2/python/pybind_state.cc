@@ -256,6 +256,21 @@ static bool ParseProtobufFromLargeString(const string& str, Message* proto) {
   return proto->ParseFromCodedStream(&coded_stream);
 }
 
+// Converts a NetCost to a list with a (flops, bytes_moved) tuple per
+// operator, or None for operators whose cost is unknown.
+static py::list netCostToPython(const NetCost& cost) {
+  py::list op_costs;
+  for (int i = 0; i < cost.op_costs.size(); ++i) {
+    if (cost.op_cost_known[i]) {
+      op_costs.append(py::make_tuple(
+          cost.op_costs[i].flops, cost.op_costs[i].bytes_moved));
+    } else {
+      op_costs.append(py::none());
+    }
+  }
+  return op_costs;
+}
+
 void addObjectMethods(py::module& m) {
   py::class_<NetBase>(m, "Net").def("run", [](NetBase* net) {
     py::gil_scoped_release g;
@@ -1125,6 +1140,22 @@ void addGlobalMethods(py::module& m) {
         CAFFE_ENFORCE(blob_info.SerializeToString(&protob));
         return py::bytes(protob);
       });
+  m.def("infer_net_cost_from_workspace", [](const py::bytes& net_proto) {
+    CAFFE_ENFORCE(gWorkspace);
+    NetDef def;
+    CAFFE_ENFORCE(
+        ParseProtobufFromLargeString(net_proto.cast<std::string>(), &def));
+    return netCostToPython(InferNetCostFromWorkspace(gWorkspace, def));
+  });
+  m.def(
+      "infer_net_cost_from_map",
+      [](const py::bytes& net_proto,
+         const std::map<std::string, std::vector<TIndex>> blob_dimensions) {
+        NetDef def;
+        CAFFE_ENFORCE(
+            ParseProtobufFromLargeString(net_proto.cast<std::string>(), &def));
+        return netCostToPython(InferNetCostFromMap(blob_dimensions, def));
+      });
   m.def("create_blob", [](const std::string& name) {
     CAFFE_ENFORCE(gWorkspace);
     CAFFE_ENFORCE(gWorkspace->CreateBlob(name));
@@ -272,6 +272,23 @@ def InferShapesAndTypes(nets, blob_dimensions=None):
     return (shapes, types)
 
 
+def InferNetCost(net, blob_dimensions=None):
+    """Estimates the cost of running every operator of a net once.
+
+    Inputs:
+      net: the net
+      blob_dimensions (optional): a dictionary of blobs and their dimensions.
+          If not specified, the workspace blobs are used.
+    Returns:
+      A list with a (flops, bytes_moved) tuple per operator, or None for the
+      operators whose cost could not be inferred.
+    """
+    net_proto = StringifyProto(net.Proto())
+    if blob_dimensions is None:
+        return C.infer_net_cost_from_workspace(net_proto)
+    return C.infer_net_cost_from_map(net_proto, blob_dimensions)
+
+
 def _StringifyName(name, expected_type):
     if isinstance(name, basestring):
         return name
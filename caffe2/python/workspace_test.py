@@ -77,6 +77,18 @@ class TestWorkspace(unittest.TestCase):
         flops, _ = workspace.GetOperatorCost(op.SerializeToString(), ["X", "W"])
         self.assertEqual(flops, 1152)
 
+    def testInferNetCost(self):
+        net = core.Net("cost")
+        net.FC(["X", "W", "b"], "Y")
+        net.Relu("Y", "Z")
+        net.Copy("Z", "Z2")
+        costs = workspace.InferNetCost(
+            net, {"X": [4, 8], "W": [16, 8], "b": [16]})
+        self.assertEqual(len(costs), 3)
+        self.assertEqual(costs[0][0], 4 * 16 * (2 * 8 + 1))
+        self.assertEqual(costs[1][0], 4 * 16 * 2)
+        self.assertIsNone(costs[2])
+
     def testRunNetOnce(self):
         self.assertEqual(
             workspace.RunNetOnce(self.net.Proto().SerializeToString()), True)
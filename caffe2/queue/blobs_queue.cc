@@ -17,10 +17,20 @@
 #include "caffe2/queue/blobs_queue.h"
 
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
 #include <memory>
 #include <mutex>
 #include <queue>
+#include <thread>
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <climits>
+#include <ctime>
+#endif
 
 #include "caffe2/core/blob_stats.h"
 #include "caffe2/core/logging.h"
@@ -37,13 +47,212 @@ static constexpr uint64_t SDT_TIMEOUT = (uint64_t)-1;
 static constexpr uint64_t SDT_ABORT = (uint64_t)-2;
 static constexpr uint64_t SDT_CANCEL = (uint64_t)-3;
 
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Lets threads sleep until another thread signals a change, without any
+// locking or system call on the signalling side while nobody sleeps. A waiter
+// calls prepareWait(), re-checks its condition, and then either cancelWait()
+// or wait() with the returned key; a signal sent after prepareWait() is never
+// lost. Uses a futex on Linux and a condition variable elsewhere.
+class EventCount {
+ public:
+  uint32_t prepareWait() {
+    waiters_.fetch_add(1);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    return epoch_.load();
+  }
+
+  void cancelWait() {
+    waiters_.fetch_sub(1);
+  }
+
+  // Sleeps until notified after prepareWait() returned key, or until the
+  // deadline if one is given. Returns false on timeout.
+  bool wait(uint32_t key, const Clock::time_point* deadline) {
+    bool notified = true;
+#if defined(__linux__)
+    while (epoch_.load() == key) {
+      struct timespec ts;
+      struct timespec* timeout = nullptr;
+      if (deadline) {
+        const auto left = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            *deadline - Clock::now());
+        if (left.count() <= 0) {
+          notified = false;
+          break;
+        }
+        ts.tv_sec = left.count() / 1000000000;
+        ts.tv_nsec = left.count() % 1000000000;
+        timeout = &ts;
+      }
+      syscall(
+          SYS_futex,
+          reinterpret_cast<uint32_t*>(&epoch_),
+          FUTEX_WAIT_PRIVATE,
+          key,
+          timeout,
+          nullptr,
+          0);
+    }
+#else
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto notifiedPred = [this, key]() { return epoch_.load() != key; };
+    if (deadline) {
+      notified = cv_.wait_until(lock, *deadline, notifiedPred);
+    } else {
+      cv_.wait(lock, notifiedPred);
+    }
+#endif
+    waiters_.fetch_sub(1);
+    return notified;
+  }
+
+  void notifyOne() {
+    notify(false);
+  }
+
+  void notifyAll() {
+    notify(true);
+  }
+
+ private:
+  void notify(bool all) {
+    // Pairs with the fence in prepareWait(): either the waiter sees the state
+    // change that preceded this call, or we see the waiter.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiters_.load(std::memory_order_relaxed) == 0) {
+      return;
+    }
+#if defined(__linux__)
+    epoch_.fetch_add(1);
+    syscall(
+        SYS_futex,
+        reinterpret_cast<uint32_t*>(&epoch_),
+        FUTEX_WAKE_PRIVATE,
+        all ? INT_MAX : 1,
+        nullptr,
+        nullptr,
+        0);
+#else
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      epoch_.fetch_add(1);
+    }
+    if (all) {
+      cv_.notify_all();
+    } else {
+      cv_.notify_one();
+    }
+#endif
+  }
+
+  std::atomic<uint32_t> epoch_{0};
+  std::atomic<uint32_t> waiters_{0};
+#if !defined(__linux__)
+  std::mutex mutex_;
+  std::condition_variable cv_;
+#endif
+};
+
+} // namespace
+
+// A bounded multi-producer multi-consumer ring buffer. Slot i is free for the
+// writer of position p when its sequence is p, and holds the record at
+// position p for readers when its sequence is p + 1. Readers and writers
+// claim positions by advancing their counter with a compare-and-swap, so
+// neither side ever takes a lock.
+struct BlobsQueue::LockFreeRing {
+  explicit LockFreeRing(size_t capacity)
+      : capacity(capacity), sequences(new std::atomic<uint64_t>[capacity]) {
+    for (size_t i = 0; i < capacity; ++i) {
+      sequences[i].store(i, std::memory_order_relaxed);
+    }
+  }
+
+  // Claims the next position to write, if its slot is free.
+  bool claimWrite(uint64_t* pos) {
+    return claim(&writePos, 0, pos);
+  }
+
+  // Claims the next position to read, if its slot holds a record.
+  bool claimRead(uint64_t* pos) {
+    return claim(&readPos, 1, pos);
+  }
+
+  // Retries a claim a few times, yielding in between, before the caller goes
+  // to sleep: the other side usually makes progress within a few time slices,
+  // which is much cheaper than a sleep and a wake-up.
+  template <typename ClaimFn>
+  static bool spinClaim(ClaimFn claimFn) {
+    for (int i = 0; i < kSpins; ++i) {
+      std::this_thread::yield();
+      if (claimFn()) {
+        return true;
+      }
+    }
+    return false;
+  }
+  static constexpr int kSpins = 16;
+
+  void publishWrite(uint64_t pos) {
+    sequences[pos % capacity].store(pos + 1, std::memory_order_release);
+  }
+
+  void publishRead(uint64_t pos) {
+    sequences[pos % capacity].store(pos + capacity, std::memory_order_release);
+  }
+
+  // Approximate number of records in the queue.
+  uint64_t size() const {
+    const auto w = writePos.load(std::memory_order_relaxed);
+    const auto r = readPos.load(std::memory_order_relaxed);
+    return w > r ? w - r : 0;
+  }
+
+  const size_t capacity;
+  std::unique_ptr<std::atomic<uint64_t>[]> sequences;
+  // Keep the counters on separate cache lines.
+  char pad0[64];
+  std::atomic<uint64_t> writePos{0};
+  char pad1[64];
+  std::atomic<uint64_t> readPos{0};
+  char pad2[64];
+  EventCount notEmpty;
+  EventCount notFull;
+
+ private:
+  bool claim(std::atomic<uint64_t>* counter, uint64_t ready, uint64_t* pos) {
+    uint64_t p = counter->load(std::memory_order_relaxed);
+    while (true) {
+      const auto seq =
+          sequences[p % capacity].load(std::memory_order_acquire);
+      const auto diff =
+          static_cast<int64_t>(seq) - static_cast<int64_t>(p + ready);
+      if (diff == 0) {
+        if (counter->compare_exchange_weak(
+                p, p + 1, std::memory_order_relaxed)) {
+          *pos = p;
+          return true;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        p = counter->load(std::memory_order_relaxed);
+      }
+    }
+  }
+};
+
 BlobsQueue::BlobsQueue(
     Workspace* ws,
     const std::string& queueName,
     size_t capacity,
     size_t numBlobs,
     bool enforceUniqueName,
-    const std::vector<std::string>& fieldNames)
+    const std::vector<std::string>& fieldNames,
+    bool lockFree)
     : numBlobs_(numBlobs), name_(queueName), stats_(queueName) {
   if (!fieldNames.empty()) {
     CAFFE_ENFORCE_EQ(
@@ -67,11 +276,22 @@ BlobsQueue::BlobsQueue(
     queue_.push_back(blobs);
   }
   DCHECK_EQ(queue_.size(), capacity);
+  if (lockFree) {
+    CAFFE_ENFORCE_GT(capacity, 0, "Lock-free queues need a capacity.");
+    ring_.reset(new LockFreeRing(capacity));
+  }
+}
+
+BlobsQueue::~BlobsQueue() {
+  close();
 }
 
 bool BlobsQueue::blockingRead(
     const std::vector<Blob*>& inputs,
     float timeout_secs) {
+  if (ring_) {
+    return lockFreeRead(inputs, timeout_secs);
+  }
   auto keeper = this->shared_from_this();
   const auto& name = name_.c_str();
   CAFFE_SDT(queue_read_start, name, (void*)this, SDT_BLOCKING_OP);
@@ -114,6 +334,9 @@ bool BlobsQueue::blockingRead(
 }
 
 bool BlobsQueue::tryWrite(const std::vector<Blob*>& inputs) {
+  if (ring_) {
+    return lockFreeWrite(inputs, false);
+  }
   auto keeper = this->shared_from_this();
   const auto& name = name_.c_str();
   CAFFE_SDT(queue_write_start, name, (void*)this, SDT_NONBLOCKING_OP);
@@ -129,6 +352,9 @@ bool BlobsQueue::tryWrite(const std::vector<Blob*>& inputs) {
 }
 
 bool BlobsQueue::blockingWrite(const std::vector<Blob*>& inputs) {
+  if (ring_) {
+    return lockFreeWrite(inputs, true);
+  }
   auto keeper = this->shared_from_this();
   const auto& name = name_.c_str();
   CAFFE_SDT(queue_write_start, name, (void*)this, SDT_BLOCKING_OP);
@@ -147,6 +373,11 @@ bool BlobsQueue::blockingWrite(const std::vector<Blob*>& inputs) {
 void BlobsQueue::close() {
   closing_ = true;
 
+  if (ring_) {
+    ring_->notEmpty.notifyAll();
+    ring_->notFull.notifyAll();
+    return;
+  }
   std::lock_guard<std::mutex> g(mutex_);
   cv_.notify_all();
 }
@@ -173,4 +404,111 @@ void BlobsQueue::doWrite(const std::vector<Blob*>& inputs) {
   cv_.notify_all();
 }
 
+bool BlobsQueue::lockFreeRead(
+    const std::vector<Blob*>& inputs,
+    float timeout_secs) {
+  auto keeper = this->shared_from_this();
+  // Check before claiming a slot: a claimed slot must always be released.
+  CAFFE_ENFORCE(inputs.size() >= numBlobs_);
+  const auto& name = name_.c_str();
+  CAFFE_SDT(queue_read_start, name, (void*)this, SDT_BLOCKING_OP);
+  CAFFE_EVENT(stats_, queue_balance, -1);
+  Clock::time_point deadline;
+  if (timeout_secs > 0) {
+    deadline = Clock::now() +
+        std::chrono::milliseconds(int(timeout_secs * 1000));
+  }
+  uint64_t pos;
+  while (!ring_->claimRead(&pos)) {
+    // Records written before close() can still be read.
+    if (closing_) {
+      CAFFE_SDT(queue_read_end, name, (void*)this, SDT_CANCEL);
+      return false;
+    }
+    if (LockFreeRing::spinClaim([&]() { return ring_->claimRead(&pos); })) {
+      break;
+    }
+    const auto key = ring_->notEmpty.prepareWait();
+    if (ring_->claimRead(&pos)) {
+      ring_->notEmpty.cancelWait();
+      break;
+    }
+    if (closing_) {
+      ring_->notEmpty.cancelWait();
+      continue;
+    }
+    if (!ring_->notEmpty.wait(key, timeout_secs > 0 ? &deadline : nullptr) &&
+        !ring_->claimRead(&pos)) {
+      LOG(ERROR) << "DequeueBlobs timed out in " << timeout_secs << " secs";
+      CAFFE_SDT(queue_read_end, name, (void*)this, SDT_TIMEOUT);
+      return false;
+    }
+  }
+  auto& result = queue_[pos % queue_.size()];
+  for (auto i = 0; i < result.size(); ++i) {
+    auto bytes = BlobStat::sizeBytes(*result[i]);
+    CAFFE_EVENT(stats_, queue_dequeued_bytes, bytes, i);
+    using std::swap;
+    swap(*(inputs[i]), *(result[i]));
+  }
+  ring_->publishRead(pos);
+  ring_->notFull.notifyOne();
+  CAFFE_SDT(queue_read_end, name, (void*)this, ring_->size());
+  CAFFE_EVENT(stats_, queue_dequeued_records);
+  return true;
+}
+
+bool BlobsQueue::lockFreeWrite(
+    const std::vector<Blob*>& inputs,
+    bool blocking) {
+  auto keeper = this->shared_from_this();
+  // Check before claiming a slot: a claimed slot must always be released.
+  CAFFE_ENFORCE(inputs.size() >= numBlobs_);
+  const auto& name = name_.c_str();
+  CAFFE_SDT(
+      queue_write_start,
+      name,
+      (void*)this,
+      blocking ? SDT_BLOCKING_OP : SDT_NONBLOCKING_OP);
+  if (blocking) {
+    CAFFE_EVENT(stats_, queue_balance, 1);
+  }
+  uint64_t pos;
+  while (!ring_->claimWrite(&pos)) {
+    if (!blocking || closing_) {
+      CAFFE_SDT(queue_write_end, name, (void*)this, SDT_ABORT);
+      return false;
+    }
+    if (LockFreeRing::spinClaim([&]() { return ring_->claimWrite(&pos); })) {
+      break;
+    }
+    const auto key = ring_->notFull.prepareWait();
+    if (ring_->claimWrite(&pos)) {
+      ring_->notFull.cancelWait();
+      break;
+    }
+    if (closing_) {
+      ring_->notFull.cancelWait();
+      continue;
+    }
+    ring_->notFull.wait(key, nullptr);
+  }
+  if (!blocking) {
+    CAFFE_EVENT(stats_, queue_balance, 1);
+  }
+  auto& result = queue_[pos % queue_.size()];
+  for (auto i = 0; i < result.size(); ++i) {
+    using std::swap;
+    swap(*(inputs[i]), *(result[i]));
+  }
+  ring_->publishWrite(pos);
+  ring_->notEmpty.notifyOne();
+  CAFFE_SDT(
+      queue_write_end,
+      name,
+      (void*)this,
+      queue_.size() - std::min<uint64_t>(ring_->size(), queue_.size()));
+  return true;
+}
+
 } // namespace caffe2
@@ -36,6 +36,11 @@ namespace caffe2 {
 // Containing blobs are owned by the workspace.
 // On read, we swap out the underlying data for the blob passed in for blobs
 
+// By default all reads and writes are serialized by one mutex. With lockFree,
+// the buffer is a ring of sequence-numbered slots instead: readers and writers
+// claim slots with a compare-and-swap on their own position counter and only
+// block, futex-style, when the queue is empty or full.
+
 class BlobsQueue : public std::enable_shared_from_this<BlobsQueue> {
  public:
   BlobsQueue(
@@ -44,11 +49,10 @@ class BlobsQueue : public std::enable_shared_from_this<BlobsQueue> {
       size_t capacity,
       size_t numBlobs,
       bool enforceUniqueName,
-      const std::vector<std::string>& fieldNames = {});
+      const std::vector<std::string>& fieldNames = {},
+      bool lockFree = false);
 
-  ~BlobsQueue() {
-    close();
-  }
+  ~BlobsQueue();
 
   bool blockingRead(
       const std::vector<Blob*>& inputs,
@@ -64,6 +68,10 @@ class BlobsQueue : public std::enable_shared_from_this<BlobsQueue> {
   bool canWrite();
   void doWrite(const std::vector<Blob*>& inputs);
 
+  struct LockFreeRing;
+  bool lockFreeRead(const std::vector<Blob*>& inputs, float timeout_secs);
+  bool lockFreeWrite(const std::vector<Blob*>& inputs, bool blocking);
+
   std::atomic<bool> closing_{false};
 
   size_t numBlobs_;
@@ -72,6 +80,9 @@ class BlobsQueue : public std::enable_shared_from_this<BlobsQueue> {
   int64_t reader_{0};
   int64_t writer_{0};
   std::vector<std::vector<Blob*>> queue_;
+  // Set if the queue is lock-free, in which case mutex_, cv_, reader_ and
+  // writer_ are unused.
+  std::unique_ptr<LockFreeRing> ring_;
   const std::string name_;
 
   struct QueueStats {
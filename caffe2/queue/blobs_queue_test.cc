@@ -0,0 +1,140 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <algorithm>
+#include <thread>
+
+#include "caffe2/queue/blobs_queue.h"
+#include <gtest/gtest.h>
+
+namespace caffe2 {
+
+namespace {
+
+std::shared_ptr<BlobsQueue>
+CreateQueue(Workspace* ws, size_t capacity, bool lockFree) {
+  return std::make_shared<BlobsQueue>(
+      ws, "queue", capacity, 1, false, std::vector<std::string>(), lockFree);
+}
+
+bool Write(BlobsQueue* queue, int value, bool blocking = true) {
+  Blob blob;
+  auto* tensor = blob.GetMutable<TensorCPU>();
+  tensor->Resize(1);
+  tensor->mutable_data<int>()[0] = value;
+  return blocking ? queue->blockingWrite({&blob}) : queue->tryWrite({&blob});
+}
+
+bool Read(BlobsQueue* queue, int* value, float timeout_secs = 0) {
+  Blob blob;
+  if (!queue->blockingRead({&blob}, timeout_secs)) {
+    return false;
+  }
+  *value = blob.Get<TensorCPU>().data<int>()[0];
+  return true;
+}
+
+} // namespace
+
+TEST(BlobsQueueTest, ManyProducersAndConsumers) {
+  const int kThreads = 4;
+  const int kItemsPerThread = 2000;
+  for (bool lockFree : {false, true}) {
+    Workspace ws;
+    auto queue = CreateQueue(&ws, 8, lockFree);
+    std::vector<std::vector<int>> received(kThreads);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t) {
+      threads.emplace_back([&, t]() {
+        for (int i = 0; i < kItemsPerThread; ++i) {
+          EXPECT_TRUE(Write(queue.get(), t * kItemsPerThread + i));
+        }
+      });
+      threads.emplace_back([&, t]() {
+        int value;
+        for (int i = 0; i < kItemsPerThread; ++i) {
+          ASSERT_TRUE(Read(queue.get(), &value));
+          received[t].push_back(value);
+        }
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    std::vector<int> all;
+    for (const auto& values : received) {
+      // Every producer's records are read in the order they were written.
+      for (size_t i = 1; i < values.size(); ++i) {
+        if (values[i] / kItemsPerThread == values[i - 1] / kItemsPerThread) {
+          EXPECT_LT(values[i - 1], values[i]);
+        }
+      }
+      all.insert(all.end(), values.begin(), values.end());
+    }
+    std::sort(all.begin(), all.end());
+    ASSERT_EQ(all.size(), kThreads * kItemsPerThread);
+    for (int i = 0; i < all.size(); ++i) {
+      EXPECT_EQ(all[i], i);
+    }
+  }
+}
+
+TEST(BlobsQueueTest, FullEmptyAndClose) {
+  for (bool lockFree : {false, true}) {
+    Workspace ws;
+    auto queue = CreateQueue(&ws, 2, lockFree);
+    int value;
+    EXPECT_FALSE(Read(queue.get(), &value, 0.01));
+    EXPECT_TRUE(Write(queue.get(), 1, false));
+    EXPECT_TRUE(Write(queue.get(), 2, false));
+    EXPECT_FALSE(Write(queue.get(), 3, false));
+
+    // A blocked writer is released by close().
+    std::thread writer([&]() { EXPECT_FALSE(Write(queue.get(), 3)); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    queue->close();
+    writer.join();
+
+    // Records written before close() can still be read.
+    ASSERT_TRUE(Read(queue.get(), &value));
+    EXPECT_EQ(value, 1);
+    ASSERT_TRUE(Read(queue.get(), &value));
+    EXPECT_EQ(value, 2);
+    EXPECT_FALSE(Read(queue.get(), &value));
+  }
+}
+
+TEST(BlobsQueueTest, CloseReleasesReaders) {
+  for (bool lockFree : {false, true}) {
+    Workspace ws;
+    auto queue = CreateQueue(&ws, 4, lockFree);
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 3; ++i) {
+      readers.emplace_back([&]() {
+        int value;
+        EXPECT_FALSE(Read(queue.get(), &value));
+      });
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    queue->close();
+    for (auto& reader : readers) {
+      reader.join();
+    }
+  }
+}
+
+} // namespace caffe2
@@ -33,7 +33,16 @@ REGISTER_CPU_OPERATOR(
     WeightedSampleDequeueBlobs,
     WeightedSampleDequeueBlobsOp<CPUContext>);
 
-OPERATOR_SCHEMA(CreateBlobsQueue).NumInputs(0).NumOutputs(1);
+OPERATOR_SCHEMA(CreateBlobsQueue)
+    .NumInputs(0)
+    .NumOutputs(1)
+    .Arg("capacity", "(int, default 1) maximum number of records in the queue")
+    .Arg("num_blobs", "(int, default 1) number of blobs in every record")
+    .Arg(
+        "lock_free",
+        "(bool, default false) use a lock-free ring buffer instead of a "
+        "mutex-guarded one; scales better with many concurrent readers and "
+        "writers");
 OPERATOR_SCHEMA(EnqueueBlobs)
     .NumInputsOutputs([](int inputs, int outputs) {
       return inputs >= 2 && outputs >= 1 && inputs == outputs + 1;
@@ -40,12 +40,19 @@ class CreateBlobsQueueOp final : public Operator<Context> {
         GetSingleArgument("enforce_unique_name", false);
     const auto fieldNames =
         OperatorBase::template GetRepeatedArgument<std::string>("field_names");
+    const auto lockFree = GetSingleArgument("lock_free", false);
     CAFFE_ENFORCE_EQ(this->OutputSize(), 1);
     auto queuePtr = Operator<Context>::Outputs()[0]
                         ->template GetMutable<std::shared_ptr<BlobsQueue>>();
     CAFFE_ENFORCE(queuePtr);
     *queuePtr = std::make_shared<BlobsQueue>(
-        ws_, name, capacity, numBlobs, enforceUniqueName, fieldNames);
+        ws_,
+        name,
+        capacity,
+        numBlobs,
+        enforceUniqueName,
+        fieldNames,
+        lockFree);
     return true;
   }
 
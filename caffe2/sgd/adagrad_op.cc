@@ -66,7 +66,11 @@ new_moment) as in the dense case.
     .Input(4, "lr", "learning rate")
     .Output(0, "output_param", "Updated parameters")
     .Output(1, "output_moment_1", "Updated moment")
-    .Arg("epsilon", "Default 1e-5");
+    .Arg("epsilon", "Default 1e-5")
+    .Arg(
+        "concurrency",
+        "Default exclusive. Set to hogwild to allow lock-free updates from "
+        "concurrent ops, or to consistent to lock each updated row.");
 
 REGISTER_CPU_OPERATOR(
     RowWiseSparseAdagrad,
@@ -93,7 +97,11 @@ also be a 1D tensor indexing into the rows of param.
     .Input(4, "lr", "learning rate")
     .Output(0, "output_param", "Updated parameters")
     .Output(1, "output_moment_1", "Updated moment")
-    .Arg("epsilon", "Default 1e-5");
+    .Arg("epsilon", "Default 1e-5")
+    .Arg(
+        "concurrency",
+        "Default exclusive. Set to hogwild to allow lock-free updates from "
+        "concurrent ops, or to consistent to lock each updated row.");
 
 SHOULD_NOT_DO_GRADIENT(Adagrad);
 SHOULD_NOT_DO_GRADIENT(SparseAdagrad);
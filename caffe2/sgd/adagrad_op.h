@@ -17,6 +17,8 @@
 #pragma once
 
 #include "caffe2/core/operator.h"
+#include "caffe2/perfkernels/sparse_optimizers.h"
+#include "caffe2/sgd/sparse_update_utils.h"
 
 namespace caffe2 {
 
@@ -80,7 +82,10 @@ class SparseAdagradOp final : public Operator<Context> {
   USE_OPERATOR_CONTEXT_FUNCTIONS;
   SparseAdagradOp(const OperatorDef& operator_def, Workspace* ws)
       : Operator<Context>(operator_def, ws),
-        epsilon_(OperatorBase::GetSingleArgument<float>("epsilon", 1e-5f)) {}
+        epsilon_(OperatorBase::GetSingleArgument<float>("epsilon", 1e-5f)),
+        concurrency_(ParseSparseUpdateConcurrency(
+            OperatorBase::GetSingleArgument<string>(
+                "concurrency", "exclusive"))) {}
 
   bool RunOnDevice() override {
     // Enforce shapes
@@ -110,54 +115,38 @@ class SparseAdagradOp final : public Operator<Context> {
     }
 
     auto block_size = Input(GRAD).size() / n;
-    for (auto i = 0; i < n; ++i) {
-      auto idx = indices[i];
-      if (block_size == 1) {
-        float gi = gradIn[i];
-        float hi = momentOut[idx] = momentIn[idx] + gi * gi;
-        paramOut[idx] = paramIn[idx] + lr[0] * gi / (std::sqrt(hi) + epsilon_);
-      } else {
-        auto offsetI = i * block_size;
-        auto offsetIdx = idx * block_size;
-
-#ifndef NDEBUG
-        CAFFE_ENFORCE_GE(
-            Input(PARAM).size(),
-            block_size + offsetIdx,
-            this->debug_def().input(PARAM),
-            ", out of bound,  idx:",
-            idx,
-            " for input i:",
-            i,
-            " and block size:",
-            block_size);
-        CAFFE_ENFORCE_GE(
-            Input(GRAD).size(),
-            block_size + offsetI,
-            this->debug_def().input(GRAD),
-            ", out of bound idx, idx:",
-            idx,
-            " for input i:",
-            i);
-#endif
-        adagrad_update(
-            block_size,
-            paramIn + offsetIdx,
-            gradIn + offsetI,
-            momentIn + offsetIdx,
-            paramOut + offsetIdx,
-            momentOut + offsetIdx,
-            epsilon_,
-            1.0f,
-            lr,
-            &context_);
-      }
-    }
+    const auto num_rows = Input(PARAM).dim(0);
+    RunSparseUpdate(
+        &context_,
+        concurrency_,
+        paramOut,
+        num_rows,
+        n,
+        block_size,
+        indices,
+        [&](TIndex begin, TIndex end, TIndex row_begin, TIndex row_end) {
+          const auto done = SparseAdagrad<SIndex>(
+              end - begin,
+              block_size,
+              num_rows,
+              row_begin,
+              row_end,
+              indices + begin,
+              gradIn + begin * block_size,
+              paramIn,
+              momentIn,
+              paramOut,
+              momentOut,
+              epsilon_,
+              lr[0]);
+          return begin + done;
+        });
     return true;
   }
 
  protected:
   T epsilon_;
+  SparseUpdateConcurrency concurrency_;
   INPUT_TAGS(PARAM, MOMENT_1, INDICES, GRAD, LR);
   OUTPUT_TAGS(OUTPUT_PARAM, OUTPUT_MOMENT_1);
 };
@@ -168,7 +157,10 @@ class RowWiseSparseAdagradOp final : public Operator<Context> {
   USE_OPERATOR_CONTEXT_FUNCTIONS;
   RowWiseSparseAdagradOp(const OperatorDef& operator_def, Workspace* ws)
       : Operator<Context>(operator_def, ws),
-        epsilon_(OperatorBase::GetSingleArgument<float>("epsilon", 1e-5f)) {}
+        epsilon_(OperatorBase::GetSingleArgument<float>("epsilon", 1e-5f)),
+        concurrency_(ParseSparseUpdateConcurrency(
+            OperatorBase::GetSingleArgument<string>(
+                "concurrency", "exclusive"))) {}
 
   bool RunOnDevice() override {
     // Enforce shapes
@@ -198,60 +190,38 @@ class RowWiseSparseAdagradOp final : public Operator<Context> {
     }
 
     auto block_size = Input(GRAD).size() / n;
-
-    for (auto i = 0; i < n; ++i) {
-      auto idx = indices[i];
-      if (block_size == 1) {
-        float gi = gradIn[i];
-        float hi = momentOut[idx] = momentIn[idx] + gi * gi;
-        paramOut[idx] = paramIn[idx] + lr[0] * gi / (std::sqrt(hi) + epsilon_);
-      } else {
-        auto offsetI = i * block_size;
-        auto offsetIdx = idx * block_size;
-
-#ifndef NDEBUG
-        CAFFE_ENFORCE_GE(
-            Input(PARAM).size(),
-            block_size + offsetIdx,
-            this->debug_def().input(PARAM),
-            ", out of bound,  idx:",
-            idx,
-            " for input i:",
-            i,
-            " and block size:",
-            block_size);
-        CAFFE_ENFORCE_GE(
-            Input(GRAD).size(),
-            block_size + offsetI,
-            this->debug_def().input(GRAD),
-            ", out of bound idx, idx:",
-            idx,
-            " for input i:",
-            i);
-#endif
-
-        const float* w = paramIn + offsetIdx;
-        const float* g = gradIn + offsetI;
-        const float* h = momentIn + idx;
-        float* nw = paramOut + offsetIdx;
-        float* nh = momentOut + idx;
-        float hs = 0.;
-        for (auto j = 0; j < block_size; ++j) {
-          float gj = g[j];
-          hs += gj * gj;
-        }
-        float hi = nh[0] = h[0] + hs / block_size;
-        float step = lr[0] / (std::sqrt(hi) + epsilon_);
-        for (auto j = 0; j < block_size; ++j) {
-          nw[j] = w[j] + g[j] * step;
-        }
-      }
-    }
+    const auto num_rows = Input(PARAM).dim(0);
+    RunSparseUpdate(
+        &context_,
+        concurrency_,
+        paramOut,
+        num_rows,
+        n,
+        block_size,
+        indices,
+        [&](TIndex begin, TIndex end, TIndex row_begin, TIndex row_end) {
+          const auto done = RowWiseSparseAdagrad<SIndex>(
+              end - begin,
+              block_size,
+              num_rows,
+              row_begin,
+              row_end,
+              indices + begin,
+              gradIn + begin * block_size,
+              paramIn,
+              momentIn,
+              paramOut,
+              momentOut,
+              epsilon_,
+              lr[0]);
+          return begin + done;
+        });
     return true;
   }
 
  protected:
   T epsilon_;
+  SparseUpdateConcurrency concurrency_;
   INPUT_TAGS(PARAM, MOMENT_1, INDICES, GRAD, LR);
   OUTPUT_TAGS(OUTPUT_PARAM, OUTPUT_MOMENT_1);
 };
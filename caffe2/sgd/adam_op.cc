@@ -79,7 +79,11 @@ Adam on (param, moment1[indices], momemnt2[indices], lr, iter) and returns
     .Output(2, "output_moment_2", "Updated second moment")
     .Arg("beta1", "Default 0.9")
     .Arg("beta2", "Default 0.999")
-    .Arg("epsilon", "Default 1e-5");
+    .Arg("epsilon", "Default 1e-5")
+    .Arg(
+        "concurrency",
+        "Default exclusive. Set to hogwild to allow lock-free updates from "
+        "concurrent ops, or to consistent to lock each updated row.");
 
 SHOULD_NOT_DO_GRADIENT(Adam);
 SHOULD_NOT_DO_GRADIENT(SparseAdam);
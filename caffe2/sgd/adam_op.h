@@ -17,6 +17,8 @@
 #pragma once
 
 #include "caffe2/core/operator.h"
+#include "caffe2/perfkernels/sparse_optimizers.h"
+#include "caffe2/sgd/sparse_update_utils.h"
 
 namespace caffe2 {
 
@@ -128,7 +130,10 @@ class SparseAdamOp final : public Operator<Context> {
       : Operator<Context>(operator_def, ws),
         beta1_(OperatorBase::GetSingleArgument<float>("beta1", 0.9f)),
         beta2_(OperatorBase::GetSingleArgument<float>("beta2", 0.999f)),
-        epsilon_(OperatorBase::GetSingleArgument<float>("epsilon", 1e-5f)) {}
+        epsilon_(OperatorBase::GetSingleArgument<float>("epsilon", 1e-5f)),
+        concurrency_(ParseSparseUpdateConcurrency(
+            OperatorBase::GetSingleArgument<string>(
+                "concurrency", "exclusive"))) {}
 
   bool RunOnDevice() override {
     // Enforce shapes
@@ -164,60 +169,37 @@ class SparseAdamOp final : public Operator<Context> {
     auto* moment1Out = Output(OUTPUT_MOMENT_1)->template mutable_data<T>();
     auto* moment2Out = Output(OUTPUT_MOMENT_2)->template mutable_data<T>();
 
-    for (auto i = 0; i < n; ++i) {
-      auto idx = indices[i];
-
-      if (block_size == 1) {
-        float gi = gradIn[i];
-        float mi = moment1Out[idx] =
-            moment1In[idx] * beta1_ + gi * (1 - beta1_);
-        float vi = moment2Out[idx] =
-            moment2In[idx] * beta2_ + gi * gi * (1 - beta2_);
-        paramOut[idx] =
-            paramIn[idx] + lr[0] * correction * mi / (std::sqrt(vi) + epsilon_);
-
-      } else {
-        auto offsetI = i * block_size;
-        auto offsetIdx = idx * block_size;
-
-#ifndef NDEBUG
-        CAFFE_ENFORCE_GE(
-            Input(PARAM).size(),
-            block_size + offsetIdx,
-            this->debug_def().input(PARAM),
-            ", out of bound,  idx:",
-            idx,
-            " for input i:",
-            i,
-            " and block size:",
-            block_size);
-        CAFFE_ENFORCE_GE(
-            Input(GRAD).size(),
-            block_size + offsetI,
-            this->debug_def().input(GRAD),
-            ", out of bound idx, idx:",
-            idx,
-            " for input i:",
-            i);
-#endif
-
-        adam_compute(
-            block_size,
-            paramIn + offsetIdx,
-            gradIn + offsetI,
-            moment1In + offsetIdx,
-            moment2In + offsetIdx,
-            paramOut + offsetIdx,
-            moment1Out + offsetIdx,
-            moment2Out + offsetIdx,
-            beta1_,
-            beta2_,
-            epsilon_,
-            correction,
-            lr,
-            &context_);
-      }
-    }
+    const auto num_rows = Input(PARAM).dim(0);
+    const float corrected_lr = lr[0] * correction;
+    RunSparseUpdate(
+        &context_,
+        concurrency_,
+        paramOut,
+        num_rows,
+        n,
+        block_size,
+        indices,
+        [&](TIndex begin, TIndex end, TIndex row_begin, TIndex row_end) {
+          const auto done = SparseAdam<SIndex>(
+              end - begin,
+              block_size,
+              num_rows,
+              row_begin,
+              row_end,
+              indices + begin,
+              gradIn + begin * block_size,
+              paramIn,
+              moment1In,
+              moment2In,
+              paramOut,
+              moment1Out,
+              moment2Out,
+              beta1_,
+              beta2_,
+              epsilon_,
+              corrected_lr);
+          return begin + done;
+        });
     return true;
   }
 
@@ -225,6 +207,7 @@ class SparseAdamOp final : public Operator<Context> {
   T beta1_;
   T beta2_;
   T epsilon_;
+  SparseUpdateConcurrency concurrency_;
   INPUT_TAGS(PARAM, MOMENT_1, MOMENT_2, INDICES, GRAD, LR, ITER);
   OUTPUT_TAGS(OUTPUT_PARAM, OUTPUT_MOMENT_1, OUTPUT_MOMENT_2);
 };
@@ -16,6 +16,8 @@
 
 #include "ftrl_op.h"
 
+#include "caffe2/perfkernels/sparse_optimizers.h"
+
 namespace caffe2 {
 
 template <class T>
@@ -115,35 +117,33 @@ void SparseFtrlOp<T>::DoRun() {
   const SIndex* idxs = indices.template data<SIndex>();
   const T* g = grad.template data<T>();
 
-  // TODO(cxj): use OMP when it is reliable
-  // #pragma omp parallel for
-  for (TIndex i = 0; i < K; ++i) {
-    SIndex idx = idxs[i];
-    DCHECK(0 <= idx && idx < N) << "Index out of bounds: " << idx
-                                << ", range 0 to " << N;
-    if (block_size == 1) {
-      ftrl_compute(
-          w[idx],
-          nz[idx * 2],
-          nz[idx * 2 + 1],
-          g[i],
-          w[idx],
-          nz[idx * 2],
-          nz[idx * 2 + 1],
-          params_);
-    } else {
-      TIndex x = block_size * idx;
-      ftrl_update(
-          block_size,
-          w + x,
-          nz + x * 2,
-          g + i * block_size,
-          w + x,
-          nz + x * 2,
-          params_,
-          &context_);
-    }
-  }
+  RunSparseUpdate(
+      &context_,
+      concurrency_,
+      w,
+      N,
+      K,
+      block_size,
+      idxs,
+      [&](TIndex begin, TIndex end, TIndex row_begin, TIndex row_end) {
+        const auto done = SparseFtrl<SIndex>(
+            end - begin,
+            block_size,
+            N,
+            row_begin,
+            row_end,
+            idxs + begin,
+            g + begin * block_size,
+            w,
+            nz,
+            w,
+            nz,
+            params_.alphaInv,
+            params_.beta,
+            params_.lambda1,
+            params_.lambda2);
+        return begin + done;
+      });
 }
 
 namespace {
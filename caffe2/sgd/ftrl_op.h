@@ -17,6 +17,7 @@
 #pragma once
 
 #include "caffe2/core/operator.h"
+#include "caffe2/sgd/sparse_update_utils.h"
 
 namespace caffe2 {
 
@@ -56,7 +57,10 @@ template <typename T>
 class SparseFtrlOp final : public Operator<CPUContext> {
  public:
   SparseFtrlOp(const OperatorDef& operator_def, Workspace* ws)
-      : Operator<CPUContext>(operator_def, ws), params_(this) {
+      : Operator<CPUContext>(operator_def, ws),
+        params_(this),
+        concurrency_(ParseSparseUpdateConcurrency(
+            GetSingleArgument<string>("concurrency", "exclusive"))) {
     CAFFE_ENFORCE(
         !HasArgument("alpha") || ALPHA >= InputSize(),
         "Cannot specify alpha by both input and argument");
@@ -83,6 +87,7 @@ class SparseFtrlOp final : public Operator<CPUContext> {
 
  protected:
   FtrlParams<T> params_;
+  SparseUpdateConcurrency concurrency_;
   INPUT_TAGS(VAR, N_Z, INDICES, GRAD, ALPHA);
   OUTPUT_TAGS(OUTPUT_VAR, OUTPUT_N_Z);
 
@@ -126,6 +126,10 @@ same blobs).
     .Output(1, "output_moment", "Updated momentum.")
     .Output(2, "output_param", "Updated parameter")
     .Arg("momentum", "Momentum hyperparameter.")
-    .Arg("nesterov", "(boolean) Whether to use Nesterov Accelerated Gradient.");
+    .Arg("nesterov", "(boolean) Whether to use Nesterov Accelerated Gradient.")
+    .Arg(
+        "concurrency",
+        "Default exclusive. Set to hogwild to allow lock-free updates from "
+        "concurrent ops, or to consistent to lock each updated row.");
 SHOULD_NOT_DO_GRADIENT(SparseMomentumSGDUpdate);
 }
@@ -17,6 +17,7 @@
 #pragma once
 
 #include "caffe2/core/operator.h"
+#include "caffe2/sgd/sparse_update_utils.h"
 
 namespace caffe2 {
 
@@ -136,7 +137,10 @@ class SparseMomentumSGDUpdateOp final : public Operator<Context> {
   SparseMomentumSGDUpdateOp(const OperatorDef& operator_def, Workspace* ws)
       : Operator<Context>(operator_def, ws),
         momentum_(OperatorBase::GetSingleArgument<T>("momentum", 0.0)),
-        nesterov_(OperatorBase::GetSingleArgument<int>("nesterov", 0)) {}
+        nesterov_(OperatorBase::GetSingleArgument<int>("nesterov", 0)),
+        concurrency_(ParseSparseUpdateConcurrency(
+            OperatorBase::GetSingleArgument<string>(
+                "concurrency", "exclusive"))) {}
 
   bool RunOnDevice() override {
     // Resize [potentially] out-of-place blobs
@@ -167,32 +171,47 @@ class SparseMomentumSGDUpdateOp final : public Operator<Context> {
     auto* momentumOut = Output(OUTPUT_MOMENTUM)->template mutable_data<T>();
     auto* paramOut = Output(OUTPUT_PARAM)->template mutable_data<T>();
 
-    for (auto i = 0; i < n; ++i) {
-      auto idx = indices[i];
-      auto offsetI = i * block_size;
-      auto offsetIdx = idx * block_size;
-
-      CAFFE_ENFORCE(offsetIdx + block_size <= Input(PARAM).size());
-      CAFFE_ENFORCE(offsetI + block_size <= Input(GRAD).size());
-
-      momentum_sgd_update<Context>(
-          block_size,
-          gradIn + offsetI,
-          momentumIn + offsetIdx,
-          gradOut + offsetI,
-          momentumOut + offsetIdx,
-          lr,
-          momentum_,
-          nesterov_,
-          paramOut + offsetIdx,
-          &context_);
-    }
+    const auto num_rows = Input(PARAM).dim(0);
+    RunSparseUpdate(
+        &context_,
+        concurrency_,
+        paramOut,
+        num_rows,
+        n,
+        block_size,
+        indices,
+        [&](TIndex begin, TIndex end, TIndex row_begin, TIndex row_end) {
+          for (auto i = begin; i < end; ++i) {
+            const TIndex idx = indices[i];
+            if (idx < 0 || idx >= num_rows) {
+              return i;
+            }
+            if (idx < row_begin || idx >= row_end) {
+              continue;
+            }
+            auto offsetI = i * block_size;
+            auto offsetIdx = idx * block_size;
+            momentum_sgd_update<Context>(
+                block_size,
+                gradIn + offsetI,
+                momentumIn + offsetIdx,
+                gradOut + offsetI,
+                momentumOut + offsetIdx,
+                lr,
+                momentum_,
+                nesterov_,
+                paramOut + offsetIdx,
+                &context_);
+          }
+          return end;
+        });
     return true;
   }
 
  protected:
   T momentum_;
   bool nesterov_;
+  SparseUpdateConcurrency concurrency_;
   INPUT_TAGS(GRAD, MOMENTUM, LR, PARAM, INDICES);
   OUTPUT_TAGS(OUTPUT_GRAD, OUTPUT_MOMENTUM, OUTPUT_PARAM);
 };
@@ -0,0 +1,97 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "caffe2/sgd/multi_tensor_optimizer_ops.h"
+
+namespace caffe2 {
+
+namespace {
+
+bool SameIndex(int in, int out) {
+  return in == out;
+}
+
+} // namespace
+
+REGISTER_CPU_OPERATOR(MultiTensorAdagrad, MultiTensorAdagradOp<float>);
+OPERATOR_SCHEMA(MultiTensorAdagrad)
+    .NumInputsOutputs([](int in, int out) {
+      return in >= 4 && (in - 1) % 3 == 0 && out == (in - 1) / 3 * 2;
+    })
+    .AllowInplace(SameIndex)
+    .SetDoc(R"DOC(
+
+Runs the Adagrad update on a list of parameters at once. Given inputs
+(param_0, ..., param_{k-1}, moment_0, ..., moment_{k-1}, grad_0, ...,
+grad_{k-1}, lr), computes the same outputs as k Adagrad ops on
+(param_i, moment_i, grad_i, lr), and returns (param_0, ..., param_{k-1},
+moment_0, ..., moment_{k-1}). All the elements are updated in a single
+parallel loop, which saves the dispatch of many ops on small parameters.
+
+)DOC")
+    .Arg("epsilon", "Default 1e-5")
+    .Arg(
+        "decay",
+        "Default 1. If it is in (0, 1), the gradient square sum "
+        "is decayed by this factor.");
+
+REGISTER_CPU_OPERATOR(MultiTensorAdam, MultiTensorAdamOp<float>);
+OPERATOR_SCHEMA(MultiTensorAdam)
+    .NumInputsOutputs([](int in, int out) {
+      return in >= 6 && (in - 2) % 4 == 0 && out == (in - 2) / 4 * 3;
+    })
+    .AllowInplace(SameIndex)
+    .SetDoc(R"DOC(
+
+Runs the Adam update on a list of parameters at once. Given inputs
+(param_0, ..., param_{k-1}, moment1_0, ..., moment1_{k-1}, moment2_0, ...,
+moment2_{k-1}, grad_0, ..., grad_{k-1}, lr, iter), computes the same outputs
+as k Adam ops on (param_i, moment1_i, moment2_i, grad_i, lr, iter), and
+returns (param_0, ..., param_{k-1}, moment1_0, ..., moment1_{k-1},
+moment2_0, ..., moment2_{k-1}).
+
+)DOC")
+    .Arg("beta1", "Default 0.9")
+    .Arg("beta2", "Default 0.999")
+    .Arg("epsilon", "Default 1e-5");
+
+REGISTER_CPU_OPERATOR(
+    MultiTensorMomentumSGDUpdate,
+    MultiTensorMomentumSGDUpdateOp<float>);
+OPERATOR_SCHEMA(MultiTensorMomentumSGDUpdate)
+    .NumInputsOutputs([](int in, int out) {
+      return in >= 4 && (in - 1) % 3 == 0 && out == in - 1;
+    })
+    .AllowInplace(SameIndex)
+    .SetDoc(R"DOC(
+
+Runs the momentum SGD update on a list of parameters at once. Given inputs
+(grad_0, ..., grad_{k-1}, moment_0, ..., moment_{k-1}, param_0, ...,
+param_{k-1}, lr), computes the same outputs as k MomentumSGDUpdate ops on
+(grad_i, moment_i, lr, param_i), and returns (grad_0, ..., grad_{k-1},
+moment_0, ..., moment_{k-1}, param_0, ..., param_{k-1}). The parameters
+must be updated in place.
+
+)DOC")
+    .Arg("momentum", "Momentum hyperparameter.")
+    .Arg("nesterov", "(boolean) Whether to use Nesterov Accelerated Gradient.");
+
+SHOULD_NOT_DO_GRADIENT(MultiTensorAdagrad);
+SHOULD_NOT_DO_GRADIENT(MultiTensorAdam);
+SHOULD_NOT_DO_GRADIENT(MultiTensorMomentumSGDUpdate);
+
+} // namespace caffe2
@@ -0,0 +1,240 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <numeric>
+#include <vector>
+
+#include "caffe2/core/operator.h"
+#include "caffe2/utils/math.h"
+
+namespace caffe2 {
+
+// Splits the elements of a list of tensors with the given sizes between the
+// threads of the workspace pool, as if the tensors were concatenated, and
+// calls fn(tensor, begin, end) on every range of elements of a single tensor.
+inline void MultiTensorParallelFor(
+    CPUContext* context,
+    const std::vector<TIndex>& sizes,
+    TIndex work_per_element,
+    const std::function<void(size_t, TIndex, TIndex)>& fn) {
+  std::vector<TIndex> offsets(sizes.size() + 1, 0);
+  std::partial_sum(sizes.begin(), sizes.end(), offsets.begin() + 1);
+  context->ParallelFor(
+      offsets.back(),
+      CPUContext::ParallelForGrain(work_per_element),
+      [&](TIndex begin, TIndex end) {
+        size_t t = std::upper_bound(offsets.begin(), offsets.end(), begin) -
+            offsets.begin() - 1;
+        for (; begin < end; ++t) {
+          const TIndex tensor_end = std::min(end, offsets[t + 1]);
+          if (tensor_end > begin) {
+            fn(t, begin - offsets[t], tensor_end - offsets[t]);
+          }
+          begin = tensor_end;
+        }
+      });
+}
+
+// Adagrad on a list of parameters. Inputs are (param_0, ..., param_{k-1},
+// moment_0, ..., moment_{k-1}, grad_0, ..., grad_{k-1}, lr) and outputs are
+// (param_0, ..., param_{k-1}, moment_0, ..., moment_{k-1}).
+template <typename T>
+class MultiTensorAdagradOp final : public Operator<CPUContext> {
+ public:
+  MultiTensorAdagradOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<CPUContext>(operator_def, ws),
+        epsilon_(GetSingleArgument<T>("epsilon", 1e-5f)),
+        decay_(GetSingleArgument<T>("decay", 1.0f)) {}
+
+  bool RunOnDevice() override {
+    const int k = OutputSize() / 2;
+    CAFFE_ENFORCE_EQ(Input(3 * k).size(), 1);
+    const T lr = Input(3 * k).template data<T>()[0];
+    std::vector<TIndex> sizes(k);
+    std::vector<const T*> w(k), h(k), g(k);
+    std::vector<T*> nw(k), nh(k);
+    for (int i = 0; i < k; ++i) {
+      CAFFE_ENFORCE_EQ(Input(2 * k + i).size(), Input(i).size());
+      CAFFE_ENFORCE_EQ(Input(2 * k + i).size(), Input(k + i).size());
+      Output(i)->ResizeLike(Input(i));
+      Output(k + i)->ResizeLike(Input(k + i));
+      sizes[i] = Input(i).size();
+      w[i] = Input(i).template data<T>();
+      h[i] = Input(k + i).template data<T>();
+      g[i] = Input(2 * k + i).template data<T>();
+      nw[i] = Output(i)->template mutable_data<T>();
+      nh[i] = Output(k + i)->template mutable_data<T>();
+    }
+
+    MultiTensorParallelFor(
+        &context_, sizes, 5, [&](size_t t, TIndex begin, TIndex end) {
+          const TIndex n = end - begin;
+          ConstEigenVectorArrayMap<T> grad(g[t] + begin, n);
+          EigenVectorArrayMap<T> moment(nh[t] + begin, n);
+          moment = decay_ * ConstEigenVectorArrayMap<T>(h[t] + begin, n) +
+              grad.square();
+          EigenVectorArrayMap<T>(nw[t] + begin, n) =
+              ConstEigenVectorArrayMap<T>(w[t] + begin, n) +
+              lr * grad / (moment.sqrt() + epsilon_);
+        });
+    return true;
+  }
+
+ protected:
+  T epsilon_;
+  T decay_;
+};
+
+// Adam on a list of parameters. Inputs are (param_0, ..., param_{k-1},
+// moment1_0, ..., moment1_{k-1}, moment2_0, ..., moment2_{k-1}, grad_0, ...,
+// grad_{k-1}, lr, iter) and outputs are (param_0, ..., param_{k-1},
+// moment1_0, ..., moment1_{k-1}, moment2_0, ..., moment2_{k-1}).
+template <typename T>
+class MultiTensorAdamOp final : public Operator<CPUContext> {
+ public:
+  MultiTensorAdamOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<CPUContext>(operator_def, ws),
+        beta1_(GetSingleArgument<float>("beta1", 0.9f)),
+        beta2_(GetSingleArgument<float>("beta2", 0.999f)),
+        epsilon_(GetSingleArgument<float>("epsilon", 1e-5f)) {}
+
+  bool RunOnDevice() override {
+    const int k = OutputSize() / 3;
+    CAFFE_ENFORCE_EQ(Input(4 * k).size(), 1);
+    const T lr = Input(4 * k).template data<T>()[0];
+    const auto iter = Input(4 * k + 1).template data<int64_t>()[0];
+    const auto step = iter + 1;
+    const T correction = std::sqrt(T(1.) - std::pow(beta2_, step)) /
+        (T(1.) - std::pow(beta1_, step));
+
+    std::vector<TIndex> sizes(k);
+    std::vector<const T*> w(k), m(k), v(k), g(k);
+    std::vector<T*> nw(k), nm(k), nv(k);
+    for (int i = 0; i < k; ++i) {
+      for (int j = 1; j < 4; ++j) {
+        CAFFE_ENFORCE_EQ(Input(j * k + i).size(), Input(i).size());
+      }
+      for (int j = 0; j < 3; ++j) {
+        Output(j * k + i)->ResizeLike(Input(j * k + i));
+      }
+      sizes[i] = Input(i).size();
+      w[i] = Input(i).template data<T>();
+      m[i] = Input(k + i).template data<T>();
+      v[i] = Input(2 * k + i).template data<T>();
+      g[i] = Input(3 * k + i).template data<T>();
+      nw[i] = Output(i)->template mutable_data<T>();
+      nm[i] = Output(k + i)->template mutable_data<T>();
+      nv[i] = Output(2 * k + i)->template mutable_data<T>();
+    }
+
+    MultiTensorParallelFor(
+        &context_, sizes, 7, [&](size_t t, TIndex begin, TIndex end) {
+          const TIndex n = end - begin;
+          ConstEigenVectorArrayMap<T> grad(g[t] + begin, n);
+          EigenVectorArrayMap<T> moment1(nm[t] + begin, n);
+          EigenVectorArrayMap<T> moment2(nv[t] + begin, n);
+          moment1 = ConstEigenVectorArrayMap<T>(m[t] + begin, n) * beta1_ +
+              grad * (1 - beta1_);
+          moment2 = ConstEigenVectorArrayMap<T>(v[t] + begin, n) * beta2_ +
+              grad.square() * (1 - beta2_);
+          EigenVectorArrayMap<T>(nw[t] + begin, n) =
+              ConstEigenVectorArrayMap<T>(w[t] + begin, n) +
+              lr * correction * moment1 / (moment2.sqrt() + epsilon_);
+        });
+    return true;
+  }
+
+ protected:
+  T beta1_;
+  T beta2_;
+  T epsilon_;
+};
+
+// MomentumSGDUpdate on a list of parameters. Inputs are (grad_0, ...,
+// grad_{k-1}, moment_0, ..., moment_{k-1}, param_0, ..., param_{k-1}, lr) and
+// outputs are (grad_0, ..., grad_{k-1}, moment_0, ..., moment_{k-1}, param_0,
+// ..., param_{k-1}). The parameters are updated in place.
+template <typename T>
+class MultiTensorMomentumSGDUpdateOp final : public Operator<CPUContext> {
+ public:
+  MultiTensorMomentumSGDUpdateOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<CPUContext>(operator_def, ws),
+        momentum_(GetSingleArgument<T>("momentum", 0.0)),
+        nesterov_(GetSingleArgument<int>("nesterov", 0)) {}
+
+  bool RunOnDevice() override {
+    const int k = OutputSize() / 3;
+    CAFFE_ENFORCE_EQ(Input(3 * k).size(), 1);
+    const T lr = Input(3 * k).template data<T>()[0];
+    std::vector<TIndex> sizes(k);
+    std::vector<const T*> g(k), m(k);
+    std::vector<T*> ng(k), nm(k), param(k);
+    for (int i = 0; i < k; ++i) {
+      CAFFE_ENFORCE_EQ(Input(k + i).size(), Input(i).size());
+      CAFFE_ENFORCE_EQ(Input(2 * k + i).size(), Input(i).size());
+      CAFFE_ENFORCE_EQ(
+          &Input(2 * k + i),
+          Output(2 * k + i),
+          "The parameters must be updated in place");
+      Output(i)->ResizeLike(Input(i));
+      Output(k + i)->ResizeLike(Input(k + i));
+      sizes[i] = Input(i).size();
+      g[i] = Input(i).template data<T>();
+      m[i] = Input(k + i).template data<T>();
+      ng[i] = Output(i)->template mutable_data<T>();
+      nm[i] = Output(k + i)->template mutable_data<T>();
+      param[i] = Output(2 * k + i)->template mutable_data<T>();
+    }
+
+    // The gradients and the moments are usually updated in place, so the
+    // new moment of a block is kept aside until the adjusted gradient,
+    // which reads the old one, is written.
+    constexpr TIndex kBlockSize = 256;
+    MultiTensorParallelFor(
+        &context_, sizes, 5, [&](size_t t, TIndex begin, TIndex end) {
+          T buffer[kBlockSize];
+          for (TIndex b = begin; b < end; b += kBlockSize) {
+            const TIndex n = std::min(kBlockSize, end - b);
+            ConstEigenVectorArrayMap<T> grad(g[t] + b, n);
+            ConstEigenVectorArrayMap<T> moment(m[t] + b, n);
+            EigenVectorArrayMap<T> new_moment(buffer, n);
+            EigenVectorArrayMap<T> adjusted_grad(ng[t] + b, n);
+            if (!nesterov_) {
+              new_moment = lr * grad + momentum_ * moment;
+              adjusted_grad = new_moment;
+            } else {
+              new_moment = momentum_ * moment + lr * grad;
+              adjusted_grad = (1 + momentum_) * new_moment - momentum_ * moment;
+            }
+            EigenVectorArrayMap<T>(nm[t] + b, n) = new_moment;
+            EigenVectorArrayMap<T>(param[t] + b, n) -= adjusted_grad;
+          }
+        });
+    return true;
+  }
+
+ protected:
+  T momentum_;
+  bool nesterov_;
+};
+
+} // namespace caffe2
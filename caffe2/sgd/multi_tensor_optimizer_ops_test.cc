@@ -0,0 +1,186 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <cmath>
+
+#include <gtest/gtest.h>
+
+#include "caffe2/core/operator.h"
+#include "caffe2/core/scope_guard.h"
+#include "caffe2/utils/proto_utils.h"
+
+CAFFE2_DECLARE_int(caffe2_threadpool_num_threads);
+
+namespace caffe2 {
+
+namespace {
+
+// Sizes of the parameters, with an empty one and a few that do not fill
+// whole vectors or blocks.
+const vector<TIndex> kSizes = {3, 0, 1000, 17, 260};
+
+void FillTensor(Workspace* ws, const string& name, TIndex size, float lo) {
+  auto* tensor = ws->CreateBlob(name)->GetMutable<TensorCPU>();
+  tensor->Resize(size);
+  float* data = tensor->mutable_data<float>();
+  for (TIndex i = 0; i < size; ++i) {
+    data[i] = lo + static_cast<float>((i * 37 + name.size()) % 101) / 50.0f;
+  }
+}
+
+// Fills `ws` with the per-parameter blobs named <role>_<i> for every role and
+// parameter, the learning rate and the iteration counter.
+void FillWorkspace(Workspace* ws, const vector<string>& roles) {
+  for (size_t i = 0; i < kSizes.size(); ++i) {
+    for (const auto& role : roles) {
+      // Second moments must stay positive.
+      const float lo = role == "moment" || role == "moment2" ? 0.0f : -1.0f;
+      FillTensor(ws, role + "_" + caffe2::to_string(i), kSizes[i], lo);
+    }
+  }
+  FillTensor(ws, "lr", 1, -0.5f);
+  auto* iter = ws->CreateBlob("iter")->GetMutable<TensorCPU>();
+  iter->Resize(1);
+  iter->mutable_data<int64_t>()[0] = 3;
+}
+
+// Runs one `type` op per parameter, with the blobs of the given input and
+// output roles, then the multi-tensor op on the same initial blobs with its
+// elements split between threads, and checks that they write the same blobs.
+// `roles` are the per-parameter blobs; lr and iter are shared.
+void ExpectSameAsSingleOps(
+    const string& type,
+    const vector<string>& inputs,
+    const vector<string>& outputs,
+    const vector<string>& roles,
+    const vector<Argument>& args) {
+  auto name = [](const string& role, size_t i) {
+    return role == "lr" || role == "iter" ? role
+                                           : role + "_" + caffe2::to_string(i);
+  };
+
+  Workspace single_ws;
+  FillWorkspace(&single_ws, roles);
+  for (size_t i = 0; i < kSizes.size(); ++i) {
+    vector<string> op_inputs, op_outputs;
+    for (const auto& role : inputs) {
+      op_inputs.push_back(name(role, i));
+    }
+    for (const auto& role : outputs) {
+      op_outputs.push_back(name(role, i));
+    }
+    auto op = CreateOperator(
+        CreateOperatorDef(type, "", op_inputs, op_outputs, args), &single_ws);
+    ASSERT_TRUE(op->Run());
+  }
+
+  const int64_t old_min_work = FLAGS_caffe2_parallel_for_min_work;
+  const int old_num_threads = FLAGS_caffe2_threadpool_num_threads;
+  auto guard = MakeGuard([&]() {
+    FLAGS_caffe2_parallel_for_min_work = old_min_work;
+    FLAGS_caffe2_threadpool_num_threads = old_num_threads;
+  });
+  FLAGS_caffe2_parallel_for_min_work = 1;
+  FLAGS_caffe2_threadpool_num_threads = 4;
+  Workspace multi_ws;
+  FillWorkspace(&multi_ws, roles);
+  vector<string> op_inputs, op_outputs;
+  for (const auto& role : inputs) {
+    if (role == "lr" || role == "iter") {
+      continue;
+    }
+    for (size_t i = 0; i < kSizes.size(); ++i) {
+      op_inputs.push_back(name(role, i));
+    }
+  }
+  for (const auto& role : inputs) {
+    if (role == "lr" || role == "iter") {
+      op_inputs.push_back(role);
+    }
+  }
+  for (const auto& role : outputs) {
+    for (size_t i = 0; i < kSizes.size(); ++i) {
+      op_outputs.push_back(name(role, i));
+    }
+  }
+  auto op = CreateOperator(
+      CreateOperatorDef(
+          "MultiTensor" + type, "", op_inputs, op_outputs, args),
+      &multi_ws);
+  EXPECT_TRUE(op->Run());
+
+  for (const auto& role : outputs) {
+    for (size_t i = 0; i < kSizes.size(); ++i) {
+      const auto& expected =
+          single_ws.GetBlob(name(role, i))->Get<TensorCPU>();
+      const auto& actual = multi_ws.GetBlob(name(role, i))->Get<TensorCPU>();
+      ASSERT_EQ(expected.dims(), actual.dims());
+      for (TIndex j = 0; j < expected.size(); ++j) {
+        const float e = expected.data<float>()[j];
+        EXPECT_NEAR(e, actual.data<float>()[j], 1e-6 * std::max(1.0f, std::abs(e)))
+            << type << " " << name(role, i) << "[" << j << "]";
+      }
+    }
+  }
+}
+
+} // namespace
+
+TEST(MultiTensorOptimizerOpsTest, Adagrad) {
+  ExpectSameAsSingleOps(
+      "Adagrad",
+      {"param", "moment", "grad", "lr"},
+      {"param", "moment"},
+      {"param", "moment", "grad"},
+      {MakeArgument<float>("decay", 0.9f)});
+}
+
+TEST(MultiTensorOptimizerOpsTest, Adam) {
+  ExpectSameAsSingleOps(
+      "Adam",
+      {"param", "moment1", "moment2", "grad", "lr", "iter"},
+      {"param", "moment1", "moment2"},
+      {"param", "moment1", "moment2", "grad"},
+      {MakeArgument<float>("beta1", 0.8f)});
+}
+
+TEST(MultiTensorOptimizerOpsTest, MomentumSGDUpdate) {
+  for (int nesterov : {0, 1}) {
+    ExpectSameAsSingleOps(
+        "MomentumSGDUpdate",
+        {"grad", "moment", "lr", "param"},
+        {"grad", "moment", "param"},
+        {"grad", "moment", "param"},
+        {MakeArgument<float>("momentum", 0.9f),
+         MakeArgument<int>("nesterov", nesterov)});
+  }
+}
+
+TEST(MultiTensorOptimizerOpsTest, MomentumSGDUpdateRequiresInPlaceParams) {
+  Workspace ws;
+  FillWorkspace(&ws, {"grad", "moment", "param"});
+  auto op = CreateOperator(
+      CreateOperatorDef(
+          "MultiTensorMomentumSGDUpdate",
+          "",
+          {"grad_0", "moment_0", "param_0", "lr"},
+          {"grad_0", "moment_0", "new_param_0"}),
+      &ws);
+  EXPECT_THROW(op->Run(), EnforceNotMet);
+}
+
+} // namespace caffe2
@@ -0,0 +1,428 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <cmath>
+#include <limits>
+
+#include <gtest/gtest.h>
+
+#include "caffe2/core/operator.h"
+#include "caffe2/core/scope_guard.h"
+#include "caffe2/utils/proto_utils.h"
+
+CAFFE2_DECLARE_int(caffe2_threadpool_num_threads);
+
+namespace caffe2 {
+
+namespace {
+
+const TIndex kNumRows = 23;
+const float kLr = -0.1f;
+const float kEpsilon = 1e-5f;
+const int64_t kIter = 4;
+
+// Duplicate indices, spread over the rows of all the threads.
+const vector<int64_t> kIndices = {3, 17, 0, 22, 3, 9, 17, 17, 11, 0, 5, 21};
+
+vector<float> Values(TIndex size, float lo, float hi) {
+  vector<float> values(size);
+  for (TIndex i = 0; i < size; ++i) {
+    values[i] = lo + (hi - lo) * static_cast<float>((i * 37) % 101) / 100.0f;
+  }
+  return values;
+}
+
+struct NamedValues {
+  string name;
+  vector<TIndex> dims;
+  vector<float> data;
+};
+
+// Runs the in-place optimizer `def` on the float blobs, the indices stored as
+// SIndex and, if the op reads it, the iteration counter. Returns the blobs
+// after the update. A minimum work of 1 splits the rows between the threads
+// of the workspace pool; a huge one keeps everything on the calling thread.
+template <typename SIndex>
+vector<NamedValues> RunOp(
+    const OperatorDef& def,
+    vector<NamedValues> blobs,
+    const vector<int64_t>& indices,
+    int64_t min_work) {
+  const int64_t old_min_work = FLAGS_caffe2_parallel_for_min_work;
+  const int old_num_threads = FLAGS_caffe2_threadpool_num_threads;
+  auto guard = MakeGuard([&]() {
+    FLAGS_caffe2_parallel_for_min_work = old_min_work;
+    FLAGS_caffe2_threadpool_num_threads = old_num_threads;
+  });
+  FLAGS_caffe2_parallel_for_min_work = min_work;
+  FLAGS_caffe2_threadpool_num_threads = 4;
+  Workspace ws;
+  for (const auto& blob : blobs) {
+    auto* tensor = ws.CreateBlob(blob.name)->GetMutable<TensorCPU>();
+    tensor->Resize(blob.dims);
+    std::copy(
+        blob.data.begin(), blob.data.end(), tensor->mutable_data<float>());
+  }
+  auto* index_tensor = ws.CreateBlob("indices")->GetMutable<TensorCPU>();
+  index_tensor->Resize(indices.size());
+  std::copy(
+      indices.begin(), indices.end(), index_tensor->mutable_data<SIndex>());
+  auto* iter = ws.CreateBlob("iter")->GetMutable<TensorCPU>();
+  iter->Resize(1);
+  iter->mutable_data<int64_t>()[0] = kIter;
+
+  auto op = CreateOperator(def, &ws);
+  EXPECT_TRUE(op->Run());
+  for (auto& blob : blobs) {
+    const auto& tensor = ws.GetBlob(blob.name)->Get<TensorCPU>();
+    const float* data = tensor.data<float>();
+    blob.data.assign(data, data + tensor.size());
+  }
+  return blobs;
+}
+
+// Checks that the serial and the multithreaded runs of `def`, and its runs in
+// the concurrent modes, all match the expected blobs.
+void ExpectUpdate(
+    const OperatorDef& def,
+    const vector<NamedValues>& blobs,
+    const vector<NamedValues>& expected) {
+  const vector<std::pair<string, int64_t>> configs = {
+      {"exclusive", std::numeric_limits<int64_t>::max()},
+      {"exclusive", 1},
+      {"hogwild", 1},
+      {"consistent", 1}};
+  for (const auto& config : configs) {
+    OperatorDef concurrent_def = def;
+    concurrent_def.add_arg()->CopyFrom(
+        MakeArgument<string>("concurrency", config.first));
+    const int64_t min_work = config.second;
+    for (int index_bits : {32, 64}) {
+      const auto actual = index_bits == 32
+          ? RunOp<int32_t>(concurrent_def, blobs, kIndices, min_work)
+          : RunOp<int64_t>(concurrent_def, blobs, kIndices, min_work);
+      for (size_t b = 0; b < expected.size(); ++b) {
+        for (size_t i = 0; i < expected[b].data.size(); ++i) {
+          const float e = expected[b].data[i];
+          EXPECT_NEAR(
+              e, actual[b].data[i], 1e-5f * std::max(1.0f, std::abs(e)))
+              << def.type() << " " << expected[b].name << "[" << i << "], "
+              << config.first << ", min work " << min_work << ", "
+              << index_bits << "-bit indices";
+        }
+      }
+    }
+  }
+}
+
+// Block sizes that cover the scalar path and the vector tails.
+const vector<TIndex> kBlockSizes = {1, 5, 8, 37};
+
+} // namespace
+
+TEST(SparseOptimizersTest, SparseAdagrad) {
+  for (TIndex block_size : kBlockSizes) {
+    const TIndex n = kIndices.size();
+    vector<NamedValues> blobs = {
+        {"param", {kNumRows, block_size}, Values(kNumRows * block_size, -1, 1)},
+        {"moment", {kNumRows, block_size}, Values(kNumRows * block_size, 0, 2)},
+        {"grad", {n, block_size}, Values(n * block_size, -3, 3)},
+        {"lr", {1}, {kLr}}};
+    auto expected = blobs;
+    auto& w = expected[0].data;
+    auto& h = expected[1].data;
+    const auto& g = expected[2].data;
+    for (TIndex i = 0; i < n; ++i) {
+      for (TIndex j = 0; j < block_size; ++j) {
+        const TIndex x = kIndices[i] * block_size + j;
+        const float gi = g[i * block_size + j];
+        h[x] += gi * gi;
+        w[x] += kLr * gi / (std::sqrt(h[x]) + kEpsilon);
+      }
+    }
+    ExpectUpdate(
+        CreateOperatorDef(
+            "SparseAdagrad",
+            "",
+            {"param", "moment", "indices", "grad", "lr"},
+            {"param", "moment"},
+            {MakeArgument<float>("epsilon", kEpsilon)}),
+        blobs,
+        expected);
+  }
+}
+
+TEST(SparseOptimizersTest, RowWiseSparseAdagrad) {
+  for (TIndex block_size : kBlockSizes) {
+    const TIndex n = kIndices.size();
+    vector<NamedValues> blobs = {
+        {"param", {kNumRows, block_size}, Values(kNumRows * block_size, -1, 1)},
+        {"moment", {kNumRows}, Values(kNumRows, 0, 2)},
+        {"grad", {n, block_size}, Values(n * block_size, -3, 3)},
+        {"lr", {1}, {kLr}}};
+    auto expected = blobs;
+    auto& w = expected[0].data;
+    auto& h = expected[1].data;
+    const auto& g = expected[2].data;
+    for (TIndex i = 0; i < n; ++i) {
+      const TIndex idx = kIndices[i];
+      float hs = 0;
+      for (TIndex j = 0; j < block_size; ++j) {
+        hs += g[i * block_size + j] * g[i * block_size + j];
+      }
+      h[idx] += hs / block_size;
+      const float step = kLr / (std::sqrt(h[idx]) + kEpsilon);
+      for (TIndex j = 0; j < block_size; ++j) {
+        w[idx * block_size + j] += g[i * block_size + j] * step;
+      }
+    }
+    ExpectUpdate(
+        CreateOperatorDef(
+            "RowWiseSparseAdagrad",
+            "",
+            {"param", "moment", "indices", "grad", "lr"},
+            {"param", "moment"},
+            {MakeArgument<float>("epsilon", kEpsilon)}),
+        blobs,
+        expected);
+  }
+}
+
+TEST(SparseOptimizersTest, SparseAdam) {
+  const float beta1 = 0.9f;
+  const float beta2 = 0.999f;
+  const float correction = std::sqrt(1.0f - std::pow(beta2, kIter + 1)) /
+      (1.0f - std::pow(beta1, kIter + 1));
+  for (TIndex block_size : kBlockSizes) {
+    const TIndex n = kIndices.size();
+    const TIndex size = kNumRows * block_size;
+    vector<NamedValues> blobs = {
+        {"param", {kNumRows, block_size}, Values(size, -1, 1)},
+        {"moment1", {kNumRows, block_size}, Values(size, -1, 1)},
+        {"moment2", {kNumRows, block_size}, Values(size, 0, 2)},
+        {"grad", {n, block_size}, Values(n * block_size, -3, 3)},
+        {"lr", {1}, {kLr}}};
+    auto expected = blobs;
+    auto& w = expected[0].data;
+    auto& m = expected[1].data;
+    auto& v = expected[2].data;
+    const auto& g = expected[3].data;
+    for (TIndex i = 0; i < n; ++i) {
+      for (TIndex j = 0; j < block_size; ++j) {
+        const TIndex x = kIndices[i] * block_size + j;
+        const float gi = g[i * block_size + j];
+        m[x] = m[x] * beta1 + gi * (1 - beta1);
+        v[x] = v[x] * beta2 + gi * gi * (1 - beta2);
+        w[x] += kLr * correction * m[x] / (std::sqrt(v[x]) + kEpsilon);
+      }
+    }
+    ExpectUpdate(
+        CreateOperatorDef(
+            "SparseAdam",
+            "",
+            {"param", "moment1", "moment2", "indices", "grad", "lr", "iter"},
+            {"param", "moment1", "moment2"},
+            {MakeArgument<float>("beta1", beta1),
+             MakeArgument<float>("beta2", beta2),
+             MakeArgument<float>("epsilon", kEpsilon)}),
+        blobs,
+        expected);
+  }
+}
+
+TEST(SparseOptimizersTest, SparseFtrl) {
+  const float alpha = 0.5f;
+  const float beta = 1.0f;
+  const float lambda1 = 0.05f;
+  const float lambda2 = 0.01f;
+  for (TIndex block_size : kBlockSizes) {
+    const TIndex n = kIndices.size();
+    const TIndex size = kNumRows * block_size;
+    vector<NamedValues> blobs = {
+        {"var", {kNumRows, block_size}, Values(size, -1, 1)},
+        {"n_z", {kNumRows, block_size, 2}, Values(2 * size, 0, 2)},
+        {"grad", {n, block_size}, Values(n * block_size, -3, 3)}};
+    auto expected = blobs;
+    auto& w = expected[0].data;
+    auto& nz = expected[1].data;
+    const auto& g = expected[2].data;
+    for (TIndex i = 0; i < n; ++i) {
+      for (TIndex j = 0; j < block_size; ++j) {
+        const TIndex x = kIndices[i] * block_size + j;
+        const float gi = g[i * block_size + j];
+        const float new_n = nz[2 * x] + gi * gi;
+        const float sigma = (std::sqrt(new_n) - std::sqrt(nz[2 * x])) / alpha;
+        nz[2 * x] = new_n;
+        const float z = nz[2 * x + 1] += gi - sigma * w[x];
+        w[x] = std::abs(z) > lambda1
+            ? (lambda1 * (z < 0 ? -1 : 1) - z) /
+                ((beta + std::sqrt(new_n)) / alpha + lambda2)
+            : 0.0f;
+      }
+    }
+    ExpectUpdate(
+        CreateOperatorDef(
+            "SparseFtrl",
+            "",
+            {"var", "n_z", "indices", "grad"},
+            {"var", "n_z"},
+            {MakeArgument<float>("alpha", alpha),
+             MakeArgument<float>("beta", beta),
+             MakeArgument<float>("lambda1", lambda1),
+             MakeArgument<float>("lambda2", lambda2)}),
+        blobs,
+        expected);
+  }
+}
+
+TEST(SparseOptimizersTest, SparseMomentumSGDUpdate) {
+  const float momentum = 0.9f;
+  for (int nesterov : {0, 1}) {
+    for (TIndex block_size : kBlockSizes) {
+      const TIndex n = kIndices.size();
+      const TIndex size = kNumRows * block_size;
+      vector<NamedValues> blobs = {
+          {"param", {kNumRows, block_size}, Values(size, -1, 1)},
+          {"moment", {kNumRows, block_size}, Values(size, -1, 1)},
+          {"grad", {n, block_size}, Values(n * block_size, -3, 3)},
+          {"lr", {1}, {-kLr}}};
+      auto expected = blobs;
+      auto& w = expected[0].data;
+      auto& m = expected[1].data;
+      const auto& g = expected[2].data;
+      for (TIndex i = 0; i < n; ++i) {
+        for (TIndex j = 0; j < block_size; ++j) {
+          const TIndex x = kIndices[i] * block_size + j;
+          const float gi = g[i * block_size + j];
+          if (nesterov) {
+            const float mi = m[x];
+            m[x] = momentum * mi - kLr * gi;
+            w[x] -= (1 + momentum) * m[x] - momentum * mi;
+          } else {
+            m[x] = -kLr * gi + momentum * m[x];
+            w[x] -= m[x];
+          }
+        }
+      }
+      ExpectUpdate(
+          CreateOperatorDef(
+              "SparseMomentumSGDUpdate",
+              "",
+              {"grad", "moment", "lr", "param", "indices"},
+              {"adjusted_grad", "moment", "param"},
+              {MakeArgument<float>("momentum", momentum),
+               MakeArgument<int>("nesterov", nesterov)}),
+          blobs,
+          expected);
+    }
+  }
+}
+
+// Concurrent substeps of a plan update one parameter through ops in the
+// consistent mode. With a learning rate of 1, no momentum and unit gradients
+// every update subtracts 1 from its row, so all the updates must show up
+// exactly in the final parameter, whatever their interleaving.
+TEST(SparseOptimizersTest, ConsistentConcurrentSubsteps) {
+  const int kNumSubsteps = 4;
+  const int kNumIter = 200;
+  const TIndex block_size = 16;
+  const TIndex n = kIndices.size();
+  Workspace ws;
+  auto fill = [&](const string& name, vector<TIndex> dims, float value) {
+    auto* tensor = ws.CreateBlob(name)->GetMutable<TensorCPU>();
+    tensor->Resize(dims);
+    std::fill(
+        tensor->mutable_data<float>(),
+        tensor->mutable_data<float>() + tensor->size(),
+        value);
+  };
+  fill("param", {kNumRows, block_size}, 0);
+  fill("moment", {kNumRows, block_size}, 0);
+  fill("lr", {1}, 1);
+  auto* indices = ws.CreateBlob("indices")->GetMutable<TensorCPU>();
+  indices->Resize(n);
+  std::copy(kIndices.begin(), kIndices.end(), indices->mutable_data<int64_t>());
+
+  PlanDef plan;
+  plan.set_name("hogwild_plan");
+  auto* step = plan.add_execution_step();
+  step->set_name("trainers");
+  step->set_concurrent_substeps(true);
+  for (int t = 0; t < kNumSubsteps; ++t) {
+    const string suffix = caffe2::to_string(t);
+    fill("grad_" + suffix, {n, block_size}, 1);
+    auto* net = plan.add_network();
+    net->set_name("trainer_" + suffix);
+    net->add_op()->CopyFrom(CreateOperatorDef(
+        "SparseMomentumSGDUpdate",
+        "",
+        {"grad_" + suffix, "moment", "lr", "param", "indices"},
+        {"adjusted_grad_" + suffix, "moment", "param"},
+        {MakeArgument<string>("concurrency", "consistent")}));
+    auto* substep = step->add_substep();
+    substep->set_name("trainer_step_" + suffix);
+    substep->add_network(net->name());
+    substep->set_num_iter(kNumIter);
+  }
+  ASSERT_TRUE(ws.RunPlan(plan));
+
+  vector<float> expected(kNumRows, 0);
+  for (auto idx : kIndices) {
+    expected[idx] -= kNumSubsteps * kNumIter;
+  }
+  const auto& param = ws.GetBlob("param")->Get<TensorCPU>();
+  for (TIndex r = 0; r < kNumRows; ++r) {
+    for (TIndex j = 0; j < block_size; ++j) {
+      EXPECT_EQ(expected[r], param.data<float>()[r * block_size + j])
+          << "row " << r;
+    }
+  }
+}
+
+TEST(SparseOptimizersTest, UnknownConcurrency) {
+  Workspace ws;
+  EXPECT_THROW(
+      CreateOperator(
+          CreateOperatorDef(
+              "SparseAdagrad",
+              "",
+              {"param", "moment", "indices", "grad", "lr"},
+              {"param", "moment"},
+              {MakeArgument<string>("concurrency", "optimistic")}),
+          &ws),
+      EnforceNotMet);
+}
+
+TEST(SparseOptimizersTest, IndexOutOfBounds) {
+  const vector<NamedValues> blobs = {
+      {"param", {kNumRows, 4}, Values(kNumRows * 4, -1, 1)},
+      {"moment", {kNumRows, 4}, Values(kNumRows * 4, 0, 2)},
+      {"grad", {2, 4}, Values(8, -3, 3)},
+      {"lr", {1}, {kLr}}};
+  const auto def = CreateOperatorDef(
+      "SparseAdagrad",
+      "",
+      {"param", "moment", "indices", "grad", "lr"},
+      {"param", "moment"});
+  for (int64_t min_work : {std::numeric_limits<int64_t>::max(), int64_t(1)}) {
+    EXPECT_THROW(
+        RunOp<int64_t>(def, blobs, {1, kNumRows}, min_work), EnforceNotMet);
+    EXPECT_THROW(RunOp<int32_t>(def, blobs, {-1, 2}, min_work), EnforceNotMet);
+  }
+}
+
+} // namespace caffe2
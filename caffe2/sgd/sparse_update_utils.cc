@@ -0,0 +1,57 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "caffe2/sgd/sparse_update_utils.h"
+
+#include "caffe2/utils/threadpool/ThreadPool.h"
+
+namespace caffe2 {
+
+namespace {
+
+const size_t kNumRowLocks = 4096;
+
+struct alignas(kCacheLineSize) PaddedSpinLock {
+  SpinLock lock;
+};
+
+PaddedSpinLock row_locks[kNumRowLocks];
+
+} // namespace
+
+SparseUpdateConcurrency ParseSparseUpdateConcurrency(const string& name) {
+  if (name == "exclusive") {
+    return SparseUpdateConcurrency::EXCLUSIVE;
+  }
+  if (name == "hogwild") {
+    return SparseUpdateConcurrency::HOGWILD;
+  }
+  if (name == "consistent") {
+    return SparseUpdateConcurrency::CONSISTENT;
+  }
+  CAFFE_THROW(
+      "Unknown concurrency: ",
+      name,
+      ", expected exclusive, hogwild or consistent");
+}
+
+SpinLock& SparseRowLock(const void* param, TIndex row) {
+  const size_t base = reinterpret_cast<uintptr_t>(param) / kCacheLineSize;
+  return row_locks[(base + static_cast<size_t>(row)) % kNumRowLocks].lock;
+}
+
+} // namespace caffe2
@@ -0,0 +1,138 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+#include "caffe2/core/context.h"
+#include "caffe2/core/logging.h"
+
+namespace caffe2 {
+
+// Grain, in parameter rows, for splitting a sparse update of num_indices rows
+// of block_size elements between threads by ranges of parameter rows. Every
+// range reads all the indices and only updates its own rows, so the number
+// of ranges follows the amount of update work, not the size of the parameter.
+inline TIndex SparseUpdateRowGrain(
+    TIndex num_rows,
+    TIndex num_indices,
+    TIndex block_size) {
+  const TIndex ranges = std::max<TIndex>(
+      num_indices * block_size / CPUContext::ParallelForGrain(1), 1);
+  return std::max<TIndex>((num_rows + ranges - 1) / ranges, 1);
+}
+
+// How a sparse optimizer may run concurrently with other ops updating the
+// same parameter, e.g. in the concurrent substeps of a plan. Selected with
+// the "concurrency" argument of the ops.
+enum class SparseUpdateConcurrency {
+  // The op is the only writer of the parameter while it runs ("exclusive",
+  // the default). The rows are split between the threads of the workspace
+  // pool.
+  EXCLUSIVE,
+  // Lock-free Hogwild updates ("hogwild"). Concurrent updates of the same
+  // row may interleave and lose part of their effect. The op runs on the
+  // calling thread, as the parallelism comes from the concurrent ops.
+  HOGWILD,
+  // Every row is updated under its lock in a striped spinlock table shared
+  // by the whole process ("consistent"), so concurrent updates of a row are
+  // serialized. The op runs on the calling thread.
+  CONSISTENT,
+};
+
+SparseUpdateConcurrency ParseSparseUpdateConcurrency(const string& name);
+
+// Test-and-test-and-set lock for short critical sections.
+class SpinLock {
+ public:
+  void lock() {
+    while (locked_.exchange(true, std::memory_order_acquire)) {
+      while (locked_.load(std::memory_order_relaxed)) {
+        std::this_thread::yield();
+      }
+    }
+  }
+
+  void unlock() {
+    locked_.store(false, std::memory_order_release);
+  }
+
+ private:
+  std::atomic<bool> locked_{false};
+};
+
+// Returns the lock of a row of the parameter stored at `param`. Locks are
+// striped: a fixed table is shared by all the parameters of the process, and
+// consecutive rows of a parameter map to distinct locks.
+SpinLock& SparseRowLock(const void* param, TIndex row);
+
+// Applies a sparse update of indices[0], ..., indices[num_indices - 1] to a
+// parameter with num_rows rows stored at `param`, with the given
+// concurrency. update(begin, end, row_begin, row_end) must apply indices
+// [begin, end) in order, skip those outside rows [row_begin, row_end), and
+// return the position of the first index outside [0, num_rows), or end.
+template <typename SIndex, typename Update>
+void RunSparseUpdate(
+    CPUContext* context,
+    SparseUpdateConcurrency concurrency,
+    const void* param,
+    TIndex num_rows,
+    TIndex num_indices,
+    TIndex block_size,
+    const SIndex* indices,
+    const Update& update) {
+  auto check = [&](TIndex done, TIndex end) {
+    CAFFE_ENFORCE_EQ(
+        done,
+        end,
+        "Index out of bounds: ",
+        indices[done],
+        " at position ",
+        done,
+        ", range 0 to ",
+        num_rows);
+  };
+  switch (concurrency) {
+    case SparseUpdateConcurrency::EXCLUSIVE:
+      // Every thread owns a range of rows, so the updates of duplicate
+      // indices keep their order.
+      context->ParallelFor(
+          num_rows,
+          SparseUpdateRowGrain(num_rows, num_indices, block_size),
+          [&](TIndex row_begin, TIndex row_end) {
+            check(update(0, num_indices, row_begin, row_end), num_indices);
+          });
+      break;
+    case SparseUpdateConcurrency::HOGWILD:
+      check(update(0, num_indices, 0, num_rows), num_indices);
+      break;
+    case SparseUpdateConcurrency::CONSISTENT:
+      for (TIndex i = 0; i < num_indices; ++i) {
+        const TIndex row = indices[i];
+        check(0 <= row && row < num_rows ? i + 1 : i, i + 1);
+        std::lock_guard<SpinLock> guard(SparseRowLock(param, row));
+        check(update(i, i + 1, row, row + 1), i + 1);
+      }
+      break;
+  }
+}
+
+} // namespace caffe2
@@ -0,0 +1,236 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "caffe2/transforms/fuse_dense_optimizers_transform.h"
+
+#include <algorithm>
+#include <set>
+
+#include "caffe2/core/common.h"
+#include "caffe2/proto/caffe2.pb.h"
+
+namespace caffe2 {
+
+using transform::Graph;
+using transform::Node;
+
+namespace {
+
+struct DenseOptimizer {
+  string type;
+  string fused_type;
+  int num_inputs;
+  int num_outputs;
+  // Inputs of every parameter, in the order of the fused op.
+  std::vector<int> tensor_inputs;
+  // Inputs shared by the whole group, which follow the other ones.
+  std::vector<int> shared_inputs;
+  // (input, output) pairs that the fused op requires to be in place.
+  std::vector<std::pair<int, int>> inplace;
+};
+
+const std::vector<DenseOptimizer>& DenseOptimizers() {
+  static const std::vector<DenseOptimizer> optimizers = {
+      {"Adagrad", "MultiTensorAdagrad", 4, 2, {0, 1, 2}, {3}, {}},
+      {"Adam", "MultiTensorAdam", 6, 3, {0, 1, 2, 3}, {4, 5}, {}},
+      {"MomentumSGDUpdate",
+       "MultiTensorMomentumSGDUpdate",
+       4,
+       3,
+       {0, 1, 3},
+       {2},
+       {{3, 2}}},
+  };
+  return optimizers;
+}
+
+// Returns the description of a CPU optimizer op that can be fused, or null.
+const DenseOptimizer* FusableOptimizer(const OperatorDef& op) {
+  if (op.device_option().device_type() != CPU) {
+    return nullptr;
+  }
+  for (const auto& optimizer : DenseOptimizers()) {
+    if (op.type() != optimizer.type ||
+        op.input_size() != optimizer.num_inputs ||
+        op.output_size() != optimizer.num_outputs) {
+      continue;
+    }
+    for (const auto& pair : optimizer.inplace) {
+      if (op.input(pair.first) != op.output(pair.second)) {
+        return nullptr;
+      }
+    }
+    return &optimizer;
+  }
+  return nullptr;
+}
+
+std::map<string, string> SerializedArgs(const OperatorDef& op) {
+  std::map<string, string> args;
+  for (const auto& arg : op.arg()) {
+    args[arg.name()] = arg.SerializeAsString();
+  }
+  return args;
+}
+
+bool SameGroup(
+    const DenseOptimizer& optimizer,
+    const OperatorDef& a,
+    const OperatorDef& b) {
+  if (a.type() != b.type() || a.engine() != b.engine()) {
+    return false;
+  }
+  for (int i : optimizer.shared_inputs) {
+    if (a.input(i) != b.input(i)) {
+      return false;
+    }
+  }
+  return SerializedArgs(a) == SerializedArgs(b);
+}
+
+} // namespace
+
+bool FuseDenseOptimizersTransform::PatternRule(
+    const Graph& g,
+    const std::vector<int>& subgraph,
+    int idx) {
+  const OperatorDef& op = g.node(idx).op;
+  const DenseOptimizer* optimizer = FusableOptimizer(op);
+  if (!optimizer) {
+    return false;
+  }
+  if (subgraph.size() == 0) {
+    return true;
+  }
+  const OperatorDef& head = g.node(subgraph.front()).op;
+  if (!SameGroup(*optimizer, head, op)) {
+    return false;
+  }
+
+  // The group only grows with the next op of its kind, which keeps the
+  // matching linear in the number of ops.
+  for (int j = subgraph.back() + 1; j < idx; ++j) {
+    const OperatorDef& other = g.node(j).op;
+    if (g.node(j).active && FusableOptimizer(other) == optimizer &&
+        SameGroup(*optimizer, head, other)) {
+      return false;
+    }
+  }
+
+  // The updates of the group are delayed until idx, so neither the ops in
+  // between nor idx itself may touch the blobs they write, or overwrite the
+  // blobs they read.
+  std::set<string> reads;
+  std::set<string> writes;
+  for (int i : subgraph) {
+    const OperatorDef& member = g.node(i).op;
+    reads.insert(member.input().begin(), member.input().end());
+    writes.insert(member.output().begin(), member.output().end());
+  }
+  auto conflicts = [&](const OperatorDef& other) {
+    for (const auto& input : other.input()) {
+      if (writes.count(input)) {
+        return true;
+      }
+    }
+    for (const auto& output : other.output()) {
+      if (reads.count(output) || writes.count(output)) {
+        return true;
+      }
+    }
+    return false;
+  };
+  for (int j = subgraph.back() + 1; j <= idx; ++j) {
+    if (g.node(j).active && conflicts(g.node(j).op)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool FuseDenseOptimizersTransform::ValidatorRule(
+    const Graph& g,
+    const std::vector<int>& subgraph) {
+  return subgraph.size() >= 2;
+}
+
+bool FuseDenseOptimizersTransform::ReplaceRule(
+    const std::vector<int>& subgraph,
+    Graph* g_ptr) {
+  CHECK(g_ptr);
+  auto& g = *g_ptr;
+  const OperatorDef& head = g.node(subgraph.front()).op;
+  const DenseOptimizer* optimizer = FusableOptimizer(head);
+  CHECK(optimizer);
+
+  OperatorDef fused = head;
+  fused.set_type(optimizer->fused_type);
+  fused.clear_input();
+  fused.clear_output();
+  for (int i : optimizer->tensor_inputs) {
+    for (int node : subgraph) {
+      fused.add_input(g.node(node).op.input(i));
+    }
+  }
+  for (int i : optimizer->shared_inputs) {
+    fused.add_input(head.input(i));
+  }
+  for (int i = 0; i < optimizer->num_outputs; ++i) {
+    for (int node : subgraph) {
+      fused.add_output(g.node(node).op.output(i));
+    }
+  }
+
+  // The last node of the group becomes the fused op, connected to the
+  // producers and the readers of all the ops of the group.
+  auto add_blobs = [](std::vector<string>* blobs,
+                      const std::vector<string>& more) {
+    for (const auto& blob : more) {
+      if (std::find(blobs->begin(), blobs->end(), blob) == blobs->end()) {
+        blobs->push_back(blob);
+      }
+    }
+  };
+  std::map<int, std::vector<string>> parents;
+  std::map<int, std::vector<string>> children;
+  for (int node : subgraph) {
+    for (const auto& edge : g.node(node).parents) {
+      add_blobs(&parents[edge.first], edge.second);
+    }
+    for (const auto& edge : g.node(node).children) {
+      add_blobs(&children[edge.first], edge.second);
+    }
+  }
+  const int last = subgraph.back();
+  g.DeactivateSubgraph(std::vector<int>(subgraph.begin(), subgraph.end() - 1));
+
+  Node& node = g.node(last);
+  node.op = fused;
+  node.parents = parents;
+  node.children = children;
+  for (const auto& edge : parents) {
+    g.node(edge.first).children[last] = edge.second;
+  }
+  for (const auto& edge : children) {
+    g.node(edge.first).parents[last] = edge.second;
+  }
+  return true;
+}
+
+REGISTER_TRANSFORM(FuseDenseOptimizers, FuseDenseOptimizersTransform);
+
+} // namespace caffe2
@@ -0,0 +1,61 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include "caffe2/core/common.h"
+#include "caffe2/core/transform.h"
+#include "caffe2/proto/caffe2.pb.h"
+#include "caffe2/utils/proto_utils.h"
+
+namespace caffe2 {
+
+/**
+ * Fuse Dense Optimizers
+ *
+ * Replaces groups of CPU Adagrad, Adam or MomentumSGDUpdate ops, one per
+ * parameter, by a single MultiTensorAdagrad, MultiTensorAdam or
+ * MultiTensorMomentumSGDUpdate op which updates all the parameters of the
+ * group in one parallel loop. This saves the dispatch of many optimizer ops
+ * on small parameters in training nets.
+ *
+ * The ops of a group have the same type, arguments and learning rate (and
+ * iteration counter for Adam), and follow each other in execution order.
+ * The fused op runs at the position of the last op of the group, so a group
+ * stops before an op whose update could not be delayed until then: an op
+ * that reads or writes the blobs of an earlier op of the group, or follows
+ * another op that does.
+ */
+class FuseDenseOptimizersTransform : public Transform {
+ public:
+  FuseDenseOptimizersTransform() {
+    SetPatternMatchType(SORTED_WRT_EXECUTION_ORDER);
+  }
+
+ protected:
+  bool PatternRule(
+      const transform::Graph& g,
+      const std::vector<int>& subgraph,
+      int idx) override;
+  bool ValidatorRule(
+      const transform::Graph& g,
+      const std::vector<int>& subgraph) override;
+  bool ReplaceRule(const std::vector<int>& subgraph, transform::Graph* g_ptr)
+      override;
+};
+
+} // namespace caffe2
@@ -0,0 +1,165 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <gtest/gtest.h>
+#include "caffe2/core/net.h"
+#include "caffe2/core/operator.h"
+#include "caffe2/core/test_utils.h"
+#include "caffe2/transforms/fuse_dense_optimizers_transform.h"
+
+namespace caffe2 {
+
+namespace {
+
+using testing::AddRandomInput;
+using testing::ExpectNear;
+using transform::Graph;
+
+OperatorDef* AddAdagrad(NetDef* netdef, const string& param, const string& lr) {
+  return AddOp(
+      netdef,
+      "Adagrad",
+      {param, param + "_moment", param + "_grad", lr},
+      {param, param + "_moment"});
+}
+
+OperatorDef* AddMomentumSGDUpdate(NetDef* netdef, const string& param) {
+  auto* op = AddOp(
+      netdef,
+      "MomentumSGDUpdate",
+      {param + "_grad", param + "_moment", "lr", param},
+      {param + "_grad", param + "_moment", param});
+  op->add_arg()->CopyFrom(MakeArgument<float>("momentum", 0.9));
+  return op;
+}
+
+} // namespace
+
+/**
+ *  Before: (Adagrad w0)  (MomentumSGDUpdate v0)  (Adagrad w1)  (Scale x)
+ *          (MomentumSGDUpdate v1)  (Adagrad w2)
+ *
+ *  After : (Scale x)  (MultiTensorMomentumSGDUpdate v0 v1)
+ *          (MultiTensorAdagrad w0 w1 w2)
+ */
+TEST(FuseDenseOptimizersTest, TestSimple) {
+  NetDef netdef;
+  AddAdagrad(&netdef, "w0", "lr");
+  AddMomentumSGDUpdate(&netdef, "v0");
+  AddAdagrad(&netdef, "w1", "lr");
+  AddOp(&netdef, "Scale", {"x"}, {"y"});
+  AddMomentumSGDUpdate(&netdef, "v1");
+  AddAdagrad(&netdef, "w2", "lr");
+
+  auto t = TransformRegistry()->Create("FuseDenseOptimizers");
+  NetDef transformed = t->ApplyTo(netdef);
+  ASSERT_EQ(transformed.op_size(), 3);
+  EXPECT_EQ(transformed.op(0).type(), "Scale");
+  const auto& momentum = transformed.op(1);
+  EXPECT_EQ(momentum.type(), "MultiTensorMomentumSGDUpdate");
+  EXPECT_EQ(
+      std::vector<string>(momentum.input().begin(), momentum.input().end()),
+      (std::vector<string>{"v0_grad",
+                           "v1_grad",
+                           "v0_moment",
+                           "v1_moment",
+                           "v0",
+                           "v1",
+                           "lr"}));
+  EXPECT_EQ(momentum.output_size(), 6);
+  EXPECT_EQ(momentum.arg_size(), 1);
+  const auto& adagrad = transformed.op(2);
+  EXPECT_EQ(adagrad.type(), "MultiTensorAdagrad");
+  EXPECT_EQ(
+      std::vector<string>(adagrad.output().begin(), adagrad.output().end()),
+      (std::vector<string>{
+          "w0", "w1", "w2", "w0_moment", "w1_moment", "w2_moment"}));
+  EXPECT_EQ(adagrad.input_size(), 10);
+
+  // Both nets compute the same updates.
+  Workspace ws;
+  for (const string& param : {"w0", "w1", "w2", "v0", "v1"}) {
+    AddRandomInput({3, 5}, param, &ws);
+    AddRandomInput({3, 5}, param + "_grad", &ws);
+    AddRandomInput({3, 5}, param + "_moment", &ws);
+  }
+  AddRandomInput({1}, "lr", &ws);
+  AddRandomInput({4}, "x", &ws);
+  // Adagrad moments must be positive.
+  for (const string& param : {"w0", "w1", "w2"}) {
+    auto* moment = ws.GetBlob(param + "_moment")->GetMutable<TensorCPU>();
+    for (int i = 0; i < moment->size(); ++i) {
+      moment->mutable_data<float>()[i] = std::abs(moment->data<float>()[i]);
+    }
+  }
+
+  std::vector<string> outputs;
+  for (const auto& op : netdef.op()) {
+    outputs.insert(outputs.end(), op.output().begin(), op.output().end());
+  }
+  std::vector<TensorCPU> initial(outputs.size());
+  for (int i = 0; i < outputs.size(); ++i) {
+    if (ws.HasBlob(outputs[i])) {
+      initial[i].CopyFrom(ws.GetBlob(outputs[i])->Get<TensorCPU>());
+    }
+  }
+  ASSERT_TRUE(ws.RunNetOnce(netdef));
+  std::vector<TensorCPU> expected(outputs.size());
+  for (int i = 0; i < outputs.size(); ++i) {
+    expected[i].CopyFrom(ws.GetBlob(outputs[i])->Get<TensorCPU>());
+    if (initial[i].size() > 0) {
+      ws.GetBlob(outputs[i])->GetMutable<TensorCPU>()->CopyFrom(initial[i]);
+    }
+  }
+  ASSERT_TRUE(ws.RunNetOnce(transformed));
+  for (int i = 0; i < outputs.size(); ++i) {
+    SCOPED_TRACE(outputs[i]);
+    ExpectNear(expected[i], ws.GetBlob(outputs[i])->Get<TensorCPU>(), 1e-5);
+  }
+}
+
+TEST(FuseDenseOptimizersTest, TestUnfusable) {
+  NetDef netdef;
+  // The update of w0 cannot be delayed past the op that reads it.
+  AddAdagrad(&netdef, "w0", "lr");
+  AddOp(&netdef, "Scale", {"w0"}, {"w0_scaled"});
+  AddAdagrad(&netdef, "w1", "lr");
+  // A different learning rate or different arguments start another group.
+  AddAdagrad(&netdef, "w2", "lr2");
+  AddAdagrad(&netdef, "w3", "lr")
+      ->add_arg()
+      ->CopyFrom(MakeArgument<float>("epsilon", 1e-3));
+  // The op overwrites the gradient of w1, which the group reads.
+  AddOp(&netdef, "Scale", {"x"}, {"w1_grad"});
+  AddAdagrad(&netdef, "w4", "lr");
+  // The parameter is not updated in place.
+  AddOp(
+      &netdef,
+      "MomentumSGDUpdate",
+      {"v0_grad", "v0_moment", "lr", "v0"},
+      {"v0_grad", "v0_moment", "v0_out"});
+  AddMomentumSGDUpdate(&netdef, "v1");
+
+  auto t = TransformRegistry()->Create("FuseDenseOptimizers");
+  NetDef transformed = t->ApplyTo(netdef);
+  ASSERT_EQ(transformed.op_size(), netdef.op_size());
+  for (int i = 0; i < netdef.op_size(); ++i) {
+    EXPECT_EQ(transformed.op(i).type(), netdef.op(i).type());
+  }
+}
+
+} // namespace caffe2
@@ -0,0 +1,154 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "caffe2/transforms/fuse_inference_ops_transform.h"
+
+#include <algorithm>
+
+#include "caffe2/core/common.h"
+#include "caffe2/core/net.h"
+#include "caffe2/proto/caffe2.pb.h"
+
+namespace caffe2 {
+
+using transform::Graph;
+using transform::Node;
+
+namespace {
+
+bool IsActivation(const OperatorDef& op) {
+  return op.type() == "Relu" || op.type() == "Sigmoid";
+}
+
+bool IsInferenceBatchNorm(const OperatorDef& op) {
+  ArgumentHelper helper(op);
+  return op.type() == "SpatialBN" && op.input_size() == 5 &&
+      op.output_size() == 1 && helper.GetSingleArgument<int>("is_test", 0);
+}
+
+string StorageOrderOf(const OperatorDef& op) {
+  return ArgumentHelper(op).GetSingleArgument<string>("order", "NCHW");
+}
+
+} // namespace
+
+bool FuseInferenceOpsTransform::PatternRule(
+    const Graph& g,
+    const std::vector<int>& subgraph,
+    int idx) {
+  const OperatorDef& op = g.node(idx).op;
+  if (subgraph.size() == 0) {
+    const bool producer = op.type() == "Conv" ||
+        (op.type() == "FC" && op.input_size() == 3);
+    return producer && op.output_size() == 1 &&
+        op.device_option().device_type() == CPU;
+  }
+
+  // The chain continues with the only reader of the previous op's output.
+  const Node& last = g.node(subgraph.back());
+  const string& blob = last.op.output(0);
+  if (last.children.size() != 1 || last.children.count(idx) == 0 ||
+      op.input_size() == 0 || op.input(0) != blob ||
+      op.device_option().device_type() != CPU) {
+    return false;
+  }
+  for (int i = 1; i < op.input_size(); ++i) {
+    if (op.input(i) == blob) {
+      return false;
+    }
+  }
+  const auto& declared_outputs = g.netdef().external_output();
+  if (op.output(0) != blob &&
+      std::find(declared_outputs.begin(), declared_outputs.end(), blob) !=
+          declared_outputs.end()) {
+    return false;
+  }
+
+  if (IsActivation(op)) {
+    return op.output_size() == 1 && !IsActivation(last.op);
+  }
+  if (IsInferenceBatchNorm(op)) {
+    const OperatorDef& head = g.node(subgraph.front()).op;
+    return subgraph.size() == 1 &&
+        (head.type() == "FC" || StorageOrderOf(head) == StorageOrderOf(op));
+  }
+  return false;
+}
+
+// Anything beyond the producer alone is worth fusing.
+bool FuseInferenceOpsTransform::ValidatorRule(
+    const Graph& g,
+    const std::vector<int>& subgraph) {
+  return subgraph.size() >= 2;
+}
+
+bool FuseInferenceOpsTransform::ReplaceRule(
+    const std::vector<int>& subgraph,
+    Graph* g_ptr) {
+  CHECK(g_ptr);
+  auto& g = *g_ptr;
+
+  // The producer node becomes the fused op; the other nodes are removed.
+  const int head = subgraph.front();
+  OperatorDef fused = g.node(head).op;
+  fused.set_type("Fused" + fused.type());
+  for (int i = 1; i < subgraph.size(); ++i) {
+    const OperatorDef& op = g.node(subgraph[i]).op;
+    if (IsActivation(op)) {
+      fused.add_arg()->CopyFrom(MakeArgument<string>("activation", op.type()));
+    } else {
+      fused.add_arg()->CopyFrom(MakeArgument<int>("fold_bn", 1));
+      fused.add_arg()->CopyFrom(MakeArgument<float>(
+          "epsilon",
+          ArgumentHelper(op).GetSingleArgument<float>("epsilon", 1e-5)));
+      for (int j = 1; j < op.input_size(); ++j) {
+        fused.add_input(op.input(j));
+      }
+    }
+  }
+  fused.set_output(0, g.node(subgraph.back()).op.output(0));
+
+  // The fused op reads the parameters of the removed ops and feeds the
+  // readers of the last op of the chain.
+  std::map<int, std::vector<string>> parents;
+  for (int i = 1; i < subgraph.size(); ++i) {
+    for (const auto& edge : g.node(subgraph[i]).parents) {
+      if (edge.first != subgraph[i - 1]) {
+        auto& blobs = parents[edge.first];
+        blobs.insert(blobs.end(), edge.second.begin(), edge.second.end());
+      }
+    }
+  }
+  const auto children = g.node(subgraph.back()).children;
+  g.DeactivateSubgraph(std::vector<int>(subgraph.begin() + 1, subgraph.end()));
+
+  Node& node = g.node(head);
+  node.op = fused;
+  for (const auto& edge : parents) {
+    auto& blobs = node.parents[edge.first];
+    blobs.insert(blobs.end(), edge.second.begin(), edge.second.end());
+    g.node(edge.first).children[head] = blobs;
+  }
+  for (const auto& edge : children) {
+    node.children[edge.first] = edge.second;
+    g.node(edge.first).parents[head] = edge.second;
+  }
+  return true;
+}
+
+REGISTER_TRANSFORM(FuseInferenceOps, FuseInferenceOpsTransform);
+
+} // namespace caffe2
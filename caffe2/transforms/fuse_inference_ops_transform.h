@@ -0,0 +1,55 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "caffe2/core/common.h"
+#include "caffe2/core/transform.h"
+#include "caffe2/proto/caffe2.pb.h"
+#include "caffe2/utils/proto_utils.h"
+
+namespace caffe2 {
+
+/**
+ * Fuse Inference Ops
+ *
+ * Replaces chains of a CPU Conv or FC, an optional SpatialBN in test mode and
+ * an optional Relu or Sigmoid, such as
+ *
+ *   (Conv)-->(SpatialBN)-->(Relu)   or   (FC)-->(Relu)
+ *
+ * by a single FusedConv or FusedFC op, which folds the SpatialBN into the
+ * weights once and applies the activation to the output in place. This saves
+ * the dispatch of the fused ops, and the intermediate tensors they write and
+ * read back, in inference nets such as the ones run by Predictor.
+ *
+ * A chain is only fused if every intermediate blob is read by the next op of
+ * the chain alone and is not an external output of the net.
+ */
+class FuseInferenceOpsTransform : public Transform {
+ protected:
+  bool PatternRule(
+      const transform::Graph& g,
+      const std::vector<int>& subgraph,
+      int idx) override;
+  bool ValidatorRule(
+      const transform::Graph& g,
+      const std::vector<int>& subgraph) override;
+  bool ReplaceRule(const std::vector<int>& subgraph, transform::Graph* g_ptr)
+      override;
+};
+
+} // namespace caffe2
@@ -0,0 +1,247 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cmath>
+
+#include <gtest/gtest.h>
+#include "caffe2/core/net.h"
+#include "caffe2/core/operator.h"
+#include "caffe2/core/test_utils.h"
+#include "caffe2/transforms/fuse_inference_ops_transform.h"
+
+namespace caffe2 {
+
+namespace {
+
+using testing::AddRandomInput;
+using testing::ExpectNear;
+using transform::Graph;
+
+OperatorDef* AddBatchNorm(NetDef* netdef, const string& in, const string& out) {
+  auto* op = AddOp(
+      netdef,
+      "SpatialBN",
+      {in, "bn_scale", "bn_bias", "bn_mean", "bn_var"},
+      {out});
+  op->add_arg()->CopyFrom(MakeArgument<int>("is_test", 1));
+  op->add_arg()->CopyFrom(MakeArgument<float>("epsilon", 1e-3));
+  return op;
+}
+
+/**
+ *  Before: (Conv)-->(SpatialBN)-->(Relu)-->(FC)-->(Relu)-->(FC)-->(Sigmoid)
+ *                                                            \-->(Relu)
+ *
+ *  After : (FusedConv)-->(FusedFC)-->(FC)-->(Sigmoid)
+ *                                      \-->(Relu)
+ */
+TEST(FuseInferenceOpsTest, TestSimple) {
+  NetDef netdef;
+  auto* conv = AddOp(&netdef, "Conv", {"X", "conv_w", "conv_b"}, {"conv"});
+  conv->add_arg()->CopyFrom(MakeArgument<int>("kernel", 3));
+  conv->add_arg()->CopyFrom(MakeArgument<int>("pad", 1));
+  AddBatchNorm(&netdef, "conv", "bn");
+  AddOp(&netdef, "Relu", {"bn"}, {"bn"});
+  AddOp(&netdef, "FC", {"bn", "fc1_w", "fc1_b"}, {"fc1"});
+  AddOp(&netdef, "Relu", {"fc1"}, {"fc1_relu"});
+  // Read twice, so this one is not fused.
+  AddOp(&netdef, "FC", {"fc1_relu", "fc2_w", "fc2_b"}, {"fc2"});
+  AddOp(&netdef, "Sigmoid", {"fc2"}, {"sigmoid"});
+  AddOp(&netdef, "Relu", {"fc2"}, {"relu"});
+  netdef.add_external_output("sigmoid");
+  netdef.add_external_output("relu");
+
+  auto t = TransformRegistry()->Create("FuseInferenceOps");
+  NetDef transformed = t->ApplyTo(netdef);
+  ASSERT_EQ(transformed.op_size(), 5);
+  EXPECT_EQ(transformed.op(0).type(), "FusedConv");
+  EXPECT_EQ(transformed.op(0).input_size(), 7);
+  EXPECT_EQ(transformed.op(0).output(0), "bn");
+  EXPECT_EQ(transformed.op(1).type(), "FusedFC");
+  EXPECT_EQ(transformed.op(1).input(0), "bn");
+  EXPECT_EQ(transformed.op(1).output(0), "fc1_relu");
+  EXPECT_EQ(transformed.op(2).type(), "FC");
+
+  // Both nets compute the same outputs.
+  Workspace ws;
+  AddRandomInput({2, 3, 6, 6}, "X", &ws);
+  AddRandomInput({4, 3, 3, 3}, "conv_w", &ws);
+  AddRandomInput({4}, "conv_b", &ws);
+  AddRandomInput({4}, "bn_scale", &ws);
+  AddRandomInput({4}, "bn_bias", &ws);
+  AddRandomInput({4}, "bn_mean", &ws);
+  AddRandomInput({4}, "bn_var", &ws, 3);
+  AddRandomInput({5, 4 * 6 * 6}, "fc1_w", &ws);
+  AddRandomInput({5}, "fc1_b", &ws);
+  AddRandomInput({3, 5}, "fc2_w", &ws);
+  AddRandomInput({3}, "fc2_b", &ws);
+  // Variances must be positive.
+  auto* var = ws.GetBlob("bn_var")->GetMutable<TensorCPU>();
+  for (int i = 0; i < var->size(); ++i) {
+    var->mutable_data<float>()[i] = std::abs(var->data<float>()[i]);
+  }
+
+  const std::vector<string> outputs{"sigmoid", "relu"};
+  ASSERT_TRUE(ws.RunNetOnce(netdef));
+  std::vector<TensorCPU> expected(outputs.size());
+  for (int i = 0; i < outputs.size(); ++i) {
+    expected[i].CopyFrom(ws.GetBlob(outputs[i])->Get<TensorCPU>());
+  }
+  ASSERT_TRUE(ws.RunNetOnce(transformed));
+  for (int i = 0; i < outputs.size(); ++i) {
+    SCOPED_TRACE(outputs[i]);
+    ExpectNear(expected[i], ws.GetBlob(outputs[i])->Get<TensorCPU>(), 1e-4);
+  }
+}
+
+TEST(FuseInferenceOpsTest, TestUnfusable) {
+  NetDef netdef;
+  // The conv output is an external output, and the BN is in training mode.
+  AddOp(&netdef, "Conv", {"X", "w1", "b1"}, {"conv1"});
+  AddOp(&netdef, "Relu", {"conv1"}, {"relu1"});
+  netdef.add_external_output("conv1");
+  AddOp(&netdef, "Conv", {"X", "w2", "b2"}, {"conv2"});
+  AddOp(
+      &netdef,
+      "SpatialBN",
+      {"conv2", "bn_scale", "bn_bias", "bn_mean", "bn_var"},
+      {"bn2", "bn_running_mean", "bn_running_var", "saved_mean", "saved_var"});
+  // The BN follows a Relu, not the conv.
+  AddOp(&netdef, "Conv", {"X", "w3", "b3"}, {"conv3"});
+  AddOp(&netdef, "Relu", {"conv3"}, {"relu3"});
+  AddBatchNorm(&netdef, "relu3", "bn3");
+
+  auto t = TransformRegistry()->Create("FuseInferenceOps");
+  NetDef transformed = t->ApplyTo(netdef);
+  ASSERT_EQ(transformed.op_size(), 6);
+  int fused = 0;
+  for (const auto& op : transformed.op()) {
+    if (op.type() == "FusedConv") {
+      ++fused;
+      EXPECT_EQ(op.input(0), "X");
+      EXPECT_EQ(op.input_size(), 3);
+      EXPECT_EQ(op.output(0), "relu3");
+    }
+  }
+  EXPECT_EQ(fused, 1);
+}
+
+TEST(FuseInferenceOpsTest, TestFoldedWeightsArePrivate) {
+  // Two ops writing the same output must not share their folded weights.
+  Workspace ws;
+  AddRandomInput({2, 6}, "X", &ws);
+  for (const string suffix : {"_a", "_b"}) {
+    AddRandomInput({4, 6}, "w" + suffix, &ws);
+    AddRandomInput({4}, "b" + suffix, &ws);
+    AddRandomInput({4}, "bn_scale" + suffix, &ws);
+    AddRandomInput({4}, "bn_bias" + suffix, &ws);
+    AddRandomInput({4}, "bn_mean" + suffix, &ws);
+    AddRandomInput({4}, "bn_var" + suffix, &ws, 3);
+    auto* var = ws.GetBlob("bn_var" + suffix)->GetMutable<TensorCPU>();
+    for (int i = 0; i < var->size(); ++i) {
+      var->mutable_data<float>()[i] = std::abs(var->data<float>()[i]);
+    }
+  }
+  std::vector<unique_ptr<OperatorBase>> ops;
+  for (const string suffix : {"_a", "_b"}) {
+    NetDef netdef;
+    auto* op = AddOp(
+        &netdef,
+        "FusedFC",
+        {"X",
+         "w" + suffix,
+         "b" + suffix,
+         "bn_scale" + suffix,
+         "bn_bias" + suffix,
+         "bn_mean" + suffix,
+         "bn_var" + suffix},
+        {"Y"});
+    op->add_arg()->CopyFrom(MakeArgument<int>("fold_bn", 1));
+    ops.push_back(CreateOperator(*op, &ws));
+    ASSERT_NE(nullptr, ops.back().get());
+  }
+
+  ASSERT_TRUE(ops[0]->Run());
+  TensorCPU expected;
+  expected.CopyFrom(ws.GetBlob("Y")->Get<TensorCPU>());
+  ASSERT_TRUE(ops[1]->Run());
+  ASSERT_TRUE(ops[0]->Run());
+  const auto& Y = ws.GetBlob("Y")->Get<TensorCPU>();
+  ASSERT_EQ(Y.dims(), expected.dims());
+  for (int i = 0; i < Y.size(); ++i) {
+    EXPECT_EQ(Y.data<float>()[i], expected.data<float>()[i]);
+  }
+}
+
+TEST(FuseInferenceOpsTest, TestFoldsParametersUpdatedInPlace) {
+  Workspace ws;
+  AddRandomInput({2, 6}, "X", &ws);
+  AddRandomInput({4, 6}, "w", &ws);
+  AddRandomInput({4}, "b", &ws);
+  AddRandomInput({4}, "bn_scale", &ws);
+  AddRandomInput({4}, "bn_bias", &ws);
+  AddRandomInput({4}, "bn_mean", &ws);
+  AddRandomInput({4}, "bn_var", &ws, 3);
+  auto* var = ws.GetBlob("bn_var")->GetMutable<TensorCPU>();
+  for (int i = 0; i < var->size(); ++i) {
+    var->mutable_data<float>()[i] = std::abs(var->data<float>()[i]);
+  }
+  NetDef netdef;
+  auto* def = AddOp(
+      &netdef,
+      "FusedFC",
+      {"X", "w", "b", "bn_scale", "bn_bias", "bn_mean", "bn_var"},
+      {"Y"});
+  def->add_arg()->CopyFrom(MakeArgument<int>("fold_bn", 1));
+  auto op = CreateOperator(*def, &ws);
+  ASSERT_NE(nullptr, op.get());
+  ASSERT_TRUE(op->Run());
+
+  // Shift the weights and the mean without reallocating them.
+  for (const string name : {"w", "bn_mean"}) {
+    auto* tensor = ws.GetBlob(name)->GetMutable<TensorCPU>();
+    for (int i = 0; i < tensor->size(); ++i) {
+      tensor->mutable_data<float>()[i] += 0.5f;
+    }
+  }
+  ASSERT_TRUE(op->Run());
+
+  const auto& X = ws.GetBlob("X")->Get<TensorCPU>();
+  const float* x = X.data<float>();
+  const float* w = ws.GetBlob("w")->Get<TensorCPU>().data<float>();
+  const float* b = ws.GetBlob("b")->Get<TensorCPU>().data<float>();
+  const float* scale = ws.GetBlob("bn_scale")->Get<TensorCPU>().data<float>();
+  const float* bias = ws.GetBlob("bn_bias")->Get<TensorCPU>().data<float>();
+  const float* mean = ws.GetBlob("bn_mean")->Get<TensorCPU>().data<float>();
+  const auto& Y = ws.GetBlob("Y")->Get<TensorCPU>();
+  ASSERT_EQ(Y.dims(), (vector<TIndex>{2, 4}));
+  for (int n = 0; n < 2; ++n) {
+    for (int m = 0; m < 4; ++m) {
+      float fc = b[m];
+      for (int k = 0; k < 6; ++k) {
+        fc += x[n * 6 + k] * w[m * 6 + k];
+      }
+      const float expected = (fc - mean[m]) * scale[m] /
+              std::sqrt(var->data<float>()[m] + 1e-5f) +
+          bias[m];
+      EXPECT_NEAR(Y.data<float>()[n * 4 + m], expected, 1e-4);
+    }
+  }
+}
+
+} // namespace
+
+} // namespace caffe2
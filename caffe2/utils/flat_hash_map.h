@@ -0,0 +1,361 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef CAFFE2_UTILS_FLAT_HASH_MAP_H_
+#define CAFFE2_UTILS_FLAT_HASH_MAP_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace caffe2 {
+
+// An open-addressing hash map with linear probing. Keys and values are
+// stored in one flat array of slots, next to a one-byte control array that
+// marks the empty slots and keeps 7 bits of the hash of every key, so that
+// most probes only compare keys that are very likely equal.
+//
+// Meant for large maps that are built once and looked up a lot. Iterators
+// and references are invalidated by erase() and by any insertion that grows
+// the table. Lookups of a batch of keys can hide the memory latency by
+// computing the hashes up front and calling prefetch() some keys ahead of
+// the find() or insert() that takes the same hash.
+template <typename K, typename V, typename Hash = std::hash<K>>
+class FlatHashMap {
+ public:
+  using key_type = K;
+  using mapped_type = V;
+  using value_type = std::pair<K, V>;
+  using size_type = size_t;
+  using hasher = Hash;
+
+  template <bool kConst>
+  class IteratorImpl {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = FlatHashMap::value_type;
+    using difference_type = std::ptrdiff_t;
+    using pointer = typename std::
+        conditional<kConst, const value_type*, value_type*>::type;
+    using reference = typename std::
+        conditional<kConst, const value_type&, value_type&>::type;
+
+    IteratorImpl() {}
+    // Converts an iterator to a const_iterator.
+    template <
+        bool kOther,
+        typename = typename std::enable_if<kConst && !kOther>::type>
+    IteratorImpl(const IteratorImpl<kOther>& other)
+        : ctrl_(other.ctrl_), end_(other.end_), slot_(other.slot_) {}
+
+    reference operator*() const {
+      return *slot_;
+    }
+    pointer operator->() const {
+      return slot_;
+    }
+    IteratorImpl& operator++() {
+      ++ctrl_;
+      ++slot_;
+      skipEmpty();
+      return *this;
+    }
+    IteratorImpl operator++(int) {
+      IteratorImpl old = *this;
+      ++*this;
+      return old;
+    }
+    bool operator==(const IteratorImpl& other) const {
+      return ctrl_ == other.ctrl_;
+    }
+    bool operator!=(const IteratorImpl& other) const {
+      return ctrl_ != other.ctrl_;
+    }
+
+   private:
+    friend class FlatHashMap;
+    template <bool>
+    friend class IteratorImpl;
+
+    IteratorImpl(const uint8_t* ctrl, const uint8_t* end, pointer slot)
+        : ctrl_(ctrl), end_(end), slot_(slot) {
+      skipEmpty();
+    }
+    void skipEmpty() {
+      while (ctrl_ != end_ && *ctrl_ == kEmpty) {
+        ++ctrl_;
+        ++slot_;
+      }
+    }
+
+    const uint8_t* ctrl_{nullptr};
+    const uint8_t* end_{nullptr};
+    pointer slot_{nullptr};
+  };
+
+  using iterator = IteratorImpl<false>;
+  using const_iterator = IteratorImpl<true>;
+
+  FlatHashMap() {}
+  explicit FlatHashMap(size_t expected_size) {
+    reserve(expected_size);
+  }
+
+  size_t size() const {
+    return size_;
+  }
+  bool empty() const {
+    return size_ == 0;
+  }
+  // Number of slots, i.e. the memory footprint is bucket_count() times
+  // (sizeof(value_type) + 1) bytes.
+  size_t bucket_count() const {
+    return ctrl_.size();
+  }
+
+  iterator begin() {
+    return iterator(ctrl_.data(), ctrl_.data() + ctrl_.size(), slots_.data());
+  }
+  iterator end() {
+    return iterator(
+        ctrl_.data() + ctrl_.size(),
+        ctrl_.data() + ctrl_.size(),
+        slots_.data() + slots_.size());
+  }
+  const_iterator begin() const {
+    return const_iterator(
+        ctrl_.data(), ctrl_.data() + ctrl_.size(), slots_.data());
+  }
+  const_iterator end() const {
+    return const_iterator(
+        ctrl_.data() + ctrl_.size(),
+        ctrl_.data() + ctrl_.size(),
+        slots_.data() + slots_.size());
+  }
+
+  void clear() {
+    ctrl_.clear();
+    slots_.clear();
+    size_ = 0;
+    mask_ = 0;
+  }
+
+  // Makes room for count elements without growing the table again.
+  void reserve(size_t count) {
+    size_t capacity = kMinCapacity;
+    while (capacity * kMaxLoadNum / kMaxLoadDen < count) {
+      capacity *= 2;
+    }
+    if (capacity > ctrl_.size()) {
+      rehash(capacity);
+    }
+  }
+
+  void swap(FlatHashMap& other) {
+    std::swap(ctrl_, other.ctrl_);
+    std::swap(slots_, other.slots_);
+    std::swap(size_, other.size_);
+    std::swap(mask_, other.mask_);
+    std::swap(hasher_, other.hasher_);
+  }
+
+  // The hash the table uses for key: the hasher's result, mixed so that
+  // identity hashes of integers spread over the table.
+  uint64_t hash_key(const K& key) const {
+    uint64_t h = hasher_(key);
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+  }
+
+  // Hints the CPU to load the first slot probed for the given hash.
+  void prefetch(uint64_t hash) const {
+#if defined(__GNUC__) || defined(__clang__)
+    if (!ctrl_.empty()) {
+      const size_t index = hash & mask_;
+      __builtin_prefetch(ctrl_.data() + index);
+      __builtin_prefetch(slots_.data() + index);
+    }
+#else
+    (void)hash;
+#endif
+  }
+
+  iterator find(const K& key) {
+    return find(key, hash_key(key));
+  }
+  const_iterator find(const K& key) const {
+    return find(key, hash_key(key));
+  }
+  // Same as find(key), with hash == hash_key(key) already computed.
+  iterator find(const K& key, uint64_t hash) {
+    const size_t index = findIndex(key, hash);
+    return index == kNotFound ? end() : iteratorAt(index);
+  }
+  const_iterator find(const K& key, uint64_t hash) const {
+    const size_t index = findIndex(key, hash);
+    return index == kNotFound ? end() : iteratorAt(index);
+  }
+
+  size_t count(const K& key) const {
+    return findIndex(key, hash_key(key)) == kNotFound ? 0 : 1;
+  }
+
+  V& operator[](const K& key) {
+    return insert(value_type(key, V())).first->second;
+  }
+
+  std::pair<iterator, bool> insert(const value_type& value) {
+    return insert(value, hash_key(value.first));
+  }
+  // Same as insert(value), with hash == hash_key(value.first).
+  std::pair<iterator, bool> insert(const value_type& value, uint64_t hash) {
+    size_t index = findIndex(value.first, hash);
+    if (index != kNotFound) {
+      return std::make_pair(iteratorAt(index), false);
+    }
+    if ((size_ + 1) * kMaxLoadDen > ctrl_.size() * kMaxLoadNum) {
+      rehash(ctrl_.empty() ? kMinCapacity : ctrl_.size() * 2);
+    }
+    index = emptyIndex(hash);
+    ctrl_[index] = tag(hash);
+    slots_[index] = value;
+    ++size_;
+    return std::make_pair(iteratorAt(index), true);
+  }
+  std::pair<iterator, bool> emplace(const K& key, const V& value) {
+    return insert(value_type(key, value));
+  }
+
+  size_t erase(const K& key) {
+    size_t index = findIndex(key, hash_key(key));
+    if (index == kNotFound) {
+      return 0;
+    }
+    // Shift back the rest of the probe run into the hole, so that lookups
+    // never stop early at it. An entry can move unless its home slot lies
+    // cyclically between the hole and its current slot.
+    for (size_t next = (index + 1) & mask_; ctrl_[next] != kEmpty;
+         next = (next + 1) & mask_) {
+      const size_t home = hash_key(slots_[next].first) & mask_;
+      if (((next - home) & mask_) >= ((next - index) & mask_)) {
+        ctrl_[index] = ctrl_[next];
+        slots_[index] = std::move(slots_[next]);
+        index = next;
+      }
+    }
+    ctrl_[index] = kEmpty;
+    slots_[index] = value_type();
+    --size_;
+    return 1;
+  }
+
+ private:
+  static constexpr uint8_t kEmpty = 0;
+  static constexpr size_t kNotFound = static_cast<size_t>(-1);
+  static constexpr size_t kMinCapacity = 16;
+  // The table grows when it is more than 3/4 full.
+  static constexpr size_t kMaxLoadNum = 3;
+  static constexpr size_t kMaxLoadDen = 4;
+
+  // The top 7 bits of the hash, with the high bit set to tell full slots
+  // from empty ones. The slot index is taken from the low bits.
+  static uint8_t tag(uint64_t hash) {
+    return static_cast<uint8_t>(0x80 | (hash >> 57));
+  }
+
+  size_t findIndex(const K& key, uint64_t hash) const {
+    if (ctrl_.empty()) {
+      return kNotFound;
+    }
+    const uint8_t t = tag(hash);
+    for (size_t index = hash & mask_;; index = (index + 1) & mask_) {
+      if (ctrl_[index] == kEmpty) {
+        return kNotFound;
+      }
+      if (ctrl_[index] == t && slots_[index].first == key) {
+        return index;
+      }
+    }
+  }
+
+  size_t emptyIndex(uint64_t hash) const {
+    size_t index = hash & mask_;
+    while (ctrl_[index] != kEmpty) {
+      index = (index + 1) & mask_;
+    }
+    return index;
+  }
+
+  iterator iteratorAt(size_t index) {
+    return iterator(
+        ctrl_.data() + index,
+        ctrl_.data() + ctrl_.size(),
+        slots_.data() + index);
+  }
+  const_iterator iteratorAt(size_t index) const {
+    return const_iterator(
+        ctrl_.data() + index,
+        ctrl_.data() + ctrl_.size(),
+        slots_.data() + index);
+  }
+
+  // capacity must be a power of two that fits all the elements.
+  void rehash(size_t capacity) {
+    std::vector<uint8_t> ctrl(capacity, kEmpty);
+    std::vector<value_type> slots(capacity);
+    std::swap(ctrl, ctrl_);
+    std::swap(slots, slots_);
+    mask_ = capacity - 1;
+    for (size_t i = 0; i < ctrl.size(); ++i) {
+      if (ctrl[i] != kEmpty) {
+        const uint64_t hash = hash_key(slots[i].first);
+        const size_t index = emptyIndex(hash);
+        ctrl_[index] = ctrl[i];
+        slots_[index] = std::move(slots[i]);
+      }
+    }
+  }
+
+  std::vector<uint8_t> ctrl_;
+  std::vector<value_type> slots_;
+  size_t size_{0};
+  size_t mask_{0};
+  Hash hasher_;
+};
+
+template <typename K, typename V, typename Hash>
+constexpr uint8_t FlatHashMap<K, V, Hash>::kEmpty;
+template <typename K, typename V, typename Hash>
+constexpr size_t FlatHashMap<K, V, Hash>::kNotFound;
+template <typename K, typename V, typename Hash>
+constexpr size_t FlatHashMap<K, V, Hash>::kMinCapacity;
+template <typename K, typename V, typename Hash>
+constexpr size_t FlatHashMap<K, V, Hash>::kMaxLoadNum;
+template <typename K, typename V, typename Hash>
+constexpr size_t FlatHashMap<K, V, Hash>::kMaxLoadDen;
+
+} // namespace caffe2
+
+#endif // CAFFE2_UTILS_FLAT_HASH_MAP_H_
@@ -0,0 +1,114 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "caffe2/utils/flat_hash_map.h"
+#include <gtest/gtest.h>
+
+#include <random>
+#include <string>
+#include <unordered_map>
+
+namespace caffe2 {
+
+TEST(FlatHashMapTest, MatchesUnorderedMap) {
+  std::mt19937 gen(0);
+  std::uniform_int_distribution<int64_t> dist(0, 5000);
+  FlatHashMap<int64_t, int32_t> map;
+  std::unordered_map<int64_t, int32_t> expected;
+  for (int i = 0; i < 10000; ++i) {
+    const auto key = dist(gen);
+    const auto inserted = map.insert({key, i});
+    EXPECT_EQ(inserted.second, expected.insert({key, i}).second);
+    EXPECT_EQ(inserted.first->first, key);
+    EXPECT_EQ(inserted.first->second, expected[key]);
+  }
+  EXPECT_EQ(map.size(), expected.size());
+  EXPECT_LE(map.size() * 4, map.bucket_count() * 3);
+  for (int64_t key = -10; key < 5010; ++key) {
+    auto it = map.find(key);
+    auto expectedIt = expected.find(key);
+    if (expectedIt == expected.end()) {
+      EXPECT_TRUE(it == map.end());
+      EXPECT_EQ(map.count(key), 0);
+    } else {
+      ASSERT_TRUE(it != map.end());
+      EXPECT_EQ(it->second, expectedIt->second);
+    }
+  }
+  size_t iterated = 0;
+  for (const auto& entry : map) {
+    EXPECT_EQ(entry.second, expected.at(entry.first));
+    ++iterated;
+  }
+  EXPECT_EQ(iterated, expected.size());
+}
+
+TEST(FlatHashMapTest, Erase) {
+  std::mt19937 gen(1);
+  std::uniform_int_distribution<int32_t> dist(0, 300);
+  // A small table keeps the probe runs long.
+  FlatHashMap<int32_t, int32_t> map;
+  std::unordered_map<int32_t, int32_t> expected;
+  for (int i = 0; i < 20000; ++i) {
+    const auto key = dist(gen);
+    if (i % 2) {
+      EXPECT_EQ(map.erase(key), expected.erase(key));
+    } else {
+      map[key] = i;
+      expected[key] = i;
+    }
+  }
+  EXPECT_EQ(map.size(), expected.size());
+  for (int32_t key = 0; key <= 300; ++key) {
+    auto it = map.find(key);
+    auto expectedIt = expected.find(key);
+    if (expectedIt == expected.end()) {
+      EXPECT_TRUE(it == map.end());
+    } else {
+      ASSERT_TRUE(it != map.end());
+      EXPECT_EQ(it->second, expectedIt->second);
+    }
+  }
+}
+
+TEST(FlatHashMapTest, StringKeys) {
+  FlatHashMap<std::string, int> map(100);
+  const auto buckets = map.bucket_count();
+  for (int i = 0; i < 100; ++i) {
+    map[std::to_string(i)] = i;
+  }
+  EXPECT_EQ(map.bucket_count(), buckets);
+  for (int i = 0; i < 100; ++i) {
+    const auto key = std::to_string(i);
+    const auto hash = map.hash_key(key);
+    map.prefetch(hash);
+    auto it = map.find(key, hash);
+    ASSERT_TRUE(it != map.end());
+    EXPECT_EQ(it->second, i);
+  }
+  EXPECT_TRUE(map.find("100") == map.end());
+  EXPECT_FALSE(map.emplace("7", 0).second);
+
+  FlatHashMap<std::string, int> other;
+  other.swap(map);
+  EXPECT_TRUE(map.empty());
+  EXPECT_EQ(other.size(), 100);
+  other.clear();
+  EXPECT_TRUE(other.begin() == other.end());
+}
+
+} // namespace caffe2
@@ -1560,7 +1560,8 @@ void TransposeCPU(
     const std::vector<TIndex>& y_dims,
     const std::vector<int>& axes,
     const T* X,
-    T* Y) {
+    T* Y,
+    CPUContext* context) {
   const TIndex count = std::accumulate(
       x_dims.cbegin(), x_dims.cend(), TIndex(1), std::multiplies<TIndex>());
   const int num_axes = axes.size();
@@ -1580,20 +1581,37 @@ void TransposeCPU(
 
   const int itr_axes = num_axes - num_shared_idxs;
   const std::vector<TIndex> base_x = MakeBase(x_dims, axes, itr_axes);
-  std::vector<TIndex> index_digits(itr_axes, 0);
   const TIndex num_blocks = count / block_size;
-  for (TIndex y_index = 0; y_index < num_blocks; ++y_index) {
-    const TIndex x_index = std::inner_product(
-        base_x.cbegin(), base_x.cend(), index_digits.cbegin(), TIndex(0));
-    if (block_size == 1) {
-      Y[y_index] = X[x_index];
-    } else {
-      memcpy(
-          Y + block_size * y_index,
-          X + block_size * x_index,
-          block_size * sizeof(T));
+  // Every chunk of output blocks starts from the index digits of its first
+  // block and walks the output in order from there.
+  auto transpose_blocks = [&](TIndex begin, TIndex end) {
+    std::vector<TIndex> index_digits(itr_axes, 0);
+    TIndex rest = begin;
+    for (int i = itr_axes - 1; i >= 0; --i) {
+      index_digits[i] = rest % y_dims[i];
+      rest /= y_dims[i];
+    }
+    for (TIndex y_index = begin; y_index < end; ++y_index) {
+      const TIndex x_index = std::inner_product(
+          base_x.cbegin(), base_x.cend(), index_digits.cbegin(), TIndex(0));
+      if (block_size == 1) {
+        Y[y_index] = X[x_index];
+      } else {
+        memcpy(
+            Y + block_size * y_index,
+            X + block_size * x_index,
+            block_size * sizeof(T));
+      }
+      IncreaseIndex(y_dims, &index_digits);
     }
-    IncreaseIndex(y_dims, &index_digits);
+  };
+  if (context) {
+    context->ParallelFor(
+        num_blocks,
+        CPUContext::ParallelForGrain(block_size + itr_axes),
+        transpose_blocks);
+  } else {
+    transpose_blocks(0, num_blocks);
   }
 }
 
@@ -1606,25 +1624,25 @@ void Transpose<float, CPUContext>(
     const std::vector<int>& axes,
     const float* X,
     float* Y,
-    CPUContext* /* context */) {
+    CPUContext* context) {
 #ifdef CAFFE2_USE_HPTT
   if (TryTransposeWithHPTT(x_dims, axes, X, Y)) {
     return;
   }
 #endif // CAFFE2_USE_HPTT
-  TransposeCPU(x_dims, y_dims, axes, X, Y);
+  TransposeCPU(x_dims, y_dims, axes, X, Y, context);
 }
 
-#define CAFFE2_SPECIALIZED_TRANSPOSE(T)       \
-  template <>                                 \
-  void Transpose<T, CPUContext>(              \
-      const std::vector<TIndex>& x_dims,      \
-      const std::vector<TIndex>& y_dims,      \
-      const std::vector<int>& axes,           \
-      const T* X,                             \
-      T* Y,                                   \
-      CPUContext* /* context */) {            \
-    TransposeCPU(x_dims, y_dims, axes, X, Y); \
+#define CAFFE2_SPECIALIZED_TRANSPOSE(T)                \
+  template <>                                          \
+  void Transpose<T, CPUContext>(                       \
+      const std::vector<TIndex>& x_dims,               \
+      const std::vector<TIndex>& y_dims,               \
+      const std::vector<int>& axes,                    \
+      const T* X,                                      \
+      T* Y,                                            \
+      CPUContext* context) {                           \
+    TransposeCPU(x_dims, y_dims, axes, X, Y, context); \
   }
 CAFFE2_SPECIALIZED_TRANSPOSE(double)
 CAFFE2_SPECIALIZED_TRANSPOSE(int)
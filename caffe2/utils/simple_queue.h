@@ -20,6 +20,8 @@
 #include <condition_variable>  // NOLINT
 #include <mutex>  // NOLINT
 #include <queue>
+#include <tuple>
+#include <vector>
 
 #include "caffe2/core/logging.h"
 
@@ -90,6 +92,65 @@ class SimpleQueue {
   SimpleQueue(const SimpleQueue& /*src*/) {}
 };
 
+// Same as SimpleQueue, but Pop() returns the value with the highest priority
+// first. Values with equal priorities are popped in the order they were
+// pushed, so a queue whose values all have the same priority behaves exactly
+// like a SimpleQueue.
+template <typename T>
+class SimplePriorityQueue {
+ public:
+  SimplePriorityQueue() : no_more_jobs_(false), sequence_(0) {}
+
+  bool Pop(T* value) {
+    std::unique_lock<std::mutex> mutex_lock(mutex_);
+    while (queue_.size() == 0 && !no_more_jobs_) cv_.wait(mutex_lock);
+    if (queue_.size() == 0 && no_more_jobs_) return false;
+    *value = std::get<2>(queue_.top());
+    queue_.pop();
+    return true;
+  }
+
+  int size() {
+    std::unique_lock<std::mutex> mutex_lock(mutex_);
+    return queue_.size();
+  }
+
+  void Push(const T& value, double priority) {
+    {
+      std::lock_guard<std::mutex> mutex_lock(mutex_);
+      CAFFE_ENFORCE(!no_more_jobs_, "Cannot push to a closed queue.");
+      // Negating the sequence number makes earlier pushes win ties.
+      queue_.emplace(priority, -sequence_++, value);
+    }
+    cv_.notify_one();
+  }
+
+  void NoMoreJobs() {
+    {
+      std::lock_guard<std::mutex> mutex_lock(mutex_);
+      no_more_jobs_ = true;
+    }
+    cv_.notify_all();
+  }
+
+ private:
+  using Entry = std::tuple<double, int64_t, T>;
+  struct EntryLess {
+    bool operator()(const Entry& a, const Entry& b) const {
+      return std::get<0>(a) < std::get<0>(b) ||
+          (std::get<0>(a) == std::get<0>(b) && std::get<1>(a) < std::get<1>(b));
+    }
+  };
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::priority_queue<Entry, std::vector<Entry>, EntryLess> queue_;
+  bool no_more_jobs_;
+  int64_t sequence_;
+  // We do not allow copy constructors.
+  SimplePriorityQueue(const SimplePriorityQueue& /*src*/) {}
+};
+
 }  // namespace caffe2
 
 #endif  // CAFFE2_UTILS_SIMPLE_QUEUE_H_
@@ -82,6 +82,35 @@ TEST(SimpleQueueDeathTest, CannotAddAfterQueueFinished) {
   ASSERT_THROW(gQueue->Push(0), EnforceNotMet);
 }
 
+TEST(SimplePriorityQueueTest, PopsHighestPriorityFirst) {
+  SimplePriorityQueue<int> queue;
+  queue.Push(0, 1.0);
+  queue.Push(1, 3.0);
+  queue.Push(2, 2.0);
+  queue.Push(3, 3.0);
+  queue.NoMoreJobs();
+  int value;
+  std::vector<int> popped;
+  while (queue.Pop(&value)) {
+    popped.push_back(value);
+  }
+  // Ties are broken in push order.
+  EXPECT_EQ(popped, (std::vector<int>{1, 3, 2, 0}));
+}
+
+TEST(SimplePriorityQueueTest, EqualPrioritiesAreFifo) {
+  SimplePriorityQueue<int> queue;
+  for (int i = 0; i < 10; ++i) {
+    queue.Push(i, 0);
+  }
+  queue.NoMoreJobs();
+  int value;
+  for (int i = 0; i < 10; ++i) {
+    ASSERT_TRUE(queue.Pop(&value));
+    EXPECT_EQ(value, i);
+  }
+  EXPECT_FALSE(queue.Pop(&value));
+}
 
 }  // namespace caffe2
 
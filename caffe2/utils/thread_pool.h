@@ -26,7 +26,19 @@
 
 namespace caffe2 {
 
-class TaskThreadPool {
+// Interface of the task pools used by the async net executors.
+class TaskThreadPoolBase {
+ public:
+    virtual ~TaskThreadPoolBase() noexcept {}
+
+    /// @brief Schedules func to run on one of the pool threads.
+    virtual void run(const std::function<void()>& func) = 0;
+
+    /// @brief Number of threads in the pool.
+    virtual std::size_t size() const = 0;
+};
+
+class TaskThreadPool : public TaskThreadPoolBase {
  private:
     struct task_element_t {
         bool run_with_id;
@@ -89,10 +101,14 @@ class TaskThreadPool {
         condition_.notify_one();
     }
 
-    void run(const std::function<void()>& func) {
+    void run(const std::function<void()>& func) override {
       runTask(func);
     }
 
+    std::size_t size() const override {
+      return total_;
+    }
+
     template <typename Task>
     void runTaskWithID(Task task) {
       std::unique_lock<std::mutex> lock(mutex_);
@@ -31,7 +31,11 @@ CAFFE2_DEFINE_int(caffe2_threadpool_android_cap, true, "");
 // Whether or not threadpool caps apply to iOS
 CAFFE2_DEFINE_int(caffe2_threadpool_ios_cap, false, "");
 
-#if CAFFE2_THREADPOOL_MOBILE
+CAFFE2_DEFINE_int(
+    caffe2_threadpool_num_threads,
+    0,
+    "Number of threads of the default threadpool on non-mobile builds; "
+    "0 means the number of hardware threads.");
 
 namespace caffe2 {
 
@@ -39,6 +43,10 @@ namespace caffe2 {
 // multiple threads; the runtime value is configurable
 #if CAFFE2_ANDROID
 constexpr size_t kDefaultMinWorkSize = 8;
+#elif !CAFFE2_THREADPOOL_MOBILE
+// Server operators decide themselves whether their work is large enough to be
+// split, so every call with more than one unit of work is distributed.
+constexpr size_t kDefaultMinWorkSize = 2;
 #else
 constexpr size_t kDefaultMinWorkSize = 80;
 #endif
@@ -62,6 +70,10 @@ std::unique_ptr<ThreadPool> ThreadPool::defaultThreadPool() {
   applyCap = caffe2::FLAGS_caffe2_threadpool_android_cap;
 #elif CAFFE2_IOS
   applyCap = caffe2::FLAGS_caffe2_threadpool_ios_cap;
+#elif !CAFFE2_THREADPOOL_MOBILE
+  if (caffe2::FLAGS_caffe2_threadpool_num_threads > 0) {
+    numThreads = caffe2::FLAGS_caffe2_threadpool_num_threads;
+  }
 #else
 #error Undefined architecture
 #endif
@@ -118,7 +130,7 @@ ThreadPool::ThreadPool(int numThreads)
 ThreadPool::~ThreadPool() {}
 
 int ThreadPool::getNumThreads() const {
-  std::lock_guard<std::mutex> guard(executionMutex_);
+  // numThreads_ never changes, so this does not wait for a running job
   return numThreads_;
 }
 
@@ -132,6 +144,23 @@ void ThreadPool::setMinWorkSize(size_t size) {
 
 void ThreadPool::run(const std::function<void(int, size_t)>& fn, size_t range) {
   std::lock_guard<std::mutex> guard(executionMutex_);
+  runLocked(fn, range);
+}
+
+bool ThreadPool::tryRun(
+    const std::function<void(int, size_t)>& fn,
+    size_t range) {
+  std::unique_lock<std::mutex> guard(executionMutex_, std::try_to_lock);
+  if (!guard.owns_lock()) {
+    return false;
+  }
+  runLocked(fn, range);
+  return true;
+}
+
+void ThreadPool::runLocked(
+    const std::function<void(int, size_t)>& fn,
+    size_t range) {
   // If there are no worker threads, or if the range is too small (too
   // little work), just run locally
   const bool runLocally = range < minWorkSize_ ||
@@ -185,5 +214,3 @@ void ThreadPool::run(const std::function<void(int, size_t)>& fn, size_t range) {
 }
 
 } // namespace caffe2
-
-#endif // CAFFE2_THREADPOOL_MOBILE
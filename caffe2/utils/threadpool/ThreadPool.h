@@ -23,9 +23,7 @@
 #error "mobile build state not defined"
 #endif
 
-// ThreadPool only used in mobile builds at the moment
-#if CAFFE2_THREADPOOL_MOBILE
-
+#include <functional>
 #include <memory>
 #include <mutex>
 #include <vector>
@@ -57,17 +55,21 @@ class alignas(kCacheLineSize) ThreadPool {
   void setMinWorkSize(size_t size);
   size_t getMinWorkSize() const { return minWorkSize_; }
   void run(const std::function<void(int, size_t)>& fn, size_t range);
+  // Same as run, but returns false without running anything if another
+  // thread is running work on the pool, instead of waiting for it
+  bool tryRun(const std::function<void(int, size_t)>& fn, size_t range);
 
 private:
+  // Runs fn with executionMutex_ held
+  void runLocked(const std::function<void(int, size_t)>& fn, size_t range);
+
   mutable std::mutex executionMutex_;
   size_t minWorkSize_;
-  size_t numThreads_;
+  const size_t numThreads_;
   std::shared_ptr<WorkersPool> workersPool_;
   std::vector<std::shared_ptr<Task>> tasks_;
 };
 
 } // namespace caffe2
 
-#endif // CAFFE2_THREADPOOL_MOBILE
-
 #endif // CAFFE2_UTILS_THREADPOOL_H_
@@ -0,0 +1,126 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "caffe2/utils/work_stealing_thread_pool.h"
+
+namespace caffe2 {
+
+namespace {
+// The pool and worker index of the calling thread, if it is a pool worker.
+thread_local const WorkStealingThreadPool* tls_pool = nullptr;
+thread_local std::size_t tls_worker_index = 0;
+} // namespace
+
+WorkStealingThreadPool::WorkStealingThreadPool(
+    std::size_t pool_size,
+    std::size_t deque_capacity) {
+  deques_.reserve(pool_size);
+  for (std::size_t i = 0; i < pool_size; ++i) {
+    deques_.emplace_back(new WorkStealingDeque<Task>(deque_capacity));
+  }
+  threads_.reserve(pool_size);
+  for (std::size_t i = 0; i < pool_size; ++i) {
+    threads_.emplace_back(&WorkStealingThreadPool::main_loop, this, i);
+  }
+}
+
+WorkStealingThreadPool::~WorkStealingThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    running_ = false;
+    condition_.notify_all();
+  }
+  for (auto& t : threads_) {
+    t.join();
+  }
+}
+
+void WorkStealingThreadPool::run(const std::function<void()>& func) {
+  auto* task = new Task(func);
+  // Count the task before publishing it so that pending_ never goes
+  // negative when a worker grabs it right away.
+  ++pending_;
+  if (!(tls_pool == this && deques_[tls_worker_index]->Push(task))) {
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    queue_.push(task);
+  }
+  if (sleeping_ > 0) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    condition_.notify_one();
+  }
+}
+
+WorkStealingThreadPool::Task* WorkStealingThreadPool::findTask(
+    std::size_t index) {
+  Task* task = deques_[index]->Pop();
+  if (task) {
+    return task;
+  }
+  {
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    if (!queue_.empty()) {
+      task = queue_.front();
+      queue_.pop();
+      return task;
+    }
+  }
+  const std::size_t num_workers = deques_.size();
+  for (std::size_t i = 1; i < num_workers; ++i) {
+    task = deques_[(index + i) % num_workers]->Steal();
+    if (task) {
+      return task;
+    }
+  }
+  return nullptr;
+}
+
+void WorkStealingThreadPool::main_loop(std::size_t index) {
+  tls_pool = this;
+  tls_worker_index = index;
+  while (true) {
+    Task* task = findTask(index);
+    if (task) {
+      --pending_;
+      try {
+        (*task)();
+      }
+      // Suppress all exceptions, same as TaskThreadPool.
+      catch (const std::exception&) {
+      }
+      delete task;
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (pending_ > 0) {
+      // A task is being published or stolen by someone else; try again.
+      lock.unlock();
+      std::this_thread::yield();
+      continue;
+    }
+    if (!running_) {
+      break;
+    }
+    ++sleeping_;
+    while (pending_ == 0 && running_) {
+      condition_.wait(lock);
+    }
+    --sleeping_;
+  }
+  tls_pool = nullptr;
+}
+
+} // namespace caffe2
@@ -0,0 +1,149 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CAFFE2_UTILS_WORK_STEALING_THREAD_POOL_H_
+#define CAFFE2_UTILS_WORK_STEALING_THREAD_POOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+#include "caffe2/utils/thread_pool.h"
+
+namespace caffe2 {
+
+// A bounded Chase-Lev work-stealing deque of task pointers (see "Correct and
+// Efficient Work-Stealing for Weak Memory Models", Le et al., PPoPP'13).
+// Only the owning thread may call Push and Pop, which work on the bottom end;
+// any thread may call Steal, which takes from the top end.
+template <typename T>
+class WorkStealingDeque {
+ public:
+  // capacity must be a power of two.
+  explicit WorkStealingDeque(std::size_t capacity)
+      : mask_(capacity - 1), buffer_(new std::atomic<T*>[capacity]) {}
+
+  // Returns false if the deque is full.
+  bool Push(T* item) {
+    int64_t b = bottom_.load(std::memory_order_relaxed);
+    int64_t t = top_.load(std::memory_order_acquire);
+    if (b - t > int64_t(mask_)) {
+      return false;
+    }
+    buffer_[b & mask_].store(item, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    bottom_.store(b + 1, std::memory_order_relaxed);
+    return true;
+  }
+
+  // Returns nullptr if the deque is empty.
+  T* Pop() {
+    int64_t b = bottom_.load(std::memory_order_relaxed) - 1;
+    bottom_.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t t = top_.load(std::memory_order_relaxed);
+    if (t > b) {
+      bottom_.store(b + 1, std::memory_order_relaxed);
+      return nullptr;
+    }
+    T* item = buffer_[b & mask_].load(std::memory_order_relaxed);
+    if (t == b) {
+      // Last item: race against concurrent thieves.
+      if (!top_.compare_exchange_strong(
+              t,
+              t + 1,
+              std::memory_order_seq_cst,
+              std::memory_order_relaxed)) {
+        item = nullptr;
+      }
+      bottom_.store(b + 1, std::memory_order_relaxed);
+    }
+    return item;
+  }
+
+  // Returns nullptr if the deque is empty or another thread won the race.
+  T* Steal() {
+    int64_t t = top_.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t b = bottom_.load(std::memory_order_acquire);
+    if (t >= b) {
+      return nullptr;
+    }
+    T* item = buffer_[t & mask_].load(std::memory_order_relaxed);
+    if (!top_.compare_exchange_strong(
+            t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+      return nullptr;
+    }
+    return item;
+  }
+
+ private:
+  const std::size_t mask_;
+  std::unique_ptr<std::atomic<T*>[]> buffer_;
+  std::atomic<int64_t> top_{0};
+  std::atomic<int64_t> bottom_{0};
+};
+
+// A task pool where every worker owns a work-stealing deque. Tasks submitted
+// from a worker of the pool (e.g. a finishing chain scheduling its children)
+// go to the bottom of that worker's own deque and are picked up by the same
+// thread next, keeping data hot in its caches. Tasks submitted from outside
+// go to a shared queue. Idle workers steal from the top of other workers'
+// deques before going to sleep.
+class WorkStealingThreadPool final : public TaskThreadPoolBase {
+ public:
+  explicit WorkStealingThreadPool(
+      std::size_t pool_size,
+      std::size_t deque_capacity = 4096);
+  ~WorkStealingThreadPool() override;
+
+  void run(const std::function<void()>& func) override;
+
+  std::size_t size() const override {
+    return threads_.size();
+  }
+
+ private:
+  using Task = std::function<void()>;
+
+  void main_loop(std::size_t index);
+  Task* findTask(std::size_t index);
+
+  std::vector<std::unique_ptr<WorkStealingDeque<Task>>> deques_;
+  std::vector<std::thread> threads_;
+
+  std::mutex queue_mutex_;
+  std::queue<Task*> queue_;
+
+  // Number of submitted tasks not yet taken by a worker, and number of
+  // workers waiting on condition_. Used to put idle workers to sleep without
+  // missing wakeups.
+  std::atomic<int64_t> pending_{0};
+  std::atomic<int> sleeping_{0};
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  std::atomic<bool> running_{true};
+};
+
+} // namespace caffe2
+
+#endif // CAFFE2_UTILS_WORK_STEALING_THREAD_POOL_H_
@@ -0,0 +1,92 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <atomic>
+#include <thread>  // NOLINT
+
+#include "caffe2/utils/work_stealing_thread_pool.h"
+#include <gtest/gtest.h>
+
+namespace caffe2 {
+
+TEST(WorkStealingDequeTest, PushPopSteal) {
+  WorkStealingDeque<int> deque(4);
+  int items[5] = {0, 1, 2, 3, 4};
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_TRUE(deque.Push(&items[i]));
+  }
+  EXPECT_FALSE(deque.Push(&items[4]));
+  // Owner pops LIFO, thieves steal FIFO.
+  EXPECT_EQ(deque.Pop(), &items[3]);
+  EXPECT_EQ(deque.Steal(), &items[0]);
+  EXPECT_EQ(deque.Pop(), &items[2]);
+  EXPECT_EQ(deque.Pop(), &items[1]);
+  EXPECT_EQ(deque.Pop(), nullptr);
+  EXPECT_EQ(deque.Steal(), nullptr);
+}
+
+TEST(WorkStealingDequeTest, ConcurrentSteal) {
+  const int kNumItems = 100000;
+  WorkStealingDeque<int> deque(1 << 17);
+  std::vector<int> items(kNumItems);
+  for (int i = 0; i < kNumItems; ++i) {
+    items[i] = 1;
+    EXPECT_TRUE(deque.Push(&items[i]));
+  }
+  std::atomic<int> taken(0);
+  std::vector<std::thread> thieves;
+  for (int t = 0; t < 4; ++t) {
+    thieves.emplace_back([&]() {
+      while (taken < kNumItems) {
+        int* item = deque.Steal();
+        if (item) {
+          taken += *item;
+          *item = 0;
+        }
+      }
+    });
+  }
+  while (taken < kNumItems) {
+    int* item = deque.Pop();
+    if (item) {
+      taken += *item;
+      *item = 0;
+    }
+  }
+  for (auto& thief : thieves) {
+    thief.join();
+  }
+  // Every item was taken exactly once.
+  EXPECT_EQ(taken, kNumItems);
+}
+
+TEST(WorkStealingThreadPoolTest, RunsAllTasks) {
+  std::atomic<int> count(0);
+  {
+    WorkStealingThreadPool pool(4);
+    EXPECT_EQ(pool.size(), 4);
+    for (int i = 0; i < 1000; ++i) {
+      pool.run([&count, &pool]() {
+        // Tasks scheduled from workers go to the local deque.
+        pool.run([&count]() { ++count; });
+        ++count;
+      });
+    }
+  }
+  EXPECT_EQ(count, 2000);
+}
+
+} // namespace caffe2